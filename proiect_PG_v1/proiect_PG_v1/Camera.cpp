@@ -26,26 +26,25 @@ namespace gps {
 
     //update the camera internal parameters following a camera move event
     void Camera::move(MOVE_DIRECTION direction, float speed) {
+        cameraPosition += getMoveOffset(direction, speed);
+    }
+
+    glm::vec3 Camera::getMoveOffset(MOVE_DIRECTION direction, float speed) {
         switch (direction) {
         case MOVE_FORWARD:
-            cameraPosition += cameraFrontDirection * speed;
-            break;
+            return cameraFrontDirection * speed;
         case MOVE_BACKWARD:
-            cameraPosition -= cameraFrontDirection * speed;
-            break;
+            return -cameraFrontDirection * speed;
         case MOVE_RIGHT:
-            cameraPosition += cameraRightDirection * speed;
-            break;
+            return cameraRightDirection * speed;
         case MOVE_LEFT:
-            cameraPosition -= cameraRightDirection * speed;
-            break;
+            return -cameraRightDirection * speed;
         case MOVE_UP:
-            cameraPosition += cameraUpDirection * speed;
-            break;
+            return cameraUpDirection * speed;
         case MOVE_DOWN:
-            cameraPosition -= cameraUpDirection * speed;
-            break;
+            return -cameraUpDirection * speed;
         }
+        return glm::vec3(0.0f);
     }
 
     //update the camera internal parameters following a camera rotate event
@@ -63,4 +62,12 @@ namespace gps {
         // Recalculate the Right vector to ensure it remains perpendicular
         this->cameraRightDirection = glm::normalize(glm::cross(cameraFrontDirection, cameraUpDirection));
     }
+
+    glm::vec3 Camera::getPosition() {
+        return this->cameraPosition;
+    }
+
+    void Camera::setPosition(glm::vec3 position) {
+        this->cameraPosition = position;
+    }
 }
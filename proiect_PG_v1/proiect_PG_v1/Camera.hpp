@@ -17,10 +17,15 @@ namespace gps {
         glm::mat4 getViewMatrix();
         //update the camera internal parameters following a camera move event
         void move(MOVE_DIRECTION direction, float speed);
+        //the displacement move() would apply, for moves checked against the scene first
+        glm::vec3 getMoveOffset(MOVE_DIRECTION direction, float speed);
         //update the camera internal parameters following a camera rotate event
         //yaw - camera rotation around the y axis
         //pitch - camera rotation around the x axis
         void rotate(float pitch, float yaw);
+        //camera position in world space, used by recorded camera paths
+        glm::vec3 getPosition();
+        void setPosition(glm::vec3 position);
         
     private:
         glm::vec3 cameraPosition;
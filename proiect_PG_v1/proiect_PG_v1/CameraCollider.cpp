@@ -0,0 +1,356 @@
+#include "CameraCollider.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace gps {
+
+    // the castle floor is one unit below the start position
+    const float CameraCollider::EYE_HEIGHT = 1.0f;
+    const float CameraCollider::STEP_HEIGHT = 0.35f;
+    const float CameraCollider::GRAVITY = 9.81f;
+    const float CameraCollider::JUMP_SPEED = 4.0f;
+
+    // kept between the sphere and what it touches, so the next sweep does not start inside it
+    static const float SKIN = 1e-3f;
+    // longer frames (a breakpoint, a window drag) would drop through thin floors
+    static const float MAX_FRAME_SECONDS = 0.1f;
+
+    static const glm::vec3 UP = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    static glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+
+        // Voronoi regions of the corners, then of the edges, else the face (Ericson, 5.1.5)
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ap = p - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) {
+            return a;
+        }
+
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) {
+            return b;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) {
+            return c;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        float denominator = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+
+    // Smallest root of a x^2 + b x + c in [0, maxRoot)
+    static bool lowestRoot(float a, float b, float c, float maxRoot, float& root) {
+
+        if (std::fabs(a) < 1e-12f) {
+            return false;
+        }
+
+        float determinant = b * b - 4.0f * a * c;
+        if (determinant < 0.0f) {
+            return false;
+        }
+
+        float squareRoot = std::sqrt(determinant);
+        float root1 = (-b - squareRoot) / (2.0f * a);
+        float root2 = (-b + squareRoot) / (2.0f * a);
+        if (root1 > root2) {
+            std::swap(root1, root2);
+        }
+
+        if (root1 >= 0.0f && root1 < maxRoot) {
+            root = root1;
+            return true;
+        }
+        if (root2 >= 0.0f && root2 < maxRoot) {
+            root = root2;
+            return true;
+        }
+        return false;
+    }
+
+    // Lowers t (a fraction of velocity) to where a sphere moving from center first touches triangle abc,
+    // contact is the touching point on the triangle
+    static bool sweepSphereTriangle(const glm::vec3& center, const glm::vec3& velocity, float radius,
+        const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t, glm::vec3& contact) {
+
+        glm::vec3 faceNormal = glm::cross(b - a, c - a);
+        float normalLength = glm::length(faceNormal);
+        if (normalLength < 1e-12f) {
+            return false;
+        }
+        faceNormal = faceNormal / normalLength;
+
+        // already touching: only moving further in is stopped
+        glm::vec3 closest = closestPointOnTriangle(center, a, b, c);
+        glm::vec3 away = center - closest;
+        if (glm::dot(away, away) < radius * radius) {
+            if (glm::dot(velocity, away) >= 0.0f) {
+                return false;
+            }
+            t = 0.0f;
+            contact = closest;
+            return true;
+        }
+
+        // the face, from the side the sphere is on
+        glm::vec3 normal = faceNormal;
+        float distance = glm::dot(center - a, normal);
+        if (distance < 0.0f) {
+            normal = -normal;
+            distance = -distance;
+        }
+
+        float normalSpeed = glm::dot(velocity, normal);
+        if (normalSpeed < 0.0f) {
+
+            float planeT = (distance - radius) / -normalSpeed;
+            if (planeT >= 0.0f && planeT < t) {
+
+                glm::vec3 point = center + velocity * planeT - normal * radius;
+                if (glm::dot(glm::cross(b - a, point - a), faceNormal) >= 0.0f
+                    && glm::dot(glm::cross(c - b, point - b), faceNormal) >= 0.0f
+                    && glm::dot(glm::cross(a - c, point - c), faceNormal) >= 0.0f) {
+                    // nothing on the triangle is reached before its plane
+                    t = planeT;
+                    contact = point;
+                    return true;
+                }
+            }
+        }
+
+        // otherwise a corner or an edge comes first, if anything
+        bool found = false;
+        float speedSquared = glm::dot(velocity, velocity);
+        const glm::vec3* vertices[3] = { &a, &b, &c };
+
+        for (int i = 0; i < 3; i++) {
+
+            const glm::vec3& vertex = *vertices[i];
+            float root;
+            if (lowestRoot(speedSquared, 2.0f * glm::dot(velocity, center - vertex),
+                glm::dot(vertex - center, vertex - center) - radius * radius, t, root)) {
+                t = root;
+                contact = vertex;
+                found = true;
+            }
+        }
+
+        for (int i = 0; i < 3; i++) {
+
+            const glm::vec3& start = *vertices[i];
+            glm::vec3 edge = *vertices[(i + 1) % 3] - start;
+            glm::vec3 toStart = start - center;
+            float edgeSquared = glm::dot(edge, edge);
+            float edgeDotVelocity = glm::dot(edge, velocity);
+            float edgeDotToStart = glm::dot(edge, toStart);
+
+            float root;
+            if (lowestRoot(edgeSquared * -speedSquared + edgeDotVelocity * edgeDotVelocity,
+                edgeSquared * 2.0f * glm::dot(velocity, toStart) - 2.0f * edgeDotVelocity * edgeDotToStart,
+                edgeSquared * (radius * radius - glm::dot(toStart, toStart)) + edgeDotToStart * edgeDotToStart, t, root)) {
+
+                // where along the edge
+                float f = (edgeDotVelocity * root - edgeDotToStart) / edgeSquared;
+                if (f >= 0.0f && f <= 1.0f) {
+                    t = root;
+                    contact = start + edge * f;
+                    found = true;
+                }
+            }
+        }
+
+        return found;
+    }
+
+    CameraCollider::CameraCollider() : scene(nullptr), verticalSpeed(0.0f), onGround(false), milliseconds(0.0), testedTriangles(0) {
+    }
+
+    void CameraCollider::setScene(gps::SceneBVH* scene) {
+
+        this->scene = scene;
+    }
+
+    glm::vec3 CameraCollider::sweep(const glm::vec3& center, const glm::vec3& offset, float radius, int maxSlides, bool& blocked) {
+
+        blocked = false;
+        float length = glm::length(offset);
+        if (scene == nullptr || length < 1e-6f) {
+            return center + offset;
+        }
+
+        // a straight sweep stays in the box around its ends, sliding never goes further than the move
+        glm::vec3 boundsMin = glm::min(center, center + offset);
+        glm::vec3 boundsMax = glm::max(center, center + offset);
+        if (maxSlides > 1) {
+            boundsMin = center - glm::vec3(length);
+            boundsMax = center + glm::vec3(length);
+        }
+        glm::vec3 margin = glm::vec3(radius + SKIN);
+        corners.clear();
+        scene->collectTriangles(boundsMin - margin, boundsMax + margin, corners);
+        testedTriangles += (int)(corners.size() / 3);
+
+        glm::vec3 position = center;
+        glm::vec3 velocity = offset;
+
+        for (int slide = 0; slide < maxSlides; slide++) {
+
+            float speed = glm::length(velocity);
+            if (speed < 1e-6f) {
+                break;
+            }
+
+            float t = 1.0f;
+            glm::vec3 contact;
+            bool hit = false;
+            for (size_t i = 0; i < corners.size(); i += 3) {
+                hit |= sweepSphereTriangle(position, velocity, radius, corners[i], corners[i + 1], corners[i + 2], t, contact);
+            }
+
+            if (!hit) {
+                position += velocity;
+                break;
+            }
+
+            blocked = true;
+            glm::vec3 touching = position + velocity * t;
+            position += velocity * (std::max(t * speed - SKIN, 0.0f) / speed);
+
+            // continue along the plane tangent to the sphere at the contact
+            glm::vec3 normal = touching - contact;
+            float normalLength = glm::length(normal);
+            if (normalLength < 1e-6f) {
+                break;
+            }
+            normal = normal / normalLength;
+
+            velocity = velocity * (1.0f - t);
+            velocity -= normal * glm::dot(velocity, normal);
+        }
+
+        return position;
+    }
+
+    glm::vec3 CameraCollider::slide(const glm::vec3& center, const glm::vec3& offset, float radius) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        testedTriangles = 0;
+
+        bool blocked;
+        glm::vec3 position = sweep(center, offset, radius, MAX_SLIDES, blocked);
+
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return position;
+    }
+
+    glm::vec3 CameraCollider::walk(const glm::vec3& eye, const glm::vec3& offset, float radius, bool jump, float seconds) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        testedTriangles = 0;
+        seconds = std::min(seconds, MAX_FRAME_SECONDS);
+
+        // the sphere rests on the feet
+        glm::vec3 feetToCenter = UP * (radius - EYE_HEIGHT);
+        glm::vec3 center = eye + feetToCenter;
+
+        // looking down does not slow the walk
+        glm::vec3 horizontal = offset - UP * glm::dot(offset, UP);
+        float horizontalLength = glm::length(horizontal);
+        if (horizontalLength > 1e-6f) {
+            horizontal = horizontal * (glm::length(offset) / horizontalLength);
+        }
+
+        if (onGround && jump) {
+            verticalSpeed = JUMP_SPEED;
+            onGround = false;
+        }
+        verticalSpeed -= GRAVITY * seconds;
+
+        bool blocked;
+        bool wasOnGround = onGround;
+
+        // up a step: lift, move, set down
+        float lifted = 0.0f;
+        if (wasOnGround) {
+            glm::vec3 raised = sweep(center, UP * STEP_HEIGHT, radius, 1, blocked);
+            lifted = glm::dot(raised - center, UP);
+            center = raised;
+        }
+
+        center = sweep(center, horizontal, radius, MAX_SLIDES, blocked);
+
+        float rise = verticalSpeed * seconds;
+        if (rise > 0.0f) {
+            glm::vec3 raised = sweep(center, UP * rise, radius, 1, blocked);
+            if (blocked) {
+                // head against a ceiling
+                verticalSpeed = 0.0f;
+            }
+            center = raised;
+            rise = 0.0f;
+        }
+
+        // back down, on the ground by as much as a step so walking down stairs does not float
+        float drop = lifted - rise + (wasOnGround ? STEP_HEIGHT : 0.0f);
+        glm::vec3 lowered = sweep(center, -UP * drop, radius, 1, blocked);
+        if (!blocked && wasOnGround) {
+            // walked off a ledge: fall from here instead of snapping down
+            lowered = sweep(center, -UP * (lifted - verticalSpeed * seconds), radius, 1, blocked);
+        }
+
+        onGround = blocked && verticalSpeed <= 0.0f;
+        if (onGround) {
+            verticalSpeed = 0.0f;
+        }
+
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return lowered - feetToCenter;
+    }
+
+    bool CameraCollider::isOnGround() {
+
+        return onGround;
+    }
+
+    void CameraCollider::resetWalk() {
+
+        verticalSpeed = 0.0f;
+        onGround = false;
+    }
+
+    double CameraCollider::getMilliseconds() {
+
+        return milliseconds;
+    }
+
+    int CameraCollider::getTestedTriangles() {
+
+        return testedTriangles;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef CameraCollider_hpp
+#define CameraCollider_hpp
+
+#include "SceneBVH.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    // Keeps the camera out of the scene: a sphere is swept along each move against the triangles
+    // the SceneBVH finds around it, stops at the first one it touches and slides along it with what
+    // is left of the move (up to MAX_SLIDES times). Triangles count from both faces.
+    // Walking puts the sphere at the feet of an eye EYE_HEIGHT above the ground, adds gravity and
+    // climbs steps up to STEP_HEIGHT by lifting the sphere before the move and setting it down after.
+    class CameraCollider {
+
+    public:
+        static const int MAX_SLIDES = 4;
+        static const float EYE_HEIGHT;     // above the feet
+        static const float STEP_HEIGHT;    // highest ledge walked onto
+        static const float GRAVITY;        // units per second squared
+        static const float JUMP_SPEED;     // units per second
+
+        CameraCollider();
+
+        void setScene(gps::SceneBVH* scene);
+
+        // Where a sphere of radius ends up moving from center by offset
+        glm::vec3 slide(const glm::vec3& center, const glm::vec3& offset, float radius);
+
+        // Eye position after walking by the horizontal part of offset for a frame of seconds,
+        // jump only counts on the ground
+        glm::vec3 walk(const glm::vec3& eye, const glm::vec3& offset, float radius, bool jump, float seconds);
+        bool isOnGround();
+        // Starts the next walk standing still, as if just dropped
+        void resetWalk();
+
+        // Of the last slide or walk
+        double getMilliseconds();
+        int getTestedTriangles();
+
+    private:
+        gps::SceneBVH* scene;
+        std::vector<glm::vec3> corners;
+        float verticalSpeed;
+        bool onGround;
+        double milliseconds;
+        int testedTriangles;
+
+        // blocked tells whether the sphere touched something on the way
+        glm::vec3 sweep(const glm::vec3& center, const glm::vec3& offset, float radius, int maxSlides, bool& blocked);
+    };
+}
+
+#endif /* CameraCollider_hpp */
@@ -0,0 +1,271 @@
+#include "CameraPath.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gps {
+
+    const float CameraPath::FIXED_TIMESTEP = 1.0f / 60.0f;
+
+    static CameraPose catmullRom(const CameraPose& p0, const CameraPose& p1, const CameraPose& p2, const CameraPose& p3, float t) {
+
+        // uniform Catmull-Rom, passes through p1 at t = 0 and p2 at t = 1
+        float t2 = t * t;
+        float t3 = t2 * t;
+        float w0 = -0.5f * t3 + t2 - 0.5f * t;
+        float w1 = 1.5f * t3 - 2.5f * t2 + 1.0f;
+        float w2 = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+        float w3 = 0.5f * t3 - 0.5f * t2;
+
+        CameraPose pose;
+        pose.position = w0 * p0.position + w1 * p1.position + w2 * p2.position + w3 * p3.position;
+        pose.yaw = w0 * p0.yaw + w1 * p1.yaw + w2 * p2.yaw + w3 * p3.yaw;
+        pose.pitch = w0 * p0.pitch + w1 * p1.pitch + w2 * p2.pitch + w3 * p3.pitch;
+        pose.lightAngle = w0 * p0.lightAngle + w1 * p1.lightAngle + w2 * p2.lightAngle + w3 * p3.lightAngle;
+        pose.pitch = std::min(std::max(pose.pitch, -89.0f), 89.0f);
+
+        return pose;
+    }
+
+    bool CameraPath::load(std::string fileName) {
+
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not open camera path " << fileName << std::endl;
+            return false;
+        }
+
+        clear();
+
+        std::string line;
+        int lineNumber = 0;
+
+        while (std::getline(file, line)) {
+
+            lineNumber++;
+            std::istringstream stream(line);
+            std::string type;
+
+            if (!(stream >> type) || type[0] == '#') {
+                continue;
+            }
+
+            CameraPose pose;
+
+            if (type == "pose") {
+
+                if (stream >> pose.position.x >> pose.position.y >> pose.position.z >> pose.yaw >> pose.pitch >> pose.lightAngle) {
+                    poses.push_back(pose);
+                    continue;
+                }
+            }
+            else if (type == "key") {
+
+                Keyframe key;
+                if (stream >> key.time >> pose.position.x >> pose.position.y >> pose.position.z >> pose.yaw >> pose.pitch >> pose.lightAngle) {
+
+                    key.pose = pose;
+                    keys.push_back(key);
+
+                    std::string name;
+                    if (stream >> name) {
+                        keyNames.push_back(name);
+                    }
+                    else {
+                        keyNames.push_back("");
+                    }
+                    continue;
+                }
+            }
+
+            std::cerr << fileName << ":" << lineNumber << ": bad camera path entry" << std::endl;
+            return false;
+        }
+
+        if (!poses.empty() && !keys.empty()) {
+            std::cerr << fileName << ": a camera path has either poses or keys" << std::endl;
+            return false;
+        }
+
+        for (size_t i = 1; i < keys.size(); i++) {
+
+            if (keys[i].time <= keys[i - 1].time) {
+                std::cerr << fileName << ": key times must increase" << std::endl;
+                return false;
+            }
+        }
+
+        buildSegments();
+
+        std::cout << "Camera path " << fileName << ": " << getFrameCount() << " frames, "
+            << segments.size() << " segments" << std::endl;
+        return getFrameCount() > 0;
+    }
+
+    void CameraPath::clear() {
+
+        poses.clear();
+        keys.clear();
+        keyNames.clear();
+        segments.clear();
+    }
+
+    void CameraPath::addPose(const CameraPose& pose) {
+
+        poses.push_back(pose);
+    }
+
+    bool CameraPath::save(std::string fileName) {
+
+        FILE* file = fopen(fileName.c_str(), "w");
+        if (!file) {
+            std::cerr << "Could not write camera path " << fileName << std::endl;
+            return false;
+        }
+
+        fprintf(file, "# recorded camera path, one pose per frame: pose x y z yaw pitch lightAngle\n");
+        for (size_t i = 0; i < poses.size(); i++) {
+            // %.9g round trips a float exactly, the playback renders the same pixels
+            fprintf(file, "pose %.9g %.9g %.9g %.9g %.9g %.9g\n", poses[i].position.x, poses[i].position.y, poses[i].position.z,
+                poses[i].yaw, poses[i].pitch, poses[i].lightAngle);
+        }
+
+        fclose(file);
+        std::cout << "Camera path: " << poses.size() << " poses saved to " << fileName << std::endl;
+        return true;
+    }
+
+    int CameraPath::getFrameCount() {
+
+        if (!poses.empty()) {
+            return (int)poses.size();
+        }
+
+        if (keys.empty()) {
+            return 0;
+        }
+
+        // one frame at every fixed timestep from the first key to the last one, both included
+        float duration = keys.back().time - keys.front().time;
+        return (int)(duration / FIXED_TIMESTEP + 0.5f) + 1;
+    }
+
+    CameraPose CameraPath::getPose(int frame) {
+
+        if (!poses.empty()) {
+            return poses[std::min(std::max(frame, 0), (int)poses.size() - 1)];
+        }
+
+        return interpolate(keys.front().time + frame * FIXED_TIMESTEP);
+    }
+
+    CameraPose CameraPath::interpolate(float time) {
+
+        if (keys.size() == 1 || time <= keys.front().time) {
+            return keys.front().pose;
+        }
+        if (time >= keys.back().time) {
+            return keys.back().pose;
+        }
+
+        size_t k = 0;
+        while (k + 2 < keys.size() && keys[k + 1].time <= time) {
+            k++;
+        }
+
+        // the end keys are repeated so the spline still reaches them
+        const CameraPose& p0 = keys[k > 0 ? k - 1 : k].pose;
+        const CameraPose& p1 = keys[k].pose;
+        const CameraPose& p2 = keys[k + 1].pose;
+        const CameraPose& p3 = keys[k + 2 < keys.size() ? k + 2 : k + 1].pose;
+
+        float t = (time - keys[k].time) / (keys[k + 1].time - keys[k].time);
+        return catmullRom(p0, p1, p2, p3, t);
+    }
+
+    void CameraPath::buildSegments() {
+
+        segments.clear();
+        int frameCount = getFrameCount();
+
+        if (!keys.empty()) {
+
+            // a segment from every key to the next, a single key is a one frame segment
+            size_t segmentCount = keys.size() > 1 ? keys.size() - 1 : 1;
+
+            for (size_t k = 0; k < segmentCount; k++) {
+
+                CameraPathSegment segment;
+                segment.name = keyNames[k].empty() ? "key " + std::to_string(k) : keyNames[k];
+                segment.firstFrame = (int)((keys[k].time - keys.front().time) / FIXED_TIMESTEP + 0.5f);
+                segments.push_back(segment);
+            }
+        }
+        else {
+
+            for (int first = 0; first < frameCount; first += RECORDED_SEGMENT_FRAMES) {
+
+                CameraPathSegment segment;
+                int last = std::min(first + RECORDED_SEGMENT_FRAMES, frameCount) - 1;
+                segment.name = "frames " + std::to_string(first) + "-" + std::to_string(last);
+                segment.firstFrame = first;
+                segments.push_back(segment);
+            }
+        }
+
+        for (size_t i = 0; i < segments.size(); i++) {
+
+            int end = i + 1 < segments.size() ? segments[i + 1].firstFrame : frameCount;
+            segments[i].frameCount = end - segments[i].firstFrame;
+        }
+
+        resetTimings();
+    }
+
+    int CameraPath::getSegmentIndex(int frame) {
+
+        int index = 0;
+        while (index + 1 < (int)segments.size() && segments[index + 1].firstFrame <= frame) {
+            index++;
+        }
+
+        return index;
+    }
+
+    void CameraPath::addFrameTime(int frame, double milliseconds) {
+
+        if (segments.empty()) {
+            return;
+        }
+
+        CameraPathSegment& segment = segments[getSegmentIndex(frame)];
+        segment.totalMilliseconds += milliseconds;
+        segment.timedFrames++;
+    }
+
+    void CameraPath::addCulledMeshes(int frame, int count) {
+
+        if (segments.empty()) {
+            return;
+        }
+
+        segments[getSegmentIndex(frame)].culledMeshes += count;
+    }
+
+    std::vector<CameraPathSegment> CameraPath::getSegments() {
+
+        return segments;
+    }
+
+    void CameraPath::resetTimings() {
+
+        for (size_t i = 0; i < segments.size(); i++) {
+            segments[i].totalMilliseconds = 0.0;
+            segments[i].timedFrames = 0;
+            segments[i].culledMeshes = 0;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef CameraPath_hpp
+#define CameraPath_hpp
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    struct CameraPose {
+
+        glm::vec3 position;
+        float yaw;          // degrees, as in mouseCallback
+        float pitch;
+        float lightAngle;
+    };
+
+    struct CameraPathSegment {
+
+        std::string name;
+        int firstFrame;
+        int frameCount;
+        double totalMilliseconds; // filled by addFrameTime
+        int timedFrames;
+        long long culledMeshes;   // filled by addCulledMeshes
+    };
+
+    // A camera path played back one pose per frame at a fixed timestep, whatever the real frame rate,
+    // so two runs render exactly the same images. Path files are text, one entry per line:
+    //   pose <x> <y> <z> <yaw> <pitch> <lightAngle>                  recorded, one per frame
+    //   key <time> <x> <y> <z> <yaw> <pitch> <lightAngle> [name]     authored keyframe, Catmull-Rom between keys
+    // A path holds either poses or keys. Keys split the path into segments (named by the key that
+    // starts them), recordings are split every RECORDED_SEGMENT_FRAMES frames.
+    class CameraPath {
+
+    public:
+        static const float FIXED_TIMESTEP;
+        static const int RECORDED_SEGMENT_FRAMES = 120;
+
+        bool load(std::string fileName);
+
+        // Recording: one pose per rendered frame, written by save
+        void clear();
+        void addPose(const CameraPose& pose);
+        bool save(std::string fileName);
+
+        int getFrameCount();
+        CameraPose getPose(int frame);
+
+        // Per segment frame times, e.g. to see which viewpoints are expensive
+        int getSegmentIndex(int frame);
+        void addFrameTime(int frame, double milliseconds);
+        void addCulledMeshes(int frame, int count);
+        std::vector<CameraPathSegment> getSegments();
+        void resetTimings();
+
+    private:
+        struct Keyframe {
+
+            float time;
+            CameraPose pose;
+        };
+
+        std::vector<CameraPose> poses;
+        std::vector<Keyframe> keys;
+        std::vector<std::string> keyNames;
+        std::vector<CameraPathSegment> segments;
+
+        void buildSegments();
+        CameraPose interpolate(float time);
+    };
+}
+
+#endif /* CameraPath_hpp */
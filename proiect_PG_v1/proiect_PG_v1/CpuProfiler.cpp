@@ -0,0 +1,196 @@
+#include "CpuProfiler.hpp"
+#include "JsonWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gps {
+
+    // Fields are atomics so writeChromeTrace may copy a slot while its thread overwrites it,
+    // release stores and acquire loads still compile to plain moves on x86
+    struct CpuEvent {
+
+        std::atomic<const char*> name;
+        std::atomic<int64_t> begin; // nanoseconds since the program started
+        std::atomic<int64_t> end;
+    };
+
+    struct CpuEventCopy {
+
+        const char* name;
+        int64_t begin;
+        int64_t end;
+    };
+
+    // One per thread that ever recorded. Buffers are owned by the registry and outlive
+    // their thread, so events of finished loader threads are still in the dump.
+    struct ThreadEvents {
+
+        std::unique_ptr<CpuEvent[]> events;
+        std::atomic<uint64_t> written; // total events ever recorded, index = written % EVENTS_PER_THREAD
+        std::string threadName;
+        int threadId;
+    };
+
+    static std::mutex registryMutex;
+    static std::vector<std::unique_ptr<ThreadEvents> > registry;
+    static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    static thread_local ThreadEvents* threadEvents = nullptr;
+
+    std::atomic<bool> CpuProfiler::enabled(false);
+
+    // Creates the buffer of the calling thread on first use, the only time the registry is locked
+    static ThreadEvents* getThreadEvents() {
+
+        if (!threadEvents) {
+
+            std::unique_ptr<ThreadEvents> events(new ThreadEvents());
+            events->events.reset(new CpuEvent[CpuProfiler::EVENTS_PER_THREAD]);
+            events->written.store(0);
+
+            std::lock_guard<std::mutex> lock(registryMutex);
+            events->threadId = (int)registry.size() + 1;
+            events->threadName = "thread " + std::to_string(events->threadId);
+            threadEvents = events.get();
+            registry.push_back(std::move(events));
+        }
+
+        return threadEvents;
+    }
+
+    void CpuProfiler::setEnabled(bool enabled) {
+
+        CpuProfiler::enabled.store(enabled);
+    }
+
+    bool CpuProfiler::isEnabled() {
+
+        return enabled.load();
+    }
+
+    void CpuProfiler::setThreadName(const char* name) {
+
+        ThreadEvents* events = getThreadEvents();
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        events->threadName = name;
+    }
+
+    int64_t CpuProfiler::now() {
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    void CpuProfiler::record(const char* name, int64_t begin, int64_t end) {
+
+        ThreadEvents* events = getThreadEvents();
+
+        uint64_t written = events->written.load(std::memory_order_relaxed);
+        CpuEvent& event = events->events[written % EVENTS_PER_THREAD];
+
+        // a reader that sees any of the stores below also sees the count published before them,
+        // so it can tell the slot is being reused
+        event.name.store(name, std::memory_order_release);
+        event.begin.store(begin, std::memory_order_release);
+        event.end.store(end, std::memory_order_release);
+
+        // publish after the event is complete, writeChromeTrace reads up to this count
+        events->written.store(written + 1, std::memory_order_release);
+    }
+
+    size_t CpuProfiler::getEventCount() {
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        size_t count = 0;
+        for (size_t t = 0; t < registry.size(); t++) {
+
+            uint64_t written = registry[t]->written.load(std::memory_order_acquire);
+            count += (size_t)(written < EVENTS_PER_THREAD ? written : EVENTS_PER_THREAD);
+        }
+
+        return count;
+    }
+
+    // Copies the events still in the ring of a thread that may be recording meanwhile.
+    // Like a seqlock reader: the count read again after the copy tells which slots were
+    // reused (or were being written) during it, those are dropped
+    static void copyEvents(ThreadEvents& events, std::vector<CpuEventCopy>& copy) {
+
+        const uint64_t size = (uint64_t)CpuProfiler::EVENTS_PER_THREAD;
+
+        uint64_t written = events.written.load(std::memory_order_acquire);
+        uint64_t oldest = written > size ? written - size : 0;
+
+        copy.clear();
+        for (uint64_t i = oldest; i < written; i++) {
+
+            const CpuEvent& event = events.events[i % size];
+            CpuEventCopy eventCopy;
+            eventCopy.name = event.name.load(std::memory_order_acquire);
+            eventCopy.begin = event.begin.load(std::memory_order_acquire);
+            eventCopy.end = event.end.load(std::memory_order_acquire);
+            copy.push_back(eventCopy);
+        }
+
+        uint64_t writtenAfter = events.written.load(std::memory_order_acquire);
+
+        // event i shares its slot with event i + size, which starts once writtenAfter reaches it
+        uint64_t firstIntact = writtenAfter + 1 > size ? writtenAfter + 1 - size : 0;
+        if (firstIntact > oldest) {
+            size_t torn = (size_t)std::min(firstIntact - oldest, (uint64_t)copy.size());
+            copy.erase(copy.begin(), copy.begin() + torn);
+        }
+    }
+
+    bool CpuProfiler::writeChromeTrace(const char* fileName) {
+
+        FILE* file = fopen(fileName, "w");
+        if (!file) {
+            fprintf(stderr, "Could not write trace %s\n", fileName);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        // complete ("X") events with microsecond timestamps, one track per thread
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        size_t eventCount = 0;
+        std::vector<CpuEventCopy> copy;
+
+        for (size_t t = 0; t < registry.size(); t++) {
+
+            ThreadEvents& events = *registry[t];
+
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                first ? "" : ",\n", events.threadId);
+            writeJsonString(file, events.threadName.c_str());
+            fprintf(file, "}}");
+            first = false;
+
+            copyEvents(events, copy);
+
+            for (size_t i = 0; i < copy.size(); i++) {
+
+                const CpuEventCopy& event = copy[i];
+                fprintf(file, ",\n{\"name\":");
+                writeJsonString(file, event.name);
+                fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    events.threadId, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+                eventCount++;
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+        fclose(file);
+
+        fprintf(stdout, "CPU trace: %zu events written to %s\n", eventCount, fileName);
+        return true;
+    }
+}
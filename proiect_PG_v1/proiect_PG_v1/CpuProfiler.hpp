@@ -0,0 +1,79 @@
+#ifndef CpuProfiler_hpp
+#define CpuProfiler_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Build with GPS_ENABLE_TRACING=0 to compile every GPS_CPU_SCOPE out of the program.
+// Compiled in, a disabled scope costs one relaxed atomic load.
+#ifndef GPS_ENABLE_TRACING
+#define GPS_ENABLE_TRACING 1
+#endif
+
+#define GPS_CPU_SCOPE_CONCAT_(a, b) a##b
+#define GPS_CPU_SCOPE_CONCAT(a, b) GPS_CPU_SCOPE_CONCAT_(a, b)
+
+#if GPS_ENABLE_TRACING
+// Times the rest of the enclosing C++ scope, name must be a string literal
+#define GPS_CPU_SCOPE(name) gps::CpuScope GPS_CPU_SCOPE_CONCAT(cpuScope, __LINE__)(name)
+#else
+#define GPS_CPU_SCOPE(name) ((void)0)
+#endif
+
+namespace gps {
+
+    // Scoped CPU timings for a Chrome trace (chrome://tracing or ui.perfetto.dev).
+    // Every thread appends to its own ring buffer, so recording takes no lock;
+    // when a buffer is full the oldest events are overwritten.
+    class CpuProfiler {
+
+    public:
+        static const int EVENTS_PER_THREAD = 1 << 16;
+
+        // Runtime switch, off by default
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+
+        // Label of the calling thread in the trace
+        static void setThreadName(const char* name);
+
+        // Writes the events of every thread as Chrome trace event JSON
+        static bool writeChromeTrace(const char* fileName);
+
+        // Events recorded so far over all threads (capped by the ring buffers)
+        static size_t getEventCount();
+
+        // Internal, used by CpuScope
+        static std::atomic<bool> enabled;
+        static int64_t now();
+        static void record(const char* name, int64_t begin, int64_t end);
+    };
+
+    class CpuScope {
+
+    public:
+        CpuScope(const char* name) {
+            if (CpuProfiler::enabled.load(std::memory_order_relaxed)) {
+                this->name = name;
+                this->begin = CpuProfiler::now();
+            }
+            else {
+                this->name = nullptr;
+                this->begin = 0;
+            }
+        }
+
+        ~CpuScope() {
+            if (this->name) {
+                CpuProfiler::record(this->name, this->begin, CpuProfiler::now());
+            }
+        }
+
+    private:
+        const char* name;
+        int64_t begin;
+    };
+}
+
+#endif /* CpuProfiler_hpp */
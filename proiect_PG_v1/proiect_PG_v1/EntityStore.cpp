@@ -0,0 +1,153 @@
+#include "EntityStore.hpp"
+
+namespace gps {
+
+    const glm::mat4 EntityStore::IDENTITY = glm::mat4(1.0f);
+    const glm::mat3 EntityStore::IDENTITY_NORMAL = glm::mat3(1.0f);
+
+    EntityStore::EntityStore() : nextEntity(0) {
+    }
+
+    int EntityStore::create() {
+
+        if (!freeEntities.empty()) {
+            int entity = freeEntities.back();
+            freeEntities.pop_back();
+            return entity;
+        }
+        return nextEntity++;
+    }
+
+    void EntityStore::destroy(int entity) {
+
+        if (transforms.has(entity)) {
+            transforms.remove(entity);
+        }
+        if (renderables.has(entity)) {
+            renderables.remove(entity);
+        }
+        if (bounds.has(entity)) {
+            bounds.remove(entity);
+        }
+        if (lights.has(entity)) {
+            lights.remove(entity);
+        }
+        freeEntities.push_back(entity);
+    }
+
+    void EntityStore::clear() {
+
+        transforms.clear();
+        renderables.clear();
+        bounds.clear();
+        lights.clear();
+        freeEntities.clear();
+        nextEntity = 0;
+    }
+
+    size_t EntityStore::getEntityCount() {
+
+        return (size_t)nextEntity - freeEntities.size();
+    }
+
+    const glm::mat4& EntityStore::getWorld(SceneGraph& graph, int entity) {
+
+        return transforms.has(entity) ? graph.getWorld(transforms.get(entity).node) : IDENTITY;
+    }
+
+    int EntityStore::updateBounds(SceneGraph& graph, size_t begin, size_t end) {
+
+        int changed = 0;
+        for (size_t i = begin; i < end; i++) {
+
+            Bounds& box = bounds[i];
+            int entity = bounds.getEntity(i);
+            bool transformed = transforms.has(entity);
+            if (!box.dirty && !(transformed && graph.wasUpdated(transforms.get(entity).node))) {
+                continue;
+            }
+
+            const glm::mat4& world = transformed ? graph.getWorld(transforms.get(entity).node) : IDENTITY;
+            transformBox(world, box.localMin, box.localMax, box.worldMin, box.worldMax);
+            for (size_t m = 0; m < box.meshes.size(); m++) {
+                MeshBounds& mesh = box.meshes[m];
+                transformBox(world, mesh.localMin, mesh.localMax, mesh.worldMin, mesh.worldMax);
+            }
+            box.dirty = false;
+            box.moved = true;
+            changed++;
+        }
+        return changed;
+    }
+
+    void EntityStore::gatherLights(SceneGraph& graph, size_t begin, size_t end, gps::PointLight* out) {
+
+        for (size_t i = begin; i < end; i++) {
+
+            int entity = lights.getEntity(i);
+            out[i].position = glm::vec3(getWorld(graph, entity)[3]);
+            out[i].radius = lights[i].radius;
+            out[i].color = lights[i].color;
+        }
+    }
+
+    void EntityStore::buildDrawList(SceneGraph& graph, size_t begin, size_t end, DrawItem* out) {
+
+        for (size_t i = begin; i < end; i++) {
+
+            int entity = renderables.getEntity(i);
+            Renderable& renderable = renderables[i];
+            out[i].entity = entity;
+            out[i].model = renderable.model;
+            out[i].name = renderable.name.c_str();
+            if (transforms.has(entity)) {
+                int node = transforms.get(entity).node;
+                out[i].world = &graph.getWorld(node);
+                out[i].normal = &graph.getNormal(node);
+            } else {
+                out[i].world = &IDENTITY;
+                out[i].normal = &IDENTITY_NORMAL;
+            }
+            out[i].visibleMeshes = &renderable.visibleMeshes;
+        }
+    }
+
+    void EntityStore::modelBounds(gps::Model3D& model3D, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+
+        boundsMin = glm::vec3(1e30f);
+        boundsMax = glm::vec3(-1e30f);
+        for (size_t i = 0; i < model3D.getMeshCount(); i++) {
+            boundsMin = glm::min(boundsMin, model3D.getMesh(i).boundsMin);
+            boundsMax = glm::max(boundsMax, model3D.getMesh(i).boundsMax);
+        }
+        if (model3D.getMeshCount() == 0) {
+            boundsMin = glm::vec3(0.0f);
+            boundsMax = glm::vec3(0.0f);
+        }
+    }
+
+    void EntityStore::meshBounds(gps::Model3D& model3D, std::vector<MeshBounds>& meshes) {
+
+        meshes.resize(model3D.getMeshCount());
+        for (size_t i = 0; i < meshes.size(); i++) {
+            meshes[i].localMin = model3D.getMesh(i).boundsMin;
+            meshes[i].localMax = model3D.getMesh(i).boundsMax;
+            meshes[i].worldMin = meshes[i].localMin;
+            meshes[i].worldMax = meshes[i].localMax;
+        }
+    }
+
+    void EntityStore::transformBox(const glm::mat4& world, const glm::vec3& localMin, const glm::vec3& localMax,
+        glm::vec3& worldMin, glm::vec3& worldMax) {
+
+        worldMin = glm::vec3(1e30f);
+        worldMax = glm::vec3(-1e30f);
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 point = glm::vec3(corner & 1 ? localMax.x : localMin.x,
+                corner & 2 ? localMax.y : localMin.y, corner & 4 ? localMax.z : localMin.z);
+            glm::vec3 transformed = glm::vec3(world * glm::vec4(point, 1.0f));
+            worldMin = glm::min(worldMin, transformed);
+            worldMax = glm::max(worldMax, transformed);
+        }
+    }
+}
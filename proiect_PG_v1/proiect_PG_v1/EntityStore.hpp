@@ -0,0 +1,184 @@
+#ifndef EntityStore_hpp
+#define EntityStore_hpp
+
+#include <glm/glm.hpp>
+
+#include "Model3D.hpp"
+#include "SceneGraph.hpp"
+#include "LightClusters.hpp"
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Components of one type packed at the front of a vector, whatever entities own them, so systems
+    // walk them in order. indices maps an entity to its component; removing one moves the last into
+    // its slot, the order of the rest is kept.
+    template <typename T>
+    class ComponentArray {
+
+    public:
+        void add(int entity, const T& component) {
+
+            if ((int)indices.size() <= entity) {
+                indices.resize(entity + 1, -1);
+            }
+            indices[entity] = (int)components.size();
+            components.push_back(component);
+            entities.push_back(entity);
+        }
+
+        void remove(int entity) {
+
+            int index = indices[entity];
+            int last = (int)components.size() - 1;
+            components[index] = components[last];
+            entities[index] = entities[last];
+            indices[entities[index]] = index;
+            components.pop_back();
+            entities.pop_back();
+            indices[entity] = -1;
+        }
+
+        bool has(int entity) const {
+
+            return entity < (int)indices.size() && indices[entity] >= 0;
+        }
+
+        T& get(int entity) {
+
+            return components[indices[entity]];
+        }
+
+        void clear() {
+
+            components.clear();
+            entities.clear();
+            indices.clear();
+        }
+
+        size_t size() const {
+
+            return components.size();
+        }
+
+        // By position in the packed array, 0 to size()
+        T& operator[](size_t index) {
+
+            return components[index];
+        }
+
+        int getEntity(size_t index) const {
+
+            return entities[index];
+        }
+
+    private:
+        std::vector<T> components;
+        std::vector<int> entities;  // owner of each component
+        std::vector<int> indices;   // by entity, -1 without the component
+    };
+
+    // Where the entity is, its world and normal matrices are those of the node
+    struct Transform {
+
+        int node;  // in the SceneGraph the systems are given
+    };
+
+    struct Renderable {
+
+        gps::Model3D* model;
+        std::string name;                 // GPU profiler scope, picking
+        bool staticGeometry;              // never moves: software occluder and collision geometry
+        std::vector<bool> visibleMeshes;  // written by culling, read by the camera passes
+    };
+
+    struct MeshBounds {
+
+        glm::vec3 localMin;
+        glm::vec3 localMax;
+        glm::vec3 worldMin;
+        glm::vec3 worldMax;
+    };
+
+    // World space box of the entity, around its transformed model space box, and one per mesh of its
+    // model for culling them one by one
+    struct Bounds {
+
+        glm::vec3 localMin;
+        glm::vec3 localMax;
+        glm::vec3 worldMin;
+        glm::vec3 worldMax;
+        std::vector<MeshBounds> meshes;  // by mesh index, empty without a model
+        bool dirty;  // the world boxes are recomputed even if the transform did not change
+        bool moved;  // the world boxes changed, cleared by whoever follows them
+    };
+
+    // Point light at the entity's position
+    struct Light {
+
+        float radius;
+        glm::vec3 color;
+    };
+
+    struct DrawItem {
+
+        int entity;
+        gps::Model3D* model;
+        const char* name;
+        const glm::mat4* world;
+        const glm::mat3* normal;  // world space, see SceneGraph::getNormal
+        std::vector<bool>* visibleMeshes;
+    };
+
+    // Entities are ids with any mix of components, each component type in its own ComponentArray.
+    // The systems go through one component array in order, over a range of it, so a system can be
+    // split into disjoint ranges run on separate threads: each writes only the components or output
+    // entries of its range. Entities without a Transform are at the origin.
+    class EntityStore {
+
+    public:
+        ComponentArray<Transform> transforms;
+        ComponentArray<Renderable> renderables;
+        ComponentArray<Bounds> bounds;
+        ComponentArray<Light> lights;
+
+        EntityStore();
+
+        // Freed ids are given out again
+        int create();
+        // Removes its components, its scene graph node stays
+        void destroy(int entity);
+        void clear();
+        size_t getEntityCount();
+
+        const glm::mat4& getWorld(SceneGraph& graph, int entity);
+
+        // Bounds from begin to end whose node the last SceneGraph::update recomputed, or that are
+        // dirty; run after every update. Returns how many changed.
+        int updateBounds(SceneGraph& graph, size_t begin, size_t end);
+        // lights[begin, end) to out[begin, end), out holds lights.size()
+        void gatherLights(SceneGraph& graph, size_t begin, size_t end, gps::PointLight* out);
+        // renderables[begin, end) to out[begin, end), out holds renderables.size(); the pointers
+        // stay valid until a component or node is added
+        void buildDrawList(SceneGraph& graph, size_t begin, size_t end, DrawItem* out);
+
+        // Model space box around every mesh of the model
+        static void modelBounds(gps::Model3D& model3D, glm::vec3& boundsMin, glm::vec3& boundsMax);
+        // Model space box of each mesh of the model, the world boxes are left to updateBounds
+        static void meshBounds(gps::Model3D& model3D, std::vector<MeshBounds>& meshes);
+        // World space box around the corners of the model space box
+        static void transformBox(const glm::mat4& world, const glm::vec3& localMin, const glm::vec3& localMax,
+            glm::vec3& worldMin, glm::vec3& worldMax);
+
+    private:
+        int nextEntity;
+        std::vector<int> freeEntities;
+
+        static const glm::mat4 IDENTITY;
+        static const glm::mat3 IDENTITY_NORMAL;
+    };
+}
+
+#endif /* EntityStore_hpp */
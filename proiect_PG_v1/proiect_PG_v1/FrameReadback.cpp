@@ -0,0 +1,121 @@
+#include "FrameReadback.hpp"
+#include "GLDispatch.hpp"
+
+#include <cstring>
+
+namespace gps {
+
+    void FrameReadback::Create(int width, int height) {
+
+        this->width = width;
+        this->height = height;
+        this->first = 0;
+        this->pending = 0;
+
+        glGenRenderbuffers(1, &resolveRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, resolveRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &resolveFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveRenderbuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenBuffers(BUFFER_COUNT, pixelBuffers);
+        for (int i = 0; i < BUFFER_COUNT; i++) {
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+            fences[i] = 0;
+            tags[i] = -1;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    void FrameReadback::Delete() {
+
+        for (int i = 0; i < BUFFER_COUNT; i++) {
+
+            if (fences[i]) {
+                glDeleteSync(fences[i]);
+                fences[i] = 0;
+            }
+        }
+
+        glDeleteBuffers(BUFFER_COUNT, pixelBuffers);
+        glDeleteFramebuffers(1, &resolveFramebuffer);
+        glDeleteRenderbuffers(1, &resolveRenderbuffer);
+    }
+
+    bool FrameReadback::request(GLuint sourceFramebuffer, int tag) {
+
+        if (pending == BUFFER_COUNT) {
+            return false;
+        }
+
+        int slot = (first + pending) % BUFFER_COUNT;
+
+        // resolve the samples
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        // with a pack buffer bound glReadPixels only queues the copy
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        tags[slot] = tag;
+        pending++;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+        return true;
+    }
+
+    bool FrameReadback::collect(Image& image, int& tag, bool wait) {
+
+        if (pending == 0) {
+            return false;
+        }
+
+        GLsync fence = fences[first];
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        }
+
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+
+        glDeleteSync(fence);
+        fences[first] = 0;
+
+        image.width = width;
+        image.height = height;
+        image.pixels.resize((size_t)width * height * 4);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[first]);
+        void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+        if (data) {
+            memcpy(&image.pixels[0], data, image.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        tag = tags[first];
+        first = (first + 1) % BUFFER_COUNT;
+        pending--;
+
+        return data != NULL;
+    }
+
+    int FrameReadback::getPendingCount() {
+
+        return pending;
+    }
+}
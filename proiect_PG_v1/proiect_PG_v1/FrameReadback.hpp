@@ -0,0 +1,53 @@
+#ifndef FrameReadback_hpp
+#define FrameReadback_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "ImageCompare.hpp"
+
+namespace gps {
+
+    // Asynchronous color readback through a ring of pixel buffer objects.
+    // request() resolves the (multisampled) source framebuffer and starts a glReadPixels into a PBO,
+    // which returns at once; collect() maps the oldest PBO once its fence has signaled,
+    // so the CPU keeps submitting frames while earlier ones are copied.
+    class FrameReadback {
+
+    public:
+        static const int BUFFER_COUNT = 3;
+
+        void Create(int width, int height);
+        void Delete();
+
+        // false when all the buffers hold readbacks that were not collected yet
+        bool request(GLuint sourceFramebuffer, int tag);
+
+        // Oldest pending readback, rows bottom to top as GL returns them.
+        // Without wait it returns false if the GPU has not finished that copy yet
+        bool collect(Image& image, int& tag, bool wait);
+
+        int getPendingCount();
+
+    private:
+        int width;
+        int height;
+
+        // single sampled copy of the source, glReadPixels cannot read multisampled buffers
+        GLuint resolveFramebuffer;
+        GLuint resolveRenderbuffer;
+
+        GLuint pixelBuffers[BUFFER_COUNT];
+        GLsync fences[BUFFER_COUNT];
+        int tags[BUFFER_COUNT];
+        int first;   // oldest pending buffer
+        int pending;
+    };
+}
+
+#endif /* FrameReadback_hpp */
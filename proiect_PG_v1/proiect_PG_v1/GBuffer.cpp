@@ -0,0 +1,81 @@
+#include "GBuffer.hpp"
+#include "GLDispatch.hpp"
+
+#include <cstdio>
+
+namespace gps {
+
+    GLuint GBuffer::createTarget(GLenum internalFormat, GLenum format, GLenum type) {
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+
+        // the lighting pass reads one texel per pixel
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        return texture;
+    }
+
+    void GBuffer::Create(int width, int height) {
+
+        this->width = width;
+        this->height = height;
+
+        albedoSpecTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        normalTexture = createTarget(GL_RG16F, GL_RG, GL_FLOAT);
+        depthTexture = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpecTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+        GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            fprintf(stderr, "ERROR: G-buffer framebuffer is not complete\n");
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void GBuffer::Delete() {
+
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &albedoSpecTexture);
+        glDeleteTextures(1, &normalTexture);
+        glDeleteTextures(1, &depthTexture);
+    }
+
+    void GBuffer::bindForWriting() {
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+    void GBuffer::bindForReading(gps::Shader shader, GLuint firstUnit) {
+
+        const char* samplers[3] = { "gAlbedoSpec", "gNormal", "gDepth" };
+        GLuint textures[3] = { albedoSpecTexture, normalTexture, depthTexture };
+
+        for (GLuint i = 0; i < 3; i++) {
+
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, samplers[i]), firstUnit + i);
+        }
+    }
+
+    size_t GBuffer::getByteSize() {
+
+        // RGBA8 + RG16F + 24 bit depth (stored as 32 bits by most drivers)
+        return (size_t)width * height * (4 + 4 + 4);
+    }
+}
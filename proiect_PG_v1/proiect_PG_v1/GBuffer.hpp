@@ -0,0 +1,45 @@
+#ifndef GBuffer_hpp
+#define GBuffer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Shader.hpp"
+
+namespace gps {
+
+    // Render targets of the deferred path:
+    // albedo + specular intensity (RGBA8), octahedral eye space normal (RG16F), depth (24 bit)
+    class GBuffer {
+
+    public:
+        void Create(int width, int height);
+        void Delete();
+
+        // Binds the framebuffer for the geometry pass
+        void bindForWriting();
+
+        // Binds the three targets as textures starting at firstUnit for the lighting pass
+        void bindForReading(gps::Shader shader, GLuint firstUnit);
+
+        // Bytes of video memory held by the targets
+        size_t getByteSize();
+
+    private:
+        GLuint framebuffer;
+        GLuint albedoSpecTexture;
+        GLuint normalTexture;
+        GLuint depthTexture;
+        int width;
+        int height;
+
+        GLuint createTarget(GLenum internalFormat, GLenum format, GLenum type);
+    };
+}
+
+#endif /* GBuffer_hpp */
@@ -0,0 +1,210 @@
+#include "GLDebug.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+
+namespace gps {
+
+    struct DebugMessage {
+
+        GLenum severity;
+        std::string text;
+        int count;
+    };
+
+    typedef std::tuple<GLenum, GLenum, GLuint> DebugMessageKey; // source, type, id
+
+    // asynchronous output may call back from a driver thread
+    static std::mutex messagesMutex;
+    static std::map<DebugMessageKey, DebugMessage> messages;
+    static std::set<GLuint> ignoredIds = {
+        131169, // NVIDIA: framebuffer storage allocated
+        131185, // NVIDIA: buffer object will use video memory
+        131204, // NVIDIA: texture unit has no defined base level
+    };
+    static bool active = false;
+    static bool synchronousOutput = false;
+    static int messageCount = 0;
+    static int errorCount = 0;
+
+#if not defined (__APPLE__)
+    static const char* sourceName(GLenum source) {
+
+        switch (source) {
+            case GL_DEBUG_SOURCE_API: return "api";
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+            case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+            case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+            case GL_DEBUG_SOURCE_APPLICATION: return "application";
+            default: return "other";
+        }
+    }
+
+    static const char* typeName(GLenum type) {
+
+        switch (type) {
+            case GL_DEBUG_TYPE_ERROR: return "error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+            case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+            case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+            case GL_DEBUG_TYPE_MARKER: return "marker";
+            default: return "other";
+        }
+    }
+
+    static const char* severityName(GLenum severity) {
+
+        switch (severity) {
+            case GL_DEBUG_SEVERITY_HIGH: return "high";
+            case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+            case GL_DEBUG_SEVERITY_LOW: return "low";
+            default: return "notification";
+        }
+    }
+
+    // file name without its directories
+    static const char* baseName(const char* path) {
+
+        const char* slash = strrchr(path, '/');
+        const char* backslash = strrchr(path, '\\');
+        if (backslash > slash) {
+            slash = backslash;
+        }
+        return slash ? slash + 1 : path;
+    }
+
+    static void GPS_GL_APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar* message, const void* userParam) {
+
+        std::lock_guard<std::mutex> lock(messagesMutex);
+
+        if (ignoredIds.count(id)) {
+            return;
+        }
+
+        messageCount++;
+        if (type == GL_DEBUG_TYPE_ERROR) {
+            errorCount++;
+        }
+
+        DebugMessageKey key(source, type, id);
+        std::map<DebugMessageKey, DebugMessage>::iterator known = messages.find(key);
+        if (known != messages.end()) {
+
+            // repeats are only reported at 10, 100, 1000, ...
+            int count = ++known->second.count;
+            while (count % 10 == 0) {
+                count /= 10;
+            }
+            if (count == 1) {
+                fprintf(stderr, "GL %s %u repeated %d times\n", typeName(type), id, known->second.count);
+            }
+            return;
+        }
+
+        DebugMessage entry;
+        entry.severity = severity;
+        entry.text = length < 0 ? std::string(message) : std::string(message, length);
+        entry.count = 1;
+
+        // the site of the last call is only the culprit when the driver reports synchronously
+        char site[256] = "";
+        if (synchronousOutput && glCallFile) {
+            snprintf(site, sizeof(site), " at %s:%d", baseName(glCallFile), glCallLine);
+        }
+
+        fprintf(stderr, "GL %s %u (%s, %s)%s: %s\n", typeName(type), id, sourceName(source), severityName(severity),
+            site, entry.text.c_str());
+
+        messages[key] = entry;
+    }
+#endif
+
+    bool GLDebug::init(bool synchronous) {
+
+#if defined (__APPLE__)
+        // macOS stops at GL 4.1 without any debug output extension
+        active = false;
+#else
+        synchronousOutput = synchronous;
+
+        if (GLEW_VERSION_4_3 || GLEW_KHR_debug) {
+
+            glEnable(GL_DEBUG_OUTPUT);
+            if (synchronous) {
+                glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            } else {
+                glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            }
+            glDebugMessageCallback(debugCallback, nullptr);
+
+            // drop the notifications but keep every performance message
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+            glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+            active = true;
+        }
+        else if (GLEW_ARB_debug_output) {
+
+            // only reports on debug contexts, and has no notification severity
+            if (synchronous) {
+                glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+            }
+            glDebugMessageCallbackARB(debugCallback, nullptr);
+            active = true;
+        }
+        else {
+            active = false;
+        }
+#endif
+        fprintf(stdout, "GL debug output: %s\n", active ? (synchronous ? "synchronous" : "asynchronous") : "not available");
+        return active;
+    }
+
+    bool GLDebug::isActive() {
+
+        return active;
+    }
+
+    void GLDebug::ignoreMessage(GLuint id) {
+
+        std::lock_guard<std::mutex> lock(messagesMutex);
+        ignoredIds.insert(id);
+    }
+
+    int GLDebug::getMessageCount() {
+
+        std::lock_guard<std::mutex> lock(messagesMutex);
+        return messageCount;
+    }
+
+    int GLDebug::getErrorCount() {
+
+        std::lock_guard<std::mutex> lock(messagesMutex);
+        return errorCount;
+    }
+
+    void GLDebug::printSummary() {
+
+#if not defined (__APPLE__)
+        if (!active) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(messagesMutex);
+
+        fprintf(stderr, "GL debug: %d messages (%d errors), %d distinct\n", messageCount, errorCount, (int)messages.size());
+        for (std::map<DebugMessageKey, DebugMessage>::iterator it = messages.begin(); it != messages.end(); ++it) {
+            if (it->second.count > 1) {
+                fprintf(stderr, "  %dx GL %s %u: %s\n", it->second.count, typeName(std::get<1>(it->first)),
+                    std::get<2>(it->first), it->second.text.c_str());
+            }
+        }
+#endif
+    }
+}
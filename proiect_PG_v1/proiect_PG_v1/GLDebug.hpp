@@ -0,0 +1,33 @@
+#ifndef GLDebug_hpp
+#define GLDebug_hpp
+
+#include "GLDispatch.hpp"
+
+namespace gps {
+
+    // GL errors and driver warnings through the debug output callback (GL 4.3, GL_KHR_debug or
+    // GL_ARB_debug_output) instead of glGetError polling, which stalls the pipeline on many drivers.
+    // Performance warnings (shader recompiles, buffer migrations, synchronized transfers) go to the
+    // same log. Every distinct message is printed once, repeats are only counted.
+    class GLDebug {
+
+    public:
+        // Installs the callback, false when the context has no debug output (always on macOS).
+        // synchronous: the driver reports inside the offending call, so with GPS_GL_CALL_SITES
+        // the message names the exact file and line; asynchronous reporting costs nothing
+        static bool init(bool synchronous);
+        static bool isActive();
+
+        // Message IDs that are never printed or counted, a few informational
+        // NVIDIA messages (buffer placement, framebuffer allocation) are ignored by default
+        static void ignoreMessage(GLuint id);
+
+        static int getMessageCount();
+        static int getErrorCount();
+
+        // Totals and the messages that repeated
+        static void printSummary();
+    };
+}
+
+#endif /* GLDebug_hpp */
@@ -0,0 +1,817 @@
+#define GPS_GL_DISPATCH_IMPLEMENTATION
+#include "GLDispatch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace gps {
+
+    GLDispatchTable glDispatch;
+    const char* glCallFile = nullptr;
+    int glCallLine = 0;
+
+    // the driver's entry points, kept for the driver and profiled backends
+    static GLDispatchTable driverTable;
+    static GLBackend currentBackend = GL_BACKEND_DRIVER;
+
+    enum GLCallId {
+#define GPS_GL_FUNCTION(ret, name, params, args) GL_CALL_##name,
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+        GL_CALL_COUNT
+    };
+
+    static const char* callNames[GL_CALL_COUNT] = {
+#define GPS_GL_FUNCTION(ret, name, params, args) "gl" #name,
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+    };
+
+    // GL is only called from the main thread, plain counters are enough
+    static uint64_t callCounts[GL_CALL_COUNT];
+    static uint64_t callNanoseconds[GL_CALL_COUNT];
+
+    // --- profiled backend: forwards to the driver ---
+
+    class CallTimer {
+
+    public:
+        CallTimer(GLCallId id) : id(id), start(std::chrono::steady_clock::now()) {
+        }
+
+        ~CallTimer() {
+            callCounts[id]++;
+            callNanoseconds[id] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        GLCallId id;
+        std::chrono::steady_clock::time_point start;
+    };
+
+#define GPS_GL_FUNCTION(ret, name, params, args) \
+    static ret GPS_GL_APIENTRY profiled##name params { \
+        CallTimer timer(GL_CALL_##name); \
+        return driverTable.name args; \
+    }
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+
+    // --- null backend ---
+
+    // 0, false or nullptr, and nothing for void
+    template <typename T>
+    static T nullResult() {
+        return T();
+    }
+
+#define GPS_GL_FUNCTION(ret, name, params, args) \
+    static ret GPS_GL_APIENTRY nullDefault##name params { \
+        callCounts[GL_CALL_##name]++; \
+        return nullResult<ret>(); \
+    }
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+
+    // object names are never reused, 0 stays "no object"
+    static GLuint nextObjectName = 1;
+    static std::vector<unsigned char> mappedScratch;
+
+    static void fakeNames(GLsizei n, GLuint* names) {
+
+        for (GLsizei i = 0; i < n; i++) {
+            names[i] = nextObjectName++;
+        }
+    }
+
+    static void GPS_GL_APIENTRY nullGenBuffers(GLsizei n, GLuint* buffers) {
+        callCounts[GL_CALL_GenBuffers]++;
+        fakeNames(n, buffers);
+    }
+
+    static void GPS_GL_APIENTRY nullGenVertexArrays(GLsizei n, GLuint* arrays) {
+        callCounts[GL_CALL_GenVertexArrays]++;
+        fakeNames(n, arrays);
+    }
+
+    static void GPS_GL_APIENTRY nullGenTextures(GLsizei n, GLuint* textures) {
+        callCounts[GL_CALL_GenTextures]++;
+        fakeNames(n, textures);
+    }
+
+    static void GPS_GL_APIENTRY nullGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+        callCounts[GL_CALL_GenFramebuffers]++;
+        fakeNames(n, framebuffers);
+    }
+
+    static void GPS_GL_APIENTRY nullGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+        callCounts[GL_CALL_GenRenderbuffers]++;
+        fakeNames(n, renderbuffers);
+    }
+
+    static void GPS_GL_APIENTRY nullGenQueries(GLsizei n, GLuint* ids) {
+        callCounts[GL_CALL_GenQueries]++;
+        fakeNames(n, ids);
+    }
+
+    static GLuint GPS_GL_APIENTRY nullCreateShader(GLenum type) {
+        callCounts[GL_CALL_CreateShader]++;
+        return nextObjectName++;
+    }
+
+    static GLuint GPS_GL_APIENTRY nullCreateProgram() {
+        callCounts[GL_CALL_CreateProgram]++;
+        return nextObjectName++;
+    }
+
+    // every compile and link succeeds at once, there is no binary to cache
+    static GLint nullObjectParameter(GLenum pname) {
+
+        switch (pname) {
+            case GL_COMPILE_STATUS:
+            case GL_LINK_STATUS:
+            case GL_COMPLETION_STATUS_KHR:
+                return GL_TRUE;
+            default:
+                return 0;
+        }
+    }
+
+    static void GPS_GL_APIENTRY nullGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+        callCounts[GL_CALL_GetShaderiv]++;
+        *params = nullObjectParameter(pname);
+    }
+
+    static void GPS_GL_APIENTRY nullGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+        callCounts[GL_CALL_GetProgramiv]++;
+        *params = nullObjectParameter(pname);
+    }
+
+    static void emptyLog(GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+
+        if (length) {
+            *length = 0;
+        }
+        if (bufSize > 0 && infoLog) {
+            infoLog[0] = '\0';
+        }
+    }
+
+    static void GPS_GL_APIENTRY nullGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+        callCounts[GL_CALL_GetShaderInfoLog]++;
+        emptyLog(bufSize, length, infoLog);
+    }
+
+    static void GPS_GL_APIENTRY nullGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+        callCounts[GL_CALL_GetProgramInfoLog]++;
+        emptyLog(bufSize, length, infoLog);
+    }
+
+    static void GPS_GL_APIENTRY nullGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) {
+        callCounts[GL_CALL_GetProgramBinary]++;
+        if (length) {
+            *length = 0;
+        }
+        *binaryFormat = 0;
+    }
+
+    static const GLubyte* GPS_GL_APIENTRY nullGetString(GLenum name) {
+        callCounts[GL_CALL_GetString]++;
+        return (const GLubyte*)"null";
+    }
+
+    static GLenum GPS_GL_APIENTRY nullCheckFramebufferStatus(GLenum target) {
+        callCounts[GL_CALL_CheckFramebufferStatus]++;
+        return GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    // mapped buffers point at scratch memory, readbacks see zeros
+    static void* GPS_GL_APIENTRY nullMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        callCounts[GL_CALL_MapBufferRange]++;
+        mappedScratch.assign((size_t)std::max<GLsizeiptr>(length, 1), 0);
+        return &mappedScratch[0];
+    }
+
+    static GLboolean GPS_GL_APIENTRY nullUnmapBuffer(GLenum target) {
+        callCounts[GL_CALL_UnmapBuffer]++;
+        return GL_TRUE;
+    }
+
+    // fences and queries are complete as soon as they are issued
+    static GLsync GPS_GL_APIENTRY nullFenceSync(GLenum condition, GLbitfield flags) {
+        callCounts[GL_CALL_FenceSync]++;
+        return (GLsync)(uintptr_t)nextObjectName++;
+    }
+
+    static GLenum GPS_GL_APIENTRY nullClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+        callCounts[GL_CALL_ClientWaitSync]++;
+        return GL_ALREADY_SIGNALED;
+    }
+
+    static void GPS_GL_APIENTRY nullGetQueryObjectiv(GLuint id, GLenum pname, GLint* params) {
+        callCounts[GL_CALL_GetQueryObjectiv]++;
+        *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+    }
+
+    static void GPS_GL_APIENTRY nullGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) {
+        callCounts[GL_CALL_GetQueryObjectui64v]++;
+        *params = 0;
+    }
+
+    static GLDispatchTable nullTable() {
+
+        GLDispatchTable table;
+#define GPS_GL_FUNCTION(ret, name, params, args) table.name = nullDefault##name;
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+
+        // calls whose results the engine reads
+        table.GenBuffers = nullGenBuffers;
+        table.GenVertexArrays = nullGenVertexArrays;
+        table.GenTextures = nullGenTextures;
+        table.GenFramebuffers = nullGenFramebuffers;
+        table.GenRenderbuffers = nullGenRenderbuffers;
+        table.GenQueries = nullGenQueries;
+        table.CreateShader = nullCreateShader;
+        table.CreateProgram = nullCreateProgram;
+        table.GetShaderiv = nullGetShaderiv;
+        table.GetProgramiv = nullGetProgramiv;
+        table.GetShaderInfoLog = nullGetShaderInfoLog;
+        table.GetProgramInfoLog = nullGetProgramInfoLog;
+        table.GetProgramBinary = nullGetProgramBinary;
+        table.GetString = nullGetString;
+        table.CheckFramebufferStatus = nullCheckFramebufferStatus;
+        table.MapBufferRange = nullMapBufferRange;
+        table.UnmapBuffer = nullUnmapBuffer;
+        table.FenceSync = nullFenceSync;
+        table.ClientWaitSync = nullClientWaitSync;
+        table.GetQueryObjectiv = nullGetQueryObjectiv;
+        table.GetQueryObjectui64v = nullGetQueryObjectui64v;
+        return table;
+    }
+
+    static GLDispatchTable profiledTable() {
+
+        GLDispatchTable table;
+#define GPS_GL_FUNCTION(ret, name, params, args) table.name = profiled##name;
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+        return table;
+    }
+
+    // --- memory layer: records the size of every allocation, then calls the backend underneath ---
+
+    // (texture, GL_TEXTURE_2D or cube map face, level) -> bytes
+    typedef std::tuple<GLuint, GLenum, GLint> TextureImageKey;
+
+    static std::map<TextureImageKey, uint64_t> textureImages;
+    static std::set<GLuint> mipmappedTextures;
+    static std::map<GLuint, uint64_t> renderbufferSizes;
+    static std::map<GLuint, uint64_t> bufferSizes;
+    static GLDispatchTable memoryNext;
+    static bool memoryTrackingEnabled = false;
+
+    // The objects bound where allocations go, followed through the bind and delete calls so an
+    // allocation needs no query to the driver. Only right when the layer saw every call since the
+    // context was made, so it is installed from the start or not at all.
+    static const int TRACKED_TEXTURE_UNITS = 32;
+    enum TrackedBufferTarget {
+        TRACKED_ARRAY_BUFFER,
+        TRACKED_PIXEL_PACK_BUFFER,
+        TRACKED_PIXEL_UNPACK_BUFFER,
+        TRACKED_UNIFORM_BUFFER,
+        TRACKED_TEXTURE_BUFFER,
+        TRACKED_BUFFER_TARGETS
+    };
+
+    static GLuint boundBuffers[TRACKED_BUFFER_TARGETS];
+    static std::map<GLuint, GLuint> elementBuffers;  // vertex array -> its GL_ELEMENT_ARRAY_BUFFER
+    static GLuint boundVertexArray = 0;
+    static GLuint boundTextures[TRACKED_TEXTURE_UNITS][2];  // 2D, cube map
+    static int activeTextureUnit = 0;
+    static GLuint boundRenderbuffer = 0;
+
+    // -1 for the targets whose allocations are not tracked
+    static int textureSlot(GLenum target) {
+
+        if (target == GL_TEXTURE_CUBE_MAP || (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)) {
+            return 1;
+        }
+        return target == GL_TEXTURE_2D ? 0 : -1;
+    }
+
+    static int bufferSlot(GLenum target) {
+
+        switch (target) {
+            case GL_ARRAY_BUFFER: return TRACKED_ARRAY_BUFFER;
+            case GL_PIXEL_PACK_BUFFER: return TRACKED_PIXEL_PACK_BUFFER;
+            case GL_PIXEL_UNPACK_BUFFER: return TRACKED_PIXEL_UNPACK_BUFFER;
+            case GL_UNIFORM_BUFFER: return TRACKED_UNIFORM_BUFFER;
+            case GL_TEXTURE_BUFFER: return TRACKED_TEXTURE_BUFFER;
+            default: return -1;
+        }
+    }
+
+    static GLuint boundTexture(GLenum target) {
+
+        int slot = textureSlot(target);
+        return slot >= 0 && activeTextureUnit < TRACKED_TEXTURE_UNITS ? boundTextures[activeTextureUnit][slot] : 0;
+    }
+
+    static GLuint boundBuffer(GLenum target) {
+
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            std::map<GLuint, GLuint>::iterator it = elementBuffers.find(boundVertexArray);
+            return it != elementBuffers.end() ? it->second : 0;
+        }
+        int slot = bufferSlot(target);
+        return slot >= 0 ? boundBuffers[slot] : 0;
+    }
+
+    static void resetBindings() {
+
+        memset(boundBuffers, 0, sizeof(boundBuffers));
+        elementBuffers.clear();
+        boundVertexArray = 0;
+        memset(boundTextures, 0, sizeof(boundTextures));
+        activeTextureUnit = 0;
+        boundRenderbuffer = 0;
+    }
+
+    static void GPS_GL_APIENTRY memoryBindBuffer(GLenum target, GLuint buffer) {
+        memoryNext.BindBuffer(target, buffer);
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            elementBuffers[boundVertexArray] = buffer;
+            return;
+        }
+        int slot = bufferSlot(target);
+        if (slot >= 0) {
+            boundBuffers[slot] = buffer;
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryBindVertexArray(GLuint array) {
+        memoryNext.BindVertexArray(array);
+        boundVertexArray = array;
+    }
+
+    static void GPS_GL_APIENTRY memoryDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+        memoryNext.DeleteVertexArrays(n, arrays);
+        for (GLsizei i = 0; i < n; i++) {
+            elementBuffers.erase(arrays[i]);
+            if (arrays[i] == boundVertexArray) {
+                boundVertexArray = 0;
+            }
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryActiveTexture(GLenum texture) {
+        memoryNext.ActiveTexture(texture);
+        activeTextureUnit = (int)(texture - GL_TEXTURE0);
+    }
+
+    static void GPS_GL_APIENTRY memoryBindTexture(GLenum target, GLuint texture) {
+        memoryNext.BindTexture(target, texture);
+        int slot = textureSlot(target);
+        if (slot >= 0 && activeTextureUnit < TRACKED_TEXTURE_UNITS) {
+            boundTextures[activeTextureUnit][slot] = texture;
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+        memoryNext.BindRenderbuffer(target, renderbuffer);
+        boundRenderbuffer = renderbuffer;
+    }
+
+    // as the drivers usually store them: RGB padded to four bytes, 24 bit depth in 32 bits
+    static uint64_t bytesPerTexel(GLint internalformat) {
+
+        switch (internalformat) {
+            case GL_RED:
+            case GL_R8:
+                return 1;
+            case GL_RG:
+            case GL_RG8:
+            case GL_R16F:
+                return 2;
+            case GL_RG32F:
+            case GL_RGB16F:
+            case GL_RGBA16F:
+                return 8;
+            case GL_RGB32F:
+            case GL_RGBA32F:
+                return 16;
+            default:
+                return 4;
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+        memoryNext.BufferData(target, size, data, usage);
+        GLuint buffer = boundBuffer(target);
+        if (buffer) {
+            bufferSizes[buffer] = (uint64_t)size;
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryDeleteBuffers(GLsizei n, const GLuint* buffers) {
+        memoryNext.DeleteBuffers(n, buffers);
+        for (GLsizei i = 0; i < n; i++) {
+            bufferSizes.erase(buffers[i]);
+
+            // deleting a bound buffer unbinds it
+            for (int slot = 0; slot < TRACKED_BUFFER_TARGETS; slot++) {
+                if (boundBuffers[slot] == buffers[i]) {
+                    boundBuffers[slot] = 0;
+                }
+            }
+            std::map<GLuint, GLuint>::iterator it = elementBuffers.find(boundVertexArray);
+            if (it != elementBuffers.end() && it->second == buffers[i]) {
+                it->second = 0;
+            }
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+        GLint border, GLenum format, GLenum type, const void* pixels) {
+        memoryNext.TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+        GLuint texture = boundTexture(target);
+        if (texture) {
+            textureImages[TextureImageKey(texture, target, level)] = (uint64_t)width * height * bytesPerTexel(internalformat);
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryGenerateMipmap(GLenum target) {
+        memoryNext.GenerateMipmap(target);
+        GLuint texture = boundTexture(target);
+        if (texture) {
+            mipmappedTextures.insert(texture);
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryDeleteTextures(GLsizei n, const GLuint* textures) {
+        memoryNext.DeleteTextures(n, textures);
+        for (GLsizei i = 0; i < n; i++) {
+            textureImages.erase(textureImages.lower_bound(TextureImageKey(textures[i], 0, 0)),
+                textureImages.lower_bound(TextureImageKey(textures[i] + 1, 0, 0)));
+            mipmappedTextures.erase(textures[i]);
+
+            for (int unit = 0; unit < TRACKED_TEXTURE_UNITS; unit++) {
+                for (int slot = 0; slot < 2; slot++) {
+                    if (boundTextures[unit][slot] == textures[i]) {
+                        boundTextures[unit][slot] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+        memoryNext.RenderbufferStorage(target, internalformat, width, height);
+        GLuint renderbuffer = boundRenderbuffer;
+        if (renderbuffer) {
+            renderbufferSizes[renderbuffer] = (uint64_t)width * height * bytesPerTexel(internalformat);
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat,
+        GLsizei width, GLsizei height) {
+        memoryNext.RenderbufferStorageMultisample(target, samples, internalformat, width, height);
+        GLuint renderbuffer = boundRenderbuffer;
+        if (renderbuffer) {
+            renderbufferSizes[renderbuffer] = (uint64_t)width * height * bytesPerTexel(internalformat) * std::max(samples, 1);
+        }
+    }
+
+    static void GPS_GL_APIENTRY memoryDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+        memoryNext.DeleteRenderbuffers(n, renderbuffers);
+        for (GLsizei i = 0; i < n; i++) {
+            renderbufferSizes.erase(renderbuffers[i]);
+            if (renderbuffers[i] == boundRenderbuffer) {
+                boundRenderbuffer = 0;
+            }
+        }
+    }
+
+    static void installMemoryLayer() {
+
+        memoryNext = glDispatch;
+
+        glDispatch.BindBuffer = memoryBindBuffer;
+        glDispatch.BindVertexArray = memoryBindVertexArray;
+        glDispatch.DeleteVertexArrays = memoryDeleteVertexArrays;
+        glDispatch.ActiveTexture = memoryActiveTexture;
+        glDispatch.BindTexture = memoryBindTexture;
+        glDispatch.BindRenderbuffer = memoryBindRenderbuffer;
+        glDispatch.BufferData = memoryBufferData;
+        glDispatch.DeleteBuffers = memoryDeleteBuffers;
+        glDispatch.TexImage2D = memoryTexImage2D;
+        glDispatch.GenerateMipmap = memoryGenerateMipmap;
+        glDispatch.DeleteTextures = memoryDeleteTextures;
+        glDispatch.RenderbufferStorage = memoryRenderbufferStorage;
+        glDispatch.RenderbufferStorageMultisample = memoryRenderbufferStorageMultisample;
+        glDispatch.DeleteRenderbuffers = memoryDeleteRenderbuffers;
+    }
+
+    // --- stats layer: counts into the current pass, then calls the backend underneath ---
+
+    static bool statsEnabled = false;
+    static GLPassStats* statsTarget = nullptr;
+    static GLDispatchTable statsNext;
+
+    static uint64_t trianglesOf(GLenum mode, GLsizei count) {
+
+        switch (mode) {
+            case GL_TRIANGLES:
+                return count / 3;
+            case GL_TRIANGLE_STRIP:
+            case GL_TRIANGLE_FAN:
+                return count > 2 ? count - 2 : 0;
+            default:
+                return 0;
+        }
+    }
+
+    static void GPS_GL_APIENTRY statsDrawArrays(GLenum mode, GLint first, GLsizei count) {
+        if (statsTarget) {
+            statsTarget->drawCalls++;
+            statsTarget->triangles += trianglesOf(mode, count);
+        }
+        statsNext.DrawArrays(mode, first, count);
+    }
+
+    static void GPS_GL_APIENTRY statsDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+        if (statsTarget) {
+            statsTarget->drawCalls++;
+            statsTarget->triangles += trianglesOf(mode, count);
+        }
+        statsNext.DrawElements(mode, count, type, indices);
+    }
+
+    static void GPS_GL_APIENTRY statsUseProgram(GLuint program) {
+        if (statsTarget) {
+            statsTarget->programBinds++;
+        }
+        statsNext.UseProgram(program);
+    }
+
+    static void GPS_GL_APIENTRY statsBindTexture(GLenum target, GLuint texture) {
+        if (statsTarget) {
+            statsTarget->textureBinds++;
+        }
+        statsNext.BindTexture(target, texture);
+    }
+
+    static void GPS_GL_APIENTRY statsBindVertexArray(GLuint array) {
+        if (statsTarget) {
+            statsTarget->vertexArrayBinds++;
+        }
+        statsNext.BindVertexArray(array);
+    }
+
+    static void GPS_GL_APIENTRY statsBindFramebuffer(GLenum target, GLuint framebuffer) {
+        if (statsTarget) {
+            statsTarget->framebufferBinds++;
+        }
+        statsNext.BindFramebuffer(target, framebuffer);
+    }
+
+    static void GPS_GL_APIENTRY statsBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+        if (statsTarget && data) {
+            statsTarget->bufferBytes += size;
+        }
+        statsNext.BufferData(target, size, data, usage);
+    }
+
+    static void countUniform() {
+        if (statsTarget) {
+            statsTarget->uniformUploads++;
+        }
+    }
+
+    static void GPS_GL_APIENTRY statsUniform1i(GLint location, GLint v0) {
+        countUniform();
+        statsNext.Uniform1i(location, v0);
+    }
+
+    static void GPS_GL_APIENTRY statsUniform3i(GLint location, GLint v0, GLint v1, GLint v2) {
+        countUniform();
+        statsNext.Uniform3i(location, v0, v1, v2);
+    }
+
+    static void GPS_GL_APIENTRY statsUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+        countUniform();
+        statsNext.Uniform2f(location, v0, v1);
+    }
+
+    static void GPS_GL_APIENTRY statsUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+        countUniform();
+        statsNext.Uniform3fv(location, count, value);
+    }
+
+    static void GPS_GL_APIENTRY statsUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+        countUniform();
+        statsNext.UniformMatrix3fv(location, count, transpose, value);
+    }
+
+    static void GPS_GL_APIENTRY statsUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+        countUniform();
+        statsNext.UniformMatrix4fv(location, count, transpose, value);
+    }
+
+    static void installStatsLayer() {
+
+        statsNext = glDispatch;
+
+        glDispatch.DrawArrays = statsDrawArrays;
+        glDispatch.DrawElements = statsDrawElements;
+        glDispatch.UseProgram = statsUseProgram;
+        glDispatch.BindTexture = statsBindTexture;
+        glDispatch.BindVertexArray = statsBindVertexArray;
+        glDispatch.BindFramebuffer = statsBindFramebuffer;
+        glDispatch.BufferData = statsBufferData;
+        glDispatch.Uniform1i = statsUniform1i;
+        glDispatch.Uniform3i = statsUniform3i;
+        glDispatch.Uniform2f = statsUniform2f;
+        glDispatch.Uniform3fv = statsUniform3fv;
+        glDispatch.UniformMatrix3fv = statsUniformMatrix3fv;
+        glDispatch.UniformMatrix4fv = statsUniformMatrix4fv;
+    }
+
+    // --- GLDispatch ---
+
+    void GLDispatch::loadDriver() {
+
+        // with GLEW most of these are function pointers filled in by glewInit
+#define GPS_GL_FUNCTION(ret, name, params, args) driverTable.name = gl##name;
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+
+        setBackend(currentBackend);
+    }
+
+    void GLDispatch::setBackend(GLBackend backend) {
+
+        currentBackend = backend;
+
+        switch (backend) {
+            case GL_BACKEND_DRIVER:
+                glDispatch = driverTable;
+                break;
+            case GL_BACKEND_PROFILED:
+                glDispatch = profiledTable();
+                break;
+            case GL_BACKEND_NULL:
+                glDispatch = nullTable();
+                break;
+        }
+
+        // the null backend allocates nothing
+        if (memoryTrackingEnabled && backend != GL_BACKEND_NULL) {
+            installMemoryLayer();
+        }
+        if (statsEnabled) {
+            installStatsLayer();
+        }
+    }
+
+    GLBackend GLDispatch::getBackend() {
+
+        return currentBackend;
+    }
+
+    const char* GLDispatch::getBackendName() {
+
+        switch (currentBackend) {
+            case GL_BACKEND_PROFILED:
+                return "profiled";
+            case GL_BACKEND_NULL:
+                return "null";
+            default:
+                return "driver";
+        }
+    }
+
+    void GLDispatch::setStatsEnabled(bool enabled) {
+
+        statsEnabled = enabled;
+        setBackend(currentBackend);
+    }
+
+    bool GLDispatch::isStatsEnabled() {
+
+        return statsEnabled;
+    }
+
+    void GLDispatch::setMemoryTrackingEnabled(bool enabled) {
+
+        memoryTrackingEnabled = enabled;
+        textureImages.clear();
+        mipmappedTextures.clear();
+        renderbufferSizes.clear();
+        bufferSizes.clear();
+        resetBindings();
+        setBackend(currentBackend);
+    }
+
+    bool GLDispatch::isMemoryTrackingEnabled() {
+
+        return memoryTrackingEnabled;
+    }
+
+    void GLDispatch::setStatsTarget(GLPassStats* stats) {
+
+        statsTarget = stats;
+    }
+
+    GLMemoryEstimate GLDispatch::getMemoryEstimate() {
+
+        GLMemoryEstimate estimate;
+        memset(&estimate, 0, sizeof(estimate));
+
+        GLuint lastTexture = 0;
+        for (std::map<TextureImageKey, uint64_t>::iterator it = textureImages.begin(); it != textureImages.end(); ++it) {
+
+            GLuint texture = std::get<0>(it->first);
+            bool mipmapped = std::get<2>(it->first) == 0 && mipmappedTextures.count(texture) > 0;
+            // the whole chain below a level is a third of its size
+            estimate.textureBytes += mipmapped ? it->second * 4 / 3 : it->second;
+            if (texture != lastTexture) {
+                estimate.textures++;
+                lastTexture = texture;
+            }
+        }
+
+        for (std::map<GLuint, uint64_t>::iterator it = renderbufferSizes.begin(); it != renderbufferSizes.end(); ++it) {
+            estimate.renderbufferBytes += it->second;
+        }
+        estimate.renderbuffers = (int)renderbufferSizes.size();
+
+        for (std::map<GLuint, uint64_t>::iterator it = bufferSizes.begin(); it != bufferSizes.end(); ++it) {
+            estimate.bufferBytes += it->second;
+        }
+        estimate.buffers = (int)bufferSizes.size();
+
+        return estimate;
+    }
+
+    void GLDispatch::resetCounters() {
+
+        memset(callCounts, 0, sizeof(callCounts));
+        memset(callNanoseconds, 0, sizeof(callNanoseconds));
+    }
+
+    uint64_t GLDispatch::getTotalCalls() {
+
+        uint64_t total = 0;
+        for (int i = 0; i < GL_CALL_COUNT; i++) {
+            total += callCounts[i];
+        }
+        return total;
+    }
+
+    void GLDispatch::printCounters(int frames) {
+
+        if (currentBackend == GL_BACKEND_DRIVER) {
+            fprintf(stdout, "GL calls: not counted with the driver backend (use --gl-profile or --null-gl)\n");
+            return;
+        }
+
+        frames = std::max(frames, 1);
+
+        // most called first
+        std::vector<int> order;
+        for (int i = 0; i < GL_CALL_COUNT; i++) {
+            if (callCounts[i] > 0) {
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [](int a, int b) { return callCounts[a] > callCounts[b]; });
+
+        bool timed = currentBackend == GL_BACKEND_PROFILED;
+        fprintf(stdout, "GL calls (%s backend, %d frames, %.1f calls per frame)\n",
+            getBackendName(), frames, (double)getTotalCalls() / frames);
+        fprintf(stdout, "  %-34s %12s%s\n", "function", "per frame", timed ? "     ns/call   ms/frame" : "");
+
+        for (size_t i = 0; i < order.size(); i++) {
+
+            int id = order[i];
+            if (timed) {
+                fprintf(stdout, "  %-34s %12.1f %11.1f %10.4f\n", callNames[id], (double)callCounts[id] / frames,
+                    (double)callNanoseconds[id] / callCounts[id], callNanoseconds[id] / 1.0e6 / frames);
+            } else {
+                fprintf(stdout, "  %-34s %12.1f\n", callNames[id], (double)callCounts[id] / frames);
+            }
+        }
+    }
+}
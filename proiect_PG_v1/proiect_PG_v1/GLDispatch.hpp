@@ -0,0 +1,121 @@
+#ifndef GLDispatch_hpp
+#define GLDispatch_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <cstdint>
+
+#if defined (_WIN32)
+    #define GPS_GL_APIENTRY __stdcall
+#else
+    #define GPS_GL_APIENTRY
+#endif
+
+// Debug builds tag every gl* call with its file and line, GLDebug prints them next to the driver's message
+#ifndef GPS_GL_CALL_SITES
+    #if defined (NDEBUG)
+        #define GPS_GL_CALL_SITES 0
+    #else
+        #define GPS_GL_CALL_SITES 1
+    #endif
+#endif
+
+#define GPS_GL_CALL_SITE(call) (gps::glCallFile = __FILE__, gps::glCallLine = __LINE__, call)
+
+namespace gps {
+
+    // One pointer per GL entry point of GLFunctions.inl, every gl* call of the engine goes through it
+    struct GLDispatchTable {
+
+#define GPS_GL_FUNCTION(ret, name, params, args) ret (GPS_GL_APIENTRY *name) params;
+#include "GLFunctions.inl"
+#undef GPS_GL_FUNCTION
+    };
+
+    extern GLDispatchTable glDispatch;
+
+    // source location of the last gl* call (GPS_GL_CALL_SITES), nullptr when not tracked
+    extern const char* glCallFile;
+    extern int glCallLine;
+
+    enum GLBackend {
+        GL_BACKEND_DRIVER,   // the driver's entry points, no overhead but the indirection (and the memory layer when tracking)
+        GL_BACKEND_PROFILED, // the driver, every call counted and timed
+        GL_BACKEND_NULL      // no context needed: calls are counted and dropped, Gen*/Create* hand out fake names
+    };
+
+    // Submission counters of one render pass, filled by the stats layer of the dispatch table
+    struct GLPassStats {
+
+        const char* name;
+        uint64_t drawCalls;
+        uint64_t triangles;
+        uint64_t programBinds;
+        uint64_t textureBinds;
+        uint64_t vertexArrayBinds;
+        uint64_t uniformUploads;
+        uint64_t bufferBytes;      // glBufferData with data
+        uint64_t framebufferBinds;
+    };
+
+    // Video memory allocated through the dispatch table, from the sizes given to glTexImage2D
+    // (a third more after glGenerateMipmap), glRenderbufferStorage* and glBufferData.
+    // An estimate: drivers pad, align and may keep more than one copy.
+    struct GLMemoryEstimate {
+
+        uint64_t textureBytes;
+        uint64_t renderbufferBytes;
+        uint64_t bufferBytes;
+        int textures;
+        int renderbuffers;
+        int buffers;
+    };
+
+    // Switches where the gl* calls go. The null backend measures the CPU side of the frame
+    // (culling, uniform setup, state changes, draw submission) without the driver or the GPU.
+    class GLDispatch {
+
+    public:
+        // Picks up the driver's entry points, call once the context is current (after glewInit)
+        static void loadDriver();
+
+        static void setBackend(GLBackend backend);
+        static GLBackend getBackend();
+        static const char* getBackendName();
+
+        // Counted by the profiled and null backends only
+        static void resetCounters();
+        static uint64_t getTotalCalls();
+
+        // Stats layer on top of any backend: draws, binds, uniform and buffer uploads are added
+        // to the current target (GLFrameStats moves it from pass to pass), nothing is counted without one
+        static void setStatsEnabled(bool enabled);
+        static bool isStatsEnabled();
+        static void setStatsTarget(GLPassStats* stats);
+
+        // Memory layer on top of the driver and profiled backends, off by default: it follows every
+        // bind and allocation, so turn it on before the context makes any (before loadDriver).
+        // Turning it on or off forgets what was recorded
+        static void setMemoryTrackingEnabled(bool enabled);
+        static bool isMemoryTrackingEnabled();
+        // Live allocations seen by the memory layer, all zero without it
+        static GLMemoryEstimate getMemoryEstimate();
+
+        // Calls per frame and, for the profiled backend, time per call of every function used since the reset
+        static void printCounters(int frames);
+    };
+}
+
+// Redirect the gl* names of the including file to gps::glDispatch.
+// GLDispatch.cpp defines GPS_GL_DISPATCH_IMPLEMENTATION because it needs the driver's names.
+#ifndef GPS_GL_DISPATCH_IMPLEMENTATION
+#include "GLRedirect.inl"
+#endif
+
+#endif /* GLDispatch_hpp */
@@ -0,0 +1,230 @@
+#include "GLFrameStats.hpp"
+#include "JsonWriter.hpp"
+
+#include <cstring>
+
+namespace gps {
+
+    static bool frameStatsEnabled = false;
+    static bool inFrame = false;
+
+    // the frame being recorded and the last finished one, index 0 is "other"
+    static GLPassStats currentPasses[GLFrameStats::MAX_PASSES];
+    static int currentPassCount = 0;
+    static GLPassStats lastPasses[GLFrameStats::MAX_PASSES];
+    static int lastPassCount = 0;
+    static long long frameIndex = -1;
+
+    static FILE* logFile = NULL;
+    static bool logCsv = false;
+
+    static GLPassStats emptyPass(const char* name) {
+
+        GLPassStats stats;
+        memset(&stats, 0, sizeof(stats));
+        stats.name = name;
+        return stats;
+    }
+
+    static void addPass(GLPassStats& sum, const GLPassStats& pass) {
+
+        sum.drawCalls += pass.drawCalls;
+        sum.triangles += pass.triangles;
+        sum.programBinds += pass.programBinds;
+        sum.textureBinds += pass.textureBinds;
+        sum.vertexArrayBinds += pass.vertexArrayBinds;
+        sum.uniformUploads += pass.uniformUploads;
+        sum.bufferBytes += pass.bufferBytes;
+        sum.framebufferBinds += pass.framebufferBinds;
+    }
+
+    void GLFrameStats::setEnabled(bool enabled) {
+
+        frameStatsEnabled = enabled;
+        GLDispatch::setStatsEnabled(enabled);
+        if (!enabled) {
+            GLDispatch::setStatsTarget(nullptr);
+            inFrame = false;
+        }
+    }
+
+    bool GLFrameStats::isEnabled() {
+
+        return frameStatsEnabled;
+    }
+
+    void GLFrameStats::beginFrame() {
+
+        if (!frameStatsEnabled) {
+            return;
+        }
+
+        currentPasses[0] = emptyPass("other");
+        currentPassCount = 1;
+        inFrame = true;
+        GLDispatch::setStatsTarget(&currentPasses[0]);
+    }
+
+    void GLFrameStats::endFrame() {
+
+        if (!inFrame) {
+            return;
+        }
+
+        // nothing between frames is counted
+        GLDispatch::setStatsTarget(nullptr);
+        inFrame = false;
+
+        memcpy(lastPasses, currentPasses, sizeof(GLPassStats) * currentPassCount);
+        lastPassCount = currentPassCount;
+        frameIndex++;
+
+        if (logFile) {
+            writeRecord();
+        }
+    }
+
+    void GLFrameStats::beginPass(const char* name) {
+
+        if (!inFrame) {
+            return;
+        }
+
+        int pass = 1;
+        while (pass < currentPassCount && strcmp(currentPasses[pass].name, name) != 0) {
+            pass++;
+        }
+
+        if (pass == currentPassCount) {
+            if (currentPassCount == MAX_PASSES) {
+                // out of slots, count it with the calls outside passes
+                pass = 0;
+            } else {
+                currentPasses[currentPassCount++] = emptyPass(name);
+            }
+        }
+
+        GLDispatch::setStatsTarget(&currentPasses[pass]);
+    }
+
+    void GLFrameStats::endPass() {
+
+        if (!inFrame) {
+            return;
+        }
+
+        GLDispatch::setStatsTarget(&currentPasses[0]);
+    }
+
+    long long GLFrameStats::getFrameIndex() {
+
+        return frameIndex;
+    }
+
+    int GLFrameStats::getPassCount() {
+
+        return lastPassCount;
+    }
+
+    const GLPassStats& GLFrameStats::getPass(int index) {
+
+        return lastPasses[index];
+    }
+
+    GLPassStats GLFrameStats::getTotal() {
+
+        GLPassStats total = emptyPass("total");
+        for (int i = 0; i < lastPassCount; i++) {
+            addPass(total, lastPasses[i]);
+        }
+        return total;
+    }
+
+    std::string GLFrameStats::getSummary() {
+
+        GLPassStats total = getTotal();
+        char line[256];
+        snprintf(line, sizeof(line), "draws %llu  tris %.1fk  programs %llu  textures %llu  VAOs %llu  uniforms %llu  upload %.1f KB  FBOs %llu",
+            (unsigned long long)total.drawCalls, total.triangles / 1000.0, (unsigned long long)total.programBinds,
+            (unsigned long long)total.textureBinds, (unsigned long long)total.vertexArrayBinds,
+            (unsigned long long)total.uniformUploads, total.bufferBytes / 1024.0, (unsigned long long)total.framebufferBinds);
+
+        // draw calls of every pass
+        std::string summary = line;
+        summary += "  |";
+        for (int i = 0; i < lastPassCount; i++) {
+            snprintf(line, sizeof(line), " %s %llu", lastPasses[i].name, (unsigned long long)lastPasses[i].drawCalls);
+            summary += line;
+        }
+        return summary;
+    }
+
+    bool GLFrameStats::openLog(const char* fileName) {
+
+        closeLog();
+
+        logFile = fopen(fileName, "w");
+        if (!logFile) {
+            fprintf(stderr, "GL stats: could not open %s\n", fileName);
+            return false;
+        }
+
+        size_t length = strlen(fileName);
+        logCsv = length >= 4 && strcmp(fileName + length - 4, ".csv") == 0;
+        if (logCsv) {
+            fprintf(logFile, "frame,pass,draw_calls,triangles,program_binds,texture_binds,vao_binds,uniform_uploads,buffer_bytes,fbo_binds\n");
+        }
+        return true;
+    }
+
+    void GLFrameStats::closeLog() {
+
+        if (logFile) {
+            fclose(logFile);
+            logFile = NULL;
+        }
+    }
+
+    static void writeCsvRow(FILE* file, long long frame, const GLPassStats& pass) {
+
+        fprintf(file, "%lld,%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", frame, pass.name,
+            (unsigned long long)pass.drawCalls, (unsigned long long)pass.triangles, (unsigned long long)pass.programBinds,
+            (unsigned long long)pass.textureBinds, (unsigned long long)pass.vertexArrayBinds, (unsigned long long)pass.uniformUploads,
+            (unsigned long long)pass.bufferBytes, (unsigned long long)pass.framebufferBinds);
+    }
+
+    static void writeJsonPass(FILE* file, const GLPassStats& pass) {
+
+        fprintf(file, "{\"name\": ");
+        writeJsonString(file, pass.name);
+        fprintf(file, ", \"draw_calls\": %llu, \"triangles\": %llu, \"program_binds\": %llu, \"texture_binds\": %llu, "
+            "\"vao_binds\": %llu, \"uniform_uploads\": %llu, \"buffer_bytes\": %llu, \"fbo_binds\": %llu}",
+            (unsigned long long)pass.drawCalls, (unsigned long long)pass.triangles, (unsigned long long)pass.programBinds,
+            (unsigned long long)pass.textureBinds, (unsigned long long)pass.vertexArrayBinds, (unsigned long long)pass.uniformUploads,
+            (unsigned long long)pass.bufferBytes, (unsigned long long)pass.framebufferBinds);
+    }
+
+    void GLFrameStats::writeRecord() {
+
+        GLPassStats total = getTotal();
+
+        if (logCsv) {
+            for (int i = 0; i < lastPassCount; i++) {
+                writeCsvRow(logFile, frameIndex, lastPasses[i]);
+            }
+            writeCsvRow(logFile, frameIndex, total);
+            return;
+        }
+
+        fprintf(logFile, "{\"frame\": %lld, \"total\": ", frameIndex);
+        writeJsonPass(logFile, total);
+        fprintf(logFile, ", \"passes\": [");
+        for (int i = 0; i < lastPassCount; i++) {
+            if (i > 0) {
+                fprintf(logFile, ", ");
+            }
+            writeJsonPass(logFile, lastPasses[i]);
+        }
+        fprintf(logFile, "]}\n");
+    }
+}
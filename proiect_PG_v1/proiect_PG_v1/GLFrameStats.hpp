@@ -0,0 +1,62 @@
+#ifndef GLFrameStats_hpp
+#define GLFrameStats_hpp
+
+#include "GLDispatch.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace gps {
+
+    // Per frame GL submission statistics (draw calls, triangles, binds, uniform and buffer uploads),
+    // broken down by render pass. The counting happens in the stats layer of the dispatch table,
+    // this class moves its target from pass to pass and keeps the record of the last frame.
+    // A record is written per frame to the log, CSV or JSON lines.
+    class GLFrameStats {
+
+    public:
+        static const int MAX_PASSES = 16;
+
+        // Installs or removes the stats layer, off by default
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+
+        // Around everything drawn in a frame, calls outside any pass count as "other".
+        // Passes do not nest, a pass used twice in a frame adds up; names must be string literals.
+        static void beginFrame();
+        static void endFrame();
+        static void beginPass(const char* name);
+        static void endPass();
+
+        // Last finished frame, passes in first use order ("other" first)
+        static long long getFrameIndex();
+        static int getPassCount();
+        static const GLPassStats& getPass(int index);
+        static GLPassStats getTotal();
+
+        // One line, e.g. for the window title
+        static std::string getSummary();
+
+        // ".csv": a row per pass and a "total" row per frame; anything else: one JSON object per frame
+        static bool openLog(const char* fileName);
+        static void closeLog();
+
+    private:
+        static void writeRecord();
+    };
+
+    // Pass for the rest of the enclosing C++ scope
+    class GLStatsPass {
+
+    public:
+        GLStatsPass(const char* name) {
+            GLFrameStats::beginPass(name);
+        }
+
+        ~GLStatsPass() {
+            GLFrameStats::endPass();
+        }
+    };
+}
+
+#endif /* GLFrameStats_hpp */
@@ -0,0 +1,116 @@
+// GLFunctions.inl
+// Every GL entry point the engine calls, as an X-macro:
+//   GPS_GL_FUNCTION(return type, name without the gl prefix, (parameters), (arguments))
+// Included by GLDispatch.hpp/.cpp with different definitions of GPS_GL_FUNCTION.
+// A new GL call in the engine needs a line here and one in GLRedirect.inl.
+
+// state
+GPS_GL_FUNCTION(void, Enable, (GLenum cap), (cap))
+GPS_GL_FUNCTION(void, Disable, (GLenum cap), (cap))
+GPS_GL_FUNCTION(void, BlendFunc, (GLenum sfactor, GLenum dfactor), (sfactor, dfactor))
+GPS_GL_FUNCTION(void, DepthFunc, (GLenum func), (func))
+GPS_GL_FUNCTION(void, DepthMask, (GLboolean flag), (flag))
+GPS_GL_FUNCTION(void, ColorMask, (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha), (red, green, blue, alpha))
+GPS_GL_FUNCTION(void, CullFace, (GLenum mode), (mode))
+GPS_GL_FUNCTION(void, FrontFace, (GLenum mode), (mode))
+GPS_GL_FUNCTION(void, PolygonMode, (GLenum face, GLenum mode), (face, mode))
+GPS_GL_FUNCTION(void, Viewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+GPS_GL_FUNCTION(void, ClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha), (red, green, blue, alpha))
+GPS_GL_FUNCTION(void, Clear, (GLbitfield mask), (mask))
+GPS_GL_FUNCTION(void, PixelStorei, (GLenum pname, GLint param), (pname, param))
+GPS_GL_FUNCTION(void, Finish, (void), ())
+GPS_GL_FUNCTION(GLenum, GetError, (void), ())
+GPS_GL_FUNCTION(void, GetIntegerv, (GLenum pname, GLint* data), (pname, data))
+GPS_GL_FUNCTION(const GLubyte*, GetString, (GLenum name), (name))
+
+// shaders and uniforms
+GPS_GL_FUNCTION(GLuint, CreateShader, (GLenum type), (type))
+GPS_GL_FUNCTION(void, ShaderSource, (GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length), (shader, count, string, length))
+GPS_GL_FUNCTION(void, CompileShader, (GLuint shader), (shader))
+GPS_GL_FUNCTION(void, GetShaderiv, (GLuint shader, GLenum pname, GLint* params), (shader, pname, params))
+GPS_GL_FUNCTION(void, GetShaderInfoLog, (GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog), (shader, bufSize, length, infoLog))
+GPS_GL_FUNCTION(void, DeleteShader, (GLuint shader), (shader))
+GPS_GL_FUNCTION(GLuint, CreateProgram, (void), ())
+GPS_GL_FUNCTION(void, AttachShader, (GLuint program, GLuint shader), (program, shader))
+GPS_GL_FUNCTION(void, DetachShader, (GLuint program, GLuint shader), (program, shader))
+GPS_GL_FUNCTION(void, LinkProgram, (GLuint program), (program))
+GPS_GL_FUNCTION(void, GetProgramiv, (GLuint program, GLenum pname, GLint* params), (program, pname, params))
+GPS_GL_FUNCTION(void, GetProgramInfoLog, (GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog), (program, bufSize, length, infoLog))
+GPS_GL_FUNCTION(void, ProgramParameteri, (GLuint program, GLenum pname, GLint value), (program, pname, value))
+GPS_GL_FUNCTION(void, GetProgramBinary, (GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary), (program, bufSize, length, binaryFormat, binary))
+GPS_GL_FUNCTION(void, ProgramBinary, (GLuint program, GLenum binaryFormat, const void* binary, GLsizei length), (program, binaryFormat, binary, length))
+GPS_GL_FUNCTION(void, UseProgram, (GLuint program), (program))
+GPS_GL_FUNCTION(void, DeleteProgram, (GLuint program), (program))
+GPS_GL_FUNCTION(GLint, GetUniformLocation, (GLuint program, const GLchar* name), (program, name))
+GPS_GL_FUNCTION(void, Uniform1i, (GLint location, GLint v0), (location, v0))
+GPS_GL_FUNCTION(void, Uniform3i, (GLint location, GLint v0, GLint v1, GLint v2), (location, v0, v1, v2))
+GPS_GL_FUNCTION(void, Uniform2f, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1))
+GPS_GL_FUNCTION(void, Uniform3fv, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+GPS_GL_FUNCTION(void, UniformMatrix3fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), (location, count, transpose, value))
+GPS_GL_FUNCTION(void, UniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), (location, count, transpose, value))
+
+// buffers and vertex arrays
+GPS_GL_FUNCTION(void, GenBuffers, (GLsizei n, GLuint* buffers), (n, buffers))
+GPS_GL_FUNCTION(void, DeleteBuffers, (GLsizei n, const GLuint* buffers), (n, buffers))
+GPS_GL_FUNCTION(void, BindBuffer, (GLenum target, GLuint buffer), (target, buffer))
+GPS_GL_FUNCTION(void, BufferData, (GLenum target, GLsizeiptr size, const void* data, GLenum usage), (target, size, data, usage))
+GPS_GL_FUNCTION(void*, MapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), (target, offset, length, access))
+GPS_GL_FUNCTION(GLboolean, UnmapBuffer, (GLenum target), (target))
+GPS_GL_FUNCTION(void, GenVertexArrays, (GLsizei n, GLuint* arrays), (n, arrays))
+GPS_GL_FUNCTION(void, DeleteVertexArrays, (GLsizei n, const GLuint* arrays), (n, arrays))
+GPS_GL_FUNCTION(void, BindVertexArray, (GLuint array), (array))
+GPS_GL_FUNCTION(void, EnableVertexAttribArray, (GLuint index), (index))
+GPS_GL_FUNCTION(void, VertexAttribPointer, (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer), (index, size, type, normalized, stride, pointer))
+GPS_GL_FUNCTION(void, DrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+GPS_GL_FUNCTION(void, DrawElements, (GLenum mode, GLsizei count, GLenum type, const void* indices), (mode, count, type, indices))
+
+// textures
+GPS_GL_FUNCTION(void, GenTextures, (GLsizei n, GLuint* textures), (n, textures))
+GPS_GL_FUNCTION(void, DeleteTextures, (GLsizei n, const GLuint* textures), (n, textures))
+GPS_GL_FUNCTION(void, ActiveTexture, (GLenum texture), (texture))
+GPS_GL_FUNCTION(void, BindTexture, (GLenum target, GLuint texture), (target, texture))
+GPS_GL_FUNCTION(void, TexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels), (target, level, internalformat, width, height, border, format, type, pixels))
+GPS_GL_FUNCTION(void, TexParameteri, (GLenum target, GLenum pname, GLint param), (target, pname, param))
+GPS_GL_FUNCTION(void, TexParameterfv, (GLenum target, GLenum pname, const GLfloat* params), (target, pname, params))
+GPS_GL_FUNCTION(void, TexBuffer, (GLenum target, GLenum internalformat, GLuint buffer), (target, internalformat, buffer))
+GPS_GL_FUNCTION(void, GenerateMipmap, (GLenum target), (target))
+
+// framebuffers
+GPS_GL_FUNCTION(void, GenFramebuffers, (GLsizei n, GLuint* framebuffers), (n, framebuffers))
+GPS_GL_FUNCTION(void, DeleteFramebuffers, (GLsizei n, const GLuint* framebuffers), (n, framebuffers))
+GPS_GL_FUNCTION(void, BindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer))
+GPS_GL_FUNCTION(void, FramebufferTexture2D, (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level), (target, attachment, textarget, texture, level))
+GPS_GL_FUNCTION(void, FramebufferRenderbuffer, (GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer), (target, attachment, renderbuffertarget, renderbuffer))
+GPS_GL_FUNCTION(GLenum, CheckFramebufferStatus, (GLenum target), (target))
+GPS_GL_FUNCTION(void, DrawBuffer, (GLenum buf), (buf))
+GPS_GL_FUNCTION(void, DrawBuffers, (GLsizei n, const GLenum* bufs), (n, bufs))
+GPS_GL_FUNCTION(void, ReadBuffer, (GLenum src), (src))
+GPS_GL_FUNCTION(void, ReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels), (x, y, width, height, format, type, pixels))
+GPS_GL_FUNCTION(void, BlitFramebuffer, (GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter), (srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter))
+GPS_GL_FUNCTION(void, GenRenderbuffers, (GLsizei n, GLuint* renderbuffers), (n, renderbuffers))
+GPS_GL_FUNCTION(void, DeleteRenderbuffers, (GLsizei n, const GLuint* renderbuffers), (n, renderbuffers))
+GPS_GL_FUNCTION(void, BindRenderbuffer, (GLenum target, GLuint renderbuffer), (target, renderbuffer))
+GPS_GL_FUNCTION(void, RenderbufferStorage, (GLenum target, GLenum internalformat, GLsizei width, GLsizei height), (target, internalformat, width, height))
+GPS_GL_FUNCTION(void, RenderbufferStorageMultisample, (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height), (target, samples, internalformat, width, height))
+
+// queries and sync
+GPS_GL_FUNCTION(void, GenQueries, (GLsizei n, GLuint* ids), (n, ids))
+GPS_GL_FUNCTION(void, DeleteQueries, (GLsizei n, const GLuint* ids), (n, ids))
+GPS_GL_FUNCTION(void, QueryCounter, (GLuint id, GLenum target), (id, target))
+GPS_GL_FUNCTION(void, GetQueryObjectiv, (GLuint id, GLenum pname, GLint* params), (id, pname, params))
+GPS_GL_FUNCTION(void, GetQueryObjectui64v, (GLuint id, GLenum pname, GLuint64* params), (id, pname, params))
+GPS_GL_FUNCTION(GLsync, FenceSync, (GLenum condition, GLbitfield flags), (condition, flags))
+GPS_GL_FUNCTION(GLenum, ClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout))
+GPS_GL_FUNCTION(void, DeleteSync, (GLsync sync), (sync))
+
+#if not defined (__APPLE__)
+// GL_KHR/ARB_parallel_shader_compile, only called when GLEW reports the extension
+GPS_GL_FUNCTION(void, MaxShaderCompilerThreadsKHR, (GLuint count), (count))
+GPS_GL_FUNCTION(void, MaxShaderCompilerThreadsARB, (GLuint count), (count))
+
+// GL 4.3/GL_KHR_debug and GL_ARB_debug_output, see GLDebug
+GPS_GL_FUNCTION(void, DebugMessageCallback, (GLDEBUGPROC callback, const void* userParam), (callback, userParam))
+GPS_GL_FUNCTION(void, DebugMessageControl, (GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled), (source, type, severity, count, ids, enabled))
+GPS_GL_FUNCTION(void, DebugMessageCallbackARB, (GLDEBUGPROCARB callback, const void* userParam), (callback, userParam))
+GPS_GL_FUNCTION(void, DebugMessageControlARB, (GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled), (source, type, severity, count, ids, enabled))
+#endif
@@ -0,0 +1,389 @@
+// GLRedirect.inl
+// Points every gl* call of the including file at the dispatch table, one pair per entry of
+// GLFunctions.inl (the preprocessor cannot generate #define lines from the X-macro).
+// GLEW defines most of these names as macros already, hence the #undef.
+// With GPS_GL_CALL_SITES (debug builds) every call also records its file and line for GLDebug.
+
+#if GPS_GL_CALL_SITES
+
+#undef glEnable
+#define glEnable(...) GPS_GL_CALL_SITE(gps::glDispatch.Enable(__VA_ARGS__))
+#undef glDisable
+#define glDisable(...) GPS_GL_CALL_SITE(gps::glDispatch.Disable(__VA_ARGS__))
+#undef glBlendFunc
+#define glBlendFunc(...) GPS_GL_CALL_SITE(gps::glDispatch.BlendFunc(__VA_ARGS__))
+#undef glDepthFunc
+#define glDepthFunc(...) GPS_GL_CALL_SITE(gps::glDispatch.DepthFunc(__VA_ARGS__))
+#undef glDepthMask
+#define glDepthMask(...) GPS_GL_CALL_SITE(gps::glDispatch.DepthMask(__VA_ARGS__))
+#undef glColorMask
+#define glColorMask(...) GPS_GL_CALL_SITE(gps::glDispatch.ColorMask(__VA_ARGS__))
+#undef glCullFace
+#define glCullFace(...) GPS_GL_CALL_SITE(gps::glDispatch.CullFace(__VA_ARGS__))
+#undef glFrontFace
+#define glFrontFace(...) GPS_GL_CALL_SITE(gps::glDispatch.FrontFace(__VA_ARGS__))
+#undef glPolygonMode
+#define glPolygonMode(...) GPS_GL_CALL_SITE(gps::glDispatch.PolygonMode(__VA_ARGS__))
+#undef glViewport
+#define glViewport(...) GPS_GL_CALL_SITE(gps::glDispatch.Viewport(__VA_ARGS__))
+#undef glClearColor
+#define glClearColor(...) GPS_GL_CALL_SITE(gps::glDispatch.ClearColor(__VA_ARGS__))
+#undef glClear
+#define glClear(...) GPS_GL_CALL_SITE(gps::glDispatch.Clear(__VA_ARGS__))
+#undef glPixelStorei
+#define glPixelStorei(...) GPS_GL_CALL_SITE(gps::glDispatch.PixelStorei(__VA_ARGS__))
+#undef glFinish
+#define glFinish(...) GPS_GL_CALL_SITE(gps::glDispatch.Finish(__VA_ARGS__))
+#undef glGetError
+#define glGetError(...) GPS_GL_CALL_SITE(gps::glDispatch.GetError(__VA_ARGS__))
+#undef glGetIntegerv
+#define glGetIntegerv(...) GPS_GL_CALL_SITE(gps::glDispatch.GetIntegerv(__VA_ARGS__))
+#undef glGetString
+#define glGetString(...) GPS_GL_CALL_SITE(gps::glDispatch.GetString(__VA_ARGS__))
+#undef glCreateShader
+#define glCreateShader(...) GPS_GL_CALL_SITE(gps::glDispatch.CreateShader(__VA_ARGS__))
+#undef glShaderSource
+#define glShaderSource(...) GPS_GL_CALL_SITE(gps::glDispatch.ShaderSource(__VA_ARGS__))
+#undef glCompileShader
+#define glCompileShader(...) GPS_GL_CALL_SITE(gps::glDispatch.CompileShader(__VA_ARGS__))
+#undef glGetShaderiv
+#define glGetShaderiv(...) GPS_GL_CALL_SITE(gps::glDispatch.GetShaderiv(__VA_ARGS__))
+#undef glGetShaderInfoLog
+#define glGetShaderInfoLog(...) GPS_GL_CALL_SITE(gps::glDispatch.GetShaderInfoLog(__VA_ARGS__))
+#undef glDeleteShader
+#define glDeleteShader(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteShader(__VA_ARGS__))
+#undef glCreateProgram
+#define glCreateProgram(...) GPS_GL_CALL_SITE(gps::glDispatch.CreateProgram(__VA_ARGS__))
+#undef glAttachShader
+#define glAttachShader(...) GPS_GL_CALL_SITE(gps::glDispatch.AttachShader(__VA_ARGS__))
+#undef glDetachShader
+#define glDetachShader(...) GPS_GL_CALL_SITE(gps::glDispatch.DetachShader(__VA_ARGS__))
+#undef glLinkProgram
+#define glLinkProgram(...) GPS_GL_CALL_SITE(gps::glDispatch.LinkProgram(__VA_ARGS__))
+#undef glGetProgramiv
+#define glGetProgramiv(...) GPS_GL_CALL_SITE(gps::glDispatch.GetProgramiv(__VA_ARGS__))
+#undef glGetProgramInfoLog
+#define glGetProgramInfoLog(...) GPS_GL_CALL_SITE(gps::glDispatch.GetProgramInfoLog(__VA_ARGS__))
+#undef glProgramParameteri
+#define glProgramParameteri(...) GPS_GL_CALL_SITE(gps::glDispatch.ProgramParameteri(__VA_ARGS__))
+#undef glGetProgramBinary
+#define glGetProgramBinary(...) GPS_GL_CALL_SITE(gps::glDispatch.GetProgramBinary(__VA_ARGS__))
+#undef glProgramBinary
+#define glProgramBinary(...) GPS_GL_CALL_SITE(gps::glDispatch.ProgramBinary(__VA_ARGS__))
+#undef glUseProgram
+#define glUseProgram(...) GPS_GL_CALL_SITE(gps::glDispatch.UseProgram(__VA_ARGS__))
+#undef glDeleteProgram
+#define glDeleteProgram(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteProgram(__VA_ARGS__))
+#undef glGetUniformLocation
+#define glGetUniformLocation(...) GPS_GL_CALL_SITE(gps::glDispatch.GetUniformLocation(__VA_ARGS__))
+#undef glUniform1i
+#define glUniform1i(...) GPS_GL_CALL_SITE(gps::glDispatch.Uniform1i(__VA_ARGS__))
+#undef glUniform3i
+#define glUniform3i(...) GPS_GL_CALL_SITE(gps::glDispatch.Uniform3i(__VA_ARGS__))
+#undef glUniform2f
+#define glUniform2f(...) GPS_GL_CALL_SITE(gps::glDispatch.Uniform2f(__VA_ARGS__))
+#undef glUniform3fv
+#define glUniform3fv(...) GPS_GL_CALL_SITE(gps::glDispatch.Uniform3fv(__VA_ARGS__))
+#undef glUniformMatrix3fv
+#define glUniformMatrix3fv(...) GPS_GL_CALL_SITE(gps::glDispatch.UniformMatrix3fv(__VA_ARGS__))
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv(...) GPS_GL_CALL_SITE(gps::glDispatch.UniformMatrix4fv(__VA_ARGS__))
+#undef glGenBuffers
+#define glGenBuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.GenBuffers(__VA_ARGS__))
+#undef glDeleteBuffers
+#define glDeleteBuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteBuffers(__VA_ARGS__))
+#undef glBindBuffer
+#define glBindBuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.BindBuffer(__VA_ARGS__))
+#undef glBufferData
+#define glBufferData(...) GPS_GL_CALL_SITE(gps::glDispatch.BufferData(__VA_ARGS__))
+#undef glMapBufferRange
+#define glMapBufferRange(...) GPS_GL_CALL_SITE(gps::glDispatch.MapBufferRange(__VA_ARGS__))
+#undef glUnmapBuffer
+#define glUnmapBuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.UnmapBuffer(__VA_ARGS__))
+#undef glGenVertexArrays
+#define glGenVertexArrays(...) GPS_GL_CALL_SITE(gps::glDispatch.GenVertexArrays(__VA_ARGS__))
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteVertexArrays(__VA_ARGS__))
+#undef glBindVertexArray
+#define glBindVertexArray(...) GPS_GL_CALL_SITE(gps::glDispatch.BindVertexArray(__VA_ARGS__))
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray(...) GPS_GL_CALL_SITE(gps::glDispatch.EnableVertexAttribArray(__VA_ARGS__))
+#undef glVertexAttribPointer
+#define glVertexAttribPointer(...) GPS_GL_CALL_SITE(gps::glDispatch.VertexAttribPointer(__VA_ARGS__))
+#undef glDrawArrays
+#define glDrawArrays(...) GPS_GL_CALL_SITE(gps::glDispatch.DrawArrays(__VA_ARGS__))
+#undef glDrawElements
+#define glDrawElements(...) GPS_GL_CALL_SITE(gps::glDispatch.DrawElements(__VA_ARGS__))
+#undef glGenTextures
+#define glGenTextures(...) GPS_GL_CALL_SITE(gps::glDispatch.GenTextures(__VA_ARGS__))
+#undef glDeleteTextures
+#define glDeleteTextures(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteTextures(__VA_ARGS__))
+#undef glActiveTexture
+#define glActiveTexture(...) GPS_GL_CALL_SITE(gps::glDispatch.ActiveTexture(__VA_ARGS__))
+#undef glBindTexture
+#define glBindTexture(...) GPS_GL_CALL_SITE(gps::glDispatch.BindTexture(__VA_ARGS__))
+#undef glTexImage2D
+#define glTexImage2D(...) GPS_GL_CALL_SITE(gps::glDispatch.TexImage2D(__VA_ARGS__))
+#undef glTexParameteri
+#define glTexParameteri(...) GPS_GL_CALL_SITE(gps::glDispatch.TexParameteri(__VA_ARGS__))
+#undef glTexParameterfv
+#define glTexParameterfv(...) GPS_GL_CALL_SITE(gps::glDispatch.TexParameterfv(__VA_ARGS__))
+#undef glTexBuffer
+#define glTexBuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.TexBuffer(__VA_ARGS__))
+#undef glGenerateMipmap
+#define glGenerateMipmap(...) GPS_GL_CALL_SITE(gps::glDispatch.GenerateMipmap(__VA_ARGS__))
+#undef glGenFramebuffers
+#define glGenFramebuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.GenFramebuffers(__VA_ARGS__))
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteFramebuffers(__VA_ARGS__))
+#undef glBindFramebuffer
+#define glBindFramebuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.BindFramebuffer(__VA_ARGS__))
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D(...) GPS_GL_CALL_SITE(gps::glDispatch.FramebufferTexture2D(__VA_ARGS__))
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.FramebufferRenderbuffer(__VA_ARGS__))
+#undef glCheckFramebufferStatus
+#define glCheckFramebufferStatus(...) GPS_GL_CALL_SITE(gps::glDispatch.CheckFramebufferStatus(__VA_ARGS__))
+#undef glDrawBuffer
+#define glDrawBuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.DrawBuffer(__VA_ARGS__))
+#undef glDrawBuffers
+#define glDrawBuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.DrawBuffers(__VA_ARGS__))
+#undef glReadBuffer
+#define glReadBuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.ReadBuffer(__VA_ARGS__))
+#undef glReadPixels
+#define glReadPixels(...) GPS_GL_CALL_SITE(gps::glDispatch.ReadPixels(__VA_ARGS__))
+#undef glBlitFramebuffer
+#define glBlitFramebuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.BlitFramebuffer(__VA_ARGS__))
+#undef glGenRenderbuffers
+#define glGenRenderbuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.GenRenderbuffers(__VA_ARGS__))
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteRenderbuffers(__VA_ARGS__))
+#undef glBindRenderbuffer
+#define glBindRenderbuffer(...) GPS_GL_CALL_SITE(gps::glDispatch.BindRenderbuffer(__VA_ARGS__))
+#undef glRenderbufferStorage
+#define glRenderbufferStorage(...) GPS_GL_CALL_SITE(gps::glDispatch.RenderbufferStorage(__VA_ARGS__))
+#undef glRenderbufferStorageMultisample
+#define glRenderbufferStorageMultisample(...) GPS_GL_CALL_SITE(gps::glDispatch.RenderbufferStorageMultisample(__VA_ARGS__))
+#undef glGenQueries
+#define glGenQueries(...) GPS_GL_CALL_SITE(gps::glDispatch.GenQueries(__VA_ARGS__))
+#undef glDeleteQueries
+#define glDeleteQueries(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteQueries(__VA_ARGS__))
+#undef glQueryCounter
+#define glQueryCounter(...) GPS_GL_CALL_SITE(gps::glDispatch.QueryCounter(__VA_ARGS__))
+#undef glGetQueryObjectiv
+#define glGetQueryObjectiv(...) GPS_GL_CALL_SITE(gps::glDispatch.GetQueryObjectiv(__VA_ARGS__))
+#undef glGetQueryObjectui64v
+#define glGetQueryObjectui64v(...) GPS_GL_CALL_SITE(gps::glDispatch.GetQueryObjectui64v(__VA_ARGS__))
+#undef glFenceSync
+#define glFenceSync(...) GPS_GL_CALL_SITE(gps::glDispatch.FenceSync(__VA_ARGS__))
+#undef glClientWaitSync
+#define glClientWaitSync(...) GPS_GL_CALL_SITE(gps::glDispatch.ClientWaitSync(__VA_ARGS__))
+#undef glDeleteSync
+#define glDeleteSync(...) GPS_GL_CALL_SITE(gps::glDispatch.DeleteSync(__VA_ARGS__))
+#if not defined (__APPLE__)
+#undef glMaxShaderCompilerThreadsKHR
+#define glMaxShaderCompilerThreadsKHR(...) GPS_GL_CALL_SITE(gps::glDispatch.MaxShaderCompilerThreadsKHR(__VA_ARGS__))
+#undef glMaxShaderCompilerThreadsARB
+#define glMaxShaderCompilerThreadsARB(...) GPS_GL_CALL_SITE(gps::glDispatch.MaxShaderCompilerThreadsARB(__VA_ARGS__))
+#undef glDebugMessageCallback
+#define glDebugMessageCallback(...) GPS_GL_CALL_SITE(gps::glDispatch.DebugMessageCallback(__VA_ARGS__))
+#undef glDebugMessageControl
+#define glDebugMessageControl(...) GPS_GL_CALL_SITE(gps::glDispatch.DebugMessageControl(__VA_ARGS__))
+#undef glDebugMessageCallbackARB
+#define glDebugMessageCallbackARB(...) GPS_GL_CALL_SITE(gps::glDispatch.DebugMessageCallbackARB(__VA_ARGS__))
+#undef glDebugMessageControlARB
+#define glDebugMessageControlARB(...) GPS_GL_CALL_SITE(gps::glDispatch.DebugMessageControlARB(__VA_ARGS__))
+#endif
+
+#else
+
+#undef glEnable
+#define glEnable gps::glDispatch.Enable
+#undef glDisable
+#define glDisable gps::glDispatch.Disable
+#undef glBlendFunc
+#define glBlendFunc gps::glDispatch.BlendFunc
+#undef glDepthFunc
+#define glDepthFunc gps::glDispatch.DepthFunc
+#undef glDepthMask
+#define glDepthMask gps::glDispatch.DepthMask
+#undef glColorMask
+#define glColorMask gps::glDispatch.ColorMask
+#undef glCullFace
+#define glCullFace gps::glDispatch.CullFace
+#undef glFrontFace
+#define glFrontFace gps::glDispatch.FrontFace
+#undef glPolygonMode
+#define glPolygonMode gps::glDispatch.PolygonMode
+#undef glViewport
+#define glViewport gps::glDispatch.Viewport
+#undef glClearColor
+#define glClearColor gps::glDispatch.ClearColor
+#undef glClear
+#define glClear gps::glDispatch.Clear
+#undef glPixelStorei
+#define glPixelStorei gps::glDispatch.PixelStorei
+#undef glFinish
+#define glFinish gps::glDispatch.Finish
+#undef glGetError
+#define glGetError gps::glDispatch.GetError
+#undef glGetIntegerv
+#define glGetIntegerv gps::glDispatch.GetIntegerv
+#undef glGetString
+#define glGetString gps::glDispatch.GetString
+#undef glCreateShader
+#define glCreateShader gps::glDispatch.CreateShader
+#undef glShaderSource
+#define glShaderSource gps::glDispatch.ShaderSource
+#undef glCompileShader
+#define glCompileShader gps::glDispatch.CompileShader
+#undef glGetShaderiv
+#define glGetShaderiv gps::glDispatch.GetShaderiv
+#undef glGetShaderInfoLog
+#define glGetShaderInfoLog gps::glDispatch.GetShaderInfoLog
+#undef glDeleteShader
+#define glDeleteShader gps::glDispatch.DeleteShader
+#undef glCreateProgram
+#define glCreateProgram gps::glDispatch.CreateProgram
+#undef glAttachShader
+#define glAttachShader gps::glDispatch.AttachShader
+#undef glDetachShader
+#define glDetachShader gps::glDispatch.DetachShader
+#undef glLinkProgram
+#define glLinkProgram gps::glDispatch.LinkProgram
+#undef glGetProgramiv
+#define glGetProgramiv gps::glDispatch.GetProgramiv
+#undef glGetProgramInfoLog
+#define glGetProgramInfoLog gps::glDispatch.GetProgramInfoLog
+#undef glProgramParameteri
+#define glProgramParameteri gps::glDispatch.ProgramParameteri
+#undef glGetProgramBinary
+#define glGetProgramBinary gps::glDispatch.GetProgramBinary
+#undef glProgramBinary
+#define glProgramBinary gps::glDispatch.ProgramBinary
+#undef glUseProgram
+#define glUseProgram gps::glDispatch.UseProgram
+#undef glDeleteProgram
+#define glDeleteProgram gps::glDispatch.DeleteProgram
+#undef glGetUniformLocation
+#define glGetUniformLocation gps::glDispatch.GetUniformLocation
+#undef glUniform1i
+#define glUniform1i gps::glDispatch.Uniform1i
+#undef glUniform3i
+#define glUniform3i gps::glDispatch.Uniform3i
+#undef glUniform2f
+#define glUniform2f gps::glDispatch.Uniform2f
+#undef glUniform3fv
+#define glUniform3fv gps::glDispatch.Uniform3fv
+#undef glUniformMatrix3fv
+#define glUniformMatrix3fv gps::glDispatch.UniformMatrix3fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv gps::glDispatch.UniformMatrix4fv
+#undef glGenBuffers
+#define glGenBuffers gps::glDispatch.GenBuffers
+#undef glDeleteBuffers
+#define glDeleteBuffers gps::glDispatch.DeleteBuffers
+#undef glBindBuffer
+#define glBindBuffer gps::glDispatch.BindBuffer
+#undef glBufferData
+#define glBufferData gps::glDispatch.BufferData
+#undef glMapBufferRange
+#define glMapBufferRange gps::glDispatch.MapBufferRange
+#undef glUnmapBuffer
+#define glUnmapBuffer gps::glDispatch.UnmapBuffer
+#undef glGenVertexArrays
+#define glGenVertexArrays gps::glDispatch.GenVertexArrays
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays gps::glDispatch.DeleteVertexArrays
+#undef glBindVertexArray
+#define glBindVertexArray gps::glDispatch.BindVertexArray
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray gps::glDispatch.EnableVertexAttribArray
+#undef glVertexAttribPointer
+#define glVertexAttribPointer gps::glDispatch.VertexAttribPointer
+#undef glDrawArrays
+#define glDrawArrays gps::glDispatch.DrawArrays
+#undef glDrawElements
+#define glDrawElements gps::glDispatch.DrawElements
+#undef glGenTextures
+#define glGenTextures gps::glDispatch.GenTextures
+#undef glDeleteTextures
+#define glDeleteTextures gps::glDispatch.DeleteTextures
+#undef glActiveTexture
+#define glActiveTexture gps::glDispatch.ActiveTexture
+#undef glBindTexture
+#define glBindTexture gps::glDispatch.BindTexture
+#undef glTexImage2D
+#define glTexImage2D gps::glDispatch.TexImage2D
+#undef glTexParameteri
+#define glTexParameteri gps::glDispatch.TexParameteri
+#undef glTexParameterfv
+#define glTexParameterfv gps::glDispatch.TexParameterfv
+#undef glTexBuffer
+#define glTexBuffer gps::glDispatch.TexBuffer
+#undef glGenerateMipmap
+#define glGenerateMipmap gps::glDispatch.GenerateMipmap
+#undef glGenFramebuffers
+#define glGenFramebuffers gps::glDispatch.GenFramebuffers
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers gps::glDispatch.DeleteFramebuffers
+#undef glBindFramebuffer
+#define glBindFramebuffer gps::glDispatch.BindFramebuffer
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D gps::glDispatch.FramebufferTexture2D
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer gps::glDispatch.FramebufferRenderbuffer
+#undef glCheckFramebufferStatus
+#define glCheckFramebufferStatus gps::glDispatch.CheckFramebufferStatus
+#undef glDrawBuffer
+#define glDrawBuffer gps::glDispatch.DrawBuffer
+#undef glDrawBuffers
+#define glDrawBuffers gps::glDispatch.DrawBuffers
+#undef glReadBuffer
+#define glReadBuffer gps::glDispatch.ReadBuffer
+#undef glReadPixels
+#define glReadPixels gps::glDispatch.ReadPixels
+#undef glBlitFramebuffer
+#define glBlitFramebuffer gps::glDispatch.BlitFramebuffer
+#undef glGenRenderbuffers
+#define glGenRenderbuffers gps::glDispatch.GenRenderbuffers
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers gps::glDispatch.DeleteRenderbuffers
+#undef glBindRenderbuffer
+#define glBindRenderbuffer gps::glDispatch.BindRenderbuffer
+#undef glRenderbufferStorage
+#define glRenderbufferStorage gps::glDispatch.RenderbufferStorage
+#undef glRenderbufferStorageMultisample
+#define glRenderbufferStorageMultisample gps::glDispatch.RenderbufferStorageMultisample
+#undef glGenQueries
+#define glGenQueries gps::glDispatch.GenQueries
+#undef glDeleteQueries
+#define glDeleteQueries gps::glDispatch.DeleteQueries
+#undef glQueryCounter
+#define glQueryCounter gps::glDispatch.QueryCounter
+#undef glGetQueryObjectiv
+#define glGetQueryObjectiv gps::glDispatch.GetQueryObjectiv
+#undef glGetQueryObjectui64v
+#define glGetQueryObjectui64v gps::glDispatch.GetQueryObjectui64v
+#undef glFenceSync
+#define glFenceSync gps::glDispatch.FenceSync
+#undef glClientWaitSync
+#define glClientWaitSync gps::glDispatch.ClientWaitSync
+#undef glDeleteSync
+#define glDeleteSync gps::glDispatch.DeleteSync
+#if not defined (__APPLE__)
+#undef glMaxShaderCompilerThreadsKHR
+#define glMaxShaderCompilerThreadsKHR gps::glDispatch.MaxShaderCompilerThreadsKHR
+#undef glMaxShaderCompilerThreadsARB
+#define glMaxShaderCompilerThreadsARB gps::glDispatch.MaxShaderCompilerThreadsARB
+#undef glDebugMessageCallback
+#define glDebugMessageCallback gps::glDispatch.DebugMessageCallback
+#undef glDebugMessageControl
+#define glDebugMessageControl gps::glDispatch.DebugMessageControl
+#undef glDebugMessageCallbackARB
+#define glDebugMessageCallbackARB gps::glDispatch.DebugMessageCallbackARB
+#undef glDebugMessageControlARB
+#define glDebugMessageControlARB gps::glDispatch.DebugMessageControlARB
+#endif
+
+#endif
@@ -0,0 +1,263 @@
+#include "GpuProfiler.hpp"
+#include "GLDispatch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace gps {
+
+    // std::min takes it by reference, so it needs a definition
+    const int GpuProfiler::HISTORY_FRAMES;
+
+    GpuProfiler::GpuProfiler() {
+
+        this->drawScopesEnabled = false;
+        this->reportInterval = 120;
+        this->frameIndex = 0;
+        this->framesSinceReport = 0;
+
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            frames[i].used = 0;
+        }
+    }
+
+    void GpuProfiler::init() {
+
+        // enough for the passes of a frame, newQuery grows the pool when draw scopes are on
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+
+            frames[i].queries.resize(32);
+            glGenQueries((GLsizei)frames[i].queries.size(), &frames[i].queries[0]);
+        }
+    }
+
+    void GpuProfiler::Delete() {
+
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+
+            if (!frames[i].queries.empty()) {
+                glDeleteQueries((GLsizei)frames[i].queries.size(), &frames[i].queries[0]);
+            }
+            frames[i].queries.clear();
+            frames[i].scopes.clear();
+            frames[i].used = 0;
+        }
+    }
+
+    void GpuProfiler::beginFrame() {
+
+        // this set was issued FRAMES_IN_FLIGHT frames ago, collect it before reusing it
+        FrameQueries& frame = frames[frameIndex];
+        readBack(frame);
+
+        frame.scopes.clear();
+        frame.used = 0;
+        openScopes.clear();
+        openNames.clear();
+    }
+
+    bool GpuProfiler::endFrame() {
+
+        frameIndex = (frameIndex + 1) % FRAMES_IN_FLIGHT;
+
+        if (++framesSinceReport < reportInterval) {
+            return false;
+        }
+
+        framesSinceReport = 0;
+        return !history.empty();
+    }
+
+    int GpuProfiler::newQuery() {
+
+        FrameQueries& frame = frames[frameIndex];
+
+        if (frame.used == (int)frame.queries.size()) {
+
+            size_t oldSize = frame.queries.size();
+            frame.queries.resize(std::max(oldSize * 2, (size_t)32));
+            glGenQueries((GLsizei)(frame.queries.size() - oldSize), &frame.queries[oldSize]);
+        }
+
+        return frame.used++;
+    }
+
+    void GpuProfiler::beginScope(const char* name) {
+
+        std::string fullName = openNames.empty() ? std::string(name) : openNames.back() + "/" + name;
+
+        std::map<std::string, int>::iterator found = historyIndex.find(fullName);
+        int scope;
+
+        if (found == historyIndex.end()) {
+
+            ScopeHistory newScope;
+            newScope.name = fullName;
+            newScope.samples.assign(HISTORY_FRAMES, 0.0f);
+            newScope.next = 0;
+            newScope.count = 0;
+
+            scope = (int)history.size();
+            history.push_back(newScope);
+            historyIndex[fullName] = scope;
+        }
+        else {
+            scope = found->second;
+        }
+
+        FrameQueries& frame = frames[frameIndex];
+
+        ScopeRecord record;
+        record.scope = scope;
+        record.beginQuery = newQuery();
+        record.endQuery = -1;
+        glQueryCounter(frame.queries[record.beginQuery], GL_TIMESTAMP);
+
+        openScopes.push_back((int)frame.scopes.size());
+        openNames.push_back(fullName);
+        frame.scopes.push_back(record);
+    }
+
+    void GpuProfiler::endScope() {
+
+        if (openScopes.empty()) {
+            return;
+        }
+
+        FrameQueries& frame = frames[frameIndex];
+        ScopeRecord& record = frame.scopes[openScopes.back()];
+
+        record.endQuery = newQuery();
+        glQueryCounter(frame.queries[record.endQuery], GL_TIMESTAMP);
+
+        openScopes.pop_back();
+        openNames.pop_back();
+    }
+
+    void GpuProfiler::readBack(FrameQueries& frame) {
+
+        if (frame.used == 0) {
+            return;
+        }
+
+        // timestamps complete in order, when the last one is there all of them are
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            // drop the frame rather than wait for the GPU
+            return;
+        }
+
+        for (size_t i = 0; i < frame.scopes.size(); i++) {
+
+            const ScopeRecord& record = frame.scopes[i];
+            if (record.endQuery < 0) {
+                continue;
+            }
+
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(frame.queries[record.beginQuery], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[record.endQuery], GL_QUERY_RESULT, &end);
+
+            ScopeHistory& scope = history[record.scope];
+            scope.samples[scope.next] = (float)((end - begin) / 1.0e6);
+            scope.next = (scope.next + 1) % HISTORY_FRAMES;
+            scope.count = std::min(scope.count + 1, HISTORY_FRAMES);
+        }
+    }
+
+    GpuScopeStats GpuProfiler::computeStats(const ScopeHistory& scope) {
+
+        GpuScopeStats stats;
+        stats.name = scope.name;
+        stats.minMs = 0.0;
+        stats.avgMs = 0.0;
+        stats.p99Ms = 0.0;
+        stats.samples = scope.count;
+
+        if (scope.count == 0) {
+            return stats;
+        }
+
+        // the ring buffer is full or filled from index 0, either way the first count entries are valid
+        std::vector<float> sorted(scope.samples.begin(), scope.samples.begin() + scope.count);
+        std::sort(sorted.begin(), sorted.end());
+
+        double sum = 0.0;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            sum += sorted[i];
+        }
+
+        stats.minMs = sorted.front();
+        stats.avgMs = sum / sorted.size();
+        stats.p99Ms = sorted[(sorted.size() - 1) * 99 / 100];
+
+        return stats;
+    }
+
+    std::vector<GpuScopeStats> GpuProfiler::getStats() {
+
+        std::vector<GpuScopeStats> stats;
+
+        for (size_t i = 0; i < history.size(); i++) {
+            stats.push_back(computeStats(history[i]));
+        }
+
+        return stats;
+    }
+
+    bool GpuProfiler::getStats(std::string name, GpuScopeStats& stats) {
+
+        std::map<std::string, int>::iterator found = historyIndex.find(name);
+        if (found == historyIndex.end()) {
+            return false;
+        }
+
+        stats = computeStats(history[found->second]);
+        return true;
+    }
+
+    void GpuProfiler::printReport(const char* label) {
+
+        // one line: name min/avg/p99 for every scope with samples in the window
+        fprintf(stdout, "GPU %s |", label);
+
+        std::vector<GpuScopeStats> stats = getStats();
+        for (size_t i = 0; i < stats.size(); i++) {
+
+            if (stats[i].samples == 0) {
+                continue;
+            }
+            fprintf(stdout, " %s %.3f/%.3f/%.3f", stats[i].name.c_str(), stats[i].minMs, stats[i].avgMs, stats[i].p99Ms);
+        }
+
+        fprintf(stdout, " (min/avg/p99 ms)\n");
+    }
+
+    void GpuProfiler::reset() {
+
+        // scopes that no longer run (e.g. the pre-pass when it is turned off) drop out of the report
+        history.clear();
+        historyIndex.clear();
+
+        // records still in flight point at the old history
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            frames[i].scopes.clear();
+            frames[i].used = 0;
+        }
+        openScopes.clear();
+        openNames.clear();
+        framesSinceReport = 0;
+    }
+
+    GpuScope::GpuScope(GpuProfiler& profiler, const char* name) : profiler(profiler) {
+
+        profiler.beginScope(name);
+    }
+
+    GpuScope::~GpuScope() {
+
+        profiler.endScope();
+    }
+}
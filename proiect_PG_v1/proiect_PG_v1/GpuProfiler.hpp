@@ -0,0 +1,114 @@
+#ifndef GpuProfiler_hpp
+#define GpuProfiler_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    struct GpuScopeStats {
+
+        std::string name;   // nested scopes are "parent/child"
+        double minMs;
+        double avgMs;
+        double p99Ms;
+        int samples;        // frames in the rolling window
+    };
+
+    // GPU timings of named scopes from GL_TIMESTAMP queries.
+    // Every scope writes a timestamp when it begins and ends, so scopes can nest
+    // (GL_TIME_ELAPSED queries cannot). The queries of a frame are read back when their
+    // set is reused FRAMES_IN_FLIGHT frames later, the GPU is long done with them by then.
+    class GpuProfiler {
+
+    public:
+        static const int FRAMES_IN_FLIGHT = 3;
+        static const int HISTORY_FRAMES = 240;
+
+        GpuProfiler();
+
+        void init();
+        void Delete();
+
+        // Call once per frame around all the scopes. endFrame returns true every
+        // reportInterval frames, when printReport has a fresh window to show
+        void beginFrame();
+        bool endFrame();
+
+        void beginScope(const char* name);
+        void endScope();
+
+        // Per Model3D draw scopes inside the passes, off by default
+        bool drawScopesEnabled;
+        int reportInterval;
+
+        // Rolling min/avg/p99 of every scope seen so far, in first seen order
+        std::vector<GpuScopeStats> getStats();
+        bool getStats(std::string name, GpuScopeStats& stats);
+
+        void printReport(const char* label);
+
+        // Forgets the history, e.g. after switching a render mode
+        void reset();
+
+    private:
+        struct ScopeRecord {
+
+            int scope;          // index into history
+            int beginQuery;
+            int endQuery;
+        };
+
+        struct FrameQueries {
+
+            std::vector<GLuint> queries;
+            std::vector<ScopeRecord> scopes;
+            int used;
+        };
+
+        struct ScopeHistory {
+
+            std::string name;
+            std::vector<float> samples; // ring buffer, milliseconds
+            int next;
+            int count;
+        };
+
+        FrameQueries frames[FRAMES_IN_FLIGHT];
+        int frameIndex;
+        int framesSinceReport;
+
+        std::vector<ScopeHistory> history;
+        std::map<std::string, int> historyIndex;
+
+        // records of the scopes currently open, innermost last
+        std::vector<int> openScopes;
+        std::vector<std::string> openNames;
+
+        int newQuery();
+        void readBack(FrameQueries& frame);
+        GpuScopeStats computeStats(const ScopeHistory& scope);
+    };
+
+    // Times the enclosing C++ scope
+    class GpuScope {
+
+    public:
+        GpuScope(GpuProfiler& profiler, const char* name);
+        ~GpuScope();
+
+    private:
+        GpuProfiler& profiler;
+    };
+}
+
+#endif /* GpuProfiler_hpp */
@@ -0,0 +1,375 @@
+#include "HiZCuller.hpp"
+#include "GLDispatch.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace gps {
+
+    HiZCuller::HiZCuller() : depthFramebuffer(0), depthTexture(0), depthTextureFormat(0), emptyVAO(0), width(0), height(0),
+        first(0), pending(0), screenWidth(0), screenHeight(0), ready(false), buildCount(0), depthBuild(0) {
+
+        for (int i = 0; i < BUFFER_COUNT; i++) {
+            pixelBuffers[i] = 0;
+            readbacks[i].fence = 0;
+        }
+    }
+
+    void HiZCuller::createTargets(GLenum depthFormat, int width, int height) {
+
+        this->width = width;
+        this->height = height;
+        this->depthTextureFormat = depthFormat;
+
+        bool packedStencil = depthFormat == GL_DEPTH24_STENCIL8;
+
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, depthFormat, width, height, 0, packedStencil ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT,
+            packedStencil ? GL_UNSIGNED_INT_24_8 : GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &depthFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, packedStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+            GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+
+        // halve until the readback is small, the CPU builds the coarser levels
+        int levelWidth = width;
+        int levelHeight = height;
+        do {
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+
+            GLuint texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            GLuint framebuffer;
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+            levelTextures.push_back(texture);
+            levelFramebuffers.push_back(framebuffer);
+            levelWidths.push_back(levelWidth);
+            levelHeights.push_back(levelHeight);
+        } while (levelWidth > READBACK_WIDTH);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenBuffers(BUFFER_COUNT, pixelBuffers);
+        for (int i = 0; i < BUFFER_COUNT; i++) {
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)levelWidth * levelHeight * sizeof(float), NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // core profile needs a bound VAO even though the fullscreen triangle has no attributes
+        if (emptyVAO == 0) {
+            glGenVertexArrays(1, &emptyVAO);
+        }
+    }
+
+    void HiZCuller::deleteTargets() {
+
+        if (width == 0) {
+            return;
+        }
+
+        reset();
+
+        glDeleteBuffers(BUFFER_COUNT, pixelBuffers);
+        glDeleteFramebuffers((GLsizei)levelFramebuffers.size(), &levelFramebuffers[0]);
+        glDeleteTextures((GLsizei)levelTextures.size(), &levelTextures[0]);
+        glDeleteFramebuffers(1, &depthFramebuffer);
+        glDeleteTextures(1, &depthTexture);
+
+        levelFramebuffers.clear();
+        levelTextures.clear();
+        levelWidths.clear();
+        levelHeights.clear();
+        width = 0;
+        height = 0;
+    }
+
+    void HiZCuller::Delete() {
+
+        deleteTargets();
+        if (emptyVAO != 0) {
+            glDeleteVertexArrays(1, &emptyVAO);
+            emptyVAO = 0;
+        }
+    }
+
+    void HiZCuller::build(gps::Shader downsampleShader, GLuint sourceFramebuffer, GLenum depthFormat, int width, int height,
+        const glm::mat4& viewProjection, const glm::vec3& eyePosition) {
+
+        if (width != this->width || height != this->height || depthFormat != depthTextureFormat) {
+            deleteTargets();
+            createTargets(depthFormat, width, height);
+        }
+
+        buildCount++;
+
+        // copy the depth, resolving the samples
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        // every texel of a level is one fragment of a fullscreen triangle
+        GLint polygonMode[2] = { GL_FILL, GL_FILL };
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+
+        downsampleShader.useShaderProgram();
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(glGetUniformLocation(downsampleShader.shaderProgram, "sourceDepth"), 0);
+        glBindVertexArray(emptyVAO);
+
+        for (size_t i = 0; i < levelFramebuffers.size(); i++) {
+
+            glBindFramebuffer(GL_FRAMEBUFFER, levelFramebuffers[i]);
+            glViewport(0, 0, levelWidths[i], levelHeights[i]);
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? depthTexture : levelTextures[i - 1]);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glEnable(GL_BLEND);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+
+        // with a pack buffer bound glReadPixels only queues the copy, collect maps it later
+        if (pending < BUFFER_COUNT) {
+
+            int slot = (first + pending) % BUFFER_COUNT;
+            Readback& readback = readbacks[slot];
+            readback.width = levelWidths.back();
+            readback.height = levelHeights.back();
+            readback.screenWidth = width;
+            readback.screenHeight = height;
+            readback.viewProjection = viewProjection;
+            readback.eyePosition = eyePosition;
+            readback.build = buildCount;
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, levelFramebuffers.back());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+            glReadPixels(0, 0, readback.width, readback.height, GL_RED, GL_FLOAT, 0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            pending++;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    void HiZCuller::collect() {
+
+        while (pending > 0) {
+
+            Readback& readback = readbacks[first];
+            if (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+                return;
+            }
+            glDeleteSync(readback.fence);
+            readback.fence = 0;
+
+            GLsizeiptr size = (GLsizeiptr)readback.width * readback.height * sizeof(float);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[first]);
+            const float* data = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            if (data) {
+                setDepth(readback.width, readback.height, data, readback.screenWidth, readback.screenHeight,
+                    readback.viewProjection, readback.eyePosition);
+                depthBuild = readback.build;
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            first = (first + 1) % BUFFER_COUNT;
+            pending--;
+        }
+    }
+
+    void HiZCuller::reset() {
+
+        for (int i = 0; i < pending; i++) {
+
+            Readback& readback = readbacks[(first + i) % BUFFER_COUNT];
+            glDeleteSync(readback.fence);
+            readback.fence = 0;
+        }
+        first = 0;
+        pending = 0;
+
+        levels.clear();
+        ready = false;
+    }
+
+    bool HiZCuller::isReady() {
+
+        return ready && buildCount - depthBuild <= MAX_AGE_FRAMES;
+    }
+
+    void HiZCuller::setDepth(int width, int height, const float* depth, int screenWidth, int screenHeight,
+        const glm::mat4& viewProjection, const glm::vec3& eyePosition) {
+
+        this->screenWidth = screenWidth;
+        this->screenHeight = screenHeight;
+        this->viewProjection = viewProjection;
+        this->eyePosition = eyePosition;
+
+        levels.resize(1);
+        levels[0].width = width;
+        levels[0].height = height;
+        levels[0].shift = 0;
+        while ((screenWidth >> levels[0].shift) > width) {
+            levels[0].shift++;
+        }
+        levels[0].depth.assign(depth, depth + (size_t)width * height);
+
+        // down to a single texel, same rule as the GPU levels: the last row and column take the odd one
+        while (levels.back().width > 1 || levels.back().height > 1) {
+
+            Level level;
+            const Level& source = levels.back();
+            level.width = std::max(source.width / 2, 1);
+            level.height = std::max(source.height / 2, 1);
+            level.shift = source.shift + 1;
+            level.depth.resize((size_t)level.width * level.height);
+
+            for (int y = 0; y < level.height; y++) {
+
+                int y1 = y == level.height - 1 ? source.height - 1 : 2 * y + 1;
+                for (int x = 0; x < level.width; x++) {
+
+                    int x1 = x == level.width - 1 ? source.width - 1 : 2 * x + 1;
+                    float farthest = 0.0f;
+                    for (int sy = 2 * y; sy <= y1; sy++) {
+                        for (int sx = 2 * x; sx <= x1; sx++) {
+                            farthest = std::max(farthest, source.depth[(size_t)sy * source.width + sx]);
+                        }
+                    }
+                    level.depth[(size_t)y * level.width + x] = farthest;
+                }
+            }
+            levels.push_back(level);
+        }
+
+        ready = true;
+        depthBuild = buildCount;
+    }
+
+    float HiZCuller::farthestDepth(int x0, int y0, int x1, int y1) {
+
+        // the finest level where the rectangle covers at most 2x2 texels, or close to it
+        int extent = std::max(x1 - x0, y1 - y0);
+        size_t index = 0;
+        while (index + 1 < levels.size() && (extent >> levels[index].shift) > 1) {
+            index++;
+        }
+
+        const Level& level = levels[index];
+        int tx0 = std::min(x0 >> level.shift, level.width - 1);
+        int tx1 = std::min(x1 >> level.shift, level.width - 1);
+        int ty0 = std::min(y0 >> level.shift, level.height - 1);
+        int ty1 = std::min(y1 >> level.shift, level.height - 1);
+
+        float farthest = 0.0f;
+        for (int y = ty0; y <= ty1; y++) {
+            for (int x = tx0; x <= tx1; x++) {
+                farthest = std::max(farthest, level.depth[(size_t)y * level.width + x]);
+            }
+        }
+        return farthest;
+    }
+
+    bool HiZCuller::isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model, const glm::vec3& eyePosition) {
+
+        if (!isReady()) {
+            return false;
+        }
+
+        // world space box, grown by how far the camera moved since the depth was rendered
+        glm::vec3 worldMin = glm::vec3(FLT_MAX);
+        glm::vec3 worldMax = glm::vec3(-FLT_MAX);
+        for (int i = 0; i < 8; i++) {
+
+            glm::vec3 corner = glm::vec3((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y,
+                (i & 4) ? boundsMax.z : boundsMin.z);
+            glm::vec3 world = glm::vec3(model * glm::vec4(corner, 1.0f));
+            worldMin = glm::min(worldMin, world);
+            worldMax = glm::max(worldMax, world);
+        }
+
+        float padding = glm::length(eyePosition - this->eyePosition);
+        worldMin -= glm::vec3(padding);
+        worldMax += glm::vec3(padding);
+
+        glm::vec3 ndcMin = glm::vec3(FLT_MAX);
+        glm::vec3 ndcMax = glm::vec3(-FLT_MAX);
+        for (int i = 0; i < 8; i++) {
+
+            glm::vec4 clip = viewProjection * glm::vec4((i & 1) ? worldMax.x : worldMin.x, (i & 2) ? worldMax.y : worldMin.y,
+                (i & 4) ? worldMax.z : worldMin.z, 1.0f);
+
+            // reaches behind the camera of the depth
+            if (clip.w <= 1e-5f) {
+                return false;
+            }
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+
+        // the depth says nothing about what was outside the view
+        if (ndcMin.x < -1.0f || ndcMax.x > 1.0f || ndcMin.y < -1.0f || ndcMax.y > 1.0f) {
+            return false;
+        }
+
+        int x0 = std::min((int)((ndcMin.x * 0.5f + 0.5f) * screenWidth), screenWidth - 1);
+        int x1 = std::min((int)((ndcMax.x * 0.5f + 0.5f) * screenWidth), screenWidth - 1);
+        int y0 = std::min((int)((ndcMin.y * 0.5f + 0.5f) * screenHeight), screenHeight - 1);
+        int y1 = std::min((int)((ndcMax.y * 0.5f + 0.5f) * screenHeight), screenHeight - 1);
+
+        float nearestDepth = ndcMin.z * 0.5f + 0.5f;
+        return nearestDepth > farthestDepth(x0, y0, x1, y1);
+    }
+
+    int HiZCuller::cullModel(gps::Model3D& model3D, const glm::mat4& model, const glm::vec3& eyePosition, std::vector<bool>& visible) {
+
+        visible.assign(model3D.getMeshCount(), true);
+        if (!isReady()) {
+            return 0;
+        }
+
+        int occluded = 0;
+        for (size_t i = 0; i < visible.size(); i++) {
+
+            const gps::Mesh& mesh = model3D.getMesh(i);
+            if (isOccluded(mesh.boundsMin, mesh.boundsMax, model, eyePosition)) {
+                visible[i] = false;
+                occluded++;
+            }
+        }
+        return occluded;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef HiZCuller_hpp
+#define HiZCuller_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Shader.hpp"
+#include "Model3D.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    // Occlusion culling against a hierarchical depth (Hi-Z) pyramid of an earlier frame.
+    // build() copies the depth of the finished frame, halves it on the GPU with a max filter down to
+    // about READBACK_WIDTH texels across and starts an asynchronous readback; collect() picks up the
+    // newest finished one a frame or two later and builds the coarser levels on the CPU.
+    // A box is occluded when its nearest depth is behind the farthest depth of every pyramid texel
+    // under its screen rectangle, in the view the depth was rendered from. Boxes reaching outside
+    // that view or behind its camera are visible, and boxes are grown by the distance the camera
+    // moved since, so objects coming into view are drawn rather than culled.
+    class HiZCuller {
+
+    public:
+        static const int BUFFER_COUNT = 3;
+        static const int READBACK_WIDTH = 160;
+        // older depth is not trusted
+        static const int MAX_AGE_FRAMES = 4;
+
+        HiZCuller();
+
+        void Delete();
+
+        // Call after the last opaque draw of a frame. The source depth is multisampled or not,
+        // depthFormat must be its format (glBlitFramebuffer copies depth between equal formats only)
+        void build(gps::Shader downsampleShader, GLuint sourceFramebuffer, GLenum depthFormat, int width, int height,
+            const glm::mat4& viewProjection, const glm::vec3& eyePosition);
+
+        // Takes the newest finished readback, never waits for the GPU
+        void collect();
+
+        // Forgets the pyramid, nothing is culled until the next readback
+        void reset();
+        bool isReady();
+
+        // CPU side, also usable without a GL context: level 0 of the pyramid (rows bottom to top,
+        // each texel the farthest depth of its screenWidth / width x screenHeight / height pixels)
+        void setDepth(int width, int height, const float* depth, int screenWidth, int screenHeight,
+            const glm::mat4& viewProjection, const glm::vec3& eyePosition);
+
+        bool isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model, const glm::vec3& eyePosition);
+
+        // visible gets one entry per mesh, returns the number of occluded meshes
+        int cullModel(gps::Model3D& model3D, const glm::mat4& model, const glm::vec3& eyePosition, std::vector<bool>& visible);
+
+    private:
+        struct Level {
+
+            int width;
+            int height;
+            int shift;  // screen pixels per texel, as a power of two
+            std::vector<float> depth;
+        };
+
+        struct Readback {
+
+            GLsync fence;
+            int width;
+            int height;
+            int screenWidth;
+            int screenHeight;
+            glm::mat4 viewProjection;
+            glm::vec3 eyePosition;
+            int build;
+        };
+
+        // GPU pyramid: the single sampled copy of the source depth and its halvings
+        GLuint depthFramebuffer;
+        GLuint depthTexture;
+        GLenum depthTextureFormat;
+        std::vector<GLuint> levelTextures;
+        std::vector<GLuint> levelFramebuffers;
+        std::vector<int> levelWidths;
+        std::vector<int> levelHeights;
+        GLuint emptyVAO;
+        int width;
+        int height;
+
+        GLuint pixelBuffers[BUFFER_COUNT];
+        Readback readbacks[BUFFER_COUNT];
+        int first;   // oldest pending readback
+        int pending;
+
+        // CPU pyramid
+        std::vector<Level> levels;
+        int screenWidth;
+        int screenHeight;
+        glm::mat4 viewProjection;
+        glm::vec3 eyePosition;
+        bool ready;
+        int buildCount;
+        int depthBuild; // the build the CPU pyramid comes from
+
+        void createTargets(GLenum depthFormat, int width, int height);
+        void deleteTargets();
+        float farthestDepth(int x0, int y0, int x1, int y1);
+    };
+}
+
+#endif /* HiZCuller_hpp */
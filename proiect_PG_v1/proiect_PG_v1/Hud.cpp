@@ -0,0 +1,242 @@
+#include "Hud.hpp"
+#include "GLDispatch.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace gps {
+
+    // 3x5 glyphs of ' ' to '_', one octal digit per row from the top, the high bit is the left column
+    static const unsigned short FONT[64] = {
+        000000, 022202, 055000, 057575, 036236, 051245, 025253, 022000, // space ! " # $ % & '
+        012221, 042224, 005250, 002720, 000024, 000700, 000002, 011244, // ( ) * + , - . /
+        075557, 026227, 071747, 071317, 055711, 074717, 074757, 071122, // 0 - 7
+        075757, 075717, 002020, 002024, 012421, 007070, 042124, 071302, // 8 9 : ; < = > ?
+        075747, 025755, 065656, 034443, 065556, 074647, 074644, 034553, // @ A - G
+        055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552, // H - O
+        065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, // P - W
+        055255, 055222, 071247, 064446, 044211, 031113, 025000, 000007, // X Y Z [ \ ] ^ _
+    };
+
+    static const int GLYPH_WIDTH = 3;
+    static const int GLYPH_HEIGHT = 5;
+
+    // a glyph per 4x6 cell, the cell after the last glyph is solid for rectangles
+    static const int CELL_WIDTH = 4;
+    static const int CELL_HEIGHT = 6;
+    static const int ATLAS_COLUMNS = 16;
+    static const int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+    static const int ATLAS_HEIGHT = 5 * CELL_HEIGHT;
+    static const int SOLID_CELL = 64;
+
+    Hud::Hud() : scale(2), fontTexture(0), vao(0), vbo(0), screenWidth(1), screenHeight(1),
+        frameTimes(GRAPH_FRAMES, 0.0f), nextFrameTime(0), frameTimeCount(0) {
+    }
+
+    void Hud::Create() {
+
+        std::vector<GLubyte> atlas(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+
+        for (int glyph = 0; glyph < 64; glyph++) {
+
+            int cellX = (glyph % ATLAS_COLUMNS) * CELL_WIDTH;
+            int cellY = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+
+            for (int row = 0; row < GLYPH_HEIGHT; row++) {
+                for (int column = 0; column < GLYPH_WIDTH; column++) {
+                    if ((FONT[glyph] >> (3 * (GLYPH_HEIGHT - 1 - row) + GLYPH_WIDTH - 1 - column)) & 1) {
+                        atlas[(cellY + row) * ATLAS_WIDTH + cellX + column] = 255;
+                    }
+                }
+            }
+        }
+
+        int solidX = (SOLID_CELL % ATLAS_COLUMNS) * CELL_WIDTH;
+        int solidY = (SOLID_CELL / ATLAS_COLUMNS) * CELL_HEIGHT;
+        for (int row = 0; row < CELL_HEIGHT; row++) {
+            std::fill_n(&atlas[(solidY + row) * ATLAS_WIDTH + solidX], CELL_WIDTH, 255);
+        }
+
+        glGenTextures(1, &fontTexture);
+        glBindTexture(GL_TEXTURE_2D, fontTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, &atlas[0]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // whole screen pixels per font pixel, nearest keeps the edges sharp
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (GLvoid*)offsetof(HudVertex, x));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (GLvoid*)offsetof(HudVertex, u));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (GLvoid*)offsetof(HudVertex, color));
+
+        glBindVertexArray(0);
+
+        // a few thousand characters without growing
+        vertices.reserve(6 * 4096);
+    }
+
+    void Hud::Delete() {
+
+        glDeleteTextures(1, &fontTexture);
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+    }
+
+    void Hud::begin(int width, int height) {
+
+        screenWidth = std::max(width, 1);
+        screenHeight = std::max(height, 1);
+        vertices.clear();
+    }
+
+    float Hud::getLineHeight() {
+
+        return (float)((GLYPH_HEIGHT + 2) * scale);
+    }
+
+    float Hud::getCharWidth() {
+
+        return (float)(CELL_WIDTH * scale);
+    }
+
+    void Hud::quad(float x, float y, float width, float height, float u0, float v0, float u1, float v1, glm::vec4 color) {
+
+        glm::vec4 clamped = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+        HudVertex corners[4];
+        for (int i = 0; i < 4; i++) {
+            corners[i].x = (i & 1) ? x + width : x;
+            corners[i].y = (i & 2) ? y + height : y;
+            corners[i].u = (i & 1) ? u1 : u0;
+            corners[i].v = (i & 2) ? v1 : v0;
+            corners[i].color[0] = (GLubyte)clamped.x;
+            corners[i].color[1] = (GLubyte)clamped.y;
+            corners[i].color[2] = (GLubyte)clamped.z;
+            corners[i].color[3] = (GLubyte)clamped.w;
+        }
+
+        // two triangles, no index buffer
+        vertices.push_back(corners[0]);
+        vertices.push_back(corners[2]);
+        vertices.push_back(corners[1]);
+        vertices.push_back(corners[1]);
+        vertices.push_back(corners[2]);
+        vertices.push_back(corners[3]);
+    }
+
+    float Hud::text(float x, float y, const char* str, glm::vec4 color) {
+
+        for (const char* c = str; *c; c++) {
+
+            int character = (unsigned char)*c;
+            if (character >= 'a' && character <= 'z') {
+                character -= 'a' - 'A';
+            }
+            if (character < ' ' || character > '_') {
+                character = '?';
+            }
+
+            if (character != ' ') {
+                int glyph = character - ' ';
+                float u0 = (float)((glyph % ATLAS_COLUMNS) * CELL_WIDTH) / ATLAS_WIDTH;
+                float v0 = (float)((glyph / ATLAS_COLUMNS) * CELL_HEIGHT) / ATLAS_HEIGHT;
+                quad(x, y, (float)(GLYPH_WIDTH * scale), (float)(GLYPH_HEIGHT * scale),
+                    u0, v0, u0 + (float)GLYPH_WIDTH / ATLAS_WIDTH, v0 + (float)GLYPH_HEIGHT / ATLAS_HEIGHT, color);
+            }
+            x += getCharWidth();
+        }
+        return x;
+    }
+
+    void Hud::rect(float x, float y, float width, float height, glm::vec4 color) {
+
+        // the middle of the solid cell
+        float u = ((SOLID_CELL % ATLAS_COLUMNS) * CELL_WIDTH + 0.5f * CELL_WIDTH) / ATLAS_WIDTH;
+        float v = ((SOLID_CELL / ATLAS_COLUMNS) * CELL_HEIGHT + 0.5f * CELL_HEIGHT) / ATLAS_HEIGHT;
+        quad(x, y, width, height, u, v, u, v, color);
+    }
+
+    void Hud::addFrameTime(float milliseconds) {
+
+        frameTimes[nextFrameTime] = milliseconds;
+        nextFrameTime = (nextFrameTime + 1) % GRAPH_FRAMES;
+        if (frameTimeCount < GRAPH_FRAMES) {
+            frameTimeCount++;
+        }
+    }
+
+    void Hud::frameGraph(float x, float y, float width, float height) {
+
+        // 30 fps fits, slower frames stretch the scale
+        float maxMilliseconds = 40.0f;
+        for (int i = 0; i < frameTimeCount; i++) {
+            maxMilliseconds = std::max(maxMilliseconds, frameTimes[i] * 1.1f);
+        }
+
+        float barWidth = width / GRAPH_FRAMES;
+        for (int i = 0; i < frameTimeCount; i++) {
+
+            float milliseconds = frameTimes[(nextFrameTime - frameTimeCount + i + GRAPH_FRAMES) % GRAPH_FRAMES];
+            float barHeight = milliseconds / maxMilliseconds * height;
+
+            glm::vec4 color = glm::vec4(0.3f, 0.9f, 0.3f, 0.9f);
+            if (milliseconds > 1000.0f / 30.0f) {
+                color = glm::vec4(1.0f, 0.3f, 0.25f, 0.9f);
+            } else if (milliseconds > 1000.0f / 60.0f) {
+                color = glm::vec4(1.0f, 0.85f, 0.2f, 0.9f);
+            }
+
+            rect(x + width - (frameTimeCount - i) * barWidth, y + height - barHeight, barWidth, barHeight, color);
+        }
+
+        float budgets[2] = { 1000.0f / 60.0f, 1000.0f / 30.0f };
+        for (int i = 0; i < 2; i++) {
+            rect(x, y + height - budgets[i] / maxMilliseconds * height, width, 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.4f));
+        }
+    }
+
+    void Hud::Draw(gps::Shader shader) {
+
+        if (vertices.empty()) {
+            return;
+        }
+
+        // wireframe and point modes stay on the scene
+        GLint polygonMode[2] = { GL_FILL, GL_FILL };
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_BLEND);
+
+        shader.useShaderProgram();
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "screenSize"), (GLfloat)screenWidth, (GLfloat)screenHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, fontTexture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "fontAtlas"), 0);
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        // a new store every frame, the driver never waits for the draw of the last one
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(HudVertex), &vertices[0], GL_STREAM_DRAW);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+        glBindVertexArray(0);
+
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    }
+}
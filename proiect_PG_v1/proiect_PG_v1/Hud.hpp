@@ -0,0 +1,79 @@
+#ifndef Hud_hpp
+#define Hud_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Shader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    // On-screen text and a frame time graph, drawn over the finished frame.
+    // Glyphs come from a built-in 3x5 bitmap font (upper case, digits, punctuation; lower case
+    // prints as upper case). Every quad of a frame, text and graph bars alike, goes into one
+    // vertex array that is uploaded to one dynamic buffer and drawn with one glDrawArrays.
+    class Hud {
+
+    public:
+        static const int GRAPH_FRAMES = 120;
+
+        Hud();
+
+        void Create();
+        void Delete();
+
+        // Starts the quads of a frame, coordinates are pixels from the top left corner
+        void begin(int width, int height);
+
+        // Returns the x after the last character
+        float text(float x, float y, const char* str, glm::vec4 color);
+        void rect(float x, float y, float width, float height, glm::vec4 color);
+
+        // Bars of the last GRAPH_FRAMES frame times, newest on the right,
+        // with lines at the 60 and 30 fps budgets
+        void addFrameTime(float milliseconds);
+        void frameGraph(float x, float y, float width, float height);
+
+        // Uploads the quads and draws them without depth test. Depth test and face culling
+        // are left enabled and the polygon mode is restored, as the rest of the frame expects
+        void Draw(gps::Shader shader);
+
+        // Screen pixels per font pixel
+        int scale;
+        float getLineHeight();
+        float getCharWidth();
+
+    private:
+        struct HudVertex {
+
+            GLfloat x, y;
+            GLfloat u, v;
+            GLubyte color[4];
+        };
+
+        GLuint fontTexture;
+        GLuint vao;
+        GLuint vbo;
+        int screenWidth;
+        int screenHeight;
+
+        std::vector<HudVertex> vertices;
+
+        std::vector<float> frameTimes; // ring buffer, milliseconds
+        int nextFrameTime;
+        int frameTimeCount;
+
+        void quad(float x, float y, float width, float height, float u0, float v0, float u1, float v1, glm::vec4 color);
+    };
+}
+
+#endif /* Hud_hpp */
@@ -0,0 +1,225 @@
+#include "ImageCompare.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace gps {
+
+    static unsigned int crcTable[256];
+    static bool crcTableReady = false;
+
+    static unsigned int updateCrc(unsigned int crc, const unsigned char* data, size_t length) {
+
+        if (!crcTableReady) {
+
+            for (unsigned int n = 0; n < 256; n++) {
+
+                unsigned int c = n;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                crcTable[n] = c;
+            }
+            crcTableReady = true;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return crc;
+    }
+
+    static void putBigEndian(std::vector<unsigned char>& out, unsigned int value) {
+
+        out.push_back((unsigned char)(value >> 24));
+        out.push_back((unsigned char)(value >> 16));
+        out.push_back((unsigned char)(value >> 8));
+        out.push_back((unsigned char)value);
+    }
+
+    static void writeChunk(FILE* file, const char* type, const std::vector<unsigned char>& data) {
+
+        std::vector<unsigned char> chunk;
+        putBigEndian(chunk, (unsigned int)data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+
+        // the CRC covers the type and the data, not the length
+        unsigned int crc = updateCrc(0xFFFFFFFFu, &chunk[4], chunk.size() - 4) ^ 0xFFFFFFFFu;
+        putBigEndian(chunk, crc);
+
+        fwrite(&chunk[0], 1, chunk.size(), file);
+    }
+
+    bool writePNG(std::string fileName, const Image& image) {
+
+        FILE* file = fopen(fileName.c_str(), "wb");
+        if (!file) {
+            fprintf(stderr, "Could not write %s\n", fileName.c_str());
+            return false;
+        }
+
+        static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+        fwrite(signature, 1, 8, file);
+
+        std::vector<unsigned char> header;
+        putBigEndian(header, (unsigned int)image.width);
+        putBigEndian(header, (unsigned int)image.height);
+        header.push_back(8); // bits per channel
+        header.push_back(6); // RGBA
+        header.push_back(0); // deflate
+        header.push_back(0); // adaptive filtering
+        header.push_back(0); // no interlace
+        writeChunk(file, "IHDR", header);
+
+        // scanlines with filter type 0, then a zlib stream of stored blocks (at most 65535 bytes each)
+        size_t rowBytes = (size_t)image.width * 4;
+        std::vector<unsigned char> raw;
+        raw.reserve((rowBytes + 1) * image.height);
+        for (int y = 0; y < image.height; y++) {
+            raw.push_back(0);
+            raw.insert(raw.end(), image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes);
+        }
+
+        std::vector<unsigned char> zlib;
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+
+        size_t offset = 0;
+        do {
+            size_t blockSize = std::min(raw.size() - offset, (size_t)65535);
+            bool last = offset + blockSize == raw.size();
+
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back((unsigned char)(blockSize & 0xFF));
+            zlib.push_back((unsigned char)(blockSize >> 8));
+            zlib.push_back((unsigned char)(~blockSize & 0xFF));
+            zlib.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+            offset += blockSize;
+        } while (offset < raw.size());
+
+        unsigned int a = 1;
+        unsigned int b = 0;
+        for (size_t i = 0; i < raw.size(); i++) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        putBigEndian(zlib, (b << 16) | a);
+
+        writeChunk(file, "IDAT", zlib);
+        writeChunk(file, "IEND", std::vector<unsigned char>());
+
+        bool ok = ferror(file) == 0;
+        fclose(file);
+        return ok;
+    }
+
+    bool readPNG(std::string fileName, Image& image) {
+
+        int width, height, channels;
+        unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &channels, 4);
+
+        if (!data) {
+            return false;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.assign(data, data + (size_t)width * height * 4);
+        stbi_image_free(data);
+
+        return true;
+    }
+
+    ImageDifference compareImages(const Image& reference, const Image& image, Image* diffImage) {
+
+        ImageDifference difference;
+        difference.psnr = 0.0;
+        difference.maxDifference = 255;
+        difference.differentPixels = 0;
+        difference.sizeMismatch = reference.width != image.width || reference.height != image.height;
+
+        if (difference.sizeMismatch) {
+            return difference;
+        }
+
+        if (diffImage) {
+            diffImage->width = reference.width;
+            diffImage->height = reference.height;
+            diffImage->pixels.resize(reference.pixels.size());
+        }
+
+        double squaredError = 0.0;
+        int maxDifference = 0;
+        size_t pixelCount = (size_t)reference.width * reference.height;
+
+        for (size_t p = 0; p < pixelCount; p++) {
+
+            const unsigned char* r = &reference.pixels[4 * p];
+            const unsigned char* i = &image.pixels[4 * p];
+
+            int pixelMax = 0;
+            for (int c = 0; c < 3; c++) {
+
+                int d = std::abs((int)r[c] - (int)i[c]);
+                squaredError += d * d;
+                pixelMax = std::max(pixelMax, d);
+            }
+
+            maxDifference = std::max(maxDifference, pixelMax);
+            if (pixelMax > 0) {
+                difference.differentPixels++;
+            }
+
+            if (diffImage) {
+
+                unsigned char* out = &diffImage->pixels[4 * p];
+                if (pixelMax > 0) {
+                    out[0] = (unsigned char)std::min(64 + pixelMax * 4, 255);
+                    out[1] = 0;
+                    out[2] = 0;
+                }
+                else {
+                    unsigned char gray = (unsigned char)((r[0] + r[1] + r[2]) / 12);
+                    out[0] = out[1] = out[2] = gray;
+                }
+                out[3] = 255;
+            }
+        }
+
+        difference.maxDifference = maxDifference;
+
+        double meanSquaredError = squaredError / (pixelCount * 3.0);
+        if (meanSquaredError == 0.0) {
+            difference.psnr = std::numeric_limits<double>::infinity();
+        }
+        else {
+            difference.psnr = 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+        }
+
+        return difference;
+    }
+
+    void flipRows(Image& image) {
+
+        size_t rowBytes = (size_t)image.width * 4;
+        std::vector<unsigned char> row(rowBytes);
+
+        for (int y = 0; y < image.height / 2; y++) {
+
+            unsigned char* top = &image.pixels[y * rowBytes];
+            unsigned char* bottom = &image.pixels[(image.height - 1 - y) * rowBytes];
+            memcpy(&row[0], top, rowBytes);
+            memcpy(top, bottom, rowBytes);
+            memcpy(bottom, &row[0], rowBytes);
+        }
+    }
+}
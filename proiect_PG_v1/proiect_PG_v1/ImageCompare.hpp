@@ -0,0 +1,39 @@
+#ifndef ImageCompare_hpp
+#define ImageCompare_hpp
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // 8 bit RGBA pixels, rows top to bottom (as in PNG files, glReadPixels rows must be flipped)
+    struct Image {
+
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    struct ImageDifference {
+
+        double psnr;          // dB over RGB, infinity when the images are identical
+        int maxDifference;    // largest difference of one channel, 0-255
+        int differentPixels;  // pixels with any RGB channel different
+        bool sizeMismatch;
+    };
+
+    // Uncompressed (stored deflate) PNG, large but needs no zlib
+    bool writePNG(std::string fileName, const Image& image);
+
+    // Any format stb_image reads, converted to RGBA
+    bool readPNG(std::string fileName, Image& image);
+
+    // Compares RGB (alpha is ignored). If diffImage is not null it receives the reference
+    // in dim gray with every differing pixel in red, brighter for larger differences
+    ImageDifference compareImages(const Image& reference, const Image& image, Image* diffImage);
+
+    // Reverses the row order, glReadPixels returns the bottom row first
+    void flipRows(Image& image);
+}
+
+#endif /* ImageCompare_hpp */
@@ -0,0 +1,345 @@
+#include "JobSystem.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    struct Job {
+
+        const char* name;
+        std::function<void()> work;
+        JobCounter* counter;
+    };
+
+    // the system the calling thread works for and its index there
+    static thread_local JobSystem* currentSystem = nullptr;
+    static thread_local int currentThread = -1;
+
+    JobCounter::JobCounter() : pending(0) {
+    }
+
+    JobCounter::~JobCounter() {
+
+        for (size_t i = 0; i < waiting.size(); i++) {
+            delete waiting[i];
+        }
+    }
+
+    bool JobCounter::isDone() {
+
+        return pending.load() == 0;
+    }
+
+    // top and bottom are sequentially consistent, which orders the race of pop and steal over the last
+    // job; a slot is written before the bottom store that publishes it and read after the load of it
+    JobSystem::WorkDeque::WorkDeque() : top(0), bottom(0), slots(new std::atomic<Job*>[DEQUE_CAPACITY]) {
+
+        for (int i = 0; i < DEQUE_CAPACITY; i++) {
+            slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    bool JobSystem::WorkDeque::push(Job* job) {
+
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load();
+        if (b - t >= DEQUE_CAPACITY) {
+            return false;
+        }
+        slots[b & (DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1);
+        return true;
+    }
+
+    Job* JobSystem::WorkDeque::pop() {
+
+        // claim the bottom slot first, then see whether a thief reached it
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b);
+        int64_t t = top.load();
+
+        if (t > b) {
+            bottom.store(b + 1);
+            return nullptr;
+        }
+
+        Job* job = slots[b & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // the last job, whoever moves top first has it
+            if (!top.compare_exchange_strong(t, t + 1)) {
+                job = nullptr;
+            }
+            bottom.store(b + 1);
+        }
+        return job;
+    }
+
+    Job* JobSystem::WorkDeque::steal() {
+
+        int64_t t = top.load();
+        int64_t b = bottom.load();
+        if (t >= b) {
+            return nullptr;
+        }
+
+        Job* job = slots[t & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+    JobSystem::JobSystem() : threadCount(0), queuedJobs(0), sleepingWorkers(0), stopping(false), executedCount(0), stolenCount(0) {
+    }
+
+    JobSystem::~JobSystem() {
+
+        Delete();
+    }
+
+    void JobSystem::Create(int threadCount) {
+
+        Delete();
+
+        if (threadCount <= 0) {
+            threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+        }
+        this->threadCount = threadCount;
+        for (int i = 0; i < threadCount; i++) {
+            deques.push_back(std::unique_ptr<WorkDeque>(new WorkDeque()));
+        }
+        queuedJobs = 0;
+        executedCount = 0;
+        stolenCount = 0;
+        stopping = false;
+
+        currentSystem = this;
+        currentThread = 0;
+        for (int i = 1; i < threadCount; i++) {
+            workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+        }
+    }
+
+    void JobSystem::Delete() {
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+
+        for (size_t i = 0; i < deques.size(); i++) {
+            for (Job* job = deques[i]->pop(); job != nullptr; job = deques[i]->pop()) {
+                delete job;
+            }
+        }
+        deques.clear();
+        for (size_t i = 0; i < injected.size(); i++) {
+            delete injected[i];
+        }
+        injected.clear();
+
+        if (currentSystem == this) {
+            currentSystem = nullptr;
+            currentThread = -1;
+        }
+        threadCount = 0;
+    }
+
+    int JobSystem::getThreadCount() {
+
+        return threadCount;
+    }
+
+    int JobSystem::currentThreadIndex() {
+
+        return currentSystem == this ? currentThread : -1;
+    }
+
+    void JobSystem::run(const char* name, const std::function<void()>& work, JobCounter* counter, JobCounter* dependency) {
+
+        Job* job = new Job();
+        job->name = name;
+        job->work = work;
+        job->counter = counter;
+        if (counter) {
+            counter->pending++;
+        }
+
+        if (dependency) {
+            std::lock_guard<std::mutex> lock(dependency->mutex);
+            if (dependency->pending.load() > 0) {
+                dependency->waiting.push_back(job);
+                return;
+            }
+        }
+        enqueue(job);
+    }
+
+    void JobSystem::enqueue(Job* job) {
+
+        // counted before it can be taken, so the count never drops below the jobs that are queued
+        queuedJobs++;
+
+        int thread = currentThreadIndex();
+        if (thread >= 0) {
+            if (!deques[thread]->push(job)) {
+                queuedJobs--;
+                execute(job);
+                return;
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(injectedMutex);
+            injected.push_back(job);
+        }
+
+        // a worker going to sleep counts itself before it reads queuedJobs, so one of the two sees the other
+        if (sleepingWorkers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wakeCondition.notify_one();
+        }
+    }
+
+    Job* JobSystem::findJob(int thread) {
+
+        Job* job = thread >= 0 ? deques[thread]->pop() : nullptr;
+
+        if (!job) {
+            std::lock_guard<std::mutex> lock(injectedMutex);
+            if (!injected.empty()) {
+                job = injected.front();
+                injected.pop_front();
+            }
+        }
+
+        // the others from the next one on, so thieves spread over the victims
+        for (int i = 1; !job && i <= threadCount; i++) {
+            int victim = (thread + i + threadCount) % threadCount;
+            if (victim != thread) {
+                job = deques[victim]->steal();
+                if (job) {
+                    stolenCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        if (job) {
+            queuedJobs--;
+        }
+        return job;
+    }
+
+    void JobSystem::execute(Job* job) {
+
+        {
+#if GPS_ENABLE_TRACING
+            CpuScope scope(job->name);
+#endif
+            job->work();
+        }
+        executedCount.fetch_add(1, std::memory_order_relaxed);
+
+        JobCounter* counter = job->counter;
+        delete job;
+        if (counter) {
+            finish(counter);
+        }
+    }
+
+    void JobSystem::finish(JobCounter* counter) {
+
+        // under the lock, so a job added to waiting either sees pending above 0 or is released here
+        std::vector<Job*> released;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (--counter->pending == 0) {
+                released.swap(counter->waiting);
+            }
+        }
+        for (size_t i = 0; i < released.size(); i++) {
+            enqueue(released[i]);
+        }
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+
+        int thread = currentThreadIndex();
+        while (counter.pending.load() > 0) {
+            Job* job = findJob(thread);
+            if (job) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        // the thread that dropped it to 0 may still be releasing its waiting jobs
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    void JobSystem::parallelFor(const char* name, size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& work) {
+
+        size_t grain = std::max(grainSize, (size_t)1);
+        size_t chunks = std::min((count + grain - 1) / grain, (size_t)std::max(threadCount, 1) * CHUNKS_PER_THREAD);
+        if (chunks <= 1 || threadCount <= 1) {
+            if (count > 0) {
+                work(0, count);
+            }
+            return;
+        }
+
+        // the caller keeps the first range, the rest go to its deque for the others to steal
+        JobCounter counter;
+        for (size_t c = 1; c < chunks; c++) {
+            size_t first = count * c / chunks;
+            size_t last = count * (c + 1) / chunks;
+            run(name, [&work, first, last]() { work(first, last); }, &counter);
+        }
+        {
+#if GPS_ENABLE_TRACING
+            CpuScope scope(name);
+#endif
+            work(0, count / chunks);
+        }
+        wait(counter);
+    }
+
+    uint64_t JobSystem::getExecutedCount() {
+
+        return executedCount.load();
+    }
+
+    uint64_t JobSystem::getStolenCount() {
+
+        return stolenCount.load();
+    }
+
+    void JobSystem::workerLoop(int thread) {
+
+        currentSystem = this;
+        currentThread = thread;
+        CpuProfiler::setThreadName("job worker");
+
+        for (;;) {
+
+            Job* job = findJob(thread);
+            if (job) {
+                execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers++;
+            wakeCondition.wait(lock, [&]() { return stopping || queuedJobs.load() > 0; });
+            sleepingWorkers--;
+            if (stopping) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    struct Job;
+
+    // Jobs of a group still to finish. Jobs run with it as their dependency are queued once it drops
+    // to 0; it has to outlive the jobs counted on it and those waiting for it.
+    class JobCounter {
+
+    public:
+        JobCounter();
+        // Frees the jobs still waiting for it, which only happens when JobSystem::Delete dropped a job
+        // it counted
+        ~JobCounter();
+
+        bool isDone();
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<int> pending;
+        std::mutex mutex;           // guards waiting and the drop to 0
+        std::vector<Job*> waiting;  // queued when pending drops to 0
+    };
+
+    // Work-stealing scheduler. Every thread of the system has a deque: jobs it queues go to the bottom
+    // and it takes them back from the bottom, most recent first, while idle threads steal the oldest
+    // from the top (Chase-Lev, without locks). Threads outside the system queue to a shared list.
+    // A thread waiting for a counter runs jobs meanwhile, so jobs can wait for the jobs they start.
+    // Each job is recorded as a CpuProfiler scope under its name, on a "job worker" track.
+    class JobSystem {
+
+    public:
+        static const int DEQUE_CAPACITY = 4096;  // per thread, a job queued past it runs right away
+        static const int CHUNKS_PER_THREAD = 4;  // ranges of a parallelFor, enough for stealing to balance them
+
+        JobSystem();
+        ~JobSystem();
+
+        // threadCount includes the calling thread, which runs jobs whenever it waits; 0 is one per
+        // hardware thread, 1 runs every job on the calling thread
+        void Create(int threadCount);
+        // Queued jobs that did not start are dropped. Jobs waiting for a counter are not queued
+        // anywhere the system can see; the counter frees them when it is destroyed
+        void Delete();
+        int getThreadCount();
+
+        // name is a string literal; counter (optional) counts the job until it has finished,
+        // dependency (optional) holds it back until done
+        void run(const char* name, const std::function<void()>& work, JobCounter* counter, JobCounter* dependency = nullptr);
+        void wait(JobCounter& counter);
+        // work(first, last) on ranges of [0, count) of at least grainSize items, the caller takes one
+        void parallelFor(const char* name, size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& work);
+
+        // Since Create
+        uint64_t getExecutedCount();
+        uint64_t getStolenCount();
+
+    private:
+        class WorkDeque {
+
+        public:
+            WorkDeque();
+
+            // The owner's end, false when full
+            bool push(Job* job);
+            Job* pop();
+            // Any thread, nullptr when empty or another thread took the job first
+            Job* steal();
+
+        private:
+            std::atomic<int64_t> top;
+            std::atomic<int64_t> bottom;
+            std::unique_ptr<std::atomic<Job*>[]> slots;
+        };
+
+        int threadCount;
+        std::vector<std::unique_ptr<WorkDeque> > deques;  // by thread index, 0 is the creating thread
+        std::vector<std::thread> workers;
+
+        std::mutex injectedMutex;
+        std::deque<Job*> injected;  // from threads outside the system
+
+        // idle workers sleep until a job is queued
+        std::atomic<int> queuedJobs;
+        std::atomic<int> sleepingWorkers;
+        std::mutex sleepMutex;
+        std::condition_variable wakeCondition;
+        bool stopping;
+
+        std::atomic<uint64_t> executedCount;
+        std::atomic<uint64_t> stolenCount;
+
+        int currentThreadIndex();
+        void enqueue(Job* job);
+        Job* findJob(int thread);
+        void execute(Job* job);
+        void finish(JobCounter* counter);
+        void workerLoop(int thread);
+    };
+}
+
+#endif /* JobSystem_hpp */
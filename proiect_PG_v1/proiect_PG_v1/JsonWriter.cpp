@@ -0,0 +1,23 @@
+#include "JsonWriter.hpp"
+
+namespace gps {
+
+    void writeJsonString(FILE* file, const char* text) {
+
+        fputc('"', file);
+        for (const char* c = text ? text : ""; *c; c++) {
+
+            if (*c == '"' || *c == '\\') {
+                fputc('\\', file);
+                fputc(*c, file);
+            }
+            else if ((unsigned char)*c < 0x20) {
+                fprintf(file, "\\u%04x", (unsigned char)*c);
+            }
+            else {
+                fputc(*c, file);
+            }
+        }
+        fputc('"', file);
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef JsonWriter_hpp
+#define JsonWriter_hpp
+
+#include <cstdio>
+
+namespace gps {
+
+    // Writes text as a JSON string literal: quoted, quotes and backslashes escaped,
+    // control characters as \u00XX. A null text is written as an empty string
+    void writeJsonString(FILE* file, const char* text);
+}
+
+#endif /* JsonWriter_hpp */
@@ -0,0 +1,213 @@
+#include "LightClusters.hpp"
+#include "GLDispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace gps {
+
+    // caps the per-cluster list so a pile of overlapping lights cannot blow up the index buffer
+    static const GLuint MAX_LIGHTS_PER_CLUSTER = 256;
+
+    LightClusters::LightClusters() {
+
+        this->nearPlane = 0.1f;
+        this->farPlane = 1000.0f;
+        this->clusterData.assign(CLUSTER_COUNT * 2, 0);
+        this->maxTexels = std::numeric_limits<GLint>::max();
+    }
+
+    void LightClusters::init() {
+
+        // GL 4.1 only guarantees 65536 texels per texture buffer
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &this->maxTexels);
+
+        glGenBuffers(3, this->buffers);
+        glGenTextures(3, this->textures);
+
+        const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+
+        for (int i = 0; i < 3; i++) {
+
+            glBindBuffer(GL_TEXTURE_BUFFER, this->buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+
+            glBindTexture(GL_TEXTURE_BUFFER, this->textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], this->buffers[i]);
+        }
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Exponential depth slicing, keeps clusters roughly cubic in view space
+    int LightClusters::depthSlice(float depth) {
+
+        if (depth <= nearPlane) {
+            return 0;
+        }
+
+        int slice = (int)(std::log(depth / nearPlane) / std::log(farPlane / nearPlane) * GRID_Z);
+        return std::min(std::max(slice, 0), GRID_Z - 1);
+    }
+
+    void LightClusters::build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+        float nearPlane, float farPlane) {
+
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+
+        lightData.clear();
+        lightIndices.clear();
+        lightRangeMin.clear();
+        lightRangeMax.clear();
+        std::fill(clusterData.begin(), clusterData.end(), 0);
+
+        // 1. find the cluster range of every light and count the lights per cluster
+        for (size_t l = 0; l < lights.size(); l++) {
+
+            // 2 texels per light, the lights past the texture buffer limit are dropped
+            if (lightData.size() + 2 > (size_t)maxTexels) {
+                break;
+            }
+
+            glm::vec3 center = glm::vec3(view * glm::vec4(lights[l].position, 1.0f));
+            float radius = lights[l].radius;
+
+            // view space looks down -Z, depth grows away from the camera
+            float minDepth = std::max(-center.z - radius, nearPlane);
+            float maxDepth = std::min(-center.z + radius, farPlane);
+
+            if (minDepth > maxDepth) {
+                continue;
+            }
+
+            // project the light's view space box, clamped in front of the near plane
+            glm::vec2 ndcMin(1.0f);
+            glm::vec2 ndcMax(-1.0f);
+
+            for (int corner = 0; corner < 8; corner++) {
+
+                glm::vec4 p;
+                p.x = center.x + ((corner & 1) ? radius : -radius);
+                p.y = center.y + ((corner & 2) ? radius : -radius);
+                p.z = (corner & 4) ? -minDepth : -maxDepth;
+                p.w = 1.0f;
+
+                glm::vec4 clip = projection * p;
+                glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                ndcMin = glm::min(ndcMin, ndc);
+                ndcMax = glm::max(ndcMax, ndc);
+            }
+
+            if (ndcMin.x > 1.0f || ndcMin.y > 1.0f || ndcMax.x < -1.0f || ndcMax.y < -1.0f) {
+                continue;
+            }
+
+            glm::vec2 tileMin = (glm::clamp(ndcMin, -1.0f, 1.0f) * 0.5f + 0.5f) * glm::vec2(GRID_X, GRID_Y);
+            glm::vec2 tileMax = (glm::clamp(ndcMax, -1.0f, 1.0f) * 0.5f + 0.5f) * glm::vec2(GRID_X, GRID_Y);
+
+            glm::ivec3 rangeMin(std::min((int)tileMin.x, GRID_X - 1), std::min((int)tileMin.y, GRID_Y - 1), depthSlice(minDepth));
+            glm::ivec3 rangeMax(std::min((int)tileMax.x, GRID_X - 1), std::min((int)tileMax.y, GRID_Y - 1), depthSlice(maxDepth));
+
+            for (int z = rangeMin.z; z <= rangeMax.z; z++) {
+                for (int y = rangeMin.y; y <= rangeMax.y; y++) {
+                    for (int x = rangeMin.x; x <= rangeMax.x; x++) {
+
+                        GLuint& count = clusterData[2 * (x + GRID_X * (y + GRID_Y * z)) + 1];
+                        count = std::min(count + 1, MAX_LIGHTS_PER_CLUSTER);
+                    }
+                }
+            }
+
+            lightRangeMin.push_back(rangeMin);
+            lightRangeMax.push_back(rangeMax);
+            lightData.push_back(glm::vec4(center, radius));
+            lightData.push_back(glm::vec4(lights[l].color, 0.0f));
+        }
+
+        // 2. prefix sum of the counts gives each cluster its slice of the index list,
+        // the clusters past the texture buffer limit keep what still fits
+        GLuint offset = 0;
+        for (int c = 0; c < CLUSTER_COUNT; c++) {
+
+            clusterData[2 * c] = offset;
+            clusterData[2 * c + 1] = std::min(clusterData[2 * c + 1], (GLuint)maxTexels - offset);
+            offset += clusterData[2 * c + 1];
+        }
+        lightIndices.resize(offset);
+
+        // 3. scatter the light indices, 'filled' is the write cursor of each cluster
+        std::vector<GLuint> filled(CLUSTER_COUNT, 0);
+
+        for (size_t l = 0; l < lightRangeMin.size(); l++) {
+
+            for (int z = lightRangeMin[l].z; z <= lightRangeMax[l].z; z++) {
+                for (int y = lightRangeMin[l].y; y <= lightRangeMax[l].y; y++) {
+                    for (int x = lightRangeMin[l].x; x <= lightRangeMax[l].x; x++) {
+
+                        int c = x + GRID_X * (y + GRID_Y * z);
+                        if (filled[c] < clusterData[2 * c + 1]) {
+                            lightIndices[clusterData[2 * c] + filled[c]++] = (GLuint)l;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void LightClusters::upload() {
+
+        // orphan and refill, an empty buffer still gets one texel so the texture stays valid
+        glm::vec4 noLight(0.0f);
+        GLuint noIndex = 0;
+
+        glBindBuffer(GL_TEXTURE_BUFFER, this->buffers[0]);
+        if (lightData.empty())
+            glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), &noLight, GL_STREAM_DRAW);
+        else
+            glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), &lightData[0], GL_STREAM_DRAW);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, this->buffers[1]);
+        glBufferData(GL_TEXTURE_BUFFER, clusterData.size() * sizeof(GLuint), &clusterData[0], GL_STREAM_DRAW);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, this->buffers[2]);
+        if (lightIndices.empty())
+            glBufferData(GL_TEXTURE_BUFFER, sizeof(GLuint), &noIndex, GL_STREAM_DRAW);
+        else
+            glBufferData(GL_TEXTURE_BUFFER, lightIndices.size() * sizeof(GLuint), &lightIndices[0], GL_STREAM_DRAW);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void LightClusters::bind(gps::Shader shader, GLuint firstUnit, int framebufferWidth, int framebufferHeight) {
+
+        const char* samplers[3] = { "lightData", "clusterData", "lightIndices" };
+
+        for (GLuint i = 0; i < 3; i++) {
+
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, this->textures[i]);
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, samplers[i]), firstUnit + i);
+        }
+
+        glUniform3i(glGetUniformLocation(shader.shaderProgram, "clusterGrid"), GRID_X, GRID_Y, GRID_Z);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "clusterTileScale"),
+            (float)GRID_X / framebufferWidth, (float)GRID_Y / framebufferHeight);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "clusterDepthParams"),
+            nearPlane, GRID_Z / std::log(farPlane / nearPlane));
+    }
+
+    int LightClusters::getLightCount() {
+        return (int)(lightData.size() / 2);
+    }
+
+    int LightClusters::getIndexCount() {
+        return (int)lightIndices.size();
+    }
+
+    void LightClusters::setMaxTexels(GLint maxTexels) {
+        this->maxTexels = std::max(maxTexels, 1);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef LightClusters_hpp
+#define LightClusters_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    struct PointLight {
+
+        glm::vec3 position; // world space
+        float radius;       // the light is ignored by clusters past this distance
+        glm::vec3 color;
+    };
+
+    // Splits the view frustum into a 3D grid of clusters (screen tiles x exponential depth slices)
+    // and builds, every frame, the list of point lights touching each cluster.
+    // The lists are uploaded to texture buffers so basic.frag only loops over the lights of its cluster.
+    class LightClusters {
+
+    public:
+        static const int GRID_X = 16;
+        static const int GRID_Y = 9;
+        static const int GRID_Z = 24;
+        static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+        LightClusters();
+
+        // Creates the texture buffers (needs a GL context)
+        void init();
+
+        // Bins the lights into clusters on the CPU, no GL calls
+        void build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+            float nearPlane, float farPlane);
+
+        // Uploads the result of the last build() to the texture buffers
+        void upload();
+
+        // Binds the texture buffers starting at firstUnit and sets the cluster uniforms
+        void bind(gps::Shader shader, GLuint firstUnit, int framebufferWidth, int framebufferHeight);
+
+        int getLightCount();
+        int getIndexCount();
+
+        // Texels a texture buffer may hold, init() sets it to GL_MAX_TEXTURE_BUFFER_SIZE (unlimited before that).
+        // build() drops the lights and cluster entries that would not fit
+        void setMaxTexels(GLint maxTexels);
+
+    private:
+        float nearPlane;
+        float farPlane;
+
+        // 2 texels per light: view space position + radius, color
+        std::vector<glm::vec4> lightData;
+        // per cluster: offset into lightIndices, number of lights
+        std::vector<GLuint> clusterData;
+        std::vector<GLuint> lightIndices;
+
+        // cluster range [min, max] covered by each light, filled by build()
+        std::vector<glm::ivec3> lightRangeMin;
+        std::vector<glm::ivec3> lightRangeMax;
+
+        GLuint buffers[3];
+        GLuint textures[3];
+        GLint maxTexels;
+
+        int depthSlice(float depth);
+    };
+}
+
+#endif /* LightClusters_hpp */
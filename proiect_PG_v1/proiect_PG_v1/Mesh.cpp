@@ -1,4 +1,5 @@
 #include "Mesh.hpp"
+#include "GLDispatch.hpp"
 namespace gps {
 
 	/* Mesh Constructor */
@@ -8,6 +9,17 @@ namespace gps {
 		this->indices = indices;
 		this->textures = textures;
 
+		this->boundsMin = glm::vec3(0.0f);
+		this->boundsMax = glm::vec3(0.0f);
+		if (!vertices.empty()) {
+			this->boundsMin = vertices[0].Position;
+			this->boundsMax = vertices[0].Position;
+			for (size_t i = 1; i < vertices.size(); i++) {
+				this->boundsMin = glm::min(this->boundsMin, vertices[i].Position);
+				this->boundsMax = glm::max(this->boundsMax, vertices[i].Position);
+			}
+		}
+
 		this->setupMesh();
 	}
 
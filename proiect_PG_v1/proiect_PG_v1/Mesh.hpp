@@ -54,6 +54,10 @@ namespace gps {
         std::vector<GLuint> indices;
         std::vector<Texture> textures;
 
+        // model space bounding box of the vertices
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+
 	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
 
 	    Buffers getBuffers();
@@ -1,36 +1,121 @@
 #include "Model3D.hpp"
+#include "CpuProfiler.hpp"
+#include "GLDispatch.hpp"
+#include "JobSystem.hpp"
+
+#include <sstream>
 
 namespace gps {
 
+	// work(first, last) over [0, count), split over the jobs when there are any
+	static void runRanges(gps::JobSystem* jobs, const char* name, size_t count, const std::function<void(size_t, size_t)>& work) {
+
+		if (jobs) {
+			jobs->parallelFor(name, count, 1, work);
+		} else if (count > 0) {
+			work(0, count);
+		}
+	}
+
 	void Model3D::LoadModel(std::string fileName) {
 
-        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
-		ReadOBJ(fileName, basePath);
+		if (!ReadModel(fileName, nullptr)) {
+
+			exit(1);
+		}
+		UploadModel();
 	}
 
     void Model3D::LoadModel(std::string fileName, std::string basePath)	{
 
-		ReadOBJ(fileName, basePath);
+		if (!ReadOBJ(fileName, basePath, nullptr)) {
+
+			exit(1);
+		}
+		UploadModel();
+	}
+
+	bool Model3D::ReadModel(std::string fileName, gps::JobSystem* jobs) {
+
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+		return ReadOBJ(fileName, basePath, jobs);
+	}
+
+	void Model3D::UploadModel() {
+
+		GPS_CPU_SCOPE("Model3D::UploadModel");
+		size_t firstTexture = loadedTextures.size();
+		for (size_t t = 0; t < pendingTextures.size(); t++) {
+
+			gps::Texture currentTexture;
+			currentTexture.id = UploadTexture(pendingTextures[t]);
+			currentTexture.type = pendingTextures[t].type;
+			currentTexture.path = pendingTextures[t].path;
+			loadedTextures.push_back(currentTexture);
+
+			stbi_image_free(pendingTextures[t].pixels);
+		}
+
+		for (size_t s = 0; s < pendingShapes.size(); s++) {
+
+			std::vector<gps::Texture> textures;
+			for (size_t t = 0; t < pendingShapes[s].textures.size(); t++) {
+				textures.push_back(loadedTextures[firstTexture + pendingShapes[s].textures[t]]);
+			}
+
+			GPS_CPU_SCOPE("Mesh upload");
+			meshes.push_back(gps::Mesh(pendingShapes[s].vertices, pendingShapes[s].indices, textures));
+		}
+
+		pendingShapes.clear();
+		pendingTextures.clear();
 	}
 
 	// Draw each mesh from the model
 	void Model3D::Draw(gps::Shader shaderProgram) {
 
-		for (int i = 0; i < meshes.size(); i++)
+		for (size_t i = 0; i < meshes.size(); i++)
 			meshes[i].Draw(shaderProgram);
 	}
 
-	// Does the parsing of the .obj file and fills in the data structure
-	void Model3D::ReadOBJ(std::string fileName, std::string basePath) {
+	void Model3D::Draw(gps::Shader shaderProgram, const std::vector<bool>& visibleMeshes) {
 
-        std::cout << "Loading : " << fileName << std::endl;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (i >= visibleMeshes.size() || visibleMeshes[i]) {
+				meshes[i].Draw(shaderProgram);
+			}
+		}
+	}
+
+	size_t Model3D::getMeshCount() {
+
+		return meshes.size();
+	}
+
+	const gps::Mesh& Model3D::getMesh(size_t index) {
+
+		return meshes[index];
+	}
+
+	// Does the parsing of the .obj file and fills in the pending shapes and textures
+	bool Model3D::ReadOBJ(std::string fileName, std::string basePath, gps::JobSystem* jobs) {
+
+        GPS_CPU_SCOPE("Model3D::ReadOBJ");
+		// whole lines, models can be read on several threads at once
+		std::ostringstream log;
+        log << "Loading : " << fileName << std::endl;
+		std::cout << log.str();
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
 		int materialId;
 
 		std::string err;
-		bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName.c_str(), basePath.c_str(), GL_TRUE);
+		bool ret;
+		{
+			GPS_CPU_SCOPE("tinyobj::LoadObj");
+			ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName.c_str(), basePath.c_str(), GL_TRUE);
+		}
 
 		if (!err.empty()) {
 
@@ -40,65 +125,23 @@ namespace gps {
 
 		if (!ret) {
 
-			exit(1);
+			// not exit(), this may be a job on a worker thread
+			return false;
 		}
 
-		std::cout << "# of shapes    : " << shapes.size() << std::endl;
-		std::cout << "# of materials : " << materials.size() << std::endl;
+		log.str("");
+		log << "# of shapes    : " << shapes.size() << std::endl;
+		log << "# of materials : " << materials.size() << std::endl;
+		std::cout << log.str();
+
+		size_t firstShape = pendingShapes.size();
+		size_t firstTexture = pendingTextures.size();
+		pendingShapes.resize(firstShape + shapes.size());
 
 		// Loop over shapes
 		for (size_t s = 0; s < shapes.size(); s++) {
 
-			std::vector<gps::Vertex> vertices;
-			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
-
-			// Loop over faces(polygon)
-			size_t index_offset = 0;
-			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-
-				int fv = shapes[s].mesh.num_face_vertices[f];
-
-				//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
-				//textures.push_back(currentTexture);
-
-				// Loop over vertices in the face.
-				for (size_t v = 0; v < fv; v++) {
-
-					// access to vertex
-					tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-					float vx = attrib.vertices[3 * idx.vertex_index + 0];
-					float vy = attrib.vertices[3 * idx.vertex_index + 1];
-					float vz = attrib.vertices[3 * idx.vertex_index + 2];
-					float nx = attrib.normals[3 * idx.normal_index + 0];
-					float ny = attrib.normals[3 * idx.normal_index + 1];
-					float nz = attrib.normals[3 * idx.normal_index + 2];
-					float tx = 0.0f;
-					float ty = 0.0f;
-
-					if (idx.texcoord_index != -1) {
-
-						tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-						ty = attrib.texcoords[2 * idx.texcoord_index + 1];
-					}
-
-					glm::vec3 vertexPosition(vx, vy, vz);
-					glm::vec3 vertexNormal(nx, ny, nz);
-					glm::vec2 vertexTexCoords(tx, ty);
-
-					gps::Vertex currentVertex;
-					currentVertex.Position = vertexPosition;
-					currentVertex.Normal = vertexNormal;
-					currentVertex.TexCoords = vertexTexCoords;
-
-					vertices.push_back(currentVertex);
-
-					indices.push_back((GLuint)(index_offset + v));
-				}
-
-				index_offset += fv;
-			}
+			std::vector<int>& textures = pendingShapes[firstShape + s].textures;
 
 			// get material id
 			// Only try to read materials if the .mtl file is present
@@ -109,19 +152,12 @@ namespace gps {
 				materialId = shapes[s].mesh.material_ids[0];
 				if (materialId != -1) {
 
-					gps::Material currentMaterial;
-					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
-					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
-					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
-
 					//ambient texture
 					std::string ambientTexturePath = materials[materialId].ambient_texname;
 
 					if (!ambientTexturePath.empty()) {
 
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
-						textures.push_back(currentTexture);
+						textures.push_back(AddPendingTexture(basePath + ambientTexturePath, "ambientTexture"));
 					}
 
 					//diffuse texture
@@ -129,9 +165,7 @@ namespace gps {
 
 					if (!diffuseTexturePath.empty()) {
 
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
-						textures.push_back(currentTexture);
+						textures.push_back(AddPendingTexture(basePath + diffuseTexturePath, "diffuseTexture"));
 					}
 
 					//specular texture
@@ -139,49 +173,111 @@ namespace gps {
 
 					if (!specularTexturePath.empty()) {
 
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
-						textures.push_back(currentTexture);
+						textures.push_back(AddPendingTexture(basePath + specularTexturePath, "specularTexture"));
 					}
 				}
 			}
-
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
 		}
+
+		// the shapes and the images are independent of each other, a range of them per job
+		runRanges(jobs, "Model3D::AssembleShape", shapes.size(), [&](size_t first, size_t last) {
+			for (size_t s = first; s < last; s++) {
+				AssembleShape(attrib, shapes[s], pendingShapes[firstShape + s].vertices, pendingShapes[firstShape + s].indices);
+			}
+		});
+		runRanges(jobs, "Model3D::DecodeTexture", pendingTextures.size() - firstTexture, [&](size_t first, size_t last) {
+			for (size_t t = first; t < last; t++) {
+				DecodeTexture(pendingTextures[firstTexture + t]);
+			}
+		});
+		return true;
 	}
 
-	// Retrieves a texture associated with the object - by its name and type
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
+	// Builds the vertex and index lists of one shape, every face corner becomes its own vertex.
+	// Only touches CPU memory, so it can be timed or run on any thread
+	void Model3D::AssembleShape(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape,
+		std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices) {
+
+		// Loop over faces(polygon)
+		size_t index_offset = 0;
+		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+
+			size_t fv = shape.mesh.num_face_vertices[f];
 
-			for (int i = 0; i < loadedTextures.size(); i++) {
+			// Loop over vertices in the face.
+			for (size_t v = 0; v < fv; v++) {
 
-				if (loadedTextures[i].path == path)	{
+				// access to vertex
+				tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
 
-					//already loaded texture
-					return loadedTextures[i];
+				float vx = attrib.vertices[3 * idx.vertex_index + 0];
+				float vy = attrib.vertices[3 * idx.vertex_index + 1];
+				float vz = attrib.vertices[3 * idx.vertex_index + 2];
+				float nx = attrib.normals[3 * idx.normal_index + 0];
+				float ny = attrib.normals[3 * idx.normal_index + 1];
+				float nz = attrib.normals[3 * idx.normal_index + 2];
+				float tx = 0.0f;
+				float ty = 0.0f;
+
+				if (idx.texcoord_index != -1) {
+
+					tx = attrib.texcoords[2 * idx.texcoord_index + 0];
+					ty = attrib.texcoords[2 * idx.texcoord_index + 1];
 				}
+
+				glm::vec3 vertexPosition(vx, vy, vz);
+				glm::vec3 vertexNormal(nx, ny, nz);
+				glm::vec2 vertexTexCoords(tx, ty);
+
+				gps::Vertex currentVertex;
+				currentVertex.Position = vertexPosition;
+				currentVertex.Normal = vertexNormal;
+				currentVertex.TexCoords = vertexTexCoords;
+
+				vertices.push_back(currentVertex);
+
+				indices.push_back((GLuint)(index_offset + v));
 			}
 
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
-			currentTexture.path = path;
+			index_offset += fv;
+		}
+	}
 
-			loadedTextures.push_back(currentTexture);
+	// Index of the pending texture of that path, added the first time - by its name and type
+	int Model3D::AddPendingTexture(std::string path, std::string type) {
+
+		for (size_t i = 0; i < pendingTextures.size(); i++) {
+
+			if (pendingTextures[i].path == path) {
 
-			return currentTexture;
+				//already read texture
+				return (int)i;
+			}
 		}
 
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
+		PendingTexture currentTexture;
+		currentTexture.path = path;
+		currentTexture.type = type;
+		currentTexture.pixels = nullptr;
+		currentTexture.width = 0;
+		currentTexture.height = 0;
+		pendingTextures.push_back(currentTexture);
+
+		return (int)pendingTextures.size() - 1;
+	}
+
+	// Reads the pixel data from an image file, only touches CPU memory
+	void Model3D::DecodeTexture(PendingTexture& texture) {
 
+		GPS_CPU_SCOPE("Model3D::DecodeTexture");
+		const char* file_name = texture.path.c_str();
 		int x, y, n;
 		int force_channels = 4;
 		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
 
 		if (!image_data) {
 			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
+			return;
 		}
 		// NPOT check
 		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
@@ -190,25 +286,19 @@ namespace gps {
 			);
 		}
 
-		int width_in_bytes = x * 4;
-		unsigned char *top = NULL;
-		unsigned char *bottom = NULL;
-		unsigned char temp = 0;
-		int half_height = y / 2;
+		FlipRows(image_data, x, y, 4);
 
-		for (int row = 0; row < half_height; row++) {
-
-			top = image_data + row * width_in_bytes;
-			bottom = image_data + (y - row - 1) * width_in_bytes;
+		texture.pixels = image_data;
+		texture.width = x;
+		texture.height = y;
+	}
 
-			for (int col = 0; col < width_in_bytes; col++) {
+	// Loads decoded pixels into the video memory
+	GLuint Model3D::UploadTexture(const PendingTexture& texture) {
 
-				temp = *top;
-				*top = *bottom;
-				*bottom = temp;
-				top++;
-				bottom++;
-			}
+		GPS_CPU_SCOPE("Model3D::UploadTexture");
+		if (!texture.pixels) {
+			return 0;
 		}
 
 		GLuint textureID;
@@ -218,12 +308,12 @@ namespace gps {
 			GL_TEXTURE_2D,
 			0,
 			GL_RGBA, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
+			texture.width,
+			texture.height,
 			0,
 			GL_RGBA,
 			GL_UNSIGNED_BYTE,
-			image_data
+			texture.pixels
 		);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -236,8 +326,39 @@ namespace gps {
 		return textureID;
 	}
 
+	// Flips the image vertically in place, GL expects the bottom row first
+	void Model3D::FlipRows(unsigned char* image_data, int width, int height, int channels) {
+
+		int width_in_bytes = width * channels;
+		unsigned char *top = NULL;
+		unsigned char *bottom = NULL;
+		unsigned char temp = 0;
+		int half_height = height / 2;
+
+		for (int row = 0; row < half_height; row++) {
+
+			top = image_data + row * width_in_bytes;
+			bottom = image_data + (height - row - 1) * width_in_bytes;
+
+			for (int col = 0; col < width_in_bytes; col++) {
+
+				temp = *top;
+				*top = *bottom;
+				*bottom = temp;
+				top++;
+				bottom++;
+			}
+		}
+	}
+
 	Model3D::~Model3D() {
 
+        // read but never uploaded
+        for (size_t i = 0; i < pendingTextures.size(); i++) {
+
+            stbi_image_free(pendingTextures[i].pixels);
+        }
+
         for (size_t i = 0; i < loadedTextures.size(); i++) {
 
             glDeleteTextures(1, &loadedTextures.at(i).id);
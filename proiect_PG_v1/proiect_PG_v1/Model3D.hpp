@@ -12,6 +12,12 @@
 
 namespace gps {
 
+    class JobSystem;
+
+    // Allocations (malloc and realloc) stb_image has made so far and their bytes, counted in stb_image.cpp
+    size_t imageAllocationCount();
+    size_t imageAllocationBytes();
+
     class Model3D {
 
     public:
@@ -21,22 +27,63 @@ namespace gps {
 
 		void LoadModel(std::string fileName, std::string basePath);
 
+		// LoadModel in two steps: ReadModel parses the file, builds the vertices and decodes the
+		// textures without GL, so it can run on any thread (its shapes and textures split over jobs
+		// when given); UploadModel then creates the buffers and textures on the GL context's thread.
+		// ReadModel returns false when the file cannot be parsed, the caller decides how to stop
+		bool ReadModel(std::string fileName, gps::JobSystem* jobs);
+		void UploadModel();
+
 		void Draw(gps::Shader shaderProgram);
 
+		// Draws the meshes whose entry is true, e.g. after occlusion culling
+		void Draw(gps::Shader shaderProgram, const std::vector<bool>& visibleMeshes);
+
+		size_t getMeshCount();
+		const gps::Mesh& getMesh(size_t index);
+
+		// CPU side steps of loading, public so the loader benchmark can time them without a GL context
+		static void AssembleShape(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape,
+			std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices);
+		static void FlipRows(unsigned char* image_data, int width, int height, int channels);
+
     private:
+		// Read, not uploaded yet
+		struct PendingShape {
+
+			std::vector<gps::Vertex> vertices;
+			std::vector<GLuint> indices;
+			std::vector<int> textures;  // into pendingTextures
+		};
+
+		struct PendingTexture {
+
+			std::string path;
+			std::string type;
+			unsigned char* pixels;  // RGBA, bottom row first; nullptr when the file could not be read
+			int width;
+			int height;
+		};
+
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
 		// Associated textures
         std::vector<gps::Texture> loadedTextures;
 
-		// Does the parsing of the .obj file and fills in the data structure
-		void ReadOBJ(std::string fileName, std::string basePath);
+		std::vector<PendingShape> pendingShapes;
+		std::vector<PendingTexture> pendingTextures;
+
+		// Does the parsing of the .obj file and fills in the pending shapes and textures
+		bool ReadOBJ(std::string fileName, std::string basePath, gps::JobSystem* jobs);
+
+		// Index of the pending texture of that path, added the first time - by its name and type
+		int AddPendingTexture(std::string path, std::string type);
 
-		// Retrieves a texture associated with the object - by its name and type
-		gps::Texture LoadTexture(std::string path, std::string type);
+		// Reads the pixel data from an image file
+		static void DecodeTexture(PendingTexture& texture);
 
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
+		// Loads decoded pixels into the video memory
+		static GLuint UploadTexture(const PendingTexture& texture);
     };
 }
 
@@ -0,0 +1,616 @@
+#include "SceneBVH.hpp"
+#include "CpuProfiler.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define GPS_SCENE_BVH_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define GPS_SCENE_BVH_SSE2 0
+#endif
+
+namespace gps {
+
+    // of a node visit, relative to a triangle test
+    static const float TRAVERSAL_COST = 1.0f;
+    // smaller subtrees are not worth a thread
+    static const int PARALLEL_MIN_TRIANGLES = 4096;
+    // every node pushes at most four children, three of them stay on the stack
+    static const int STACK_SIZE = 3 * SceneBVH::MAX_DEPTH + 4;
+
+    struct TraversalEntry {
+
+        int child;
+        int count;
+        float distance;
+    };
+
+    static float surfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+
+        glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    SceneBVH::SceneBVH() : leafCount(0), buildMilliseconds(0.0), buildNodeCount(0), buildJobs(nullptr) {
+    }
+
+    void SceneBVH::addMesh(const std::vector<gps::Vertex>& vertices, const std::vector<GLuint>& indices,
+        const glm::mat4& model, int meshId) {
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+
+            glm::vec3 a = glm::vec3(model * glm::vec4(vertices[indices[i]].Position, 1.0f));
+            glm::vec3 b = glm::vec3(model * glm::vec4(vertices[indices[i + 1]].Position, 1.0f));
+            glm::vec3 c = glm::vec3(model * glm::vec4(vertices[indices[i + 2]].Position, 1.0f));
+
+            Triangle triangle;
+            triangle.v0 = a;
+            triangle.edge1 = b - a;
+            triangle.edge2 = c - a;
+            triangle.mesh = meshId;
+            triangle.index = (int)(i / 3);
+            triangles.push_back(triangle);
+        }
+    }
+
+    void SceneBVH::clear() {
+
+        triangles.clear();
+        nodes.clear();
+        leafCount = 0;
+    }
+
+    int SceneBVH::allocateBuildNode() {
+
+        return buildNodeCount++;
+    }
+
+    void SceneBVH::buildRecursive(int nodeIndex, int depth, int parallelDepth) {
+
+        int first = buildNodes[nodeIndex].first;
+        int count = buildNodes[nodeIndex].count;
+        buildNodes[nodeIndex].left = -1;
+        buildNodes[nodeIndex].right = -1;
+
+        if (count <= 1 || depth >= MAX_DEPTH) {
+            return;
+        }
+
+        glm::vec3 centroidMin = glm::vec3(FLT_MAX);
+        glm::vec3 centroidMax = glm::vec3(-FLT_MAX);
+        for (int i = first; i < first + count; i++) {
+            centroidMin = glm::min(centroidMin, centroids[order[i]]);
+            centroidMax = glm::max(centroidMax, centroids[order[i]]);
+        }
+
+        // binned SAH: the cost of a split is the area of each side times its triangles
+        struct Bin {
+
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+            int count;
+        };
+
+        int bestAxis = -1;
+        int bestBin = 0;
+        float bestCost = FLT_MAX;
+
+        for (int axis = 0; axis < 3; axis++) {
+
+            float extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f) {
+                continue;
+            }
+
+            Bin bins[SAH_BINS];
+            for (int b = 0; b < SAH_BINS; b++) {
+                bins[b].boundsMin = glm::vec3(FLT_MAX);
+                bins[b].boundsMax = glm::vec3(-FLT_MAX);
+                bins[b].count = 0;
+            }
+
+            float scale = SAH_BINS / extent;
+            for (int i = first; i < first + count; i++) {
+
+                int primitive = order[i];
+                int b = (int)((centroids[primitive][axis] - centroidMin[axis]) * scale);
+                b = b < SAH_BINS ? b : SAH_BINS - 1;
+                bins[b].boundsMin = glm::min(bins[b].boundsMin, primitiveMin[primitive]);
+                bins[b].boundsMax = glm::max(bins[b].boundsMax, primitiveMax[primitive]);
+                bins[b].count++;
+            }
+
+            // right side of each split plane, swept from the right
+            float rightArea[SAH_BINS];
+            int rightCount[SAH_BINS];
+            glm::vec3 sideMin = glm::vec3(FLT_MAX);
+            glm::vec3 sideMax = glm::vec3(-FLT_MAX);
+            int sideCount = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                sideMin = glm::min(sideMin, bins[b].boundsMin);
+                sideMax = glm::max(sideMax, bins[b].boundsMax);
+                sideCount += bins[b].count;
+                rightArea[b - 1] = surfaceArea(sideMin, sideMax);
+                rightCount[b - 1] = sideCount;
+            }
+
+            sideMin = glm::vec3(FLT_MAX);
+            sideMax = glm::vec3(-FLT_MAX);
+            sideCount = 0;
+            for (int b = 0; b < SAH_BINS - 1; b++) {
+                sideMin = glm::min(sideMin, bins[b].boundsMin);
+                sideMax = glm::max(sideMax, bins[b].boundsMax);
+                sideCount += bins[b].count;
+                if (sideCount == 0 || rightCount[b] == 0) {
+                    continue;
+                }
+
+                float cost = surfaceArea(sideMin, sideMax) * sideCount + rightArea[b] * rightCount[b];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        if (count <= MAX_LEAF_TRIANGLES) {
+
+            float nodeArea = surfaceArea(buildNodes[nodeIndex].boundsMin, buildNodes[nodeIndex].boundsMax);
+            if (bestAxis < 0 || (float)count <= TRAVERSAL_COST + bestCost / std::max(nodeArea, FLT_MIN)) {
+                return;
+            }
+        }
+
+        int middle;
+        if (bestAxis >= 0) {
+
+            float scale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+            float axisMin = centroidMin[bestAxis];
+            int axis = bestAxis;
+            int splitBin = bestBin;
+            middle = (int)(std::partition(order.begin() + first, order.begin() + first + count, [&](int primitive) {
+                int b = (int)((centroids[primitive][axis] - axisMin) * scale);
+                return (b < SAH_BINS ? b : SAH_BINS - 1) <= splitBin;
+            }) - order.begin());
+        } else {
+            // every centroid in one point, any halving will do
+            middle = first + count / 2;
+        }
+
+        int left = allocateBuildNode();
+        int right = allocateBuildNode();
+        int ranges[2][2] = { { first, middle - first }, { middle, first + count - middle } };
+        int children[2] = { left, right };
+        for (int c = 0; c < 2; c++) {
+
+            BuildNode& child = buildNodes[children[c]];
+            child.first = ranges[c][0];
+            child.count = ranges[c][1];
+            child.boundsMin = glm::vec3(FLT_MAX);
+            child.boundsMax = glm::vec3(-FLT_MAX);
+            for (int i = child.first; i < child.first + child.count; i++) {
+                child.boundsMin = glm::min(child.boundsMin, primitiveMin[order[i]]);
+                child.boundsMax = glm::max(child.boundsMax, primitiveMax[order[i]]);
+            }
+        }
+        buildNodes[nodeIndex].left = left;
+        buildNodes[nodeIndex].right = right;
+
+        // the two halves touch disjoint ranges of order and their own nodes
+        if (parallelDepth > 0 && count >= PARALLEL_MIN_TRIANGLES) {
+            gps::JobCounter leftBuilt;
+            buildJobs->run("SceneBVH::buildRecursive", [this, left, depth, parallelDepth]() {
+                buildRecursive(left, depth + 1, parallelDepth - 1);
+            }, &leftBuilt);
+            buildRecursive(right, depth + 1, parallelDepth - 1);
+            buildJobs->wait(leftBuilt);
+        } else {
+            buildRecursive(left, depth + 1, 0);
+            buildRecursive(right, depth + 1, 0);
+        }
+    }
+
+    int SceneBVH::flatten(int buildIndex) {
+
+        // up to four descendants: open the inner child with the largest surface until there are four
+        int children[4];
+        int childCount = 0;
+        const BuildNode& root = buildNodes[buildIndex];
+        if (root.left < 0) {
+            children[childCount++] = buildIndex;
+        } else {
+            children[childCount++] = root.left;
+            children[childCount++] = root.right;
+
+            while (childCount < 4) {
+
+                int largest = -1;
+                float largestArea = -1.0f;
+                for (int c = 0; c < childCount; c++) {
+
+                    const BuildNode& child = buildNodes[children[c]];
+                    float area = surfaceArea(child.boundsMin, child.boundsMax);
+                    if (child.left >= 0 && area > largestArea) {
+                        largest = c;
+                        largestArea = area;
+                    }
+                }
+                if (largest < 0) {
+                    break;
+                }
+
+                int opened = children[largest];
+                children[largest] = buildNodes[opened].left;
+                children[childCount++] = buildNodes[opened].right;
+            }
+        }
+
+        int nodeIndex = (int)nodes.size();
+        nodes.push_back(Node());
+
+        for (int c = 0; c < 4; c++) {
+
+            glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+            glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+            int childIndex = -1;
+            int triangleCount = 0;
+
+            if (c < childCount) {
+
+                const BuildNode& child = buildNodes[children[c]];
+                boundsMin = child.boundsMin;
+                boundsMax = child.boundsMax;
+                if (child.left < 0) {
+                    childIndex = child.first;
+                    triangleCount = child.count;
+                    leafCount++;
+                } else {
+                    childIndex = flatten(children[c]);
+                }
+            }
+
+            // flatten may have grown nodes
+            Node& node = nodes[nodeIndex];
+            node.minX[c] = boundsMin.x;
+            node.minY[c] = boundsMin.y;
+            node.minZ[c] = boundsMin.z;
+            node.maxX[c] = boundsMax.x;
+            node.maxY[c] = boundsMax.y;
+            node.maxZ[c] = boundsMax.z;
+            node.child[c] = childIndex;
+            node.count[c] = triangleCount;
+        }
+
+        return nodeIndex;
+    }
+
+    void SceneBVH::build(gps::JobSystem* jobs) {
+
+        GPS_CPU_SCOPE("SceneBVH::build");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        nodes.clear();
+        leafCount = 0;
+
+        int triangleCount = (int)triangles.size();
+        if (triangleCount == 0) {
+            buildMilliseconds = 0.0;
+            return;
+        }
+
+        primitiveMin.resize(triangleCount);
+        primitiveMax.resize(triangleCount);
+        centroids.resize(triangleCount);
+        order.resize(triangleCount);
+
+        glm::vec3 sceneMin = glm::vec3(FLT_MAX);
+        glm::vec3 sceneMax = glm::vec3(-FLT_MAX);
+        for (int i = 0; i < triangleCount; i++) {
+
+            const Triangle& triangle = triangles[i];
+            glm::vec3 b = triangle.v0 + triangle.edge1;
+            glm::vec3 c = triangle.v0 + triangle.edge2;
+            primitiveMin[i] = glm::min(triangle.v0, glm::min(b, c));
+            primitiveMax[i] = glm::max(triangle.v0, glm::max(b, c));
+            centroids[i] = (primitiveMin[i] + primitiveMax[i]) * 0.5f;
+            order[i] = i;
+
+            sceneMin = glm::min(sceneMin, primitiveMin[i]);
+            sceneMax = glm::max(sceneMax, primitiveMax[i]);
+        }
+
+        // a binary tree over n triangles has at most 2n - 1 nodes, the vector never grows while threads build
+        buildNodes.resize(2 * (size_t)triangleCount);
+        buildNodeCount = 0;
+        int root = allocateBuildNode();
+        buildNodes[root].first = 0;
+        buildNodes[root].count = triangleCount;
+        buildNodes[root].boundsMin = sceneMin;
+        buildNodes[root].boundsMax = sceneMax;
+
+        // each parallel level doubles the jobs
+        buildJobs = jobs;
+        int threadCount = jobs ? jobs->getThreadCount() : 1;
+        int parallelDepth = 0;
+        while ((1 << parallelDepth) < threadCount) {
+            parallelDepth++;
+        }
+        buildRecursive(root, 0, parallelDepth);
+        buildJobs = nullptr;
+
+        // leaves refer to ranges of the reordered triangles
+        std::vector<Triangle> sorted(triangleCount);
+        for (int i = 0; i < triangleCount; i++) {
+            sorted[i] = triangles[order[i]];
+        }
+        triangles.swap(sorted);
+
+        nodes.reserve(buildNodeCount);
+        flatten(root);
+
+        std::vector<glm::vec3>().swap(primitiveMin);
+        std::vector<glm::vec3>().swap(primitiveMax);
+        std::vector<glm::vec3>().swap(centroids);
+        std::vector<int>().swap(order);
+        std::vector<BuildNode>().swap(buildNodes);
+
+        buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool SceneBVH::intersectTriangle(const Triangle& triangle, const glm::vec3& origin, const glm::vec3& direction,
+        float maxDistance, float& distance, float& u, float& v) {
+
+        glm::vec3 p = glm::cross(direction, triangle.edge2);
+        float determinant = glm::dot(triangle.edge1, p);
+
+        // parallel to the plane
+        if (std::fabs(determinant) < 1e-12f) {
+            return false;
+        }
+
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = origin - triangle.v0;
+        u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+
+        glm::vec3 q = glm::cross(s, triangle.edge1);
+        v = glm::dot(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+
+        distance = glm::dot(triangle.edge2, q) * inverseDeterminant;
+        return distance >= 0.0f && distance < maxDistance;
+    }
+
+    bool SceneBVH::traverse(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, bool stopAtAny, RayHit* hit) {
+
+        if (nodes.empty()) {
+            return false;
+        }
+
+        // a zero component would give 0 * inf in the slab test
+        glm::vec3 inverse;
+        for (int axis = 0; axis < 3; axis++) {
+            inverse[axis] = 1.0f / (direction[axis] != 0.0f ? direction[axis] : 1e-30f);
+        }
+
+        // the planes the ray enters through
+        bool negativeX = inverse.x < 0.0f;
+        bool negativeY = inverse.y < 0.0f;
+        bool negativeZ = inverse.z < 0.0f;
+
+#if GPS_SCENE_BVH_SSE2
+        __m128 originX = _mm_set1_ps(origin.x);
+        __m128 originY = _mm_set1_ps(origin.y);
+        __m128 originZ = _mm_set1_ps(origin.z);
+        __m128 inverseX = _mm_set1_ps(inverse.x);
+        __m128 inverseY = _mm_set1_ps(inverse.y);
+        __m128 inverseZ = _mm_set1_ps(inverse.z);
+#endif
+
+        TraversalEntry stack[STACK_SIZE];
+        int stackSize = 0;
+        stack[stackSize].child = 0;
+        stack[stackSize].count = 0;
+        stack[stackSize].distance = 0.0f;
+        stackSize++;
+
+        float closest = maxDistance;
+        bool found = false;
+
+        while (stackSize > 0) {
+
+            TraversalEntry entry = stack[--stackSize];
+
+            // a nearer hit was found since it was pushed
+            if (entry.distance > closest) {
+                continue;
+            }
+
+            if (entry.count > 0) {
+
+                for (int i = entry.child; i < entry.child + entry.count; i++) {
+
+                    float distance;
+                    float u;
+                    float v;
+                    if (intersectTriangle(triangles[i], origin, direction, closest, distance, u, v)) {
+
+                        if (stopAtAny) {
+                            return true;
+                        }
+                        closest = distance;
+                        found = true;
+                        hit->distance = distance;
+                        hit->mesh = triangles[i].mesh;
+                        hit->triangle = triangles[i].index;
+                        hit->u = u;
+                        hit->v = v;
+                    }
+                }
+                continue;
+            }
+
+            const Node& node = nodes[entry.child];
+            float entryDistances[4];
+            int hitMask = 0;
+
+#if GPS_SCENE_BVH_SSE2
+            __m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(negativeX ? node.maxX : node.minX), originX), inverseX);
+            __m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(negativeY ? node.maxY : node.minY), originY), inverseY);
+            __m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(negativeZ ? node.maxZ : node.minZ), originZ), inverseZ);
+            __m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(negativeX ? node.minX : node.maxX), originX), inverseX);
+            __m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(negativeY ? node.minY : node.maxY), originY), inverseY);
+            __m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(negativeZ ? node.minZ : node.maxZ), originZ), inverseZ);
+
+            __m128 enter = _mm_max_ps(_mm_max_ps(nearX, nearY), _mm_max_ps(nearZ, _mm_setzero_ps()));
+            __m128 leave = _mm_min_ps(_mm_min_ps(farX, farY), _mm_min_ps(farZ, _mm_set1_ps(closest)));
+            hitMask = _mm_movemask_ps(_mm_cmple_ps(enter, leave));
+            _mm_storeu_ps(entryDistances, enter);
+#else
+            for (int c = 0; c < 4; c++) {
+
+                float nearX = ((negativeX ? node.maxX[c] : node.minX[c]) - origin.x) * inverse.x;
+                float nearY = ((negativeY ? node.maxY[c] : node.minY[c]) - origin.y) * inverse.y;
+                float nearZ = ((negativeZ ? node.maxZ[c] : node.minZ[c]) - origin.z) * inverse.z;
+                float farX = ((negativeX ? node.minX[c] : node.maxX[c]) - origin.x) * inverse.x;
+                float farY = ((negativeY ? node.minY[c] : node.maxY[c]) - origin.y) * inverse.y;
+                float farZ = ((negativeZ ? node.minZ[c] : node.maxZ[c]) - origin.z) * inverse.z;
+
+                entryDistances[c] = std::max(std::max(nearX, nearY), std::max(nearZ, 0.0f));
+                float leave = std::min(std::min(farX, farY), std::min(farZ, closest));
+                if (entryDistances[c] <= leave) {
+                    hitMask |= 1 << c;
+                }
+            }
+#endif
+
+            // the nearest child goes on top of the stack
+            int pushed = stackSize;
+            for (int c = 0; c < 4; c++) {
+
+                if (!(hitMask & (1 << c)) || node.child[c] < 0) {
+                    continue;
+                }
+
+                TraversalEntry child;
+                child.child = node.child[c];
+                child.count = node.count[c];
+                child.distance = entryDistances[c];
+
+                int slot = stackSize++;
+                while (!stopAtAny && slot > pushed && stack[slot - 1].distance < child.distance) {
+                    stack[slot] = stack[slot - 1];
+                    slot--;
+                }
+                stack[slot] = child;
+            }
+        }
+
+        return found;
+    }
+
+    bool SceneBVH::closestHit(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) {
+
+        return traverse(origin, direction, maxDistance, false, &hit);
+    }
+
+    bool SceneBVH::anyHit(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) {
+
+        return traverse(origin, direction, maxDistance, true, nullptr);
+    }
+
+    void SceneBVH::collectTriangles(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<glm::vec3>& corners) {
+
+        if (nodes.empty()) {
+            return;
+        }
+
+        int stack[STACK_SIZE];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+
+            const Node& node = nodes[stack[--stackSize]];
+            for (int c = 0; c < 4; c++) {
+
+                if (node.child[c] < 0
+                    || node.minX[c] > boundsMax.x || node.maxX[c] < boundsMin.x
+                    || node.minY[c] > boundsMax.y || node.maxY[c] < boundsMin.y
+                    || node.minZ[c] > boundsMax.z || node.maxZ[c] < boundsMin.z) {
+                    continue;
+                }
+
+                if (node.count[c] == 0) {
+                    stack[stackSize++] = node.child[c];
+                    continue;
+                }
+
+                for (int i = node.child[c]; i < node.child[c] + node.count[c]; i++) {
+
+                    const Triangle& triangle = triangles[i];
+                    glm::vec3 b = triangle.v0 + triangle.edge1;
+                    glm::vec3 d = triangle.v0 + triangle.edge2;
+                    glm::vec3 triangleMin = glm::min(triangle.v0, glm::min(b, d));
+                    glm::vec3 triangleMax = glm::max(triangle.v0, glm::max(b, d));
+                    if (triangleMin.x > boundsMax.x || triangleMax.x < boundsMin.x
+                        || triangleMin.y > boundsMax.y || triangleMax.y < boundsMin.y
+                        || triangleMin.z > boundsMax.z || triangleMax.z < boundsMin.z) {
+                        continue;
+                    }
+
+                    corners.push_back(triangle.v0);
+                    corners.push_back(b);
+                    corners.push_back(d);
+                }
+            }
+        }
+    }
+
+    size_t SceneBVH::getTriangleCount() {
+
+        return triangles.size();
+    }
+
+    size_t SceneBVH::getNodeCount() {
+
+        return nodes.size();
+    }
+
+    size_t SceneBVH::getLeafCount() {
+
+        return leafCount;
+    }
+
+    double SceneBVH::getBuildMilliseconds() {
+
+        return buildMilliseconds;
+    }
+
+    void SceneBVH::getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) {
+
+        boundsMin = glm::vec3(FLT_MAX);
+        boundsMax = glm::vec3(-FLT_MAX);
+        if (nodes.empty()) {
+            return;
+        }
+
+        const Node& root = nodes[0];
+        for (int c = 0; c < 4; c++) {
+            if (root.child[c] >= 0) {
+                boundsMin = glm::min(boundsMin, glm::vec3(root.minX[c], root.minY[c], root.minZ[c]));
+                boundsMax = glm::max(boundsMax, glm::vec3(root.maxX[c], root.maxY[c], root.maxZ[c]));
+            }
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef SceneBVH_hpp
+#define SceneBVH_hpp
+
+#include "Mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace gps {
+
+    class JobSystem;
+
+    struct RayHit {
+
+        float distance;  // along the ray direction, in lengths of it
+        int mesh;        // the id given to addMesh
+        int triangle;    // triangle of that mesh, in index buffer order
+        float u;         // barycentric weights of the second and third vertex
+        float v;
+    };
+
+    // Bounding volume hierarchy over the world space triangles of static meshes, for ray queries on the CPU
+    // (picking, light visibility, baking) without a scan over every triangle.
+    // build() splits by the surface area heuristic over SAH_BINS bins per axis, the halves of the upper
+    // levels as separate jobs. The binary tree is then collapsed into a four wide one: each 128 byte node holds
+    // the bounds of its four children plane by plane, so one SSE slab test checks them all.
+    // Nodes are stored depth first and the triangles in leaf order.
+    class SceneBVH {
+
+    public:
+        static const int SAH_BINS = 16;
+        static const int MAX_LEAF_TRIANGLES = 8;
+        static const int MAX_DEPTH = 64;
+
+        SceneBVH();
+
+        // Copies the triangles in world space, build() has to run again afterwards
+        void addMesh(const std::vector<gps::Vertex>& vertices, const std::vector<GLuint>& indices,
+            const glm::mat4& model, int meshId);
+        void clear();
+
+        // Splits the upper levels over the jobs, builds on the calling thread alone without them
+        void build(gps::JobSystem* jobs);
+
+        // Nearest triangle hit by the ray before maxDistance, both faces count.
+        // The direction does not need to be normalized
+        bool closestHit(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit);
+
+        // True as soon as any triangle is hit before maxDistance, for visibility
+        bool anyHit(const glm::vec3& origin, const glm::vec3& direction, float maxDistance);
+
+        // Appends the three corners of every triangle whose bounds overlap the box, for collision
+        void collectTriangles(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<glm::vec3>& corners);
+
+        size_t getTriangleCount();
+        size_t getNodeCount();
+        size_t getLeafCount();
+        double getBuildMilliseconds();
+        void getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    private:
+        // Child c is a node when count[c] == 0 and child[c] >= 0, a leaf of count[c] triangles
+        // from child[c] when count[c] > 0, and unused when child[c] < 0 (its bounds are empty)
+        struct Node {
+
+            float minX[4];
+            float minY[4];
+            float minZ[4];
+            float maxX[4];
+            float maxY[4];
+            float maxZ[4];
+            int child[4];
+            int count[4];
+        };
+
+        // Edges for the Moller-Trumbore test
+        struct Triangle {
+
+            glm::vec3 v0;
+            glm::vec3 edge1;
+            glm::vec3 edge2;
+            int mesh;
+            int index;
+        };
+
+        struct BuildNode {
+
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+            int first;
+            int count;
+            int left;   // -1 for a leaf
+            int right;
+        };
+
+        std::vector<Triangle> triangles;
+        std::vector<Node> nodes;
+        size_t leafCount;
+        double buildMilliseconds;
+
+        // only while building
+        std::vector<glm::vec3> primitiveMin;
+        std::vector<glm::vec3> primitiveMax;
+        std::vector<glm::vec3> centroids;
+        std::vector<int> order;
+        std::vector<BuildNode> buildNodes;
+        std::atomic<int> buildNodeCount;
+        gps::JobSystem* buildJobs;
+
+        int allocateBuildNode();
+        void buildRecursive(int nodeIndex, int depth, int parallelDepth);
+        int flatten(int buildIndex);
+        bool intersectTriangle(const Triangle& triangle, const glm::vec3& origin, const glm::vec3& direction,
+            float maxDistance, float& distance, float& u, float& v);
+        // Nearest first, stopAtAny returns on the first hit and leaves hit untouched
+        bool traverse(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, bool stopAtAny, RayHit* hit);
+    };
+}
+
+#endif /* SceneBVH_hpp */
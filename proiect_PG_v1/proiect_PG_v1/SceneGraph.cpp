@@ -0,0 +1,113 @@
+#include "SceneGraph.hpp"
+#include "CpuProfiler.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+
+namespace gps {
+
+    SceneGraph::SceneGraph() : firstDirty(0), lastUpdatedCount(0) {
+    }
+
+    int SceneGraph::addNode(int parent, const glm::mat4& local) {
+
+        int node = (int)parents.size();
+        parents.push_back(parent);
+        locals.push_back(local);
+        worlds.push_back(local);
+        normals.push_back(glm::mat3(1.0f));
+        dirty.push_back(1);
+        updated.push_back(0);
+        firstDirty = std::min(firstDirty, node);
+        return node;
+    }
+
+    void SceneGraph::clear() {
+
+        parents.clear();
+        locals.clear();
+        worlds.clear();
+        normals.clear();
+        dirty.clear();
+        updated.clear();
+        firstDirty = 0;
+        lastUpdatedCount = 0;
+    }
+
+    void SceneGraph::reserve(size_t nodeCount) {
+
+        parents.reserve(nodeCount);
+        locals.reserve(nodeCount);
+        worlds.reserve(nodeCount);
+        normals.reserve(nodeCount);
+        dirty.reserve(nodeCount);
+        updated.reserve(nodeCount);
+    }
+
+    void SceneGraph::setLocal(int node, const glm::mat4& local) {
+
+        locals[node] = local;
+        dirty[node] = 1;
+        firstDirty = std::min(firstDirty, node);
+    }
+
+    const glm::mat4& SceneGraph::getLocal(int node) {
+
+        return locals[node];
+    }
+
+    const glm::mat4& SceneGraph::getWorld(int node) {
+
+        return worlds[node];
+    }
+
+    const glm::mat3& SceneGraph::getNormal(int node) {
+
+        return normals[node];
+    }
+
+    int SceneGraph::getParent(int node) {
+
+        return parents[node];
+    }
+
+    size_t SceneGraph::getNodeCount() {
+
+        return parents.size();
+    }
+
+    int SceneGraph::update() {
+
+        GPS_CPU_SCOPE("SceneGraph::update");
+        int nodeCount = (int)parents.size();
+
+        if (lastUpdatedCount > 0) {
+            std::fill(updated.begin(), updated.end(), (unsigned char)0);
+        }
+
+        int count = 0;
+        for (int node = firstDirty; node < nodeCount; node++) {
+
+            int parent = parents[node];
+            if (!dirty[node] && (parent < 0 || !updated[parent])) {
+                continue;
+            }
+
+            worlds[node] = parent < 0 ? locals[node] : worlds[parent] * locals[node];
+            normals[node] = glm::inverseTranspose(glm::mat3(worlds[node]));
+            dirty[node] = 0;
+            updated[node] = 1;
+            count++;
+        }
+
+        firstDirty = nodeCount;
+        lastUpdatedCount = count;
+        return count;
+    }
+
+    bool SceneGraph::wasUpdated(int node) {
+
+        return updated[node] != 0;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef SceneGraph_hpp
+#define SceneGraph_hpp
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    // Transform hierarchy with cached world and normal matrices. Nodes are stored as parallel arrays
+    // (parent, local, world, normal, flags) in creation order; a parent has to exist before its
+    // children, so every parent comes before its children in the arrays. update() is then one
+    // forward sweep: a node is recomputed when its local matrix changed or its parent was recomputed
+    // in the same sweep, starting at the first changed node. Nothing is recomputed between changes.
+    class SceneGraph {
+
+    public:
+        SceneGraph();
+
+        // parent -1 for a root, returns the node index
+        int addNode(int parent, const glm::mat4& local);
+        void clear();
+        void reserve(size_t nodeCount);
+
+        void setLocal(int node, const glm::mat4& local);
+        const glm::mat4& getLocal(int node);
+        // As of the last update
+        const glm::mat4& getWorld(int node);
+        // Inverse transpose of the upper 3x3 of the world matrix; mat3(view) * it is the view space
+        // normal matrix for a view without scale
+        const glm::mat3& getNormal(int node);
+        int getParent(int node);
+        size_t getNodeCount();
+
+        // Recomputes the changed nodes and everything below them, returns how many
+        int update();
+        // Recomputed by the last update
+        bool wasUpdated(int node);
+
+    private:
+        std::vector<int> parents;
+        std::vector<glm::mat4> locals;
+        std::vector<glm::mat4> worlds;
+        std::vector<glm::mat3> normals;
+        std::vector<unsigned char> dirty;    // local set since the last update
+        std::vector<unsigned char> updated;  // by the last update
+        int firstDirty;                      // nodes before it are unchanged, the size when none is
+        int lastUpdatedCount;
+    };
+}
+
+#endif /* SceneGraph_hpp */
@@ -0,0 +1,358 @@
+#include "SceneIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    SceneIndex::SceneIndex() {
+
+        Create(glm::vec3(0.0f), 1.0f);
+    }
+
+    void SceneIndex::Create(const glm::vec3& worldCenter, float worldHalfSize) {
+
+        this->worldCenter = worldCenter;
+        this->worldHalfSize = worldHalfSize;
+        nodes.clear();
+        freeNodes.clear();
+        instances.clear();
+        freeInstances.clear();
+
+        Node root;
+        root.center = worldCenter;
+        root.halfSize = worldHalfSize;
+        root.depth = 0;
+        root.parent = -1;
+        std::fill(root.children, root.children + 8, -1);
+        root.subtreeCount = 0;
+        nodes.push_back(root);
+    }
+
+    void SceneIndex::clear() {
+
+        Create(worldCenter, worldHalfSize);
+    }
+
+    int SceneIndex::allocateNode(int parent, int octant) {
+
+        // the parent may move when nodes grows
+        float halfSize = nodes[parent].halfSize * 0.5f;
+        glm::vec3 center = nodes[parent].center + glm::vec3(
+            (octant & 1) ? halfSize : -halfSize,
+            (octant & 2) ? halfSize : -halfSize,
+            (octant & 4) ? halfSize : -halfSize);
+        int depth = nodes[parent].depth + 1;
+
+        int index;
+        if (!freeNodes.empty()) {
+            index = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            index = (int)nodes.size();
+            nodes.push_back(Node());
+        }
+
+        Node& node = nodes[index];
+        node.center = center;
+        node.halfSize = halfSize;
+        node.depth = depth;
+        node.parent = parent;
+        std::fill(node.children, node.children + 8, -1);
+        node.subtreeCount = 0;
+        node.instances.clear();
+        return index;
+    }
+
+    int SceneIndex::targetDepth(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+
+        glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+        float largest = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+
+        // a cell of half size h holds bounds of half extent up to h anywhere in it
+        int depth = 0;
+        float halfSize = worldHalfSize;
+        while (depth < MAX_DEPTH && halfSize * 0.5f >= largest) {
+            halfSize *= 0.5f;
+            depth++;
+        }
+        return depth;
+    }
+
+    bool SceneIndex::inCell(int node, const glm::vec3& point) {
+
+        glm::vec3 offset = point - nodes[node].center;
+        float halfSize = nodes[node].halfSize;
+        return std::abs(offset.x) <= halfSize && std::abs(offset.y) <= halfSize && std::abs(offset.z) <= halfSize;
+    }
+
+    void SceneIndex::link(int instance) {
+
+        glm::vec3 center = (instances[instance].boundsMin + instances[instance].boundsMax) * 0.5f;
+        int depth = targetDepth(instances[instance].boundsMin, instances[instance].boundsMax);
+
+        int node = 0;
+        if (inCell(0, center)) {
+            while (nodes[node].depth < depth) {
+
+                int octant = (center.x >= nodes[node].center.x ? 1 : 0)
+                    | (center.y >= nodes[node].center.y ? 2 : 0)
+                    | (center.z >= nodes[node].center.z ? 4 : 0);
+                int child = nodes[node].children[octant];
+                if (child < 0) {
+                    child = allocateNode(node, octant);
+                    nodes[node].children[octant] = child;
+                }
+                node = child;
+            }
+        }
+
+        nodes[node].instances.push_back(instance);
+        instances[instance].node = node;
+        instances[instance].slot = (int)nodes[node].instances.size() - 1;
+        for (int n = node; n >= 0; n = nodes[n].parent) {
+            nodes[n].subtreeCount++;
+        }
+    }
+
+    void SceneIndex::unlink(int instance) {
+
+        int node = instances[instance].node;
+        int slot = instances[instance].slot;
+
+        std::vector<int>& list = nodes[node].instances;
+        int last = list.back();
+        list[slot] = last;
+        instances[last].slot = slot;
+        list.pop_back();
+        instances[instance].node = -1;
+
+        for (int n = node; n >= 0; n = nodes[n].parent) {
+            nodes[n].subtreeCount--;
+        }
+
+        // an empty subtree has already given back its children
+        while (node != 0 && nodes[node].subtreeCount == 0) {
+
+            int parent = nodes[node].parent;
+            for (int c = 0; c < 8; c++) {
+                if (nodes[parent].children[c] == node) {
+                    nodes[parent].children[c] = -1;
+                }
+            }
+            freeNodes.push_back(node);
+            node = parent;
+        }
+    }
+
+    int SceneIndex::insert(const glm::vec3& boundsMin, const glm::vec3& boundsMax, int userData) {
+
+        int instance;
+        if (!freeInstances.empty()) {
+            instance = freeInstances.back();
+            freeInstances.pop_back();
+        } else {
+            instance = (int)instances.size();
+            instances.push_back(Instance());
+        }
+
+        instances[instance].boundsMin = boundsMin;
+        instances[instance].boundsMax = boundsMax;
+        instances[instance].userData = userData;
+        link(instance);
+        return instance;
+    }
+
+    void SceneIndex::move(int instance, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+
+        instances[instance].boundsMin = boundsMin;
+        instances[instance].boundsMax = boundsMax;
+
+        // most moves stay in the cell at the same depth, only the bounds change
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        int depth = targetDepth(boundsMin, boundsMax);
+        int node = instances[instance].node;
+        bool stays = node == 0 ? (depth == 0 || !inCell(0, center)) : (nodes[node].depth == depth && inCell(node, center));
+        if (!stays) {
+            unlink(instance);
+            link(instance);
+        }
+    }
+
+    void SceneIndex::remove(int instance) {
+
+        unlink(instance);
+        freeInstances.push_back(instance);
+    }
+
+    int SceneIndex::getUserData(int instance) {
+
+        return instances[instance].userData;
+    }
+
+    void SceneIndex::getBounds(int instance, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+
+        boundsMin = instances[instance].boundsMin;
+        boundsMax = instances[instance].boundsMax;
+    }
+
+    size_t SceneIndex::getInstanceCount() {
+
+        return instances.size() - freeInstances.size();
+    }
+
+    size_t SceneIndex::getNodeCount() {
+
+        return nodes.size() - freeNodes.size();
+    }
+
+    SceneIndex::Containment SceneIndex::classify(const Shape& shape, const glm::vec3& boundsMin, const glm::vec3& boundsMax, int& planeMask) {
+
+        if (shape.kind == Shape::FRUSTUM) {
+
+            // the corner furthest along each plane normal decides outside, the nearest one inside
+            for (int p = 0; p < 6; p++) {
+
+                if (!(planeMask & (1 << p))) {
+                    continue;
+                }
+
+                glm::vec3 normal = glm::vec3(shape.planes[p]);
+                glm::vec3 positive = glm::vec3(normal.x >= 0.0f ? boundsMax.x : boundsMin.x,
+                    normal.y >= 0.0f ? boundsMax.y : boundsMin.y, normal.z >= 0.0f ? boundsMax.z : boundsMin.z);
+                glm::vec3 negative = glm::vec3(normal.x >= 0.0f ? boundsMin.x : boundsMax.x,
+                    normal.y >= 0.0f ? boundsMin.y : boundsMax.y, normal.z >= 0.0f ? boundsMin.z : boundsMax.z);
+
+                if (glm::dot(normal, positive) + shape.planes[p].w < 0.0f) {
+                    return OUTSIDE;
+                }
+                if (glm::dot(normal, negative) + shape.planes[p].w >= 0.0f) {
+                    planeMask &= ~(1 << p);
+                }
+            }
+            return planeMask == 0 ? INSIDE : INTERSECTS;
+        }
+
+        if (shape.kind == Shape::SPHERE) {
+
+            glm::vec3 closest = glm::clamp(shape.center, boundsMin, boundsMax);
+            glm::vec3 toClosest = closest - shape.center;
+            float radiusSquared = shape.radius * shape.radius;
+            if (glm::dot(toClosest, toClosest) > radiusSquared) {
+                return OUTSIDE;
+            }
+
+            glm::vec3 toFarthest = glm::max(glm::abs(shape.center - boundsMin), glm::abs(shape.center - boundsMax));
+            return glm::dot(toFarthest, toFarthest) <= radiusSquared ? INSIDE : INTERSECTS;
+        }
+
+        // slabs, a ray never holds a box
+        glm::vec3 slabNear = (boundsMin - shape.origin) * shape.inverseDirection;
+        glm::vec3 slabFar = (boundsMax - shape.origin) * shape.inverseDirection;
+        glm::vec3 entries = glm::min(slabNear, slabFar);
+        glm::vec3 exits = glm::max(slabNear, slabFar);
+        float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+        float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, shape.maxDistance));
+        return enter <= exit ? INTERSECTS : OUTSIDE;
+    }
+
+    void SceneIndex::collectSubtree(int node, std::vector<int>& result) {
+
+        result.insert(result.end(), nodes[node].instances.begin(), nodes[node].instances.end());
+        for (int c = 0; c < 8; c++) {
+            if (nodes[node].children[c] >= 0) {
+                collectSubtree(nodes[node].children[c], result);
+            }
+        }
+    }
+
+    void SceneIndex::query(const Shape& shape, std::vector<int>& result) {
+
+        stack.clear();
+        StackEntry root;
+        root.node = 0;
+        root.planeMask = 0x3f;
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+
+            StackEntry entry = stack.back();
+            stack.pop_back();
+            int node = entry.node;
+            if (nodes[node].subtreeCount == 0) {
+                continue;
+            }
+
+            // the root also holds what is outside the world, it is never culled as a whole
+            Containment containment = INTERSECTS;
+            if (node != 0) {
+                glm::vec3 loose = glm::vec3(nodes[node].halfSize * 2.0f);
+                containment = classify(shape, nodes[node].center - loose, nodes[node].center + loose, entry.planeMask);
+            }
+
+            if (containment == OUTSIDE) {
+                continue;
+            }
+            if (containment == INSIDE) {
+                collectSubtree(node, result);
+                continue;
+            }
+
+            const std::vector<int>& list = nodes[node].instances;
+            for (size_t i = 0; i < list.size(); i++) {
+                int planeMask = entry.planeMask;
+                if (classify(shape, instances[list[i]].boundsMin, instances[list[i]].boundsMax, planeMask) != OUTSIDE) {
+                    result.push_back(list[i]);
+                }
+            }
+
+            for (int c = 0; c < 8; c++) {
+                if (nodes[node].children[c] >= 0) {
+                    StackEntry child;
+                    child.node = nodes[node].children[c];
+                    child.planeMask = entry.planeMask;
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+
+    void SceneIndex::queryFrustum(const glm::mat4& viewProjection, std::vector<int>& result) {
+
+        // planes from the rows of the matrix (Gribb and Hartmann), inside is positive
+        glm::vec4 rows[4];
+        for (int r = 0; r < 4; r++) {
+            rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+        }
+
+        Shape shape;
+        shape.kind = Shape::FRUSTUM;
+        for (int axis = 0; axis < 3; axis++) {
+            shape.planes[2 * axis] = rows[3] + rows[axis];
+            shape.planes[2 * axis + 1] = rows[3] - rows[axis];
+        }
+        query(shape, result);
+    }
+
+    void SceneIndex::querySphere(const glm::vec3& center, float radius, std::vector<int>& result) {
+
+        Shape shape;
+        shape.kind = Shape::SPHERE;
+        shape.center = center;
+        shape.radius = radius;
+        query(shape, result);
+    }
+
+    void SceneIndex::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<int>& result) {
+
+        Shape shape;
+        shape.kind = Shape::RAY;
+        shape.origin = origin;
+        // a zero component would give 0 * inf in the slab test
+        for (int axis = 0; axis < 3; axis++) {
+            shape.inverseDirection[axis] = 1.0f / (direction[axis] != 0.0f ? direction[axis] : 1e-30f);
+        }
+        shape.maxDistance = maxDistance;
+        query(shape, result);
+    }
+}
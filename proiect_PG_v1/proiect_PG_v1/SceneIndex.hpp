@@ -0,0 +1,106 @@
+#ifndef SceneIndex_hpp
+#define SceneIndex_hpp
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    // Loose octree over object instances with world space bounds, for frustum, sphere and ray queries.
+    // An instance lives in one node, the deepest whose size still holds its bounds (chosen from the
+    // bounds' size) among those containing its center. Nodes are loose: their bounds are twice their
+    // size, so an instance never straddles children and moving it only relinks it when it leaves the
+    // node's cell or changes size enough to belong to another depth, at a cost of MAX_DEPTH steps at most.
+    // Nodes are created on the way down and recycled once their subtree is empty.
+    // Instances whose center is outside the world cube stay in the root, which every query tests.
+    class SceneIndex {
+
+    public:
+        static const int MAX_DEPTH = 5;  // cells down to 1/32 of the world, smaller ones cost more to visit than they save
+
+        SceneIndex();
+
+        // The cube of worldHalfSize around worldCenter is subdivided, clears the index
+        void Create(const glm::vec3& worldCenter, float worldHalfSize);
+        void clear();
+
+        // Returns the instance handle, userData comes back from getUserData
+        int insert(const glm::vec3& boundsMin, const glm::vec3& boundsMax, int userData);
+        void move(int instance, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+        void remove(int instance);
+
+        int getUserData(int instance);
+        void getBounds(int instance, glm::vec3& boundsMin, glm::vec3& boundsMax);
+        size_t getInstanceCount();
+        size_t getNodeCount();
+
+        // Append the instances whose bounds are at least partly inside
+        void queryFrustum(const glm::mat4& viewProjection, std::vector<int>& result);
+        void querySphere(const glm::vec3& center, float radius, std::vector<int>& result);
+        // Bounds the ray crosses between 0 and maxDistance (in lengths of direction)
+        void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<int>& result);
+
+    private:
+        enum Containment { OUTSIDE, INTERSECTS, INSIDE };
+
+        // What a query is tested against, one of the three
+        struct Shape {
+
+            enum Kind { FRUSTUM, SPHERE, RAY } kind;
+            glm::vec4 planes[6];
+            glm::vec3 center;
+            float radius;
+            glm::vec3 origin;
+            glm::vec3 inverseDirection;
+            float maxDistance;
+        };
+
+        struct Node {
+
+            glm::vec3 center;
+            float halfSize;    // of the cell, the loose bounds are twice as large
+            int depth;
+            int parent;
+            int children[8];   // -1 where there is none
+            int subtreeCount;  // instances here and below
+            std::vector<int> instances;
+        };
+
+        struct Instance {
+
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+            int userData;
+            int node;  // -1 when the handle is free
+            int slot;  // in the node's instances
+        };
+
+        struct StackEntry {
+
+            int node;
+            int planeMask;  // frustum planes the parent was not already inside of
+        };
+
+        glm::vec3 worldCenter;
+        float worldHalfSize;
+        std::vector<Node> nodes;  // the root is nodes[0]
+        std::vector<int> freeNodes;
+        std::vector<Instance> instances;
+        std::vector<int> freeInstances;
+        std::vector<StackEntry> stack;
+
+        int allocateNode(int parent, int octant);
+        int targetDepth(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+        bool inCell(int node, const glm::vec3& point);
+        void link(int instance);
+        void unlink(int instance);
+
+        // planeMask: the frustum planes to test, those the box is inside of are cleared from it
+        Containment classify(const Shape& shape, const glm::vec3& boundsMin, const glm::vec3& boundsMax, int& planeMask);
+        void query(const Shape& shape, std::vector<int>& result);
+        void collectSubtree(int node, std::vector<int>& result);
+    };
+}
+
+#endif /* SceneIndex_hpp */
@@ -7,15 +7,78 @@
 //
 
 #include "Shader.hpp"
+#include "GLDispatch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace gps {
-    std::string Shader::readShaderFile(std::string fileName) {
+
+    bool Shader::binaryCacheEnabled = true;
+    std::string Shader::binaryCacheDirectory = "shaders/cache/";
+    int Shader::cacheHits = 0;
+    int Shader::cacheMisses = 0;
+    int Shader::failedLoads = 0;
+    int Shader::compiledInBackground = 0;
+    bool Shader::parallelCompileSupported = false;
+    double Shader::compileMilliseconds = 0.0;
+    double Shader::cacheLoadMilliseconds = 0.0;
+
+    //bumped whenever the cache file layout changes
+    static const unsigned int CACHE_MAGIC = 0x31425047; // "GPB1"
+
+    struct ProgramBinaryHeader {
+        unsigned int magic;
+        unsigned int format;
+        unsigned int length;
+    };
+
+    //64 bit FNV-1a, plenty to tell sources apart
+    static unsigned long long hashString(const std::string& text, unsigned long long hash) {
+
+        for (size_t i = 0; i < text.size(); i++) {
+            hash ^= (unsigned char)text[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    //nested includes past this depth are taken for a runaway chain
+    static const size_t MAX_INCLUDE_DEPTH = 16;
+
+    bool Shader::readShaderFile(std::string fileName, std::vector<std::string>& includeStack, std::string& source) {
+
+        //a file that includes itself, directly or through others, would never finish
+        if (std::find(includeStack.begin(), includeStack.end(), fileName) != includeStack.end()) {
+            std::cout << "Shader error: " << fileName << " includes itself (from " << includeStack.back() << ")" << std::endl;
+            return false;
+        }
+        if (includeStack.size() >= MAX_INCLUDE_DEPTH) {
+            std::cout << "Shader error: includes nested deeper than " << MAX_INCLUDE_DEPTH << " at " << fileName << std::endl;
+            return false;
+        }
 
         std::ifstream shaderFile;
-        std::string shaderString;
         
         //open shader file
         shaderFile.open(fileName);
+        if (!shaderFile.is_open()) {
+            std::cout << "Shader error: could not open " << fileName;
+            if (!includeStack.empty()) {
+                std::cout << " (included from " << includeStack.back() << ")";
+            }
+            std::cout << std::endl;
+            return false;
+        }
         
         std::stringstream shaderStringStream;
         
@@ -24,13 +87,75 @@ namespace gps {
         
         //close shader file
         shaderFile.close();
-        
-        //convert stream into GLchar array
-        shaderString = shaderStringStream.str();
-        return shaderString;
+
+        //paste in the #include "file" lines, relative to this file
+        includeStack.push_back(fileName);
+        bool expanded = expandIncludes(shaderStringStream.str(), fileName.substr(0, fileName.find_last_of('/') + 1), includeStack, source);
+        includeStack.pop_back();
+        return expanded;
+    }
+
+    bool Shader::expandIncludes(std::string source, std::string directory, std::vector<std::string>& includeStack, std::string& expanded) {
+
+        std::istringstream sourceStream(source);
+        std::stringstream expandedStream;
+        std::string line;
+
+        while (std::getline(sourceStream, line)) {
+
+            size_t start = line.find("#include \"");
+
+            if (start != std::string::npos && line.find_first_not_of(" \t") == start) {
+
+                size_t nameStart = start + 10;
+                size_t nameEnd = line.find('"', nameStart);
+                if (nameEnd == std::string::npos) {
+                    std::cout << "Shader error: unterminated #include in " << includeStack.back() << std::endl;
+                    return false;
+                }
+
+                std::string included;
+                if (!readShaderFile(directory + line.substr(nameStart, nameEnd - nameStart), includeStack, included)) {
+                    return false;
+                }
+                expandedStream << included << "\n";
+            }
+            else {
+
+                expandedStream << line << "\n";
+            }
+        }
+
+        expanded = expandedStream.str();
+        return true;
     }
     
-    void Shader::shaderCompileLog(GLuint shaderId) {
+    std::string Shader::injectDefines(std::string source, std::vector<std::string> defines) {
+
+        if (defines.empty()) {
+            return source;
+        }
+
+        std::string defineLines;
+        for (size_t i = 0; i < defines.size(); i++) {
+            defineLines += "#define " + defines[i] + "\n";
+        }
+
+        //#version has to stay the first line
+        size_t versionLine = source.find("#version");
+        if (versionLine == std::string::npos) {
+            return defineLines + source;
+        }
+
+        size_t insertAt = source.find('\n', versionLine);
+        if (insertAt == std::string::npos) {
+            return source + "\n" + defineLines;
+        }
+
+        return source.insert(insertAt + 1, defineLines);
+    }
+
+    bool Shader::shaderCompileLog(GLuint shaderId) {
 
         GLint success;
         GLchar infoLog[512];
@@ -43,9 +168,10 @@ namespace gps {
             glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
             std::cout << "Shader compilation error\n" << infoLog << std::endl;
         }
+        return success == GL_TRUE;
     }
     
-    void Shader::shaderLinkLog(GLuint shaderProgramId) {
+    bool Shader::shaderLinkLog(GLuint shaderProgramId) {
 
         GLint success;
         GLchar infoLog[512];
@@ -56,41 +182,252 @@ namespace gps {
             glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
             std::cout << "Shader linking error\n" << infoLog << std::endl;
         }
+        return success == GL_TRUE;
     }
     
     void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
 
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
-        const GLchar* vertexShaderString = v.c_str();
+        loadShader(vertexShaderFileName, fragmentShaderFileName, std::vector<std::string>());
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, std::vector<std::string> defines) {
+
+        beginLoadShader(vertexShaderFileName, fragmentShaderFileName, defines);
+        finishLoad();
+    }
+
+    void Shader::beginLoadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, std::vector<std::string> defines) {
+
+        this->pending = false;
+        this->pendingCacheFile.clear();
+
+        //read and parse both shaders, the final text is also the cache key
+        std::vector<std::string> includeStack;
+        std::string v;
+        std::string f;
+        if (!readShaderFile(vertexShaderFileName, includeStack, v) || !readShaderFile(fragmentShaderFileName, includeStack, f)) {
+
+            //nothing worth compiling, the program stays 0 and draws nothing
+            std::cout << "Shader error: could not load " << vertexShaderFileName << " + " << fragmentShaderFileName << std::endl;
+            this->shaderProgram = 0;
+            failedLoads++;
+            return;
+        }
+        v = injectDefines(v, defines);
+        f = injectDefines(f, defines);
+
+        if (binaryCacheEnabled) {
+
+            this->pendingCacheFile = cacheFileName(v, f);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if (loadProgramBinary(this->pendingCacheFile)) {
+
+                cacheHits++;
+                cacheLoadMilliseconds += elapsedMilliseconds(start);
+                return;
+            }
+        }
+
+        cacheMisses++;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        startCompile(v, f);
+        compileMilliseconds += elapsedMilliseconds(start);
+    }
+
+    bool Shader::isReady() {
+
+        if (!this->pending) {
+            return true;
+        }
+
+        if (!parallelCompileSupported) {
+            //without the extension any status query blocks until the driver is done
+            return false;
+        }
+
+        GLint completed = GL_FALSE;
+        glGetProgramiv(this->shaderProgram, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+
+    void Shader::finishLoad() {
+
+        if (!this->pending) {
+            return;
+        }
+
+        if (isReady()) {
+            compiledInBackground++;
+        }
+
+        //these queries wait for the driver if it is still compiling
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        shaderCompileLog(this->pendingVertexShader);
+        shaderCompileLog(this->pendingFragmentShader);
+        bool linked = shaderLinkLog(this->shaderProgram);
+
+        glDetachShader(this->shaderProgram, this->pendingVertexShader);
+        glDetachShader(this->shaderProgram, this->pendingFragmentShader);
+        glDeleteShader(this->pendingVertexShader);
+        glDeleteShader(this->pendingFragmentShader);
+        compileMilliseconds += elapsedMilliseconds(start);
+
+        this->pending = false;
+
+        if (!linked) {
+            failedLoads++;
+        }
+        else if (binaryCacheEnabled) {
+            saveProgramBinary(this->pendingCacheFile);
+        }
+    }
+
+    void Shader::startCompile(std::string vertexSource, std::string fragmentSource) {
+
+        //compile the vertex shader, the status is checked in finishLoad
+        const GLchar* vertexShaderString = vertexSource.c_str();
         GLuint vertexShader;
         vertexShader = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
         glCompileShader(vertexShader);
-        //check compilation status
-        shaderCompileLog(vertexShader);
-        
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
-        const GLchar* fragmentShaderString = f.c_str();
+
+        //compile the fragment shader
+        const GLchar* fragmentShaderString = fragmentSource.c_str();
         GLuint fragmentShader;
         fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
         glCompileShader(fragmentShader);
-        //check compilation status
-        shaderCompileLog(fragmentShader);
-        
-        //attach and link the shader programs
+
+        //attach and link the shader programs without waiting for the compile
         this->shaderProgram = glCreateProgram();
+        if (binaryCacheEnabled) {
+            glProgramParameteri(this->shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glAttachShader(this->shaderProgram, vertexShader);
         glAttachShader(this->shaderProgram, fragmentShader);
         glLinkProgram(this->shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        //check linking info
-        shaderLinkLog(this->shaderProgram);
+
+        this->pendingVertexShader = vertexShader;
+        this->pendingFragmentShader = fragmentShader;
+        this->pending = true;
     }
-    
+
+    void Shader::enableParallelCompile() {
+
+#if not defined (__APPLE__)
+        //let the driver use as many compiler threads as it wants
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallelCompileSupported = true;
+        }
+        else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            parallelCompileSupported = true;
+        }
+#endif
+        std::cout << "Parallel shader compile: " << (parallelCompileSupported ? "yes" : "no") << std::endl;
+    }
+
+    void Shader::finishBatch(std::vector<Shader*> shaders) {
+
+        for (size_t i = 0; i < shaders.size(); i++) {
+            shaders[i]->finishLoad();
+        }
+    }
+
+    std::string Shader::cacheFileName(std::string vertexSource, std::string fragmentSource) {
+
+        //a driver update changes these strings and invalidates every entry
+        std::string driver;
+        const GLubyte* strings[3] = { glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION) };
+        for (int i = 0; i < 3; i++) {
+            if (strings[i]) {
+                driver += (const char*)strings[i];
+            }
+            driver += '\n';
+        }
+
+        unsigned long long hash = 14695981039346656037ull;
+        hash = hashString(driver, hash);
+        hash = hashString(vertexSource, hash);
+        hash = hashString(std::string(1, '\0'), hash);
+        hash = hashString(fragmentSource, hash);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", hash);
+        return binaryCacheDirectory + name;
+    }
+
+    bool Shader::loadProgramBinary(std::string cacheFileName) {
+
+        std::ifstream cacheFile(cacheFileName, std::ios::binary);
+        if (!cacheFile) {
+            return false;
+        }
+
+        ProgramBinaryHeader header;
+        cacheFile.read((char*)&header, sizeof(header));
+        if (!cacheFile || header.magic != CACHE_MAGIC || header.length == 0) {
+            return false;
+        }
+
+        std::vector<char> binary(header.length);
+        cacheFile.read(&binary[0], header.length);
+        if (!cacheFile) {
+            return false;
+        }
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.format, &binary[0], (GLsizei)header.length);
+
+        //the driver may reject binaries from another build of itself, compile from source then
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+
+            std::cout << "Shader cache: driver rejected " << cacheFileName << ", recompiling" << std::endl;
+            glDeleteProgram(program);
+            return false;
+        }
+
+        this->shaderProgram = program;
+        return true;
+    }
+
+    void Shader::saveProgramBinary(std::string cacheFileName) {
+
+        GLint length = 0;
+        glGetProgramiv(this->shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            //no binary formats on this driver, nothing to cache
+            return;
+        }
+
+        std::vector<char> binary(length);
+        ProgramBinaryHeader header;
+        GLenum format = 0;
+        glGetProgramBinary(this->shaderProgram, length, NULL, &format, &binary[0]);
+
+        header.magic = CACHE_MAGIC;
+        header.format = format;
+        header.length = (unsigned int)length;
+
+        std::ofstream cacheFile(cacheFileName, std::ios::binary);
+        if (!cacheFile) {
+            std::cout << "Shader cache: could not write " << cacheFileName << std::endl;
+            return;
+        }
+        cacheFile.write((const char*)&header, sizeof(header));
+        cacheFile.write(&binary[0], length);
+    }
+
+    void Shader::printCacheStats() {
+
+        fprintf(stdout, "Shader cache: %d hits (%.1f ms), %d compiled from source (%.1f ms blocking, %d done in the background), %d failed\n",
+            cacheHits, cacheLoadMilliseconds, cacheMisses, compileMilliseconds, compiledInBackground, failedLoads);
+    }
+
     void Shader::useShaderProgram() {
 
         glUseProgram(this->shaderProgram);
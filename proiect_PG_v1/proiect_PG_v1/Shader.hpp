@@ -20,6 +20,8 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 
 namespace gps {
@@ -29,12 +31,52 @@ namespace gps {
     public:
         GLuint shaderProgram;
         void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+        //same, with a "#define NAME" line added after #version for every entry of defines
+        void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, std::vector<std::string> defines);
         void useShaderProgram();
+
+        //batch loading: beginLoadShader only submits the compile and link, so several programs
+        //compile in parallel (GL_KHR_parallel_shader_compile) while the caller does other work;
+        //finishLoad checks the logs, it is called before first use and is a no-op when done
+        void beginLoadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, std::vector<std::string> defines);
+        bool isReady();
+        void finishLoad();
+        static void enableParallelCompile();
+        static void finishBatch(std::vector<Shader*> shaders);
+        static bool parallelCompileSupported;
+
+        //program binary cache: linked programs are saved with glGetProgramBinary, keyed by a hash of
+        //the final sources (includes and defines expanded) and the driver's vendor/renderer/version,
+        //and reloaded with glProgramBinary on the next launch
+        static bool binaryCacheEnabled;
+        static std::string binaryCacheDirectory;
+        static int cacheHits;
+        static int cacheMisses;
+        //loads that could not read a file (missing, an include cycle, includes nested too deep),
+        //compile or link; such a program is left unusable, see the log for which one
+        static int failedLoads;
+        static int compiledInBackground;
+        static double compileMilliseconds;
+        static double cacheLoadMilliseconds;
+        static void printCacheStats();
     
     private:
-        std::string readShaderFile(std::string fileName);
-        void shaderCompileLog(GLuint shaderId);
-        void shaderLinkLog(GLuint shaderProgramId);
+        bool pending = false;
+        GLuint pendingVertexShader = 0;
+        GLuint pendingFragmentShader = 0;
+        std::string pendingCacheFile;
+
+        //false (with the reason printed) when a file or one of its includes cannot be read;
+        //includeStack holds the files being expanded, to catch cycles
+        bool readShaderFile(std::string fileName, std::vector<std::string>& includeStack, std::string& source);
+        bool expandIncludes(std::string source, std::string directory, std::vector<std::string>& includeStack, std::string& expanded);
+        std::string injectDefines(std::string source, std::vector<std::string> defines);
+        bool shaderCompileLog(GLuint shaderId);
+        bool shaderLinkLog(GLuint shaderProgramId);
+        void startCompile(std::string vertexSource, std::string fragmentSource);
+        bool loadProgramBinary(std::string cacheFileName);
+        void saveProgramBinary(std::string cacheFileName);
+        std::string cacheFileName(std::string vertexSource, std::string fragmentSource);
     };
     
 }
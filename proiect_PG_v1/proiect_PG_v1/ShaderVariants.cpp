@@ -0,0 +1,73 @@
+#include "ShaderVariants.hpp"
+
+namespace gps {
+
+    static const char* featureNames[FEATURE_COUNT] = { "FLAT", "ALPHA_TEST", "SPOT_LIGHT", "SHADOWS", "FOG" };
+
+    void ShaderVariants::init(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+
+        this->vertexShaderFileName = vertexShaderFileName;
+        this->fragmentShaderFileName = fragmentShaderFileName;
+    }
+
+    gps::Shader ShaderVariants::getVariant(unsigned int features) {
+
+        std::map<unsigned int, gps::Shader>::iterator variant = variants.find(features);
+
+        if (variant == variants.end()) {
+
+            precompile(features);
+            variant = variants.find(features);
+        }
+
+        //no-op unless the variant is still compiling in the background
+        variant->second.finishLoad();
+        return variant->second;
+    }
+
+    void ShaderVariants::precompile(unsigned int features) {
+
+        if (variants.count(features) > 0) {
+            return;
+        }
+
+        std::vector<std::string> defines = getDefines(features);
+
+        std::cout << "Loading " << fragmentShaderFileName << " variant [";
+        for (size_t i = 0; i < defines.size(); i++) {
+            std::cout << (i > 0 ? " " : "") << defines[i];
+        }
+        std::cout << "]" << std::endl;
+
+        gps::Shader shader;
+        shader.beginLoadShader(vertexShaderFileName, fragmentShaderFileName, defines);
+        variants[features] = shader;
+    }
+
+    void ShaderVariants::finishAll() {
+
+        std::map<unsigned int, gps::Shader>::iterator variant;
+        for (variant = variants.begin(); variant != variants.end(); variant++) {
+            variant->second.finishLoad();
+        }
+    }
+
+    size_t ShaderVariants::getVariantCount() {
+
+        return variants.size();
+    }
+
+    std::vector<std::string> ShaderVariants::getDefines(unsigned int features) {
+
+        std::vector<std::string> defines;
+
+        for (int i = 0; i < FEATURE_COUNT; i++) {
+
+            if (features & (1u << i)) {
+                defines.push_back(featureNames[i]);
+            }
+        }
+
+        return defines;
+    }
+}
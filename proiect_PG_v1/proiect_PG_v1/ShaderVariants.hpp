@@ -0,0 +1,52 @@
+#ifndef ShaderVariants_hpp
+#define ShaderVariants_hpp
+
+#include "Shader.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Compile time shader features, each one becomes a #define in the variant that uses it
+    enum ShaderFeature {
+        FEATURE_FLAT        = 1 << 0, // flat normals from screen space derivatives
+        FEATURE_ALPHA_TEST  = 1 << 1, // discard fragments with diffuse alpha < 0.1
+        FEATURE_SPOT_LIGHT  = 1 << 2, // camera flashlight
+        FEATURE_SHADOWS     = 1 << 3, // directional light shadow map with PCF
+        FEATURE_FOG         = 1 << 4, // exponential squared fog
+        FEATURE_COUNT       = 5
+    };
+
+    // One vertex/fragment shader pair compiled once per feature combination (permutation).
+    // Variants are cached by their feature mask and chosen at draw time, so a variant only
+    // contains the code paths it actually needs instead of branching on uniforms.
+    class ShaderVariants {
+
+    public:
+        void init(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+
+        // Returns the program for this feature mask, compiling it on first use
+        gps::Shader getVariant(unsigned int features);
+
+        // Starts compiling a variant ahead of time so the first frame using it does not hitch,
+        // the driver may finish it in the background until getVariant or finishAll
+        void precompile(unsigned int features);
+
+        // Waits for every precompiled variant and checks its logs
+        void finishAll();
+
+        size_t getVariantCount();
+
+        // "FLAT", "ALPHA_TEST", ... for the bits set in features
+        static std::vector<std::string> getDefines(unsigned int features);
+
+    private:
+        std::string vertexShaderFileName;
+        std::string fragmentShaderFileName;
+        std::map<unsigned int, gps::Shader> variants;
+    };
+}
+
+#endif /* ShaderVariants_hpp */
@@ -7,6 +7,7 @@
 //
 
 #include "SkyBox.hpp"
+#include "GLDispatch.hpp"
 
 namespace gps {
     
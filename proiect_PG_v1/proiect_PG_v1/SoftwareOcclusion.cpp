@@ -0,0 +1,489 @@
+#include "SoftwareOcclusion.hpp"
+#include "CpuProfiler.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define GPS_SOFTWARE_OCCLUSION_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define GPS_SOFTWARE_OCCLUSION_SSE2 0
+#endif
+
+namespace gps {
+
+    // std::min takes them by reference, so they need a definition
+    const int SoftwareOcclusion::TILE_WIDTH;
+    const int SoftwareOcclusion::TILE_HEIGHT;
+    const int SoftwareOcclusion::CHUNK_TRIANGLES;
+
+    // in pixels: centers on an edge shared by two triangles belong to both, whatever the rounding
+    static const double EDGE_EPSILON = 1.0 / 64.0;
+
+    SoftwareOcclusion::SoftwareOcclusion() : width(0), height(0), tilesX(0), tilesY(0), rasterMilliseconds(0.0),
+        testMilliseconds(0.0), rasterizedTriangles(0), jobs(nullptr) {
+    }
+
+    SoftwareOcclusion::~SoftwareOcclusion() {
+
+        Delete();
+    }
+
+    void SoftwareOcclusion::Create(int width, int height, gps::JobSystem* jobs) {
+
+        Delete();
+
+        this->width = std::max(width, 1);
+        this->height = std::max(height, 1);
+        tilesX = (this->width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tilesY = (this->height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        depth.assign((size_t)tilesX * tilesY * TILE_WIDTH * TILE_HEIGHT, 1.0f);
+        tileMax.assign((size_t)tilesX * tilesY, 1.0f);
+        this->jobs = jobs;
+    }
+
+    void SoftwareOcclusion::Delete() {
+
+        depth.clear();
+        tileMax.clear();
+        bins.clear();
+        width = 0;
+        height = 0;
+        tilesX = 0;
+        tilesY = 0;
+        jobs = nullptr;
+    }
+
+    void SoftwareOcclusion::runParallel(int itemCount, const std::function<void(int)>& work) {
+
+        if (!jobs) {
+            for (int i = 0; i < itemCount; i++) {
+                work(i);
+            }
+            return;
+        }
+
+        // tiles differ in cost, small ranges let the idle threads steal the rest
+        jobs->parallelFor("SoftwareOcclusion", (size_t)itemCount, 1, [&work](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                work((int)i);
+            }
+        });
+    }
+
+    int SoftwareOcclusion::addOccluder(const std::vector<gps::Vertex>& vertices, const std::vector<GLuint>& indices,
+        const glm::mat4& model, float minArea) {
+
+        int added = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+
+            glm::vec3 a = glm::vec3(model * glm::vec4(vertices[indices[i]].Position, 1.0f));
+            glm::vec3 b = glm::vec3(model * glm::vec4(vertices[indices[i + 1]].Position, 1.0f));
+            glm::vec3 c = glm::vec3(model * glm::vec4(vertices[indices[i + 2]].Position, 1.0f));
+
+            // small triangles cost as much to set up and hide little
+            if (0.5f * glm::length(glm::cross(b - a, c - a)) < minArea) {
+                continue;
+            }
+
+            occluders.push_back(a);
+            occluders.push_back(b);
+            occluders.push_back(c);
+            added++;
+        }
+        return added;
+    }
+
+    void SoftwareOcclusion::clearOccluders() {
+
+        occluders.clear();
+        setup.clear();
+        bins.clear();
+    }
+
+    size_t SoftwareOcclusion::getOccluderTriangleCount() {
+
+        return occluders.size() / 3;
+    }
+
+    void SoftwareOcclusion::setupChunk(int chunk) {
+
+        std::vector<std::vector<int> >& chunkBins = bins[chunk];
+        for (size_t t = 0; t < chunkBins.size(); t++) {
+            chunkBins[t].clear();
+        }
+
+        int firstTriangle = chunk * CHUNK_TRIANGLES;
+        int lastTriangle = std::min(firstTriangle + CHUNK_TRIANGLES, (int)(occluders.size() / 3));
+
+        for (int i = firstTriangle; i < lastTriangle; i++) {
+
+            glm::vec4 clip[3];
+            bool clipped = false;
+            int outside[5] = { 0, 0, 0, 0, 0 };
+            for (int v = 0; v < 3; v++) {
+
+                clip[v] = viewProjection * glm::vec4(occluders[3 * i + v], 1.0f);
+
+                // the GPU does not draw what is in front of the near plane, nothing behind it may be culled
+                if (clip[v].w <= 0.0f || clip[v].z < -clip[v].w) {
+                    clipped = true;
+                }
+                outside[0] += clip[v].x < -clip[v].w;
+                outside[1] += clip[v].x > clip[v].w;
+                outside[2] += clip[v].y < -clip[v].w;
+                outside[3] += clip[v].y > clip[v].w;
+                outside[4] += clip[v].z > clip[v].w;
+            }
+            if (clipped || outside[0] == 3 || outside[1] == 3 || outside[2] == 3 || outside[3] == 3 || outside[4] == 3) {
+                continue;
+            }
+
+            // screen space in double: vertices close to the camera project far outside the buffer
+            double x[3];
+            double y[3];
+            double z[3];
+            for (int v = 0; v < 3; v++) {
+                x[v] = (clip[v].x / clip[v].w * 0.5 + 0.5) * width;
+                y[v] = (clip[v].y / clip[v].w * 0.5 + 0.5) * height;
+                z[v] = std::min(clip[v].z / clip[v].w * 0.5 + 0.5, 1.0);
+            }
+
+            double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (area < 0.0) {
+                std::swap(x[1], x[2]);
+                std::swap(y[1], y[2]);
+                std::swap(z[1], z[2]);
+                area = -area;
+            }
+
+            if (area <= 0.0) {
+                continue;
+            }
+
+            // pixels with their center inside the bounds
+            int minX = (int)std::ceil(std::max(std::min(std::min(x[0], x[1]), x[2]), 0.0) - 0.5);
+            int minY = (int)std::ceil(std::max(std::min(std::min(y[0], y[1]), y[2]), 0.0) - 0.5);
+            int maxX = (int)std::floor(std::min(std::max(std::max(x[0], x[1]), x[2]), (double)width) - 0.5);
+            int maxY = (int)std::floor(std::min(std::max(std::max(y[0], y[1]), y[2]), (double)height) - 0.5);
+            if (minX > maxX || minY > maxY) {
+                continue;
+            }
+
+            SetupTriangle& triangle = setup[i];
+            triangle.minX = minX;
+            triangle.minY = minY;
+            triangle.maxX = maxX;
+            triangle.maxY = maxY;
+
+            for (int e = 0; e < 3; e++) {
+
+                int v0 = e;
+                int v1 = (e + 1) % 3;
+                double a = y[v0] - y[v1];
+                double b = x[v1] - x[v0];
+                double c = x[v0] * y[v1] - y[v0] * x[v1];
+
+                // scaled to pixels so the float equation keeps its precision across the buffer
+                double scale = 1.0 / std::max(std::fabs(a), std::fabs(b));
+                a *= scale;
+                b *= scale;
+                c *= scale;
+
+                // at the pixel center, >= 0 on the inner side and on the edge
+                c += 0.5 * a + 0.5 * b + EDGE_EPSILON;
+
+                triangle.edgeA[e] = (float)a;
+                triangle.edgeB[e] = (float)b;
+                triangle.edgeC[e] = (float)c;
+            }
+
+            double depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+            double depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+            double depthC = z[0] - depthA * x[0] - depthB * y[0];
+
+            // the farthest depth over the pixel, never beyond the farthest vertex
+            triangle.depthA = (float)depthA;
+            triangle.depthB = (float)depthB;
+            triangle.depthC = (float)(depthC + 0.5 * depthA + 0.5 * depthB + 0.5 * (std::fabs(depthA) + std::fabs(depthB)));
+            triangle.depthMax = (float)std::max(std::max(z[0], z[1]), z[2]);
+
+            for (int ty = minY / TILE_HEIGHT; ty <= maxY / TILE_HEIGHT; ty++) {
+                for (int tx = minX / TILE_WIDTH; tx <= maxX / TILE_WIDTH; tx++) {
+                    chunkBins[ty * tilesX + tx].push_back(i);
+                }
+            }
+        }
+    }
+
+    void SoftwareOcclusion::rasterizeTile(int tile) {
+
+        int tileX = (tile % tilesX) * TILE_WIDTH;
+        int tileY = (tile / tilesX) * TILE_HEIGHT;
+        float* tileDepth = &depth[(size_t)tile * TILE_WIDTH * TILE_HEIGHT];
+        std::fill_n(tileDepth, TILE_WIDTH * TILE_HEIGHT, 1.0f);
+
+        int triangles = 0;
+        for (size_t chunk = 0; chunk < bins.size(); chunk++) {
+
+            const std::vector<int>& bin = bins[chunk][tile];
+            for (size_t i = 0; i < bin.size(); i++) {
+
+                const SetupTriangle& triangle = setup[bin[i]];
+
+                // tile relative
+                int x0 = std::max(triangle.minX - tileX, 0);
+                int y0 = std::max(triangle.minY - tileY, 0);
+                int x1 = std::min(triangle.maxX - tileX, TILE_WIDTH - 1);
+                int y1 = std::min(triangle.maxY - tileY, TILE_HEIGHT - 1);
+                triangles++;
+
+#if GPS_SOFTWARE_OCCLUSION_SSE2
+                // four pixels a step from a multiple of four, the edge tests drop the ones outside
+                x0 &= ~3;
+                __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)(tileX + x0)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+                __m128 zero = _mm_setzero_ps();
+                __m128 depthMax = _mm_set1_ps(triangle.depthMax);
+
+                __m128 edgeStep[3];
+                __m128 edgeRow[3];
+                for (int e = 0; e < 3; e++) {
+                    edgeStep[e] = _mm_set1_ps(4.0f * triangle.edgeA[e]);
+                    edgeRow[e] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[e]), pixelX), _mm_set1_ps(triangle.edgeC[e]));
+                }
+                __m128 depthStep = _mm_set1_ps(4.0f * triangle.depthA);
+                __m128 depthRow = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthA), pixelX), _mm_set1_ps(triangle.depthC));
+
+                for (int y = y0; y <= y1; y++) {
+
+                    float pixelY = (float)(tileY + y);
+                    __m128 edge0 = _mm_add_ps(edgeRow[0], _mm_set1_ps(triangle.edgeB[0] * pixelY));
+                    __m128 edge1 = _mm_add_ps(edgeRow[1], _mm_set1_ps(triangle.edgeB[1] * pixelY));
+                    __m128 edge2 = _mm_add_ps(edgeRow[2], _mm_set1_ps(triangle.edgeB[2] * pixelY));
+                    __m128 triangleDepth = _mm_add_ps(depthRow, _mm_set1_ps(triangle.depthB * pixelY));
+                    float* row = tileDepth + y * TILE_WIDTH;
+
+                    for (int x = x0; x <= x1; x += 4) {
+
+                        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)),
+                            _mm_cmpge_ps(edge2, zero));
+                        __m128 old = _mm_loadu_ps(row + x);
+                        __m128 nearer = _mm_min_ps(old, _mm_min_ps(triangleDepth, depthMax));
+                        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+
+                        edge0 = _mm_add_ps(edge0, edgeStep[0]);
+                        edge1 = _mm_add_ps(edge1, edgeStep[1]);
+                        edge2 = _mm_add_ps(edge2, edgeStep[2]);
+                        triangleDepth = _mm_add_ps(triangleDepth, depthStep);
+                    }
+                }
+#else
+                for (int y = y0; y <= y1; y++) {
+
+                    float pixelY = (float)(tileY + y);
+                    float* row = tileDepth + y * TILE_WIDTH;
+
+                    for (int x = x0; x <= x1; x++) {
+
+                        float pixelX = (float)(tileX + x);
+                        bool inside = true;
+                        for (int e = 0; e < 3; e++) {
+                            inside = inside && triangle.edgeA[e] * pixelX + triangle.edgeB[e] * pixelY + triangle.edgeC[e] >= 0.0f;
+                        }
+                        if (inside) {
+                            float triangleDepth = triangle.depthA * pixelX + triangle.depthB * pixelY + triangle.depthC;
+                            row[x] = std::min(row[x], std::min(triangleDepth, triangle.depthMax));
+                        }
+                    }
+                }
+#endif
+            }
+        }
+
+        // the part of the tile inside the buffer
+        int tileWidth = std::min(TILE_WIDTH, width - tileX);
+        int tileHeight = std::min(TILE_HEIGHT, height - tileY);
+        float farthest = 0.0f;
+        for (int y = 0; y < tileHeight; y++) {
+            for (int x = 0; x < tileWidth; x++) {
+                farthest = std::max(farthest, tileDepth[y * TILE_WIDTH + x]);
+            }
+        }
+        tileMax[tile] = farthest;
+
+        rasterizedTriangles += triangles;
+    }
+
+    void SoftwareOcclusion::render(const glm::mat4& viewProjection) {
+
+        GPS_CPU_SCOPE("SoftwareOcclusion::render");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        this->viewProjection = viewProjection;
+        testMilliseconds = 0.0;
+        rasterizedTriangles = 0;
+
+        int triangleCount = (int)(occluders.size() / 3);
+        int chunkCount = (triangleCount + CHUNK_TRIANGLES - 1) / CHUNK_TRIANGLES;
+        setup.resize(triangleCount);
+        bins.resize(chunkCount, std::vector<std::vector<int> >((size_t)tilesX * tilesY));
+
+        runParallel(chunkCount, [this](int chunk) { setupChunk(chunk); });
+        runParallel(tilesX * tilesY, [this](int tile) { rasterizeTile(tile); });
+
+        rasterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool SoftwareOcclusion::isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model) {
+
+        if (tileMax.empty()) {
+            return false;
+        }
+
+        glm::mat4 modelViewProjection = viewProjection * model;
+
+        float minX = FLT_MAX;
+        float minY = FLT_MAX;
+        float maxX = -FLT_MAX;
+        float maxY = -FLT_MAX;
+        float nearestDepth = FLT_MAX;
+        for (int i = 0; i < 8; i++) {
+
+            glm::vec4 clip = modelViewProjection * glm::vec4((i & 1) ? boundsMax.x : boundsMin.x,
+                (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+
+            // reaches the camera
+            if (clip.w <= 0.0f || clip.z < -clip.w) {
+                return false;
+            }
+
+            float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+            float y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+            nearestDepth = std::min(nearestDepth, clip.z / clip.w * 0.5f + 0.5f);
+        }
+
+        // out of view, frustum culling is not done here
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) {
+            return false;
+        }
+
+        // every pixel the box touches and one more around them: coverage is sampled at pixel centers,
+        // a box reaching less than half a pixel past an occluder edge would find none of its own
+        int x0 = std::max((int)std::floor(minX) - 1, 0);
+        int y0 = std::max((int)std::floor(minY) - 1, 0);
+        int x1 = std::min((int)std::floor(maxX) + 1, width - 1);
+        int y1 = std::min((int)std::floor(maxY) + 1, height - 1);
+
+        for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++) {
+            for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++) {
+
+                // the whole tile is nearer than the box
+                int tile = ty * tilesX + tx;
+                if (tileMax[tile] < nearestDepth) {
+                    continue;
+                }
+
+                const float* tileDepth = &depth[(size_t)tile * TILE_WIDTH * TILE_HEIGHT];
+                int tileX = tx * TILE_WIDTH;
+                int tileY = ty * TILE_HEIGHT;
+                int localX0 = std::max(x0 - tileX, 0);
+                int localY0 = std::max(y0 - tileY, 0);
+                int localX1 = std::min(x1 - tileX, TILE_WIDTH - 1);
+                int localY1 = std::min(y1 - tileY, TILE_HEIGHT - 1);
+
+#if GPS_SOFTWARE_OCCLUSION_SSE2
+                __m128 boxDepth = _mm_set1_ps(nearestDepth);
+                __m128 firstColumn = _mm_set1_ps((float)localX0);
+                __m128 lastColumn = _mm_set1_ps((float)localX1);
+                for (int y = localY0; y <= localY1; y++) {
+
+                    const float* row = tileDepth + y * TILE_WIDTH;
+                    for (int x = localX0 & ~3; x <= localX1; x += 4) {
+
+                        __m128 column = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+                        __m128 inBox = _mm_and_ps(_mm_cmpge_ps(column, firstColumn), _mm_cmple_ps(column, lastColumn));
+                        if (_mm_movemask_ps(_mm_and_ps(inBox, _mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)))) {
+                            return false;
+                        }
+                    }
+                }
+#else
+                for (int y = localY0; y <= localY1; y++) {
+                    for (int x = localX0; x <= localX1; x++) {
+                        if (tileDepth[y * TILE_WIDTH + x] >= nearestDepth) {
+                            return false;
+                        }
+                    }
+                }
+#endif
+            }
+        }
+        return true;
+    }
+
+    int SoftwareOcclusion::cullModel(gps::Model3D& model3D, const glm::mat4& model, std::vector<bool>& visible) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        visible.resize(model3D.getMeshCount(), true);
+        int occluded = 0;
+        for (size_t i = 0; i < visible.size(); i++) {
+
+            if (!visible[i]) {
+                continue;
+            }
+            const gps::Mesh& mesh = model3D.getMesh(i);
+            if (isOccluded(mesh.boundsMin, mesh.boundsMax, model)) {
+                visible[i] = false;
+                occluded++;
+            }
+        }
+
+        testMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return occluded;
+    }
+
+    double SoftwareOcclusion::getRasterMilliseconds() {
+
+        return rasterMilliseconds;
+    }
+
+    double SoftwareOcclusion::getTestMilliseconds() {
+
+        return testMilliseconds;
+    }
+
+    int SoftwareOcclusion::getRasterizedTriangles() {
+
+        return rasterizedTriangles;
+    }
+
+    int SoftwareOcclusion::getWidth() {
+
+        return width;
+    }
+
+    int SoftwareOcclusion::getHeight() {
+
+        return height;
+    }
+
+    int SoftwareOcclusion::getThreadCount() {
+
+        return jobs ? jobs->getThreadCount() : 1;
+    }
+
+    float SoftwareOcclusion::getDepth(int x, int y) {
+
+        int tile = (y / TILE_HEIGHT) * tilesX + x / TILE_WIDTH;
+        return depth[(size_t)tile * TILE_WIDTH * TILE_HEIGHT + (y % TILE_HEIGHT) * TILE_WIDTH + x % TILE_WIDTH];
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef SoftwareOcclusion_hpp
+#define SoftwareOcclusion_hpp
+
+#include "Model3D.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace gps {
+
+    class JobSystem;
+
+    // Occlusion culling on the CPU: a few large occluder triangles are drawn into a small depth buffer
+    // in the current view and mesh bounding boxes are tested against it before their draws are submitted.
+    // No GL and no frame of latency, so it also runs headless (see benchmarks/occlusionBench.cpp).
+    //
+    // The buffer is split into TILE_WIDTH x TILE_HEIGHT tiles. Triangle setup and binning run in parallel
+    // over chunks of occluder triangles, rasterization in parallel over tiles (one writer per tile), four
+    // pixels at a time with SSE2 where available. Coverage is sampled at pixel centers, so shared edges
+    // leave no cracks; a covered pixel takes the farthest depth of the triangle over it and boxes are
+    // tested one pixel wider than they are. Gaps between occluders narrower than a pixel count as closed.
+    class SoftwareOcclusion {
+
+    public:
+        static const int TILE_WIDTH = 32;
+        static const int TILE_HEIGHT = 16;
+        static const int CHUNK_TRIANGLES = 256;
+
+        SoftwareOcclusion();
+        ~SoftwareOcclusion();
+
+        // Setup and rasterization are split into jobs of the given system, which has to outlive the
+        // culler; without one everything runs on the calling thread
+        void Create(int width, int height, gps::JobSystem* jobs);
+        void Delete();
+
+        // Keeps the triangles of at least minArea (world units squared) in world space, returns how many
+        int addOccluder(const std::vector<gps::Vertex>& vertices, const std::vector<GLuint>& indices,
+            const glm::mat4& model, float minArea);
+        void clearOccluders();
+        size_t getOccluderTriangleCount();
+
+        // Draws the occluders through viewProjection into a cleared buffer
+        void render(const glm::mat4& viewProjection);
+
+        // True when every pixel of the box is behind an occluder. Boxes crossing the near plane are visible
+        bool isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model);
+
+        // Tests the meshes whose entry is true (visible gets one entry per mesh, new ones true),
+        // returns the number found occluded
+        int cullModel(gps::Model3D& model3D, const glm::mat4& model, std::vector<bool>& visible);
+
+        // Times of the last render and of the cullModel calls after it
+        double getRasterMilliseconds();
+        double getTestMilliseconds();
+        // Triangles drawn by the last render, once per tile they touch
+        int getRasterizedTriangles();
+
+        int getWidth();
+        int getHeight();
+        int getThreadCount();
+        // Nearest occluder depth of a pixel (1 where there is none), rows bottom to top
+        float getDepth(int x, int y);
+
+    private:
+        // Edge and depth planes in pixels, E = a * x + b * y + c at pixel centers (x + 0.5, y + 0.5)
+        struct SetupTriangle {
+
+            float edgeA[3];
+            float edgeB[3];
+            float edgeC[3];
+            float depthA;
+            float depthB;
+            float depthC;
+            float depthMax;
+            int minX;
+            int minY;
+            int maxX;
+            int maxY;
+        };
+
+        int width;
+        int height;
+        int tilesX;
+        int tilesY;
+        std::vector<float> depth;    // tile after tile, rows of TILE_WIDTH inside a tile
+        std::vector<float> tileMax;  // farthest depth of each tile
+
+        std::vector<glm::vec3> occluders; // three vertices per triangle
+        glm::mat4 viewProjection;
+        std::vector<SetupTriangle> setup;
+        std::vector<std::vector<std::vector<int> > > bins; // chunk, tile, setup index
+
+        double rasterMilliseconds;
+        double testMilliseconds;
+        std::atomic<int> rasterizedTriangles;
+
+        gps::JobSystem* jobs;
+
+        void runParallel(int itemCount, const std::function<void(int)>& work);
+
+        void setupChunk(int chunk);
+        void rasterizeTile(int tile);
+    };
+}
+
+#endif /* SoftwareOcclusion_hpp */
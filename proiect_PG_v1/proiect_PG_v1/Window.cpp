@@ -1,8 +1,9 @@
 #include "Window.h"
+#include "GLDispatch.hpp"
 
 namespace gps {
 
-    void Window::Create(int width, int height, const char *title) {
+    void Window::Create(int width, int height, const char *title, bool visible, bool vsync, bool debug) {
         if (!glfwInit()) {
             throw std::runtime_error("Could not start GLFW3!");
         }
@@ -22,6 +23,10 @@ namespace gps {
         //for antialising
         glfwWindowHint(GLFW_SAMPLES, 4);
 
+        glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug ? GLFW_TRUE : GLFW_FALSE);
+
         this->window = glfwCreateWindow(width, height, title, NULL, NULL);
         if (!this->window) {
             throw std::runtime_error("Could not create GLFW3 window!");
@@ -29,13 +34,15 @@ namespace gps {
 
         glfwMakeContextCurrent(window);
 
-        glfwSwapInterval(1);
+        glfwSwapInterval(vsync ? 1 : 0);
 
 #if not defined (__APPLE__)
         // start GLEW extension handler
         glewExperimental = GL_TRUE;
         glewInit();
 #endif
+        // every gl* call goes through the dispatch table from here on
+        GLDispatch::loadDriver();
 
         // get version info
         const GLubyte* renderer = glGetString(GL_RENDERER); // get renderer string
@@ -24,7 +24,9 @@ namespace gps {
     class Window {
 
     public:
-        void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        // visible=false creates a hidden window, only its context is used (offscreen rendering)
+        // debug=true asks for a debug context, the driver reports more through GLDebug then
+        void Create(int width=800, int height=600, const char *title="OpenGL Project", bool visible=true, bool vsync=true, bool debug=false);
         void Delete();
 
         GLFWwindow* getWindow();
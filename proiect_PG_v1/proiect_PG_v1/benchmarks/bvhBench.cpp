@@ -0,0 +1,336 @@
+// bvhBench.cpp
+// Builds a SceneBVH over the castle at 1..N threads and reports the build time, then casts primary
+// rays through a grid of pixels from a ring of cameras (closest hit) and shadow rays from the hit
+// points towards the sun (any hit), on all threads, in millions of rays per second.
+// A sample of the rays is checked against a scan over every triangle first; the benchmark fails
+// if a distance differs. Last, camera moves are swept through the castle with CameraCollider
+// (flying and walking) and timed per frame, after a few fixed wall and step scenes are checked.
+// No GL context is needed. Run from the project directory: bvhBench [maxThreads]
+
+#include "../SceneBVH.hpp"
+#include "../CameraCollider.hpp"
+#include "../Model3D.hpp"
+#include "../JobSystem.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static const int IMAGE_WIDTH = 320;
+static const int IMAGE_HEIGHT = 180;
+static const float MAX_DISTANCE = 1000.0f;
+
+struct Ray {
+
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Moller-Trumbore without the tree, both faces count
+static bool bruteForceHit(const std::vector<glm::vec3>& triangles, const Ray& ray, float& closest) {
+
+    bool found = false;
+    closest = MAX_DISTANCE;
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+
+        glm::vec3 edge1 = triangles[i + 1] - triangles[i];
+        glm::vec3 edge2 = triangles[i + 2] - triangles[i];
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (std::fabs(determinant) < 1e-12f) {
+            continue;
+        }
+
+        glm::vec3 s = ray.origin - triangles[i];
+        float u = glm::dot(s, p) / determinant;
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(ray.direction, q) / determinant;
+        float distance = glm::dot(edge2, q) / determinant;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < closest) {
+            closest = distance;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool check(const char* name, bool condition) {
+
+    if (!condition) {
+        printf("check failed: %s\n", name);
+    }
+    return condition;
+}
+
+// Two triangles a b c, a c d
+static void addQuad(gps::SceneBVH& bvh, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d) {
+
+    std::vector<gps::Vertex> vertices(4);
+    vertices[0].Position = a;
+    vertices[1].Position = b;
+    vertices[2].Position = c;
+    vertices[3].Position = d;
+    GLuint quad[] = { 0, 1, 2, 0, 2, 3 };
+    bvh.addMesh(vertices, std::vector<GLuint>(quad, quad + 6), glm::mat4(1.0f), 0);
+}
+
+static bool near(float value, float expected) {
+
+    return std::fabs(value - expected) < 0.01f;
+}
+
+// A 10 x 10 wall at z = 0, then a floor at y = 0 with a step of 0.3 at z = 0 and a wall of 1 at z = -3
+static bool checkCollision() {
+
+    const float radius = 0.25f;
+    bool passed = true;
+
+    gps::SceneBVH wall;
+    addQuad(wall, glm::vec3(-5.0f, -5.0f, 0.0f), glm::vec3(5.0f, -5.0f, 0.0f), glm::vec3(5.0f, 5.0f, 0.0f), glm::vec3(-5.0f, 5.0f, 0.0f));
+    wall.build(nullptr);
+
+    gps::CameraCollider collider;
+    collider.setScene(&wall);
+    glm::vec3 end = collider.slide(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -3.0f), radius);
+    passed &= check("sphere stops at the wall", near(end.z, radius) && near(end.x, 0.0f) && near(end.y, 0.0f));
+    end = collider.slide(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(-2.0f, 0.0f, -3.0f), radius);
+    passed &= check("sphere slides along the wall", near(end.z, radius) && near(end.x, -2.0f));
+    end = collider.slide(glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 0.0f, 3.0f), radius);
+    passed &= check("back face stops the sphere", near(end.z, -radius));
+    end = collider.slide(glm::vec3(5.3f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -4.0f), radius);
+    passed &= check("sphere passes beside the wall", near(end.z, -2.0f));
+    end = collider.slide(glm::vec3(5.1f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -4.0f), radius);
+    passed &= check("sphere slides around the edge of the wall",
+        end.z < 0.0f && glm::length(glm::vec3(end.x - 5.0f, 0.0f, end.z)) >= radius);
+
+    gps::SceneBVH steps;
+    addQuad(steps, glm::vec3(-5.0f, 0.0f, 5.0f), glm::vec3(5.0f, 0.0f, 5.0f), glm::vec3(5.0f, 0.0f, 0.0f), glm::vec3(-5.0f, 0.0f, 0.0f));
+    addQuad(steps, glm::vec3(-5.0f, 0.0f, 0.0f), glm::vec3(5.0f, 0.0f, 0.0f), glm::vec3(5.0f, 0.3f, 0.0f), glm::vec3(-5.0f, 0.3f, 0.0f));
+    addQuad(steps, glm::vec3(-5.0f, 0.3f, 0.0f), glm::vec3(5.0f, 0.3f, 0.0f), glm::vec3(5.0f, 0.3f, -5.0f), glm::vec3(-5.0f, 0.3f, -5.0f));
+    addQuad(steps, glm::vec3(-5.0f, 0.3f, -3.0f), glm::vec3(5.0f, 0.3f, -3.0f), glm::vec3(5.0f, 1.3f, -3.0f), glm::vec3(-5.0f, 1.3f, -3.0f));
+    steps.build(nullptr);
+
+    collider.setScene(&steps);
+    collider.resetWalk();
+    glm::vec3 eye = glm::vec3(0.0f, 3.0f, 2.0f);
+    for (int frame = 0; frame < 120; frame++) {
+        eye = collider.walk(eye, glm::vec3(0.0f), radius, false, 1.0f / 60.0f);
+    }
+    passed &= check("walker lands on the floor", collider.isOnGround() && near(eye.y, gps::CameraCollider::EYE_HEIGHT));
+
+    for (int frame = 0; frame < 120; frame++) {
+        eye = collider.walk(eye, glm::vec3(0.0f, -0.02f, -0.05f), radius, false, 1.0f / 60.0f);
+    }
+    passed &= check("walker climbs the step and stops at the wall", collider.isOnGround()
+        && near(eye.y, gps::CameraCollider::EYE_HEIGHT + 0.3f) && near(eye.z, -3.0f + radius));
+
+    for (int frame = 0; frame < 120; frame++) {
+        eye = collider.walk(eye, glm::vec3(0.0f, 0.0f, 0.05f), radius, false, 1.0f / 60.0f);
+    }
+    passed &= check("walker goes back down the step", collider.isOnGround() && near(eye.y, gps::CameraCollider::EYE_HEIGHT));
+
+    return passed;
+}
+
+// Splits count items over threads, work(first, last) per thread
+template <typename Work>
+static void runThreads(int threads, size_t count, Work work) {
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.push_back(std::thread(work, count * t / threads, count * (t + 1) / threads));
+    }
+    work(0, count / threads);
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    const int buildIterations = 5;
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "objects/castle/castle.obj", "objects/castle/", true)) {
+        printf("cannot load objects/castle/castle.obj (run from the project directory)\n");
+        return 1;
+    }
+
+    // placed as in the viewer
+    glm::mat4 castleModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+
+    std::vector<std::vector<gps::Vertex> > shapeVertices(shapes.size());
+    std::vector<std::vector<GLuint> > shapeIndices(shapes.size());
+    std::vector<glm::vec3> worldTriangles;
+    for (size_t s = 0; s < shapes.size(); s++) {
+
+        gps::Model3D::AssembleShape(attrib, shapes[s], shapeVertices[s], shapeIndices[s]);
+        for (size_t i = 0; i < shapeIndices[s].size(); i++) {
+            worldTriangles.push_back(glm::vec3(castleModel * glm::vec4(shapeVertices[s][shapeIndices[s][i]].Position, 1.0f)));
+        }
+    }
+
+    printf("%zu shapes, %zu triangles\n", shapes.size(), worldTriangles.size() / 3);
+    printf("%8s %12s %8s %8s\n", "threads", "build (ms)", "nodes", "leaves");
+
+    gps::SceneBVH bvh;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+        gps::JobSystem jobs;
+        jobs.Create(threads);
+        double buildMilliseconds = 0.0;
+        for (int iteration = 0; iteration < buildIterations; iteration++) {
+
+            bvh.clear();
+            for (size_t s = 0; s < shapes.size(); s++) {
+                bvh.addMesh(shapeVertices[s], shapeIndices[s], castleModel, (int)s);
+            }
+            bvh.build(&jobs);
+            buildMilliseconds += bvh.getBuildMilliseconds();
+        }
+        printf("%8d %12.3f %8zu %8zu\n", threads, buildMilliseconds / buildIterations, bvh.getNodeCount(), bvh.getLeafCount());
+    }
+
+    // around the walls at eye height looking at the keep, then from the courtyard looking out
+    std::vector<Ray> rays;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)IMAGE_WIDTH / IMAGE_HEIGHT, 0.1f, MAX_DISTANCE);
+    for (int i = 0; i < 16; i++) {
+
+        float angle = glm::radians(360.0f * i / 16);
+        glm::vec3 direction = glm::vec3(std::sin(angle), 0.0f, std::cos(angle));
+        glm::vec3 eyes[2] = { direction * 45.0f + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 2.0f) };
+        glm::vec3 targets[2] = { glm::vec3(0.0f, 3.0f, -5.0f), glm::vec3(0.0f, 1.0f, 2.0f) + direction };
+
+        for (int v = 0; v < 2; v++) {
+
+            glm::mat4 inverseViewProjection = glm::inverse(projection * glm::lookAt(eyes[v], targets[v], glm::vec3(0.0f, 1.0f, 0.0f)));
+            for (int y = 0; y < IMAGE_HEIGHT; y++) {
+                for (int x = 0; x < IMAGE_WIDTH; x++) {
+
+                    glm::vec4 ndc = glm::vec4((x + 0.5f) / IMAGE_WIDTH * 2.0f - 1.0f, (y + 0.5f) / IMAGE_HEIGHT * 2.0f - 1.0f, 1.0f, 1.0f);
+                    glm::vec4 farPoint = inverseViewProjection * ndc;
+                    Ray ray;
+                    ray.origin = eyes[v];
+                    ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - eyes[v]);
+                    rays.push_back(ray);
+                }
+            }
+        }
+    }
+
+    int mismatches = 0;
+    for (size_t i = 0; i < rays.size(); i += 997) {
+
+        float expected;
+        bool expectedHit = bruteForceHit(worldTriangles, rays[i], expected);
+        gps::RayHit hit;
+        bool found = bvh.closestHit(rays[i].origin, rays[i].direction, MAX_DISTANCE, hit);
+        bool any = bvh.anyHit(rays[i].origin, rays[i].direction, MAX_DISTANCE);
+        if (found != expectedHit || any != expectedHit || (found && std::fabs(hit.distance - expected) > 1e-3f * std::max(1.0f, expected))) {
+            mismatches++;
+        }
+    }
+    if (mismatches > 0) {
+        printf("%d rays differ from the brute force scan\n", mismatches);
+        return 1;
+    }
+    printf("brute force check passed\n");
+
+    // shadow rays start a little off the surface towards the sun
+    glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+    std::vector<Ray> shadowRays(rays.size());
+    std::vector<char> primaryHits(rays.size());
+
+    printf("%zu primary rays\n", rays.size());
+    printf("%8s %16s %16s %8s %8s\n", "threads", "closest (Mray/s)", "any (Mray/s)", "hits", "shadowed");
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        runThreads(threads, rays.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+
+                gps::RayHit hit;
+                primaryHits[i] = bvh.closestHit(rays[i].origin, rays[i].direction, MAX_DISTANCE, hit);
+                float distance = primaryHits[i] ? hit.distance : 0.0f;
+                shadowRays[i].origin = rays[i].origin + rays[i].direction * distance + sunDirection * 1e-3f;
+                shadowRays[i].direction = sunDirection;
+            }
+        });
+        double closestSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<char> shadowed(rays.size());
+        start = std::chrono::steady_clock::now();
+        runThreads(threads, rays.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                shadowed[i] = primaryHits[i] && bvh.anyHit(shadowRays[i].origin, shadowRays[i].direction, MAX_DISTANCE);
+            }
+        });
+        double anySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t hits = std::count(primaryHits.begin(), primaryHits.end(), 1);
+        size_t shadowedCount = std::count(shadowed.begin(), shadowed.end(), 1);
+        printf("%8d %16.2f %16.2f %8zu %8zu\n", threads, rays.size() / closestSeconds * 1e-6,
+            hits / anySeconds * 1e-6, hits, shadowedCount);
+    }
+
+    // frames of camera movement: from the courtyard and around the walls in every direction
+    if (!checkCollision()) {
+        return 1;
+    }
+    printf("collision checks passed\n");
+
+    const float cameraRadius = 0.25f;
+    const float frameMove = 0.05f;
+    const int frames = 200;
+    gps::CameraCollider collider;
+    collider.setScene(&bvh);
+
+    const char* modes[2] = { "fly", "walk" };
+    printf("%8s %14s %14s %14s\n", "mode", "avg (ms)", "max (ms)", "triangles");
+    for (int mode = 0; mode < 2; mode++) {
+
+        double totalMilliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+        long long tested = 0;
+        int moves = 0;
+
+        for (int i = 0; i < 32; i++) {
+
+            float angle = glm::radians(360.0f * i / 32);
+            glm::vec3 direction = glm::vec3(std::sin(angle), 0.0f, std::cos(angle));
+            glm::vec3 starts[2] = { glm::vec3(0.0f, 0.0f, 2.0f), direction * 40.0f };
+            for (int s = 0; s < 2; s++) {
+
+                glm::vec3 eye = starts[s];
+                glm::vec3 heading = s == 0 ? direction : -direction;
+                collider.resetWalk();
+                for (int frame = 0; frame < frames; frame++) {
+
+                    glm::vec3 offset = heading * frameMove;
+                    eye = mode == 0 ? collider.slide(eye, offset, cameraRadius)
+                        : collider.walk(eye, offset, cameraRadius, false, 1.0f / 60.0f);
+
+                    totalMilliseconds += collider.getMilliseconds();
+                    maxMilliseconds = std::max(maxMilliseconds, collider.getMilliseconds());
+                    tested += collider.getTestedTriangles();
+                    moves++;
+                }
+            }
+        }
+
+        printf("%8s %14.5f %14.5f %14.1f\n", modes[mode], totalMilliseconds / moves, maxMilliseconds, (double)tested / moves);
+    }
+
+    return 0;
+}
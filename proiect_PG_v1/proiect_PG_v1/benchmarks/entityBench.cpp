@@ -0,0 +1,227 @@
+// entityBench.cpp
+// Times the EntityStore systems on many entities at 1..N threads: a share of the transforms is
+// animated every frame, then the scene graph update, the bounds, the lights and the draw list run
+// one after the other, each split into equal ranges of its component array over the threads.
+// After every frame the bounds (of the entities and of their meshes), lights and draw list are checked
+// against values computed here from the scene graph; the benchmark fails if any differs.
+// No GL context or assets are needed: entityBench [entities] [animated percent] [maxThreads]
+
+#include "../EntityStore.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const int FRAMES = 100;
+static const int NODES_PER_OBJECT = 20;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Splits count items over threads, work(first, last) per thread
+template <typename Work>
+static void runThreads(int threads, size_t count, Work work) {
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.push_back(std::thread(work, count * t / threads, count * (t + 1) / threads));
+    }
+    work(0, count / threads);
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+static glm::mat4 randomLocal(std::mt19937& random, float spread) {
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f) * spread);
+    return glm::rotate(local, unit(random) * 6.2831853f, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// Axes of the world box that differ from the transformed corners of the local box
+static int boxMismatches(const glm::mat4& world, const glm::vec3& localMin, const glm::vec3& localMax,
+    const glm::vec3& worldMin, const glm::vec3& worldMax) {
+
+    glm::vec3 expectedMin = glm::vec3(1e30f);
+    glm::vec3 expectedMax = glm::vec3(-1e30f);
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point = glm::vec3(corner & 1 ? localMax.x : localMin.x,
+            corner & 2 ? localMax.y : localMin.y, corner & 4 ? localMax.z : localMin.z);
+        glm::vec3 transformed = glm::vec3(world * glm::vec4(point, 1.0f));
+        expectedMin = glm::min(expectedMin, transformed);
+        expectedMax = glm::max(expectedMax, transformed);
+    }
+    int mismatches = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        mismatches += worldMin[axis] != expectedMin[axis] || worldMax[axis] != expectedMax[axis];
+    }
+    return mismatches;
+}
+
+static int countMismatches(gps::EntityStore& store, gps::SceneGraph& graph, const std::vector<gps::PointLight>& lights,
+    const std::vector<gps::DrawItem>& drawList) {
+
+    int mismatches = 0;
+    for (size_t i = 0; i < store.bounds.size(); i++) {
+
+        gps::Bounds& box = store.bounds[i];
+        const glm::mat4& world = store.getWorld(graph, store.bounds.getEntity(i));
+        mismatches += boxMismatches(world, box.localMin, box.localMax, box.worldMin, box.worldMax);
+        for (size_t m = 0; m < box.meshes.size(); m++) {
+            const gps::MeshBounds& mesh = box.meshes[m];
+            mismatches += boxMismatches(world, mesh.localMin, mesh.localMax, mesh.worldMin, mesh.worldMax);
+        }
+    }
+
+    for (size_t i = 0; i < store.lights.size(); i++) {
+        glm::vec3 position = glm::vec3(store.getWorld(graph, store.lights.getEntity(i))[3]);
+        for (int axis = 0; axis < 3; axis++) {
+            mismatches += lights[i].position[axis] != position[axis];
+        }
+    }
+
+    for (size_t i = 0; i < store.renderables.size(); i++) {
+        int entity = store.renderables.getEntity(i);
+        mismatches += drawList[i].entity != entity || drawList[i].world != &store.getWorld(graph, entity)
+            || drawList[i].visibleMeshes != &store.renderables[i].visibleMeshes;
+    }
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+
+    int entityCount = argc > 1 ? atoi(argv[1]) : 100000;
+    float animatedPercent = argc > 2 ? (float)atof(argv[2]) : 1.0f;
+    int maxThreads = argc > 3 ? atoi(argv[3]) : (int)std::max(2u, std::thread::hardware_concurrency());
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // objects of a root and parts under it; every entity has bounds, most are drawn, some are lights
+    gps::SceneGraph graph;
+    gps::EntityStore store;
+    graph.reserve(entityCount);
+    for (int e = 0; e < entityCount; e++) {
+
+        int entity = store.create();
+        int part = e % NODES_PER_OBJECT;
+        int parent = part == 0 ? -1 : e - 1 - (int)(random() % part);
+        gps::Transform transform = { graph.addNode(parent, randomLocal(random, part == 0 ? 500.0f : 2.0f)) };
+        store.transforms.add(entity, transform);
+
+        gps::Bounds box;
+        box.localMin = -glm::vec3(0.2f + unit(random));
+        box.localMax = glm::vec3(0.2f + unit(random));
+        box.dirty = true;
+        box.moved = false;
+        if (e % 10 != 9) {
+            // two meshes, the halves of the box along x
+            box.meshes.resize(2);
+            for (int m = 0; m < 2; m++) {
+                box.meshes[m].localMin = box.localMin;
+                box.meshes[m].localMax = box.localMax;
+            }
+            box.meshes[0].localMax.x = 0.0f;
+            box.meshes[1].localMin.x = 0.0f;
+        }
+        store.bounds.add(entity, box);
+
+        if (e % 10 != 9) {
+            gps::Renderable renderable;
+            renderable.model = nullptr;
+            renderable.name = "part";
+            renderable.staticGeometry = false;
+            store.renderables.add(entity, renderable);
+        }
+        if (e % 20 == 0) {
+            gps::Light light;
+            light.radius = 5.0f;
+            light.color = glm::vec3(1.0f);
+            store.lights.add(entity, light);
+        }
+    }
+
+    int animatedCount = std::min((int)(entityCount * animatedPercent / 100.0f), entityCount);
+    std::vector<gps::PointLight> lights(store.lights.size());
+    std::vector<gps::DrawItem> drawList(store.renderables.size());
+    std::vector<int> animatedNodes(animatedCount);
+    std::vector<glm::mat4> animatedLocals(animatedCount);
+
+    // the first update computes everything, the frames only what the animation changed
+    graph.update();
+    store.updateBounds(graph, 0, store.bounds.size());
+
+    printf("%d entities: %zu renderables, %zu lights, %d transforms animated per frame\n", entityCount,
+        store.renderables.size(), store.lights.size(), animatedCount);
+    printf("%8s %14s %12s %12s %14s %12s\n", "threads", "transforms", "bounds", "lights", "draw list", "changed");
+
+    int mismatches = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+        double transformMilliseconds = 0.0;
+        double boundsMilliseconds = 0.0;
+        double lightMilliseconds = 0.0;
+        double drawListMilliseconds = 0.0;
+        long long changed = 0;
+
+        for (int frame = 0; frame < FRAMES; frame++) {
+
+            for (int a = 0; a < animatedCount; a++) {
+                animatedNodes[a] = (int)(random() % entityCount);
+                animatedLocals[a] = randomLocal(random, 2.0f);
+            }
+            for (int a = 0; a < animatedCount; a++) {
+                graph.setLocal(animatedNodes[a], animatedLocals[a]);
+            }
+
+            // a sweep over parents before children, not split
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            graph.update();
+            transformMilliseconds += millisecondsSince(start);
+
+            std::atomic<int> frameChanged(0);
+            start = std::chrono::steady_clock::now();
+            runThreads(threads, store.bounds.size(), [&](size_t first, size_t last) {
+                frameChanged += store.updateBounds(graph, first, last);
+            });
+            boundsMilliseconds += millisecondsSince(start);
+            changed += frameChanged;
+
+            start = std::chrono::steady_clock::now();
+            runThreads(threads, store.lights.size(), [&](size_t first, size_t last) {
+                store.gatherLights(graph, first, last, lights.data());
+            });
+            lightMilliseconds += millisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            runThreads(threads, store.renderables.size(), [&](size_t first, size_t last) {
+                store.buildDrawList(graph, first, last, drawList.data());
+            });
+            drawListMilliseconds += millisecondsSince(start);
+
+            mismatches += countMismatches(store, graph, lights, drawList);
+        }
+
+        printf("%8d %14.4f %12.4f %12.4f %14.4f %12.0f\n", threads, transformMilliseconds / FRAMES, boundsMilliseconds / FRAMES,
+            lightMilliseconds / FRAMES, drawListMilliseconds / FRAMES, (double)changed / FRAMES);
+    }
+
+    if (mismatches > 0) {
+        printf("%d values differ from the scene graph\n", mismatches);
+        return 1;
+    }
+    printf("every bounds, light and draw item matches the scene graph\n");
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+// jobBench.cpp
+// Times the JobSystem at 1..N threads on four loads:
+//   parallel for  a long array transformed in ranges (parallelFor)
+//   small jobs    many short independent jobs queued from the calling thread
+//   fork join     a binary tree of jobs, each queues two children and waits for them (nested waits)
+//   stages        waves of jobs, each wave held back by a dependency on the counter of the one before
+// and reports milliseconds, the speedup over 1 thread and how many jobs were stolen.
+// Rows with more threads than the machine has are marked: they measure the cost of sharing cores, not scaling.
+// Every result is checked (the array against a serial pass, job and node counts, the order of the
+// stages); the benchmark fails if one is wrong.
+// No GL context is needed: jobBench [maxThreads] [trace.json]
+// With a trace file the jobs of the last run are written as a Chrome trace, one track per worker.
+
+#include "../JobSystem.hpp"
+#include "../CpuProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static const size_t ARRAY_SIZE = 1 << 22;
+static const size_t GRAIN_SIZE = 4096;
+static const int SMALL_JOBS = 50000;
+static const int SMALL_JOB_ITERATIONS = 200;
+static const int TREE_DEPTH = 14;
+static const int STAGES = 8;
+static const int JOBS_PER_STAGE = 256;
+static const int REPEATS = 3;  // the best of
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static float transform(float x) {
+
+    return std::sqrt(x) * std::sin(x * 0.001f) + std::cos(x * 0.002f);
+}
+
+// a few hundred nanoseconds of arithmetic
+static float smallWork(int seed) {
+
+    float value = (float)seed;
+    for (int i = 0; i < SMALL_JOB_ITERATIONS; i++) {
+        value = value * 0.999f + 1.0f;
+    }
+    return value;
+}
+
+static void treeNode(gps::JobSystem& jobs, int depth, std::atomic<int>& nodes) {
+
+    nodes++;
+    if (depth == 0) {
+        smallWork(depth);
+        return;
+    }
+    gps::JobCounter children;
+    jobs.run("tree node", [&jobs, depth, &nodes]() { treeNode(jobs, depth - 1, nodes); }, &children);
+    jobs.run("tree node", [&jobs, depth, &nodes]() { treeNode(jobs, depth - 1, nodes); }, &children);
+    jobs.wait(children);
+}
+
+int main(int argc, char* argv[]) {
+
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    const char* traceFile = argc > 2 ? argv[2] : nullptr;
+
+    std::vector<float> input(ARRAY_SIZE);
+    std::vector<float> expected(ARRAY_SIZE);
+    std::vector<float> output(ARRAY_SIZE);
+    for (size_t i = 0; i < ARRAY_SIZE; i++) {
+        input[i] = (float)(i % 100000);
+        expected[i] = transform(input[i]);
+    }
+
+    gps::CpuProfiler::setThreadName("main");
+
+    int hardwareThreads = (int)std::thread::hardware_concurrency();
+    printf("hardware threads: %d\n", hardwareThreads);
+    printf("%8s %-14s %10s %9s %10s\n", "threads", "load", "ms", "speedup", "stolen");
+    double baseline[4] = { 0.0, 0.0, 0.0, 0.0 };
+    int failures = 0;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+        gps::JobSystem jobs;
+        jobs.Create(threads);
+        if (traceFile && threads * 2 > maxThreads) {
+            gps::CpuProfiler::setEnabled(true);
+        }
+
+        double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+        uint64_t stolen[4] = { 0, 0, 0, 0 };
+
+        for (int repeat = 0; repeat < REPEATS; repeat++) {
+
+            // parallel for
+            uint64_t stolenBefore = jobs.getStolenCount();
+            std::fill(output.begin(), output.end(), 0.0f);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            jobs.parallelFor("transform range", ARRAY_SIZE, GRAIN_SIZE, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    output[i] = transform(input[i]);
+                }
+            });
+            best[0] = std::min(best[0], millisecondsSince(start));
+            stolen[0] = jobs.getStolenCount() - stolenBefore;
+            failures += output != expected;
+
+            // small jobs
+            stolenBefore = jobs.getStolenCount();
+            std::atomic<int> ran(0);
+            start = std::chrono::steady_clock::now();
+            gps::JobCounter smallJobs;
+            for (int j = 0; j < SMALL_JOBS; j++) {
+                jobs.run("small job", [&ran, j]() {
+                    if (smallWork(j) > 0.0f) {
+                        ran++;
+                    }
+                }, &smallJobs);
+            }
+            jobs.wait(smallJobs);
+            best[1] = std::min(best[1], millisecondsSince(start));
+            stolen[1] = jobs.getStolenCount() - stolenBefore;
+            failures += ran != SMALL_JOBS;
+
+            // fork join
+            stolenBefore = jobs.getStolenCount();
+            std::atomic<int> nodes(0);
+            start = std::chrono::steady_clock::now();
+            treeNode(jobs, TREE_DEPTH, nodes);
+            best[2] = std::min(best[2], millisecondsSince(start));
+            stolen[2] = jobs.getStolenCount() - stolenBefore;
+            failures += nodes != (1 << (TREE_DEPTH + 1)) - 1;
+
+            // stages: every job of a wave checks that the whole wave before it has finished
+            stolenBefore = jobs.getStolenCount();
+            std::vector<std::atomic<int> > finished(STAGES);
+            for (int s = 0; s < STAGES; s++) {
+                finished[s] = 0;
+            }
+            std::atomic<int> outOfOrder(0);
+            std::vector<gps::JobCounter> waves(STAGES);
+            start = std::chrono::steady_clock::now();
+            for (int s = 0; s < STAGES; s++) {
+                for (int j = 0; j < JOBS_PER_STAGE; j++) {
+                    jobs.run("stage job", [&finished, &outOfOrder, s, j]() {
+                        if (s > 0 && finished[s - 1] != JOBS_PER_STAGE) {
+                            outOfOrder++;
+                        }
+                        smallWork(j);
+                        finished[s]++;
+                    }, &waves[s], s > 0 ? &waves[s - 1] : nullptr);
+                }
+            }
+            jobs.wait(waves[STAGES - 1]);
+            best[3] = std::min(best[3], millisecondsSince(start));
+            stolen[3] = jobs.getStolenCount() - stolenBefore;
+            failures += outOfOrder != 0 || finished[STAGES - 1] != JOBS_PER_STAGE;
+        }
+
+        const char* names[4] = { "parallel for", "small jobs", "fork join", "stages" };
+        for (int load = 0; load < 4; load++) {
+            if (threads == 1) {
+                baseline[load] = best[load];
+            }
+            printf("%8d %-14s %10.3f %8.2fx %10llu%s\n", threads, names[load], best[load], baseline[load] / best[load],
+                (unsigned long long)stolen[load], hardwareThreads > 0 && threads > hardwareThreads ? "  oversubscribed" : "");
+        }
+        jobs.Delete();
+    }
+
+    if (traceFile) {
+        gps::CpuProfiler::setEnabled(false);
+        gps::CpuProfiler::writeChromeTrace(traceFile);
+    }
+
+    if (failures > 0) {
+        printf("%d results are wrong\n", failures);
+        return 1;
+    }
+    printf("every result matches\n");
+    printf("%d small jobs of %d iterations, a tree of depth %d (%d jobs), %d stages of %d jobs\n", SMALL_JOBS,
+        SMALL_JOB_ITERATIONS, TREE_DEPTH, (1 << (TREE_DEPTH + 1)) - 2, STAGES, JOBS_PER_STAGE);
+
+    return 0;
+}
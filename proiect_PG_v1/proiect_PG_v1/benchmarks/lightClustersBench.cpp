@@ -0,0 +1,56 @@
+// lightClustersBench.cpp
+// Sweeps the point light count and times the CPU side of the clustered lighting
+// (binning lights into the cluster grid). No GL context is needed, the GPU side is
+// measured in the viewer with --torches N and the lit pass timer.
+
+#include "../LightClusters.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+int main() {
+
+    const int lightCounts[] = { 1, 16, 64, 128, 256, 512, 1024, 4096, 16384 };
+    const int iterations = 200;
+
+    // camera inside the courtyard looking across the castle, same projection as the viewer
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 20.0f), glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 1000.0f);
+
+    gps::LightClusters clusters;
+
+    printf("%8s %12s %14s %14s\n", "lights", "build (ms)", "visible lights", "index count");
+
+    for (int lightCount : lightCounts) {
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> xDist(-30.0f, 30.0f);
+        std::uniform_real_distribution<float> yDist(0.0f, 4.0f);
+        std::uniform_real_distribution<float> zDist(-28.0f, 25.0f);
+
+        std::vector<gps::PointLight> lights(lightCount);
+        for (gps::PointLight& light : lights) {
+            light.position = glm::vec3(xDist(rng), yDist(rng), zDist(rng));
+            light.radius = 6.0f;
+            light.color = glm::vec3(1.0f, 0.6f, 0.25f);
+        }
+
+        // warm up the allocations
+        clusters.build(lights, view, projection, 0.1f, 1000.0f);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            clusters.build(lights, view, projection, 0.1f, 1000.0f);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+        printf("%8d %12.4f %14d %14d\n", lightCount, ms, clusters.getLightCount(), clusters.getIndexCount());
+    }
+
+    return 0;
+}
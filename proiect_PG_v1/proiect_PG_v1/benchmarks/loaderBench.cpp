@@ -0,0 +1,334 @@
+// loaderBench.cpp
+// Times the CPU stages of model loading one by one, at 1..N threads:
+// tinyobj parse, vertex assembly (Model3D::AssembleShape), texture decode per format,
+// the row flip of DecodeTexture (Model3D::FlipRows) and mesh packing (the copies the
+// Mesh constructor and glBufferData make, stubbed with memcpy so no GL context is needed).
+// Each stage reports MB/s, heap allocations (operator new plus stb_image's own malloc/realloc) and
+// how much the resident set grew over the stage.
+// Run from the project directory: loaderBench [maxThreads]  (POSIX only: dirent, /proc/self/statm or mach)
+
+#include "../Model3D.hpp"
+
+#include <dirent.h>
+#include <unistd.h>
+#if defined (__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- allocation counting: every operator new of the process goes through here, stb_image counts its mallocs itself ---
+
+static std::atomic<size_t> allocationCount(0);
+static std::atomic<size_t> allocationBytes(0);
+
+void* operator new(size_t size) {
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// --- helpers ---
+
+// The resident set now (not the peak, which only ever grows and would charge every stage with the ones before it)
+static double currentRssMegabytes() {
+
+#if defined (__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0.0;
+    }
+    return info.resident_size / (1024.0 * 1024.0);
+#else
+    // size, resident, shared, ... in pages
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0.0;
+    }
+    unsigned long size = 0, resident = 0;
+    int read = fscanf(file, "%lu %lu", &size, &resident);
+    fclose(file);
+    return read == 2 ? resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0) : 0.0;
+#endif
+}
+
+static size_t fileSize(const std::string& fileName) {
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size > 0 ? (size_t)size : 0;
+}
+
+static std::vector<std::string> listFiles(const std::string& directory, const char* extensionA, const char* extensionB) {
+
+    std::vector<std::string> files;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return files;
+    }
+
+    while (struct dirent* entry = readdir(dir)) {
+
+        std::string name = entry->d_name;
+        size_t dot = name.find_last_of('.');
+        if (dot == std::string::npos) {
+            continue;
+        }
+
+        std::string extension = name.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == extensionA || extension == extensionB) {
+            files.push_back(directory + name);
+        }
+    }
+    closedir(dir);
+
+    // readdir order is arbitrary, keep runs comparable
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Runs work(item) for every item on the given number of threads, items are handed out one at a time.
+// Returns the wall time in milliseconds.
+template <typename Work>
+static double runParallel(int threadCount, size_t itemCount, Work work) {
+
+    std::atomic<size_t> next(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        for (size_t item = next++; item < itemCount; item = next++) {
+            work(item);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; t++) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* stage, int threads, size_t items, double megabytes, double ms,
+    size_t allocations, size_t allocatedBytes, double rssGrowth) {
+
+    printf("%-14s %7d %6zu %10.1f %10.2f %10.1f %10zu %12.1f %+12.1f\n", stage, threads, items, megabytes, ms,
+        megabytes / (ms / 1000.0), allocations, allocatedBytes / (1024.0 * 1024.0), rssGrowth);
+}
+
+// Times one stage: counts the allocations it makes, the megabytes it processes and how much the resident set grew
+template <typename Work>
+static void measure(const char* stage, int threads, size_t items, double megabytes, Work work) {
+
+    size_t allocationsBefore = allocationCount.load() + gps::imageAllocationCount();
+    size_t bytesBefore = allocationBytes.load() + gps::imageAllocationBytes();
+    double rssBefore = currentRssMegabytes();
+
+    double ms = runParallel(threads, items, work);
+
+    report(stage, threads, items, megabytes, ms, allocationCount.load() + gps::imageAllocationCount() - allocationsBefore,
+        allocationBytes.load() + gps::imageAllocationBytes() - bytesBefore, currentRssMegabytes() - rssBefore);
+}
+
+struct ParsedObj {
+
+    std::string fileName;
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+struct DecodedImage {
+
+    unsigned char* pixels;
+    int width;
+    int height;
+};
+
+int main(int argc, char* argv[]) {
+
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    const double MB = 1024.0 * 1024.0;
+
+    const char* objFiles[] = { "objects/castle/castle.obj", "objects/nanosuit/nanosuit.obj", "models/teapot/teapot20segUT.obj" };
+    const size_t objCount = sizeof(objFiles) / sizeof(objFiles[0]);
+
+    std::vector<std::string> jpegFiles = listFiles("objects/castle/textures/", "jpg", "jpeg");
+    std::vector<std::string> pngFiles = listFiles("objects/castle/textures/", "png", "png");
+
+    double objMegabytes = 0.0;
+    for (size_t i = 0; i < objCount; i++) {
+        objMegabytes += fileSize(objFiles[i]) / MB;
+    }
+    double jpegMegabytes = 0.0;
+    for (size_t i = 0; i < jpegFiles.size(); i++) {
+        jpegMegabytes += fileSize(jpegFiles[i]) / MB;
+    }
+    double pngMegabytes = 0.0;
+    for (size_t i = 0; i < pngFiles.size(); i++) {
+        pngMegabytes += fileSize(pngFiles[i]) / MB;
+    }
+
+    if (objMegabytes == 0.0) {
+        fprintf(stderr, "Models not found, run loaderBench from the project directory\n");
+        return 1;
+    }
+
+    // inputs of the later stages, produced once outside the timings
+    std::vector<ParsedObj> parsed(objCount);
+    for (size_t i = 0; i < objCount; i++) {
+
+        std::string fileName = objFiles[i];
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+        std::string err;
+        parsed[i].fileName = fileName;
+        tinyobj::LoadObj(&parsed[i].attrib, &parsed[i].shapes, &parsed[i].materials, &err, fileName.c_str(), basePath.c_str(), true);
+    }
+
+    // one work item per shape of every model
+    std::vector<std::pair<size_t, size_t> > shapeItems;
+    double assembledMegabytes = 0.0;
+    for (size_t i = 0; i < objCount; i++) {
+        for (size_t s = 0; s < parsed[i].shapes.size(); s++) {
+
+            shapeItems.push_back(std::make_pair(i, s));
+            size_t corners = parsed[i].shapes[s].mesh.indices.size();
+            assembledMegabytes += corners * (sizeof(gps::Vertex) + sizeof(GLuint)) / MB;
+        }
+    }
+
+    std::vector<std::vector<gps::Vertex> > assembledVertices(shapeItems.size());
+    std::vector<std::vector<GLuint> > assembledIndices(shapeItems.size());
+    for (size_t item = 0; item < shapeItems.size(); item++) {
+        gps::Model3D::AssembleShape(parsed[shapeItems[item].first].attrib, parsed[shapeItems[item].first].shapes[shapeItems[item].second],
+            assembledVertices[item], assembledIndices[item]);
+    }
+
+    std::vector<std::string> textureFiles = jpegFiles;
+    textureFiles.insert(textureFiles.end(), pngFiles.begin(), pngFiles.end());
+    std::vector<DecodedImage> decoded(textureFiles.size());
+    double decodedMegabytes = 0.0;
+    for (size_t i = 0; i < textureFiles.size(); i++) {
+
+        int channels;
+        decoded[i].pixels = stbi_load(textureFiles[i].c_str(), &decoded[i].width, &decoded[i].height, &channels, 4);
+        if (decoded[i].pixels) {
+            decodedMegabytes += (double)decoded[i].width * decoded[i].height * 4 / MB;
+        }
+    }
+
+    printf("%zu models (%.1f MB), %zu JPEG (%.1f MB), %zu PNG (%.1f MB), %.1f MB decoded, up to %d threads\n",
+        objCount, objMegabytes, jpegFiles.size(), jpegMegabytes, pngFiles.size(), pngMegabytes, decodedMegabytes, maxThreads);
+    printf("MB/s is over the stage input (files for parse/decode, output arrays for assembly/flip/pack)\n");
+    printf("RSS MB is the resident set after the stage minus before it, memory the allocator kept or gave back\n\n");
+    printf("%-14s %7s %6s %10s %10s %10s %10s %12s %12s\n",
+        "stage", "threads", "items", "MB", "ms", "MB/s", "allocs", "alloc MB", "RSS MB");
+
+    // 1, 2, 4, ... and maxThreads itself
+    for (int threads = 1; threads <= maxThreads; threads = threads < maxThreads ? std::min(threads * 2, maxThreads) : maxThreads + 1) {
+
+        measure("parse obj", threads, objCount, objMegabytes, [&](size_t i) {
+
+            ParsedObj result;
+            std::string fileName = objFiles[i];
+            std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+            std::string err;
+            tinyobj::LoadObj(&result.attrib, &result.shapes, &result.materials, &err, fileName.c_str(), basePath.c_str(), true);
+        });
+
+        measure("assemble", threads, shapeItems.size(), assembledMegabytes, [&](size_t item) {
+
+            std::vector<gps::Vertex> vertices;
+            std::vector<GLuint> indices;
+            gps::Model3D::AssembleShape(parsed[shapeItems[item].first].attrib, parsed[shapeItems[item].first].shapes[shapeItems[item].second],
+                vertices, indices);
+        });
+
+        measure("decode jpeg", threads, jpegFiles.size(), jpegMegabytes, [&](size_t i) {
+
+            int width, height, channels;
+            stbi_image_free(stbi_load(jpegFiles[i].c_str(), &width, &height, &channels, 4));
+        });
+
+        measure("decode png", threads, pngFiles.size(), pngMegabytes, [&](size_t i) {
+
+            int width, height, channels;
+            stbi_image_free(stbi_load(pngFiles[i].c_str(), &width, &height, &channels, 4));
+        });
+
+        measure("flip rows", threads, decoded.size(), decodedMegabytes, [&](size_t i) {
+
+            if (decoded[i].pixels) {
+                gps::Model3D::FlipRows(decoded[i].pixels, decoded[i].width, decoded[i].height, 4);
+            }
+        });
+
+        // the Mesh constructor copies both arrays, glBufferData copies them again (stubbed with a staging block)
+        measure("pack mesh", threads, shapeItems.size(), assembledMegabytes * 2.0, [&](size_t item) {
+
+            std::vector<gps::Vertex> meshVertices = assembledVertices[item];
+            std::vector<GLuint> meshIndices = assembledIndices[item];
+
+            std::vector<unsigned char> staging(meshVertices.size() * sizeof(gps::Vertex) + meshIndices.size() * sizeof(GLuint));
+            if (!staging.empty()) {
+                memcpy(&staging[0], meshVertices.data(), meshVertices.size() * sizeof(gps::Vertex));
+                memcpy(&staging[meshVertices.size() * sizeof(gps::Vertex)], meshIndices.data(), meshIndices.size() * sizeof(GLuint));
+            }
+        });
+
+        printf("\n");
+    }
+
+    for (size_t i = 0; i < decoded.size(); i++) {
+        stbi_image_free(decoded[i].pixels);
+    }
+
+    return 0;
+}
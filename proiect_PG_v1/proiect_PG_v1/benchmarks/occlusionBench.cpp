@@ -0,0 +1,175 @@
+// occlusionBench.cpp
+// Times the CPU occlusion culling (SoftwareOcclusion) at 1..N threads: the castle's large triangles
+// are the occluders, the bounding boxes of its shapes are tested from a ring of cameras around and
+// inside the walls. Reports rasterization and test time per frame and how many boxes were culled.
+// A few fixed scenes are checked first (a box behind a wall is culled, boxes beside, in front
+// of or reaching past it are not); the benchmark fails if one of them does not hold.
+// No GL context is needed. Run from the project directory: occlusionBench [maxThreads]
+
+#include "../SoftwareOcclusion.hpp"
+#include "../JobSystem.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// same buffer and occluder selection as the viewer
+static const int BUFFER_WIDTH = 320;
+static const int BUFFER_HEIGHT = 180;
+static const float OCCLUDER_MIN_AREA = 0.5f;
+
+struct Box {
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+static glm::mat4 viewProjection(const glm::vec3& eye, const glm::vec3& target) {
+
+    glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)BUFFER_WIDTH / BUFFER_HEIGHT, 0.1f, 1000.0f);
+    return projection * view;
+}
+
+static bool check(const char* name, bool condition) {
+
+    if (!condition) {
+        printf("check failed: %s\n", name);
+    }
+    return condition;
+}
+
+// A 10 x 10 wall at z = 0 seen from z = 10
+static bool checkScenes() {
+
+    std::vector<gps::Vertex> vertices(4);
+    vertices[0].Position = glm::vec3(-5.0f, -5.0f, 0.0f);
+    vertices[1].Position = glm::vec3(5.0f, -5.0f, 0.0f);
+    vertices[2].Position = glm::vec3(5.0f, 5.0f, 0.0f);
+    vertices[3].Position = glm::vec3(-5.0f, 5.0f, 0.0f);
+    GLuint quad[] = { 0, 1, 2, 0, 2, 3 };
+    std::vector<GLuint> indices(quad, quad + 6);
+
+    gps::SoftwareOcclusion occlusion;
+    gps::JobSystem jobs;
+    jobs.Create(2);
+    occlusion.Create(BUFFER_WIDTH, BUFFER_HEIGHT, &jobs);
+    occlusion.addOccluder(vertices, indices, glm::mat4(1.0f), 0.0f);
+    occlusion.render(viewProjection(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f)));
+
+    glm::mat4 identity = glm::mat4(1.0f);
+    bool passed = true;
+    passed &= check("box behind the wall is culled",
+        occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, -3.0f), glm::vec3(1.0f, 1.0f, -1.0f), identity));
+    passed &= check("box in front of the wall is drawn",
+        !occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 3.0f), identity));
+    passed &= check("box through the wall is drawn",
+        !occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), identity));
+    passed &= check("box beside the wall is drawn",
+        !occlusion.isOccluded(glm::vec3(6.0f, -1.0f, -3.0f), glm::vec3(7.0f, 1.0f, -1.0f), identity));
+    passed &= check("box reaching past the edge is drawn",
+        !occlusion.isOccluded(glm::vec3(4.0f, -1.0f, -3.0f), glm::vec3(5.5f, 1.0f, -1.0f), identity));
+    passed &= check("box around the camera is drawn",
+        !occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, 9.0f), glm::vec3(1.0f, 1.0f, 11.0f), identity));
+
+    // behind the camera the wall hides nothing
+    occlusion.render(viewProjection(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, 20.0f)));
+    passed &= check("box behind a wall out of view is drawn",
+        !occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, 14.0f), glm::vec3(1.0f, 1.0f, 16.0f), identity));
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    const int iterations = 20;
+
+    if (!checkScenes()) {
+        return 1;
+    }
+    printf("scene checks passed\n");
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "objects/castle/castle.obj", "objects/castle/", true)) {
+        printf("cannot load objects/castle/castle.obj (run from the project directory)\n");
+        return 1;
+    }
+
+    // placed as in the viewer
+    glm::mat4 castleModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+
+    std::vector<std::vector<gps::Vertex> > shapeVertices(shapes.size());
+    std::vector<std::vector<GLuint> > shapeIndices(shapes.size());
+    std::vector<Box> boxes(shapes.size());
+    for (size_t s = 0; s < shapes.size(); s++) {
+
+        gps::Model3D::AssembleShape(attrib, shapes[s], shapeVertices[s], shapeIndices[s]);
+
+        boxes[s].boundsMin = glm::vec3(1e30f);
+        boxes[s].boundsMax = glm::vec3(-1e30f);
+        for (size_t v = 0; v < shapeVertices[s].size(); v++) {
+            boxes[s].boundsMin = glm::min(boxes[s].boundsMin, shapeVertices[s][v].Position);
+            boxes[s].boundsMax = glm::max(boxes[s].boundsMax, shapeVertices[s][v].Position);
+        }
+    }
+
+    // around the walls at eye height looking at the keep, then from the courtyard looking out
+    std::vector<glm::mat4> views;
+    for (int i = 0; i < 32; i++) {
+
+        float angle = glm::radians(360.0f * i / 32);
+        glm::vec3 direction = glm::vec3(std::sin(angle), 0.0f, std::cos(angle));
+        views.push_back(viewProjection(direction * 45.0f + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 3.0f, -5.0f)));
+        views.push_back(viewProjection(glm::vec3(0.0f, 1.0f, 2.0f), glm::vec3(0.0f, 1.0f, 2.0f) + direction));
+    }
+
+    printf("%zu shapes, %zu views\n", shapes.size(), views.size());
+    printf("%8s %10s %12s %10s %12s %10s\n", "threads", "occluders", "raster (ms)", "test (ms)", "tile tris", "culled");
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+        gps::JobSystem jobs;
+        jobs.Create(threads);
+        gps::SoftwareOcclusion occlusion;
+        occlusion.Create(BUFFER_WIDTH, BUFFER_HEIGHT, &jobs);
+        for (size_t s = 0; s < shapes.size(); s++) {
+            occlusion.addOccluder(shapeVertices[s], shapeIndices[s], castleModel, OCCLUDER_MIN_AREA);
+        }
+
+        double rasterMilliseconds = 0.0;
+        double testMilliseconds = 0.0;
+        long long rasterized = 0;
+        long long culled = 0;
+
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (size_t v = 0; v < views.size(); v++) {
+
+                occlusion.render(views[v]);
+
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (size_t b = 0; b < boxes.size(); b++) {
+                    culled += occlusion.isOccluded(boxes[b].boundsMin, boxes[b].boundsMax, castleModel);
+                }
+                testMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                rasterMilliseconds += occlusion.getRasterMilliseconds();
+                rasterized += occlusion.getRasterizedTriangles();
+            }
+        }
+
+        double frames = (double)iterations * views.size();
+        printf("%8d %10zu %12.4f %10.4f %12.1f %6.1f/%zu\n", threads, occlusion.getOccluderTriangleCount(),
+            rasterMilliseconds / frames, testMilliseconds / frames, rasterized / frames, culled / frames, boxes.size());
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+// sceneGraphBench.cpp
+// Times SceneGraph updates on a scene of many small hierarchies (a root with a tree of parts under it,
+// like a character's skeleton or a prop with attachments): with nothing changed, with a share of the
+// nodes animated each frame and with every root moved. Next to them, recomputing every world and normal
+// matrix each frame without the dirty flags.
+// After every update the cached matrices are checked against that recomputation; the benchmark fails
+// if any differs.
+// No GL context or assets are needed: sceneGraphBench [objects] [nodes per object] [animated percent]
+
+#include "../SceneGraph.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static const int FRAMES = 200;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static glm::mat4 randomLocal(std::mt19937& random, float spread) {
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f) * spread);
+    local = glm::rotate(local, unit(random) * 6.2831853f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.1f)));
+    // some non uniform scale, so the normal matrix is not the rotation
+    return glm::scale(local, glm::vec3(0.8f + unit(random) * 0.4f, 0.8f + unit(random) * 0.4f, 0.8f + unit(random) * 0.4f));
+}
+
+// every node from its local and its parent's world, what update() saves doing
+static void recomputeAll(gps::SceneGraph& graph, std::vector<glm::mat4>& worlds, std::vector<glm::mat3>& normals) {
+
+    int nodeCount = (int)graph.getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        int parent = graph.getParent(node);
+        worlds[node] = parent < 0 ? graph.getLocal(node) : worlds[parent] * graph.getLocal(node);
+        normals[node] = glm::inverseTranspose(glm::mat3(worlds[node]));
+    }
+}
+
+static float largestDifference(gps::SceneGraph& graph, const std::vector<glm::mat4>& worlds, const std::vector<glm::mat3>& normals) {
+
+    float largest = 0.0f;
+    int nodeCount = (int)graph.getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                largest = std::max(largest, std::abs(graph.getWorld(node)[c][r] - worlds[node][c][r]));
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            for (int r = 0; r < 3; r++) {
+                largest = std::max(largest, std::abs(graph.getNormal(node)[c][r] - normals[node][c][r]));
+            }
+        }
+    }
+    return largest;
+}
+
+int main(int argc, char* argv[]) {
+
+    int objectCount = argc > 1 ? atoi(argv[1]) : 500;
+    int nodesPerObject = std::max(argc > 2 ? atoi(argv[2]) : 100, 1);
+    float animatedPercent = argc > 3 ? (float)atof(argv[3]) : 1.0f;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // each object's parts hang from earlier parts of the same object
+    gps::SceneGraph graph;
+    graph.reserve((size_t)objectCount * nodesPerObject);
+    std::vector<int> roots;
+    for (int o = 0; o < objectCount; o++) {
+
+        int root = graph.addNode(-1, randomLocal(random, 400.0f));
+        roots.push_back(root);
+        for (int n = 1; n < nodesPerObject; n++) {
+            int parent = root + (int)(random() % n);
+            graph.addNode(parent, randomLocal(random, 2.0f));
+        }
+    }
+    int nodeCount = (int)graph.getNodeCount();
+    int animatedCount = std::min((int)(nodeCount * animatedPercent / 100.0f), nodeCount);
+
+    std::vector<glm::mat4> worlds(nodeCount);
+    std::vector<glm::mat3> normals(nodeCount);
+    std::vector<glm::mat4> animatedLocals(animatedCount);
+    std::vector<int> animatedNodes(animatedCount);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    graph.update();
+    double firstMilliseconds = millisecondsSince(start);
+
+    double staticMilliseconds = 0.0;
+    double animatedMilliseconds = 0.0;
+    double rootsMilliseconds = 0.0;
+    double recomputeMilliseconds = 0.0;
+    long long animatedUpdated = 0;
+    long long rootsUpdated = 0;
+    float largest = 0.0f;
+    int unchangedUpdates = 0;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+
+        start = std::chrono::steady_clock::now();
+        unchangedUpdates += graph.update();
+        staticMilliseconds += millisecondsSince(start);
+
+        // new poses picked outside the timing, only setting them and the update are timed
+        for (int a = 0; a < animatedCount; a++) {
+            animatedNodes[a] = (int)(random() % nodeCount);
+            animatedLocals[a] = randomLocal(random, 2.0f);
+        }
+        start = std::chrono::steady_clock::now();
+        for (int a = 0; a < animatedCount; a++) {
+            graph.setLocal(animatedNodes[a], animatedLocals[a]);
+        }
+        animatedUpdated += graph.update();
+        animatedMilliseconds += millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        recomputeAll(graph, worlds, normals);
+        recomputeMilliseconds += millisecondsSince(start);
+        largest = std::max(largest, largestDifference(graph, worlds, normals));
+
+        if (frame % 10 == 0) {
+
+            for (size_t r = 0; r < roots.size(); r++) {
+                glm::mat4 local = graph.getLocal(roots[r]);
+                graph.setLocal(roots[r], glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.01f, 0.0f)) * local);
+            }
+            start = std::chrono::steady_clock::now();
+            rootsUpdated += graph.update();
+            rootsMilliseconds += millisecondsSince(start);
+
+            recomputeAll(graph, worlds, normals);
+            largest = std::max(largest, largestDifference(graph, worlds, normals));
+        }
+    }
+
+    int rootFrames = (FRAMES + 9) / 10;
+    if (largest > 1e-4f || unchangedUpdates != 0) {
+        printf("cached matrices differ from the recomputation by %g, %d nodes updated without changes\n", largest, unchangedUpdates);
+        return 1;
+    }
+    printf("every cached matrix matches the recomputation\n");
+
+    printf("%d nodes (%d objects of %d), %d animated per frame\n", nodeCount, objectCount, nodesPerObject, animatedCount);
+    printf("%-16s %12s %14s\n", "update", "ms/update", "nodes updated");
+    printf("%-16s %12.4f %14d\n", "first", firstMilliseconds, nodeCount);
+    printf("%-16s %12.4f %14d\n", "unchanged", staticMilliseconds / FRAMES, 0);
+    printf("%-16s %12.4f %14.0f\n", "animated", animatedMilliseconds / FRAMES, (double)animatedUpdated / FRAMES);
+    printf("%-16s %12.4f %14.0f\n", "roots moved", rootsMilliseconds / rootFrames, (double)rootsUpdated / rootFrames);
+    printf("%-16s %12.4f %14d\n", "recompute all", recomputeMilliseconds / FRAMES, nodeCount);
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+// sceneIndexBench.cpp
+// Times the loose octree (SceneIndex) on a field of boxes, a few of them large, some of them moving
+// every frame and some removed and added again. Per frame it reports the cost of the moves and of
+// frustum, sphere and ray queries, next to a scan over every box.
+// Every query is checked against that scan; the benchmark fails if the sets differ.
+// No GL context or assets are needed: sceneIndexBench [instances] [moving]
+
+#include "../SceneIndex.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static const float WORLD_HALF_SIZE = 256.0f;
+static const int FRAMES = 100;
+static const int CHURN = 100;          // removed and inserted again per frame
+static const int SPHERES = 64;         // queries per frame
+static const int RAYS = 64;
+static const float FRAME_SECONDS = 1.0f / 60.0f;
+
+struct Box {
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 velocity;
+    int instance;
+};
+
+// the same tests the index makes on its instances
+static bool inFrustum(const glm::vec4 planes[6], const Box& box) {
+
+    for (int p = 0; p < 6; p++) {
+        glm::vec3 normal = glm::vec3(planes[p]);
+        glm::vec3 positive = glm::vec3(normal.x >= 0.0f ? box.boundsMax.x : box.boundsMin.x,
+            normal.y >= 0.0f ? box.boundsMax.y : box.boundsMin.y, normal.z >= 0.0f ? box.boundsMax.z : box.boundsMin.z);
+        if (glm::dot(normal, positive) + planes[p].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool inSphere(const glm::vec3& center, float radius, const Box& box) {
+
+    glm::vec3 toClosest = glm::clamp(center, box.boundsMin, box.boundsMax) - center;
+    return glm::dot(toClosest, toClosest) <= radius * radius;
+}
+
+static bool onRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const Box& box) {
+
+    glm::vec3 slabNear = (box.boundsMin - origin) * inverseDirection;
+    glm::vec3 slabFar = (box.boundsMax - origin) * inverseDirection;
+    glm::vec3 entries = glm::min(slabNear, slabFar);
+    glm::vec3 exits = glm::max(slabNear, slabFar);
+    float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+    float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+    return enter <= exit;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool sameSet(std::vector<int>& found, std::vector<int>& expected) {
+
+    std::sort(found.begin(), found.end());
+    std::sort(expected.begin(), expected.end());
+    return found == expected;
+}
+
+int main(int argc, char* argv[]) {
+
+    int instanceCount = argc > 1 ? atoi(argv[1]) : 20000;
+    int movingCount = std::min(argc > 2 ? atoi(argv[2]) : 1000, instanceCount);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // mostly props of 0.5 to 8 units, one in a hundred a building of up to 60
+    std::vector<Box> boxes(instanceCount);
+    gps::SceneIndex index;
+    index.Create(glm::vec3(0.0f), WORLD_HALF_SIZE);
+    for (int i = 0; i < instanceCount; i++) {
+
+        glm::vec3 center = glm::vec3((unit(random) * 2.0f - 1.0f) * 240.0f, unit(random) * 40.0f, (unit(random) * 2.0f - 1.0f) * 240.0f);
+        float size = i % 100 == 0 ? 20.0f + unit(random) * 40.0f : 0.5f + unit(random) * 7.5f;
+        glm::vec3 half = glm::vec3(size, size * (0.5f + unit(random)), size) * 0.5f;
+        boxes[i].boundsMin = center - half;
+        boxes[i].boundsMax = center + half;
+        boxes[i].velocity = glm::vec3(unit(random) * 2.0f - 1.0f, 0.0f, unit(random) * 2.0f - 1.0f) * 10.0f;
+        boxes[i].instance = index.insert(boxes[i].boundsMin, boxes[i].boundsMax, i);
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+
+    double moveMilliseconds = 0.0;
+    double churnMilliseconds = 0.0;
+    double frustumMilliseconds = 0.0;
+    double frustumScanMilliseconds = 0.0;
+    double sphereMilliseconds = 0.0;
+    double sphereScanMilliseconds = 0.0;
+    double rayMilliseconds = 0.0;
+    double rayScanMilliseconds = 0.0;
+    long long visible = 0;
+    int mismatches = 0;
+
+    std::vector<int> found;
+    std::vector<int> expected;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+
+        // the first movingCount boxes drift and bounce off the world's edge
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < movingCount; i++) {
+
+            glm::vec3 step = boxes[i].velocity * FRAME_SECONDS;
+            boxes[i].boundsMin += step;
+            boxes[i].boundsMax += step;
+            glm::vec3 center = (boxes[i].boundsMin + boxes[i].boundsMax) * 0.5f;
+            if (std::abs(center.x) > 240.0f) {
+                boxes[i].velocity.x = -boxes[i].velocity.x;
+            }
+            if (std::abs(center.z) > 240.0f) {
+                boxes[i].velocity.z = -boxes[i].velocity.z;
+            }
+            index.move(boxes[i].instance, boxes[i].boundsMin, boxes[i].boundsMax);
+        }
+        moveMilliseconds += millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int c = 0; c < CHURN; c++) {
+            int i = (int)(random() % instanceCount);
+            index.remove(boxes[i].instance);
+            boxes[i].instance = index.insert(boxes[i].boundsMin, boxes[i].boundsMax, i);
+        }
+        churnMilliseconds += millisecondsSince(start);
+
+        // a camera circling the field, looking across it
+        float angle = glm::radians(360.0f * frame / FRAMES);
+        glm::vec3 eye = glm::vec3(std::sin(angle), 0.1f, std::cos(angle)) * 200.0f;
+        glm::mat4 viewProjection = projection * glm::lookAt(eye, glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        found.clear();
+        start = std::chrono::steady_clock::now();
+        index.queryFrustum(viewProjection, found);
+        frustumMilliseconds += millisecondsSince(start);
+        visible += found.size();
+
+        glm::vec4 rows[4];
+        glm::vec4 planes[6];
+        for (int r = 0; r < 4; r++) {
+            rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            planes[2 * axis] = rows[3] + rows[axis];
+            planes[2 * axis + 1] = rows[3] - rows[axis];
+        }
+
+        expected.clear();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < instanceCount; i++) {
+            if (inFrustum(planes, boxes[i])) {
+                expected.push_back(boxes[i].instance);
+            }
+        }
+        frustumScanMilliseconds += millisecondsSince(start);
+        mismatches += !sameSet(found, expected);
+
+        for (int s = 0; s < SPHERES; s++) {
+
+            glm::vec3 center = glm::vec3((unit(random) * 2.0f - 1.0f) * 240.0f, unit(random) * 40.0f, (unit(random) * 2.0f - 1.0f) * 240.0f);
+            float radius = 2.0f + unit(random) * 18.0f;
+
+            found.clear();
+            start = std::chrono::steady_clock::now();
+            index.querySphere(center, radius, found);
+            sphereMilliseconds += millisecondsSince(start);
+
+            expected.clear();
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < instanceCount; i++) {
+                if (inSphere(center, radius, boxes[i])) {
+                    expected.push_back(boxes[i].instance);
+                }
+            }
+            sphereScanMilliseconds += millisecondsSince(start);
+            mismatches += !sameSet(found, expected);
+        }
+
+        for (int r = 0; r < RAYS; r++) {
+
+            glm::vec3 origin = glm::vec3((unit(random) * 2.0f - 1.0f) * 240.0f, 1.0f + unit(random) * 10.0f, (unit(random) * 2.0f - 1.0f) * 240.0f);
+            glm::vec3 direction = glm::normalize(glm::vec3(unit(random) * 2.0f - 1.0f, (unit(random) - 0.5f) * 0.2f, unit(random) * 2.0f - 1.0f));
+            float maxDistance = 100.0f;
+
+            found.clear();
+            start = std::chrono::steady_clock::now();
+            index.queryRay(origin, direction, maxDistance, found);
+            rayMilliseconds += millisecondsSince(start);
+
+            glm::vec3 inverseDirection;
+            for (int axis = 0; axis < 3; axis++) {
+                inverseDirection[axis] = 1.0f / (direction[axis] != 0.0f ? direction[axis] : 1e-30f);
+            }
+            expected.clear();
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < instanceCount; i++) {
+                if (onRay(origin, inverseDirection, maxDistance, boxes[i])) {
+                    expected.push_back(boxes[i].instance);
+                }
+            }
+            rayScanMilliseconds += millisecondsSince(start);
+            mismatches += !sameSet(found, expected);
+        }
+    }
+
+    if (mismatches > 0 || index.getInstanceCount() != (size_t)instanceCount) {
+        printf("%d queries differ from the scan, %zu instances indexed\n", mismatches, index.getInstanceCount());
+        return 1;
+    }
+    printf("every query matches the scan\n");
+
+    printf("%d instances (%d moving, %d removed and added per frame), %zu nodes\n", instanceCount, movingCount, CHURN, index.getNodeCount());
+    printf("moves     %8.4f ms/frame  %6.1f ns each\n", moveMilliseconds / FRAMES, moveMilliseconds * 1e6 / ((double)FRAMES * std::max(movingCount, 1)));
+    printf("churn     %8.4f ms/frame\n", churnMilliseconds / FRAMES);
+    printf("%-9s %14s %14s %10s\n", "query", "index (ms)", "scan (ms)", "speedup");
+    printf("%-9s %14.4f %14.4f %9.1fx  (%.0f visible)\n", "frustum", frustumMilliseconds / FRAMES, frustumScanMilliseconds / FRAMES,
+        frustumScanMilliseconds / frustumMilliseconds, (double)visible / FRAMES);
+    printf("%-9s %14.4f %14.4f %9.1fx\n", "sphere", sphereMilliseconds / (FRAMES * SPHERES), sphereScanMilliseconds / (FRAMES * SPHERES),
+        sphereScanMilliseconds / sphereMilliseconds);
+    printf("%-9s %14.4f %14.4f %9.1fx\n", "ray", rayMilliseconds / (FRAMES * RAYS), rayScanMilliseconds / (FRAMES * RAYS),
+        rayScanMilliseconds / rayMilliseconds);
+
+    return 0;
+}
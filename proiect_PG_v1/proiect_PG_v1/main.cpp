@@ -21,8 +21,36 @@
 #include "Camera.hpp"
 #include "Model3D.hpp"
 #include "SkyBox.hpp"
+#include "LightClusters.hpp"
+#include "GBuffer.hpp"
+#include "ShaderVariants.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuProfiler.hpp"
+#include "CameraPath.hpp"
+#include "FrameReadback.hpp"
+#include "ImageCompare.hpp"
+#include "JsonWriter.hpp"
+#include "GLDispatch.hpp"
+#include "GLFrameStats.hpp"
+#include "GLDebug.hpp"
+#include "Hud.hpp"
+#include "HiZCuller.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "SceneBVH.hpp"
+#include "CameraCollider.hpp"
+#include "SceneIndex.hpp"
+#include "SceneGraph.hpp"
+#include "EntityStore.hpp"
+#include "JobSystem.hpp"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
 
 // mouse handling
 bool firstMouse = true;
@@ -32,32 +60,46 @@ float yaw = -90.0f;   // face negative Z
 float pitch = 0.0f;
 
 // shading mode
-GLint isFlatLoc;
 int isFlat = 0; // 0 = Smooth (Default), 1 = Flat
 
+// optional lighting features, each combination is its own shader variant
+bool spotLight = false; // F - flashlight from the camera
+bool shadows = true;    // H
+bool fog = true;        // N
+
 // window
 gps::Window myWindow;
 
-// matrices
-glm::mat4 model;
+// matrices, the per draw model and normal matrices are locals of the passes
 glm::mat4 view;
 glm::mat4 projection;
-glm::mat3 normalMatrix;
+
+// transform hierarchy, the entities take their world matrices from their nodes
+gps::SceneGraph sceneGraph;
+
+// the nanosuit, the castles and the point lights; the draw list is built from the renderables every frame
+gps::EntityStore entities;
+std::vector<gps::DrawItem> drawList;
+int nanosuitEntity = -1;  // turned by Q and E
+int castleCount = 1;      // --castles N, side by side along x
+const float CASTLE_SPACING = 80.0f;
+
+// model reads, occluder rasterization and the entity systems run as jobs
+gps::JobSystem jobSystem;
+int jobThreads = 0;                     // --jobs N, 0 is one per hardware thread
+const size_t ENTITY_GRAIN_SIZE = 1024;  // components per job, fewer run on the calling thread
 
 // light parameters
 glm::vec3 lightDir;
 glm::vec3 lightColor;
 
 glm::vec3 pointLightPos;
-GLuint pointLightPosLoc;
 
-// shader uniform locations
-GLint modelLoc;
-GLint viewLoc;
-GLint projectionLoc;
-GLint normalMatrixLoc;
-GLint lightDirLoc;
-GLint lightColorLoc;
+// point lights (the original one + optional torches), gathered from the light entities every frame
+// and shaded through light clusters
+std::vector<gps::PointLight> pointLights;
+gps::LightClusters lightClusters;
+int torchCount = 0; // --torches N
 
 // camera
 gps::Camera myCamera(
@@ -74,14 +116,14 @@ GLboolean pressedKeys[1024];
 gps::Model3D nanosuit;
 gps::Model3D myCastle;
 
-GLfloat angle;
-
 // globals for light cube (directional light)
 gps::Model3D lightCube;
 gps::Shader lightShader;
 float lightAngle = 0.0f; // controls the rotation around the scene
 
 // shaders
+// basic.vert/basic.frag permutations, myBasicShader is the variant picked for the current frame
+gps::ShaderVariants basicShaders;
 gps::Shader myBasicShader;
 
 // Shadow variables
@@ -91,10 +133,124 @@ const unsigned int SHADOW_WIDTH = 2048, SHADOW_HEIGHT = 2048; // High res for be
 
 gps::Shader depthMapShader;
 
+// deferred shading (--deferred), the forward path is the default
+bool deferredShading = false;
+gps::GBuffer gBuffer;
+gps::ShaderVariants gBufferShaders;
+gps::ShaderVariants deferredLightingShaders;
+GLuint fullscreenVAO;
+
+// depth pre-pass (toggle with P, forward path only)
+bool depthPrePass = false;
+gps::Shader depthPrePassShader;
+
+// GPU time of every render pass, logged every gpuProfiler.reportInterval frames
+// --profile-draws adds a scope per Model3D draw inside the passes
+gps::GpuProfiler gpuProfiler;
+
+// CPU scopes (GPS_CPU_SCOPE) for a Chrome trace: --trace records from startup,
+// T toggles recording and writes the trace when it stops, it is also written at exit
+const char* CPU_TRACE_FILE = "cpu_trace.json";
+
+// headless benchmark (--benchmark [--frames N]): hidden window, no vsync,
+// the scene is drawn into sceneFBO instead of the default framebuffer
+bool benchmarkMode = false;
+int benchmarkFrames = 1000;
+const int BENCHMARK_WARMUP_FRAMES = 30;
+GLuint sceneFBO = 0; // 0 = window
+GLuint sceneColorRenderbuffer;
+GLuint sceneDepthRenderbuffer;
+
+// GL submission stats per frame and pass (GLFrameStats): --gl-stats FILE logs every frame
+// (.csv, otherwise JSON lines), G shows the last frame in the window title
+const char* WINDOW_TITLE = "OpenGL Project Core";
+std::string glStatsFile;
+bool glStatsOverlay = false;
+
+// camera paths: --record-path FILE saves the pose of every frame at exit,
+// --play-path FILE drives the camera one pose per frame (fixed timestep) instead of the input
+gps::CameraPath cameraPath;
+std::string playPathFile;
+std::string recordPathFile;
+bool playingPath = false;
+int pathFrame = 0;
+
+// golden image check (--golden, or --update-golden to rewrite the references):
+// renders the viewpoints of golden/viewpoints.txt offscreen and compares them with golden/<name>.png
+enum GoldenMode { GOLDEN_OFF, GOLDEN_CHECK, GOLDEN_UPDATE };
+GoldenMode goldenMode = GOLDEN_OFF;
+const char* GOLDEN_DIRECTORY = "golden/";
+double goldenMinPsnr = 40.0;    // --golden-psnr
+int goldenMaxDifference = 48;   // --golden-max-diff, per channel
+gps::FrameReadback frameReadback;
+
 // skybox
 gps::SkyBox mySkyBox;
 gps::Shader skyboxShader;
 
+// GL errors arrive through the debug output callback (GLDebug). Debug builds ask for a debug context
+// and get the messages synchronously, tagged with the file and line of the call; --gl-debug does the
+// same in a release build. glGetError stalls the pipeline on many drivers, so glCheckError()
+// only polls in debug builds
+#if defined (NDEBUG)
+bool glDebugContext = false;
+#else
+bool glDebugContext = true;
+#endif
+
+// Hi-Z occlusion culling (O or --occlusion-culling): the camera passes skip meshes hidden in the
+// depth of an earlier frame, the shadow pass still draws everything
+gps::HiZCuller hiZCuller;
+gps::Shader hiZDownsampleShader;
+bool occlusionCulling = false;
+
+// CPU occlusion culling (K or --software-occlusion): the large triangles of the castle are drawn into
+// a small depth buffer in the current view, on its own or after the Hi-Z test
+gps::SoftwareOcclusion softwareOcclusion;
+bool softwareOcclusionCulling = false;
+const int SOFTWARE_OCCLUSION_WIDTH = 320;
+const float OCCLUDER_MIN_AREA = 0.5f; // square units: walls, towers and ramparts, no detail
+
+// ray queries against the static castle, left click picks the mesh under the cursor
+// (or at the screen center while the mouse drives the camera)
+gps::SceneBVH sceneBVH;
+const float PICK_DISTANCE = 1000.0f;
+
+// camera moves swept against the same BVH (C or --collision), walking with gravity and steps
+// (V or --walk, space jumps)
+gps::CameraCollider cameraCollider;
+bool cameraCollision = false;
+bool walkMode = false;
+const float CAMERA_RADIUS = 0.25f;
+
+// frustum culling (B or --frustum-culling) through a loose octree of the renderables' meshes in
+// world space; an entity's instances move when its bounds do
+struct IndexedMesh {
+
+    int entity;
+    size_t mesh;
+    int instance;
+};
+gps::SceneIndex sceneIndex;
+bool frustumCulling = false;
+std::vector<IndexedMesh> indexedMeshes;  // by user data of the index instances and BVH mesh id
+std::vector<int> frustumInstances;
+std::vector<bool> meshInView;
+
+// performance HUD (F1 or --hud), drawn over the finished frame
+gps::Hud hud;
+gps::Shader hudShader;
+bool hudVisible = false;
+bool vramEstimate = false;      // --vram, or --hud: follow GL allocations from the start for the HUD
+float frameMilliseconds = 0.0f; // start to start of the last frame, vsync included
+float cpuMilliseconds = 0.0f;   // input, culling and submission of the last frame
+float hudMilliseconds = 0.0f;   // building and submitting the HUD itself
+int culledMeshes = 0;           // meshes skipped by culling in the last frame
+std::vector<gps::GpuScopeStats> hudGpuStats;
+
+#if defined (NDEBUG)
+#define glCheckError() ((void)0)
+#else
 GLenum glCheckError_(const char *file, int line)
 {
 	GLenum errorCode;
@@ -122,16 +278,38 @@ GLenum glCheckError_(const char *file, int line)
 	return errorCode;
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
+#endif
+
+// The stats layer counts while the title, the HUD or the log shows its numbers
+void updateGLStatsEnabled() {
+    gps::GLFrameStats::setEnabled(glStatsOverlay || hudVisible || !glStatsFile.empty());
+}
 
 void windowResizeCallback(GLFWwindow* window, int width, int height) {
     fprintf(stdout, "Window resized! New width: %d , and height: %d\n", width, height);
 
-    glViewport(0, 0, width, height);
+    // the targets follow the framebuffer, which is larger than the window on HiDPI displays
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    if (framebufferWidth == 0 || framebufferHeight == 0) {
+        // minimized, the old targets are kept until the window comes back
+        return;
+    }
+    myWindow.setWindowDimensions(WindowDimensions{ framebufferWidth, framebufferHeight });
+
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
     // update projection matrix
-    projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 1000.0f);
-    // send new projection to shader
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    projection = glm::perspective(glm::radians(45.0f), (float)framebufferWidth / (float)framebufferHeight, 0.1f, 1000.0f);
+    // the new projection is sent to the shaders with the other per frame uniforms
+
+    // the cluster tiles and the Hi-Z pyramid follow the new dimensions on the next frame (the pyramid is
+    // rebuilt at the new size, its readbacks of the old one are dropped); the G-buffer is made again here.
+    // The offscreen scene target only exists in the benchmark and golden runs, which never resize
+    if (deferredShading) {
+        gBuffer.Delete();
+        gBuffer.Create(framebufferWidth, framebufferHeight);
+    }
+    hiZCuller.reset();
 }
 
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
@@ -139,6 +317,81 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
 
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        depthPrePass = !depthPrePass;
+        std::cout << "Depth pre-pass: " << (depthPrePass ? "on" : "off") << std::endl;
+
+        // restart the statistics so the two modes are not mixed in one report
+        gpuProfiler.reset();
+    }
+
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        occlusionCulling = !occlusionCulling;
+        hiZCuller.reset();
+        culledMeshes = 0;
+        std::cout << "Occlusion culling: " << (occlusionCulling ? "on" : "off") << std::endl;
+        gpuProfiler.reset();
+    }
+
+    if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+        softwareOcclusionCulling = !softwareOcclusionCulling;
+        culledMeshes = 0;
+        std::cout << "Software occlusion culling: " << (softwareOcclusionCulling ? "on" : "off") << std::endl;
+        gpuProfiler.reset();
+    }
+
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        frustumCulling = !frustumCulling;
+        culledMeshes = 0;
+        std::cout << "Frustum culling: " << (frustumCulling ? "on" : "off") << std::endl;
+        gpuProfiler.reset();
+    }
+
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        cameraCollision = !cameraCollision;
+        std::cout << "Camera collision: " << (cameraCollision ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        walkMode = !walkMode;
+        cameraCollider.resetWalk();
+        std::cout << "Walk mode: " << (walkMode ? "on" : "off") << std::endl;
+    }
+
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        if (gps::CpuProfiler::isEnabled()) {
+            gps::CpuProfiler::setEnabled(false);
+            gps::CpuProfiler::writeChromeTrace(CPU_TRACE_FILE);
+        } else {
+            gps::CpuProfiler::setEnabled(true);
+            std::cout << "CPU trace: recording" << std::endl;
+        }
+    }
+
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        glStatsOverlay = !glStatsOverlay;
+        if (!glStatsOverlay) {
+            glfwSetWindowTitle(window, WINDOW_TITLE);
+        }
+        updateGLStatsEnabled();
+    }
+
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+        hudVisible = !hudVisible;
+        updateGLStatsEnabled();
+    }
+
+    // lighting features, switching picks another shader variant
+    if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        spotLight = !spotLight;
+    }
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        shadows = !shadows;
+    }
+    if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+        fog = !fog;
+    }
+
     if (key == GLFW_KEY_M && action == GLFW_PRESS) {
         int cursorMode = glfwGetInputMode(window, GLFW_CURSOR);
 
@@ -194,87 +447,92 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
     myCamera.rotate(pitch, yaw);
 
     view = myCamera.getViewMatrix();
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) {
+        return;
+    }
+
+    // window coordinates have y down, NDC has y up
+    glm::vec2 ndc = glm::vec2(0.0f);
+    if (glfwGetInputMode(window, GLFW_CURSOR) == GLFW_CURSOR_NORMAL) {
+        double cursorX;
+        double cursorY;
+        int width;
+        int height;
+        glfwGetCursorPos(window, &cursorX, &cursorY);
+        glfwGetWindowSize(window, &width, &height);
+        ndc = glm::vec2((float)(cursorX / std::max(width, 1)) * 2.0f - 1.0f, 1.0f - (float)(cursorY / std::max(height, 1)) * 2.0f);
+    }
+
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+    gps::RayHit hit;
+    if (!sceneBVH.closestHit(origin, direction, PICK_DISTANCE, hit)) {
+        std::cout << "pick: nothing" << std::endl;
+        return;
+    }
+
+    glm::vec3 point = origin + direction * hit.distance;
+    const IndexedMesh& indexed = indexedMeshes[hit.mesh];
+    std::cout << "pick: " << entities.renderables.get(indexed.entity).name << " mesh " << indexed.mesh
+        << " triangle " << hit.triangle << " at " << hit.distance << " (" << point.x << ", " << point.y << ", " << point.z << ")" << std::endl;
 }
 
 void processInput() {
+    GPS_CPU_SCOPE("processInput");
+    // the move keys add up to one offset, swept against the castle when collision or walking is on
+    glm::vec3 moveOffset = glm::vec3(0.0f);
 	if (pressedKeys[GLFW_KEY_W]) {
-		myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
-		//update view matrix
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
+		moveOffset += myCamera.getMoveOffset(gps::MOVE_FORWARD, cameraSpeed);
 	}
-
 	if (pressedKeys[GLFW_KEY_S]) {
-		myCamera.move(gps::MOVE_BACKWARD, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
+		moveOffset += myCamera.getMoveOffset(gps::MOVE_BACKWARD, cameraSpeed);
 	}
-
 	if (pressedKeys[GLFW_KEY_A]) {
-		myCamera.move(gps::MOVE_LEFT, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
+		moveOffset += myCamera.getMoveOffset(gps::MOVE_LEFT, cameraSpeed);
 	}
-
 	if (pressedKeys[GLFW_KEY_D]) {
-		myCamera.move(gps::MOVE_RIGHT, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
+		moveOffset += myCamera.getMoveOffset(gps::MOVE_RIGHT, cameraSpeed);
 	}
 
-    if (pressedKeys[GLFW_KEY_SPACE]) {
-        myCamera.move(gps::MOVE_UP, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+    glm::vec3 eye = myCamera.getPosition();
+    if (walkMode) {
+        // space jumps instead of flying up, gravity pulls every frame
+        myCamera.setPosition(cameraCollider.walk(eye, moveOffset, CAMERA_RADIUS, pressedKeys[GLFW_KEY_SPACE] != 0,
+            frameMilliseconds / 1000.0f));
+    } else {
+        if (pressedKeys[GLFW_KEY_SPACE]) {
+            moveOffset += myCamera.getMoveOffset(gps::MOVE_UP, cameraSpeed);
+        }
+        if (pressedKeys[GLFW_KEY_LEFT_SHIFT]) {
+            moveOffset += myCamera.getMoveOffset(gps::MOVE_DOWN, cameraSpeed);
+        }
+        if (moveOffset != glm::vec3(0.0f)) {
+            myCamera.setPosition(cameraCollision ? cameraCollider.slide(eye, moveOffset, CAMERA_RADIUS) : eye + moveOffset);
+        }
     }
 
-    if (pressedKeys[GLFW_KEY_LEFT_SHIFT]) {
-        myCamera.move(gps::MOVE_DOWN, cameraSpeed);
+    if (myCamera.getPosition() != eye) {
         //update view matrix
         view = myCamera.getViewMatrix();
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     }
 
     if (pressedKeys[GLFW_KEY_Q]) {
-        angle -= 1.0f;
-        // update model matrix for teapot
-        model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0, 1, 0));
-        // update normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
+        // its world matrix, bounds and index instances follow at the next frame
+        int node = entities.transforms.get(nanosuitEntity).node;
+        sceneGraph.setLocal(node, glm::rotate(sceneGraph.getLocal(node), glm::radians(-1.0f), glm::vec3(0, 1, 0)));
     }
 
     if (pressedKeys[GLFW_KEY_E]) {
-        angle += 1.0f;
-        // update model matrix for teapot
-        model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0, 1, 0));
-        // update normal matrix for teapot
-        normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
+        // its world matrix, bounds and index instances follow at the next frame
+        int node = entities.transforms.get(nanosuitEntity).node;
+        sceneGraph.setLocal(node, glm::rotate(sceneGraph.getLocal(node), glm::radians(1.0f), glm::vec3(0, 1, 0)));
     }
 
     // --- visualization modes ---
@@ -312,13 +570,22 @@ void processInput() {
 }
 
 void initOpenGLWindow() {
-    myWindow.Create(1024, 768, "OpenGL Project Core");
+    // a benchmark or golden run must not wait for the display
+    bool offscreen = benchmarkMode || goldenMode != GOLDEN_OFF;
+    if (gps::GLDispatch::getBackend() == gps::GL_BACKEND_NULL) {
+        // nothing to draw into, the null backend answers every call
+        myWindow.setWindowDimensions(WindowDimensions{ 1024, 768 });
+        return;
+    }
+    myWindow.Create(1024, 768, WINDOW_TITLE, !offscreen, !offscreen, glDebugContext);
+    gps::GLDebug::init(glDebugContext);
 }
 
 void setWindowCallbacks() {
 	glfwSetWindowSizeCallback(myWindow.getWindow(), windowResizeCallback);
     glfwSetKeyCallback(myWindow.getWindow(), keyboardCallback);
     glfwSetCursorPosCallback(myWindow.getWindow(), mouseCallback);
+    glfwSetMouseButtonCallback(myWindow.getWindow(), mouseButtonCallback);
 
     // hide and capture cursor
     glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -341,21 +608,92 @@ void initOpenGLState() {
 }
 
 void initModels() {
+    GPS_CPU_SCOPE("initModels");
     //teapot.LoadModel("models/teapot/teapot20segUT.obj");
-    nanosuit.LoadModel("objects/nanosuit/nanosuit.obj");
-    lightCube.LoadModel("objects/cube/cube.obj");
-    myCastle.LoadModel("objects/castle/castle.obj");
+    // the files are read and decoded as jobs, the GL objects are made here once they are all read
+    gps::JobCounter reads;
+    bool read[3] = { false, false, false };
+    jobSystem.run("read nanosuit", [&read]() { read[0] = nanosuit.ReadModel("objects/nanosuit/nanosuit.obj", &jobSystem); }, &reads);
+    jobSystem.run("read cube", [&read]() { read[1] = lightCube.ReadModel("objects/cube/cube.obj", &jobSystem); }, &reads);
+    jobSystem.run("read castle", [&read]() { read[2] = myCastle.ReadModel("objects/castle/castle.obj", &jobSystem); }, &reads);
     skyboxShader.loadShader("shaders/skyboxShader.vert", "shaders/skyboxShader.frag");
     skyboxShader.useShaderProgram();
+
+    jobSystem.wait(reads);
+    // exits here on the main thread, with every worker idle, rather than inside a job
+    if (!read[0] || !read[1] || !read[2]) {
+        std::cerr << "could not read the models" << std::endl;
+        exit(1);
+    }
+    nanosuit.UploadModel();
+    lightCube.UploadModel();
+    myCastle.UploadModel();
+}
+
+// Feature mask of the lit shaders for the current frame
+unsigned int sceneFeatures() {
+    unsigned int features = 0;
+    if (isFlat) features |= gps::FEATURE_FLAT;
+    if (spotLight) features |= gps::FEATURE_SPOT_LIGHT;
+    if (shadows) features |= gps::FEATURE_SHADOWS;
+    if (fog) features |= gps::FEATURE_FOG;
+    return features;
 }
 
-void initShaders() {
-	myBasicShader.loadShader("shaders/basic.vert", "shaders/basic.frag");
-    lightShader.loadShader("shaders/lightCube.vert", "shaders/lightCube.frag");
-    depthMapShader.loadShader("shaders/depthMap.vert", "shaders/depthMap.frag");
+// Submits every startup shader without waiting for the driver,
+// they compile in parallel while initModels reads the meshes and textures
+void beginShaders() {
+    GPS_CPU_SCOPE("beginShaders");
+    gps::Shader::enableParallelCompile();
+
+    basicShaders.init("shaders/basic.vert", "shaders/basic.frag");
+    // the default look and flat shading, other combinations compile on first use
+    basicShaders.precompile(sceneFeatures());
+    basicShaders.precompile(sceneFeatures() | gps::FEATURE_FLAT);
+
+    std::vector<std::string> noDefines;
+    lightShader.beginLoadShader("shaders/lightCube.vert", "shaders/lightCube.frag", noDefines);
+    depthMapShader.beginLoadShader("shaders/depthMap.vert", "shaders/depthMap.frag", noDefines);
+    depthPrePassShader.beginLoadShader("shaders/depthPrePass.vert", "shaders/depthPrePass.frag", noDefines);
+    hudShader.beginLoadShader("shaders/hud.vert", "shaders/hud.frag", noDefines);
+    hiZDownsampleShader.beginLoadShader("shaders/hizDownsample.vert", "shaders/hizDownsample.frag", noDefines);
+
+    if (deferredShading) {
+        gBufferShaders.init("shaders/basic.vert", "shaders/gbuffer.frag");
+        gBufferShaders.precompile(sceneFeatures());
+        deferredLightingShaders.init("shaders/deferredLighting.vert", "shaders/deferredLighting.frag");
+        deferredLightingShaders.precompile(sceneFeatures());
+    }
+}
+
+// Collects the programs started by beginShaders, only blocks for the ones still compiling
+void finishShaders() {
+    GPS_CPU_SCOPE("finishShaders");
+    basicShaders.finishAll();
+    myBasicShader = basicShaders.getVariant(sceneFeatures());
+
+    std::vector<gps::Shader*> shaders;
+    shaders.push_back(&lightShader);
+    shaders.push_back(&depthMapShader);
+    shaders.push_back(&depthPrePassShader);
+    shaders.push_back(&hudShader);
+    shaders.push_back(&hiZDownsampleShader);
+    gps::Shader::finishBatch(shaders);
+
+    if (deferredShading) {
+        gBufferShaders.finishAll();
+        deferredLightingShaders.finishAll();
+    }
+
+    gps::Shader::printCacheStats();
+    if (gps::Shader::failedLoads > 0) {
+        std::cerr << "could not load the shaders" << std::endl;
+        exit(1);
+    }
 }
 
 void initSkyBox() {
+    GPS_CPU_SCOPE("initSkyBox");
     std::vector<const GLchar*> faces;
     faces.push_back("skybox/right.tga");
     faces.push_back("skybox/left.tga");
@@ -367,51 +705,117 @@ void initSkyBox() {
     mySkyBox.Load(faces);
 }
 
-void initUniforms() {
-	myBasicShader.useShaderProgram();
+// An entity with a transform under the root, the model and its bounds
+int createModelEntity(gps::Model3D& model3D, const std::string& name, const glm::mat4& local, bool staticGeometry) {
+    int entity = entities.create();
+
+    gps::Transform transform = { sceneGraph.addNode(-1, local) };
+    entities.transforms.add(entity, transform);
+
+    gps::Renderable renderable;
+    renderable.model = &model3D;
+    renderable.name = name;
+    renderable.staticGeometry = staticGeometry;
+    renderable.visibleMeshes.assign(model3D.getMeshCount(), true);
+    entities.renderables.add(entity, renderable);
+
+    gps::Bounds bounds;
+    gps::EntityStore::modelBounds(model3D, bounds.localMin, bounds.localMax);
+    bounds.worldMin = bounds.localMin;
+    bounds.worldMax = bounds.localMax;
+    gps::EntityStore::meshBounds(model3D, bounds.meshes);
+    bounds.dirty = true;
+    bounds.moved = false;
+    entities.bounds.add(entity, bounds);
+    return entity;
+}
+
+int createLightEntity(const glm::vec3& position, float radius, const glm::vec3& color) {
+    int entity = entities.create();
+
+    gps::Transform transform = { sceneGraph.addNode(-1, glm::translate(glm::mat4(1.0f), position)) };
+    entities.transforms.add(entity, transform);
+
+    gps::Light light;
+    light.radius = radius;
+    light.color = color;
+    entities.lights.add(entity, light);
+    return entity;
+}
+
+// The systems of a frame, each a loop over one component array: transforms, bounds, lights, draw list.
+// The last three are split into ranges of their array over the jobs
+void updateEntities() {
+    GPS_CPU_SCOPE("updateEntities");
+    sceneGraph.update();
+    jobSystem.parallelFor("updateBounds", entities.bounds.size(), ENTITY_GRAIN_SIZE, [](size_t first, size_t last) {
+        entities.updateBounds(sceneGraph, first, last);
+    });
+
+    pointLights.resize(entities.lights.size());
+    jobSystem.parallelFor("gatherLights", entities.lights.size(), ENTITY_GRAIN_SIZE, [](size_t first, size_t last) {
+        entities.gatherLights(sceneGraph, first, last, pointLights.data());
+    });
+
+    drawList.resize(entities.renderables.size());
+    jobSystem.parallelFor("buildDrawList", entities.renderables.size(), ENTITY_GRAIN_SIZE, [](size_t first, size_t last) {
+        entities.buildDrawList(sceneGraph, first, last, drawList.data());
+    });
+}
 
-    // create model matrix for teapot
-    model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-	modelLoc = glGetUniformLocation(myBasicShader.shaderProgram, "model");
+// The nanosuit and the castles, initPointLights adds the lights; updated so the matrices and bounds
+// are valid before the first frame
+void initEntities() {
+    sceneGraph.clear();
+    entities.clear();
+    nanosuitEntity = createModelEntity(nanosuit, "nanosuit", glm::mat4(1.0f), false);
+
+    for (int i = 0; i < castleCount; i++) {
+        glm::mat4 castleModel = glm::mat4(1.0f);
+        castleModel = glm::translate(castleModel, glm::vec3(CASTLE_SPACING * i, -1.0f, 0.0f)); // Lower it slightly if needed
+        // castleModel = glm::scale(castleModel, glm::vec3(0.5f)); // Enable this if it's still too big
+        createModelEntity(myCastle, i == 0 ? "castle" : "castle " + std::to_string(i + 1), castleModel, true);
+    }
+    updateEntities();
+}
 
+void initUniforms() {
 	// get view matrix for current camera
 	view = myCamera.getViewMatrix();
-	viewLoc = glGetUniformLocation(myBasicShader.shaderProgram, "view");
-	// send view matrix to shader
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-    // compute normal matrix for teapot
-    normalMatrix = glm::mat3(glm::inverseTranspose(view*model));
-	normalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
 
 	// create projection matrix
 	projection = glm::perspective(glm::radians(45.0f),
                                (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
                                0.1f, 1000.0f);
-	projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-	// send projection matrix to shader
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));	
 
 	//set the light direction (direction towards the light)
 	lightDir = glm::vec3(0.0f, 1.0f, 1.0f);
-	lightDirLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightDir");
-	// send light dir to shader
-	glUniform3fv(lightDirLoc, 1, glm::value_ptr(lightDir));
 
 	//set light color
 	lightColor = glm::vec3(1.0f, 1.0f, 1.0f); //white light
-	lightColorLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightColor");
-	// send light color to shader
-	glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
 
     // --- point light ---
     // positioned above the ground here
     pointLightPos = glm::vec3(0.0f, 2.0f, 0.0f);
-    pointLightPosLoc = glGetUniformLocation(myBasicShader.shaderProgram, "pointLightPos");
-    glUniform3fv(pointLightPosLoc, 1, glm::value_ptr(pointLightPos));
 
-    isFlatLoc = glGetUniformLocation(myBasicShader.shaderProgram, "isFlat");
-    glUniform1i(isFlatLoc, isFlat);
+    // the uniforms are sent every frame by setLightingUniforms, whichever shader variant is in use
+}
+
+void initPointLights() {
+    // the original point light, its attenuation is below 1/256 at 90 units
+    createLightEntity(pointLightPos, 90.0f, lightColor);
+
+    // torches scattered over the castle footprint, fixed seed so every run is the same
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xDist(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> yDist(0.0f, 4.0f);
+    std::uniform_real_distribution<float> zDist(-28.0f, 25.0f);
+
+    for (int i = 0; i < torchCount; i++) {
+        createLightEntity(glm::vec3(xDist(rng), yDist(rng), zDist(rng)), 6.0f, glm::vec3(1.0f, 0.6f, 0.25f));
+    }
+
+    lightClusters.init();
 }
 
 void initFBO() {
@@ -444,6 +848,45 @@ void initFBO() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+// Offscreen target for the benchmark, multisampled like the window so the cost is the same
+void initSceneFBO() {
+    int width = myWindow.getWindowDimensions().width;
+    int height = myWindow.getWindowDimensions().height;
+
+    glGenRenderbuffers(1, &sceneColorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneColorRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &sceneDepthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneDepthRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &sceneFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepthRenderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Scene framebuffer is incomplete" << std::endl;
+    }
+}
+
+void initDeferred() {
+    if (!deferredShading) {
+        return;
+    }
+
+    gBuffer.Create(myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+
+    // core profile needs a bound VAO even though the fullscreen triangle has no attributes
+    glGenVertexArrays(1, &fullscreenVAO);
+
+    // every pixel is written by the geometry pass and read by the lighting pass once per frame
+    fprintf(stdout, "Deferred shading: G-buffer %.1f MB (written and read once per frame)\n",
+        gBuffer.getByteSize() / (1024.0 * 1024.0));
+}
+
 glm::mat4 computeLightSpaceTrMatrix() {
     // 1. Light View
     // We position the "light camera" somewhere along the lightDir vector
@@ -466,132 +909,859 @@ glm::mat4 computeLightSpaceTrMatrix() {
     return lightProjection * lightView;
 }
 
-// Draws the Nanosuit and Ground (does not handle shaders/matrices)
-void drawObjects(gps::Shader shader, bool depthPass) {
-    // --- DRAW NANOSUIT ---
+// Draws the draw list (does not handle shaders/matrices)
+// cullOccluded: camera passes skip the meshes cullMeshes found hidden, the shadow pass does not
+void drawObjects(gps::Shader shader, bool depthPass, bool cullOccluded) {
+    GPS_CPU_SCOPE("drawObjects");
+    bool culling = cullOccluded && (occlusionCulling || softwareOcclusionCulling || frustumCulling);
+
     shader.useShaderProgram();
 
-    model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    for (size_t i = 0; i < drawList.size(); i++) {
+        const gps::DrawItem& item = drawList[i];
+        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(*item.world));
 
-    // Only send normal matrix if NOT in depth pass (depth pass doesn't need normals)
-    if (!depthPass) {
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-        glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        // Only send normal matrix if NOT in depth pass (depth pass doesn't need normals)
+        // The view has no scale, so its rotation times the cached world normal matrix is
+        // inverseTranspose(view * model) without inverting anything per draw
+        if (!depthPass) {
+            glm::mat3 normalMatrix = glm::mat3(view) * *item.normal;
+            glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        }
+
+        if (gpuProfiler.drawScopesEnabled) gpuProfiler.beginScope(item.name);
+        if (culling) {
+            item.model->Draw(shader, *item.visibleMeshes);
+        } else {
+            item.model->Draw(shader);
+        }
+        if (gpuProfiler.drawScopesEnabled) gpuProfiler.endScope();
     }
+}
 
-    nanosuit.Draw(shader);
+// Sends the camera, dir light, shadow map and point light clusters to a lit shader variant
+void setLightingUniforms(gps::Shader shader, glm::mat4 lightSpaceTrMatrix, glm::vec3 rotatedLightDir) {
+    GPS_CPU_SCOPE("setLightingUniforms");
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    // --- DRAW CASTLE ---
-    shader.useShaderProgram();
+    // Send Light Space Matrix (for coordinate conversion)
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
 
-    // 1. Position it
-    glm::mat4 castleModel = glm::mat4(1.0f);
-    castleModel = glm::translate(castleModel, glm::vec3(0.0f, -1.0f, 0.0f)); // Lower it slightly if needed
-    // castleModel = glm::scale(castleModel, glm::vec3(0.5f)); // Enable this if it's still too big
+    // Bind Shadow Map Texture to Unit 2
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+    glUniform1i(glGetUniformLocation(shader.shaderProgram, "shadowMap"), 2);
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(castleModel));
+    glUniform3fv(glGetUniformLocation(shader.shaderProgram, "lightDir"), 1, glm::value_ptr(rotatedLightDir));
+    glUniform3fv(glGetUniformLocation(shader.shaderProgram, "lightColor"), 1, glm::value_ptr(lightColor));
 
-    // 2. Normals (Skip for shadow pass)
-    if (!depthPass) {
-        glm::mat3 castleNormal = glm::mat3(glm::inverseTranspose(view * castleModel));
-        glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(castleNormal));
+    lightClusters.bind(shader, 5, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+}
+
+void renderForward(glm::mat4 lightSpaceTrMatrix, glm::vec3 rotatedLightDir) {
+    GPS_CPU_SCOPE("renderForward");
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // -----------------------------------------
+    // OPTIONAL DEPTH PRE-PASS
+    // -----------------------------------------
+    // Lays down the final depth with a position-only shader so the
+    // expensive lit pass only shades the visible fragment of each pixel
+    if (depthPrePass) {
+        gps::GpuScope scope(gpuProfiler, "pre-pass");
+        gps::GLStatsPass statsPass("pre-pass");
+        depthPrePassShader.useShaderProgram();
+        glUniformMatrix4fv(glGetUniformLocation(depthPrePassShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(depthPrePassShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawObjects(depthPrePassShader, true, true);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        // the lit pass only touches fragments matching the pre-pass depth
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
     }
 
-    // 3. Draw
-    myCastle.Draw(shader);
+    gps::GpuScope scope(gpuProfiler, "lit");
+    gps::GLStatsPass statsPass("lit");
+
+    // Pick the variant compiled for the current features
+    // nanosuit and castle are solid, so no variant needs FEATURE_ALPHA_TEST
+    myBasicShader = basicShaders.getVariant(sceneFeatures());
+    myBasicShader.useShaderProgram();
+
+    setLightingUniforms(myBasicShader, lightSpaceTrMatrix, rotatedLightDir);
+
+    // Draw scene with lighting
+    drawObjects(myBasicShader, false, true);
+
+    if (depthPrePass) {
+        // restore the default depth state for the light cube and skybox
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
 }
 
-void renderScene() {
+void renderDeferred(glm::mat4 lightSpaceTrMatrix, glm::vec3 rotatedLightDir) {
+    GPS_CPU_SCOPE("renderDeferred");
+    // -----------------------------------------
+    // GEOMETRY PASS: fill the G-buffer
+    // -----------------------------------------
+    gpuProfiler.beginScope("g-buffer");
+    gps::GLFrameStats::beginPass("g-buffer");
+    gBuffer.bindForWriting();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // the targets hold surface data, blending would corrupt it
+    glDisable(GL_BLEND);
+
+    gps::Shader gBufferShader = gBufferShaders.getVariant(sceneFeatures());
+    gBufferShader.useShaderProgram();
+    glUniformMatrix4fv(glGetUniformLocation(gBufferShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(gBufferShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    drawObjects(gBufferShader, false, true);
+
+    glEnable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    gps::GLFrameStats::endPass();
+    gpuProfiler.endScope();
 
     // -----------------------------------------
-    // STEP 1: RENDER DEPTH MAP (Shadow Pass)
+    // LIGHTING PASS: one fullscreen triangle
     // -----------------------------------------
-    depthMapShader.useShaderProgram();
+    gps::GpuScope scope(gpuProfiler, "lighting");
+    gps::GLStatsPass statsPass("lighting");
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Calculate Matrix
-    glm::mat4 lightSpaceTrMatrix = computeLightSpaceTrMatrix();
+    gps::Shader deferredLightingShader = deferredLightingShaders.getVariant(sceneFeatures());
+    deferredLightingShader.useShaderProgram();
+    setLightingUniforms(deferredLightingShader, lightSpaceTrMatrix, rotatedLightDir);
+    glUniformMatrix4fv(glGetUniformLocation(deferredLightingShader.shaderProgram, "inverseView"), 1, GL_FALSE, glm::value_ptr(glm::inverse(view)));
+    glUniformMatrix4fv(glGetUniformLocation(deferredLightingShader.shaderProgram, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+    gBuffer.bindForReading(deferredLightingShader, 8);
+
+    // the pass writes the G-buffer depth itself through gl_FragDepth
+    glDepthFunc(GL_ALWAYS);
+    glBindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+}
 
-    // Send to depth shader
-    glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
+// Frame times, GPU passes, submission counts and video memory in the top left corner.
+// Rebuilt every frame into one buffer and drawn with one call; the numbers are those of the last frame
+void drawHud() {
+    GPS_CPU_SCOPE("drawHud");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    // Viewport for shadow map resolution
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    // the rolling GPU statistics sort their samples, a few refreshes a second are enough
+    if (hudGpuStats.empty() || gps::GLFrameStats::getFrameIndex() % 15 == 0) {
+        hudGpuStats = gpuProfiler.getStats();
+    }
+
+    const float margin = 6.0f;
+    const float graphHeight = 48.0f;
+    const int textLines = 5 + (int)hudGpuStats.size() + (softwareOcclusionCulling ? 1 : 0) + (cameraCollision || walkMode ? 1 : 0);
+    float lineHeight = hud.getLineHeight();
+    float width = 40 * hud.getCharWidth();
+    float x = 2.0f * margin;
+    float y = 2.0f * margin;
+
+    glm::vec4 white = glm::vec4(1.0f);
+    glm::vec4 grey = glm::vec4(0.75f, 0.75f, 0.75f, 1.0f);
+    char line[128];
+
+    hud.begin(myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+    hud.rect(margin, margin, width + 2.0f * margin, textLines * lineHeight + graphHeight + 3.0f * margin, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+
+    snprintf(line, sizeof(line), "frame %6.2f ms %5.0f fps  cpu %5.2f ms", frameMilliseconds,
+        frameMilliseconds > 0.0f ? 1000.0f / frameMilliseconds : 0.0f, cpuMilliseconds);
+    hud.text(x, y, line, white);
+    y += lineHeight;
+
+    hud.frameGraph(x, y, width, graphHeight);
+    y += graphHeight + margin;
+
+    for (size_t i = 0; i < hudGpuStats.size(); i++) {
+        snprintf(line, sizeof(line), "gpu %-24s %7.3f ms", hudGpuStats[i].name.c_str(), hudGpuStats[i].avgMs);
+        hud.text(x, y, line, grey);
+        y += lineHeight;
+    }
 
-    glCullFace(GL_FRONT); // Render back faces to the shadow map to fix acne
+    gps::GLPassStats total = gps::GLFrameStats::getTotal();
+    int meshCount = 0;
+    for (size_t i = 0; i < drawList.size(); i++) {
+        meshCount += (int)drawList[i].model->getMeshCount();
+    }
+    snprintf(line, sizeof(line), "draws %llu  tris %.1fk  culled %d/%d", (unsigned long long)total.drawCalls,
+        total.triangles / 1000.0, culledMeshes, meshCount);
+    hud.text(x, y, line, white);
+    y += lineHeight;
+
+    if (softwareOcclusionCulling) {
+        snprintf(line, sizeof(line), "  occluders %.3f ms  tests %.3f ms", softwareOcclusion.getRasterMilliseconds(),
+            softwareOcclusion.getTestMilliseconds());
+        hud.text(x, y, line, grey);
+        y += lineHeight;
+    }
 
-    // Draw scene
-    drawObjects(depthMapShader, true);
+    if (cameraCollision || walkMode) {
+        snprintf(line, sizeof(line), "%s %.3f ms  %d tris%s", walkMode ? "walk" : "collision", cameraCollider.getMilliseconds(),
+            cameraCollider.getTestedTriangles(), walkMode && !cameraCollider.isOnGround() ? "  falling" : "");
+        hud.text(x, y, line, grey);
+        y += lineHeight;
+    }
 
-    glCullFace(GL_BACK); // Restore normal culling for the actual render
+    if (gps::GLDispatch::isMemoryTrackingEnabled()) {
+        gps::GLMemoryEstimate memory = gps::GLDispatch::getMemoryEstimate();
+        const double MB = 1024.0 * 1024.0;
+        snprintf(line, sizeof(line), "vram %.1f mb (estimate)",
+            (memory.textureBytes + memory.renderbufferBytes + memory.bufferBytes) / MB);
+        hud.text(x, y, line, white);
+        y += lineHeight;
+        snprintf(line, sizeof(line), "  tex %.1f  rb %.1f  buf %.1f", memory.textureBytes / MB,
+            memory.renderbufferBytes / MB, memory.bufferBytes / MB);
+        hud.text(x, y, line, grey);
+    } else {
+        hud.text(x, y, "vram not tracked (--vram)", grey);
+    }
+    y += lineHeight;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    snprintf(line, sizeof(line), "hud %.3f ms cpu", hudMilliseconds);
+    hud.text(x, y, line, grey);
+
+    hud.Draw(hudShader);
+
+    hudMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Static renderables (the castles) are the occluders, kept in world space
+void initSoftwareOcclusion() {
+    int width = myWindow.getWindowDimensions().width;
+    int height = myWindow.getWindowDimensions().height;
+    softwareOcclusion.Create(SOFTWARE_OCCLUSION_WIDTH, std::max(SOFTWARE_OCCLUSION_WIDTH * height / std::max(width, 1), 1), &jobSystem);
+
+    for (size_t r = 0; r < entities.renderables.size(); r++) {
+        gps::Renderable& renderable = entities.renderables[r];
+        if (!renderable.staticGeometry) {
+            continue;
+        }
+        const glm::mat4& world = entities.getWorld(sceneGraph, entities.renderables.getEntity(r));
+        for (size_t i = 0; i < renderable.model->getMeshCount(); i++) {
+            const gps::Mesh& mesh = renderable.model->getMesh(i);
+            softwareOcclusion.addOccluder(mesh.vertices, mesh.indices, world, OCCLUDER_MIN_AREA);
+        }
+    }
+}
+
+// The meshes of the static renderables, their ids index indexedMeshes
+void initSceneBVH() {
+    for (size_t i = 0; i < indexedMeshes.size(); i++) {
+        gps::Renderable& renderable = entities.renderables.get(indexedMeshes[i].entity);
+        if (!renderable.staticGeometry) {
+            continue;
+        }
+        const gps::Mesh& mesh = renderable.model->getMesh(indexedMeshes[i].mesh);
+        sceneBVH.addMesh(mesh.vertices, mesh.indices, entities.getWorld(sceneGraph, indexedMeshes[i].entity), (int)i);
+    }
+    sceneBVH.build(&jobSystem);
+    cameraCollider.setScene(&sceneBVH);
+
+    std::cout << "scene BVH: " << sceneBVH.getTriangleCount() << " triangles, " << sceneBVH.getNodeCount()
+        << " nodes, built in " << sceneBVH.getBuildMilliseconds() << " ms" << std::endl;
+}
+
+// The mesh world boxes of the entity's Bounds, as updateEntities last computed them
+void indexEntity(int entity) {
+    gps::Bounds& bounds = entities.bounds.get(entity);
+    for (size_t i = 0; i < bounds.meshes.size(); i++) {
+        IndexedMesh indexed = { entity, i, -1 };
+        indexed.instance = sceneIndex.insert(bounds.meshes[i].worldMin, bounds.meshes[i].worldMax, (int)indexedMeshes.size());
+        indexedMeshes.push_back(indexed);
+    }
+}
+
+// Around the castles, whose walls reach about 34 units from their centers
+void initSceneIndex() {
+    float halfRow = CASTLE_SPACING * (castleCount - 1) * 0.5f;
+    sceneIndex.Create(glm::vec3(halfRow, 0.0f, 0.0f), 64.0f + halfRow);
+    for (size_t r = 0; r < entities.renderables.size(); r++) {
+        indexEntity(entities.renderables.getEntity(r));
+    }
+}
+
+// The instances of the entities whose bounds moved since the last call
+void moveIndexedMeshes() {
+    for (size_t i = 0; i < indexedMeshes.size(); i++) {
+        IndexedMesh& indexed = indexedMeshes[i];
+        gps::Bounds& bounds = entities.bounds.get(indexed.entity);
+        if (!bounds.moved) {
+            continue;
+        }
+        sceneIndex.move(indexed.instance, bounds.meshes[indexed.mesh].worldMin, bounds.meshes[indexed.mesh].worldMax);
+    }
+    for (size_t b = 0; b < entities.bounds.size(); b++) {
+        entities.bounds[b].moved = false;
+    }
+}
+
+// Marks the meshes hidden in the newest Hi-Z pyramid, of the rest those out of the view frustum and
+// those behind the software occluders, for the camera passes of this frame
+void cullMeshes() {
+    GPS_CPU_SCOPE("cullMeshes");
+    glm::vec3 eye = myCamera.getPosition();
+    culledMeshes = 0;
+
+    if (occlusionCulling) {
+        hiZCuller.collect();
+        for (size_t i = 0; i < drawList.size(); i++) {
+            culledMeshes += hiZCuller.cullModel(*drawList[i].model, *drawList[i].world, eye, *drawList[i].visibleMeshes);
+        }
+    } else {
+        for (size_t i = 0; i < drawList.size(); i++) {
+            drawList[i].visibleMeshes->assign(drawList[i].model->getMeshCount(), true);
+        }
+    }
+
+    if (frustumCulling) {
+        moveIndexedMeshes();
+        frustumInstances.clear();
+        sceneIndex.queryFrustum(projection * view, frustumInstances);
+        meshInView.assign(indexedMeshes.size(), false);
+        for (size_t i = 0; i < frustumInstances.size(); i++) {
+            meshInView[sceneIndex.getUserData(frustumInstances[i])] = true;
+        }
+
+        for (size_t i = 0; i < indexedMeshes.size(); i++) {
+            std::vector<bool>& visible = entities.renderables.get(indexedMeshes[i].entity).visibleMeshes;
+            if (!meshInView[i] && visible[indexedMeshes[i].mesh]) {
+                visible[indexedMeshes[i].mesh] = false;
+                culledMeshes++;
+            }
+        }
+    }
+
+    if (softwareOcclusionCulling) {
+        softwareOcclusion.render(projection * view);
+        for (size_t i = 0; i < drawList.size(); i++) {
+            culledMeshes += softwareOcclusion.cullModel(*drawList[i].model, *drawList[i].world, *drawList[i].visibleMeshes);
+        }
+    }
+}
+
+void renderScene() {
+    GPS_CPU_SCOPE("renderScene");
+    gpuProfiler.beginFrame();
+    gps::GLFrameStats::beginFrame();
+
+    // transforms, bounds, lights and draw list of this frame, before culling and drawing read them
+    updateEntities();
 
     // -----------------------------------------
-    // STEP 2: RENDER FINAL SCENE
+    // STEP 1: RENDER DEPTH MAP (Shadow Pass)
     // -----------------------------------------
+    // Calculate Matrix
+    glm::mat4 lightSpaceTrMatrix = computeLightSpaceTrMatrix();
 
-    // Reset viewport to window dimensions
-    glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // variants without FEATURE_SHADOWS never sample the map
+    if (shadows) {
+        gps::GpuScope scope(gpuProfiler, "shadow");
+        gps::GLStatsPass statsPass("shadow");
+        depthMapShader.useShaderProgram();
 
-    myBasicShader.useShaderProgram();
+        // Send to depth shader
+        glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
+
+        // Viewport for shadow map resolution
+        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glClear(GL_DEPTH_BUFFER_BIT);
 
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "isFlat"), isFlat);
-    GLint initAlphaLoc = glGetUniformLocation(myBasicShader.shaderProgram, "initAlpha");
+        glCullFace(GL_FRONT); // Render back faces to the shadow map to fix acne
 
-    // --- DRAW NANOSUIT (Solid Object) ---
-    // Disable alpha discard
-    glUniform1i(initAlphaLoc, 0);
+        // Draw scene
+        // casters hidden from the camera still cast shadows
+        drawObjects(depthMapShader, true, false);
 
+        glCullFace(GL_BACK); // Restore normal culling for the actual render
+
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    }
+
+    // -----------------------------------------
+    // STEP 2: RENDER FINAL SCENE
+    // -----------------------------------------
 
     // Update View Matrix (camera)
     view = myCamera.getViewMatrix();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 
-    // Send Light Space Matrix to Basic Shader (for coordinate conversion)
-    glUniformMatrix4fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
-
-    // Bind Shadow Map Texture to Unit 2
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "shadowMap"), 2);
+    if (occlusionCulling || softwareOcclusionCulling || frustumCulling) {
+        cullMeshes();
+    }
 
     // Update Light Direction (Rotating) for lighting calculation
     glm::mat4 lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
     glm::vec3 rotatedLightDir = glm::vec3(lightRotation * glm::vec4(0.0f, 1.0f, 1.0f, 0.0f));
-    glUniform3fv(lightDirLoc, 1, glm::value_ptr(rotatedLightDir));
 
-    // Draw scene with lighting
-    drawObjects(myBasicShader, false);
+    // Bin the point lights for this camera
+    {
+        GPS_CPU_SCOPE("lightClusters");
+        lightClusters.build(pointLights, view, projection, 0.1f, 1000.0f);
+        lightClusters.upload();
+    }
+
+    // Reset viewport to window dimensions (the window or the benchmark target)
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+
+    if (deferredShading) {
+        renderDeferred(lightSpaceTrMatrix, rotatedLightDir);
+    } else {
+        renderForward(lightSpaceTrMatrix, rotatedLightDir);
+    }
 
     // -----------------------------------------
     // DRAW LIGHT CUBE
     // -----------------------------------------
+    gpuProfiler.beginScope("light cube");
+    gps::GLFrameStats::beginPass("light cube");
     lightShader.useShaderProgram();
     glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
     // Position cube at the light source
-    model = lightRotation;
+    glm::mat4 model = lightRotation;
     model = glm::translate(model, glm::vec3(0.0f, 1.0f, 1.0f) * 10.0f); // Same distance as in computeLightSpaceTrMatrix
     model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
     glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
 
     lightCube.Draw(lightShader);
+    gps::GLFrameStats::endPass();
+    gpuProfiler.endScope();
 
+    gpuProfiler.beginScope("skybox");
+    gps::GLFrameStats::beginPass("skybox");
     mySkyBox.Draw(skyboxShader, view, projection);
+    gps::GLFrameStats::endPass();
+    gpuProfiler.endScope();
+
+    // the depth of this frame culls the next ones
+    if (occlusionCulling) {
+        gps::GpuScope scope(gpuProfiler, "hi-z");
+        gps::GLStatsPass statsPass("hi-z");
+        // the benchmark target has a DEPTH_COMPONENT24 renderbuffer, the window 24 bit depth with 8 bit stencil
+        hiZCuller.build(hiZDownsampleShader, sceneFBO, sceneFBO != 0 ? GL_DEPTH_COMPONENT24 : GL_DEPTH24_STENCIL8,
+            myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height, projection * view, myCamera.getPosition());
+    }
+
+    if (hudVisible) {
+        gps::GpuScope scope(gpuProfiler, "hud");
+        gps::GLStatsPass statsPass("hud");
+        drawHud();
+    }
+
+    gps::GLFrameStats::endFrame();
+
+    if (gpuProfiler.endFrame()) {
+        if (deferredShading) {
+            gpuProfiler.printReport("deferred");
+        } else {
+            gpuProfiler.printReport(depthPrePass ? "forward, pre-pass on" : "forward, pre-pass off");
+        }
+        if (gps::GLDispatch::getBackend() == gps::GL_BACKEND_PROFILED) {
+            gps::GLDispatch::printCounters(gpuProfiler.reportInterval);
+            gps::GLDispatch::resetCounters();
+        }
+    }
+}
+
+gps::CameraPose currentCameraPose() {
+    gps::CameraPose pose;
+    pose.position = myCamera.getPosition();
+    pose.yaw = yaw;
+    pose.pitch = pitch;
+    pose.lightAngle = lightAngle;
+    return pose;
+}
+
+void applyCameraPose(const gps::CameraPose& pose) {
+    myCamera.setPosition(pose.position);
+    yaw = pose.yaw;
+    pitch = pose.pitch;
+    myCamera.rotate(pitch, yaw);
+    lightAngle = pose.lightAngle;
+    view = myCamera.getViewMatrix();
+}
+
+void printPathSegments() {
+    std::vector<gps::CameraPathSegment> segments = cameraPath.getSegments();
+    for (size_t i = 0; i < segments.size(); i++) {
+        if (segments[i].timedFrames > 0) {
+            fprintf(stdout, "Camera path segment %-16s frames %5d-%5d: %.3f ms/frame, %.1f meshes culled/frame\n", segments[i].name.c_str(),
+                segments[i].firstFrame, segments[i].firstFrame + segments[i].frameCount - 1,
+                segments[i].totalMilliseconds / segments[i].timedFrames, (double)segments[i].culledMeshes / segments[i].timedFrames);
+        }
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[(size_t)((sorted.size() - 1) * p + 0.5)];
+}
+
+// Renders a fixed number of frames without input and prints the frame times as JSON.
+// Every frame ends with glFinish so a sample is the full CPU + GPU cost of that frame.
+int runBenchmark() {
+    // a camera path sets the length of the run
+    if (playingPath) {
+        benchmarkFrames = cameraPath.getFrameCount();
+    }
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(benchmarkFrames);
+    long long totalCulledMeshes = 0;
+    double occluderMilliseconds = 0.0;
+    double occlusionTestMilliseconds = 0.0;
+
+    for (int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + benchmarkFrames; frame++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        int measuredFrame = frame - BENCHMARK_WARMUP_FRAMES;
+        if (measuredFrame == 0) {
+            gps::GLDispatch::resetCounters();
+        }
+        if (playingPath) {
+            // the warm-up frames look at the start of the path
+            applyCameraPose(cameraPath.getPose(std::max(measuredFrame, 0)));
+        } else {
+            // a slowly rotating light keeps the shadow pass honest, the camera stays put
+            lightAngle = frame * 0.5f;
+        }
+        renderScene();
+        cpuMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (gps::GLDispatch::getBackend() != gps::GL_BACKEND_NULL) {
+            glfwPollEvents();
+        }
+        glFinish();
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        frameMilliseconds = (float)ms;
+        hud.addFrameTime(frameMilliseconds);
+        if (measuredFrame >= 0) {
+            frameTimes.push_back(ms);
+            totalCulledMeshes += culledMeshes;
+            if (softwareOcclusionCulling) {
+                occluderMilliseconds += softwareOcclusion.getRasterMilliseconds();
+                occlusionTestMilliseconds += softwareOcclusion.getTestMilliseconds();
+            }
+            if (playingPath) {
+                cameraPath.addFrameTime(measuredFrame, ms);
+                cameraPath.addCulledMeshes(measuredFrame, culledMeshes);
+            }
+        }
+    }
+
+    glCheckError();
+
+    if (frameTimes.empty()) {
+        std::cerr << "Benchmark: no frames measured" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        sum += sorted[i];
+    }
+
+    // every string goes through writeJsonString, the renderer and the path and segment names come from outside
+    fprintf(stdout, "{\"benchmark\": {\"renderer\": ");
+    gps::writeJsonString(stdout, (const char*)glGetString(GL_RENDERER));
+    fprintf(stdout, ", \"path\": ");
+    gps::writeJsonString(stdout, deferredShading ? "deferred" : "forward");
+    fprintf(stdout, ", \"camera_path\": ");
+    gps::writeJsonString(stdout, playPathFile.c_str());
+    fprintf(stdout, ", \"width\": %d, \"height\": %d, \"torches\": %d, \"castles\": %d, \"job_threads\": %d, \"frames\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, "
+        "\"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"gl_backend\": ",
+        myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height,
+        torchCount, castleCount, jobSystem.getThreadCount(), (int)sorted.size(), sum / sorted.size(), percentile(sorted, 0.50),
+        percentile(sorted, 0.95), percentile(sorted, 0.99), sorted.back());
+    gps::writeJsonString(stdout, gps::GLDispatch::getBackendName());
+    fprintf(stdout, ", \"gl_calls_per_frame\": %.1f, "
+        "\"occlusion_culling\": %s, \"software_occlusion\": %s, \"frustum_culling\": %s, \"occluder_raster_ms\": %.4f, \"occlusion_test_ms\": %.4f, "
+        "\"culled_meshes_per_frame\": %.2f, \"segments\": [",
+        (double)gps::GLDispatch::getTotalCalls() / sorted.size(),
+        occlusionCulling ? "true" : "false", softwareOcclusionCulling ? "true" : "false", frustumCulling ? "true" : "false", occluderMilliseconds / sorted.size(),
+        occlusionTestMilliseconds / sorted.size(), (double)totalCulledMeshes / sorted.size());
+
+    std::vector<gps::CameraPathSegment> segments = cameraPath.getSegments();
+    for (size_t i = 0; i < segments.size(); i++) {
+        fprintf(stdout, "%s{\"name\": ", i > 0 ? ", " : "");
+        gps::writeJsonString(stdout, segments[i].name.c_str());
+        fprintf(stdout, ", \"first_frame\": %d, \"frames\": %d, \"mean_ms\": %.4f, \"culled_meshes_per_frame\": %.2f}",
+            segments[i].firstFrame, segments[i].timedFrames,
+            segments[i].timedFrames > 0 ? segments[i].totalMilliseconds / segments[i].timedFrames : 0.0,
+            segments[i].timedFrames > 0 ? (double)segments[i].culledMeshes / segments[i].timedFrames : 0.0);
+    }
+    fprintf(stdout, "]}}\n");
+
+    // the driver backend does not count, gl_calls_per_frame is 0 then
+    if (gps::GLDispatch::getBackend() != gps::GL_BACKEND_DRIVER) {
+        gps::GLDispatch::printCounters((int)sorted.size());
+    }
+
+    return EXIT_SUCCESS;
+}
+
+struct GoldenView {
+    std::string name;
+    gps::CameraPose pose;
+};
+
+// view <name> <x> <y> <z> <yaw> <pitch> <lightAngle>
+bool loadGoldenViews(std::string fileName, std::vector<GoldenView>& views) {
+    std::ifstream file(fileName.c_str());
+    if (!file.is_open()) {
+        std::cerr << "Could not open " << fileName << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string type;
+        if (!(stream >> type) || type[0] == '#') {
+            continue;
+        }
+
+        GoldenView view;
+        gps::CameraPose& pose = view.pose;
+        if (type != "view" || !(stream >> view.name >> pose.position.x >> pose.position.y >> pose.position.z
+            >> pose.yaw >> pose.pitch >> pose.lightAngle)) {
+            std::cerr << fileName << ": bad line: " << line << std::endl;
+            return false;
+        }
+        views.push_back(view);
+    }
+
+    return !views.empty();
+}
+
+// Compares one read back frame with its golden image, or replaces the golden image
+bool checkGoldenImage(const GoldenView& view, gps::Image& image) {
+    // glReadPixels starts at the bottom row, PNG at the top
+    gps::flipRows(image);
+
+    std::string goldenFile = std::string(GOLDEN_DIRECTORY) + view.name + ".png";
+
+    if (goldenMode == GOLDEN_UPDATE) {
+        bool written = gps::writePNG(goldenFile, image);
+        fprintf(stdout, "Golden %-20s %s\n", view.name.c_str(), written ? "updated" : "NOT WRITTEN");
+        return written;
+    }
+
+    gps::Image golden;
+    if (!gps::readPNG(goldenFile, golden)) {
+        fprintf(stdout, "Golden %-20s FAIL: no %s, run with --update-golden\n", view.name.c_str(), goldenFile.c_str());
+        return false;
+    }
+
+    gps::Image diff;
+    gps::ImageDifference difference = gps::compareImages(golden, image, &diff);
+
+    if (difference.sizeMismatch) {
+        fprintf(stdout, "Golden %-20s FAIL: %dx%d rendered, %dx%d golden\n", view.name.c_str(),
+            image.width, image.height, golden.width, golden.height);
+        return false;
+    }
+
+    bool passed = difference.psnr >= goldenMinPsnr && difference.maxDifference <= goldenMaxDifference;
+    fprintf(stdout, "Golden %-20s %s: PSNR %.2f dB, max diff %d, %d pixels differ\n", view.name.c_str(),
+        passed ? "pass" : "FAIL", difference.psnr, difference.maxDifference, difference.differentPixels);
+
+    if (!passed) {
+        std::string failures = std::string(GOLDEN_DIRECTORY) + "failures/";
+        gps::writePNG(failures + view.name + ".png", image);
+        gps::writePNG(failures + view.name + "_diff.png", diff);
+    }
+
+    return passed;
+}
+
+// Renders every golden viewpoint into sceneFBO. The readbacks are asynchronous: the next views
+// are rendered while earlier ones are copied, and each frame is compared as soon as it arrives.
+int runGolden() {
+    std::vector<GoldenView> views;
+    if (!loadGoldenViews(std::string(GOLDEN_DIRECTORY) + "viewpoints.txt", views)) {
+        return EXIT_FAILURE;
+    }
+
+    frameReadback.Create(myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+
+    int failures = 0;
+    gps::Image image;
+    int tag;
+
+    for (size_t v = 0; v < views.size(); v++) {
+        applyCameraPose(views[v].pose);
+        renderScene();
+
+        // all buffers in flight: the oldest one is the first to be ready
+        if (!frameReadback.request(sceneFBO, (int)v)) {
+            if (frameReadback.collect(image, tag, true) && !checkGoldenImage(views[tag], image)) {
+                failures++;
+            }
+            frameReadback.request(sceneFBO, (int)v);
+        }
+
+        while (frameReadback.collect(image, tag, false)) {
+            if (!checkGoldenImage(views[tag], image)) {
+                failures++;
+            }
+        }
+    }
+
+    while (frameReadback.getPendingCount() > 0) {
+        if (frameReadback.collect(image, tag, true) && !checkGoldenImage(views[tag], image)) {
+            failures++;
+        }
+    }
+
+    frameReadback.Delete();
+    glCheckError();
+
+    if (goldenMode == GOLDEN_CHECK) {
+        fprintf(stdout, "Golden images: %d of %d passed (min PSNR %.1f dB, max diff %d)\n",
+            (int)views.size() - failures, (int)views.size(), goldenMinPsnr, goldenMaxDifference);
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 void cleanup() {
+    if (deferredShading) {
+        gBuffer.Delete();
+    }
+    gpuProfiler.Delete();
+    hud.Delete();
+    hiZCuller.Delete();
+    softwareOcclusion.Delete();
+    jobSystem.Delete();
+    gps::GLDebug::printSummary();
+    if (sceneFBO != 0) {
+        glDeleteFramebuffers(1, &sceneFBO);
+        glDeleteRenderbuffers(1, &sceneColorRenderbuffer);
+        glDeleteRenderbuffers(1, &sceneDepthRenderbuffer);
+    }
     myWindow.Delete();
+
+    gps::GLFrameStats::closeLog();
+
+    if (gps::CpuProfiler::isEnabled()) {
+        gps::CpuProfiler::writeChromeTrace(CPU_TRACE_FILE);
+    }
+
+    // a played path is not recorded again
+    if (!recordPathFile.empty() && playPathFile.empty() && !benchmarkMode && goldenMode == GOLDEN_OFF) {
+        cameraPath.save(recordPathFile);
+    }
     //cleanup code for your own data
 }
 
 int main(int argc, const char * argv[]) {
 
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--torches") == 0 && i + 1 < argc) {
+            torchCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--castles") == 0 && i + 1 < argc) {
+            castleCount = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobThreads = std::max(atoi(argv[++i]), 0);
+        } else if (strcmp(argv[i], "--deferred") == 0) {
+            deferredShading = true;
+        } else if (strcmp(argv[i], "--no-shader-cache") == 0) {
+            gps::Shader::binaryCacheEnabled = false;
+        } else if (strcmp(argv[i], "--profile-draws") == 0) {
+            gpuProfiler.drawScopesEnabled = true;
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkMode = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            benchmarkFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--golden") == 0) {
+            goldenMode = GOLDEN_CHECK;
+        } else if (strcmp(argv[i], "--update-golden") == 0) {
+            goldenMode = GOLDEN_UPDATE;
+        } else if (strcmp(argv[i], "--golden-psnr") == 0 && i + 1 < argc) {
+            goldenMinPsnr = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--golden-max-diff") == 0 && i + 1 < argc) {
+            goldenMaxDifference = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--play-path") == 0 && i + 1 < argc) {
+            playPathFile = argv[++i];
+        } else if (strcmp(argv[i], "--record-path") == 0 && i + 1 < argc) {
+            recordPathFile = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            gps::CpuProfiler::setEnabled(true);
+        } else if (strcmp(argv[i], "--gl-debug") == 0) {
+            glDebugContext = true;
+        } else if (strcmp(argv[i], "--gl-stats") == 0 && i + 1 < argc) {
+            glStatsFile = argv[++i];
+        } else if (strcmp(argv[i], "--null-gl") == 0) {
+            // benchmark without a window or context: GL calls are counted and dropped,
+            // so the frame time is the CPU submission cost alone
+            gps::GLDispatch::setBackend(gps::GL_BACKEND_NULL);
+            benchmarkMode = true;
+        } else if (strcmp(argv[i], "--occlusion-culling") == 0) {
+            occlusionCulling = true;
+        } else if (strcmp(argv[i], "--software-occlusion") == 0) {
+            softwareOcclusionCulling = true;
+        } else if (strcmp(argv[i], "--frustum-culling") == 0) {
+            frustumCulling = true;
+        } else if (strcmp(argv[i], "--collision") == 0) {
+            cameraCollision = true;
+        } else if (strcmp(argv[i], "--walk") == 0) {
+            walkMode = true;
+        } else if (strcmp(argv[i], "--hud") == 0) {
+            hudVisible = true;
+        } else if (strcmp(argv[i], "--vram") == 0) {
+            vramEstimate = true;
+        } else if (strcmp(argv[i], "--gl-profile") == 0) {
+            // the driver, every call counted and timed
+            gps::GLDispatch::setBackend(gps::GL_BACKEND_PROFILED);
+        }
+    }
+
+    if (gps::GLDispatch::getBackend() == gps::GL_BACKEND_NULL && goldenMode != GOLDEN_OFF) {
+        std::cerr << "--null-gl draws nothing, it cannot check golden images" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (gps::GLDispatch::getBackend() == gps::GL_BACKEND_NULL && occlusionCulling) {
+        // the readback would be all zeros and cull everything
+        std::cerr << "--null-gl renders no depth, occlusion culling stays off" << std::endl;
+        occlusionCulling = false;
+    }
+
+    // the golden images are of the scene alone
+    if (goldenMode != GOLDEN_OFF) {
+        hudVisible = false;
+    }
+
+    if (!glStatsFile.empty()) {
+        if (!gps::GLFrameStats::openLog(glStatsFile.c_str())) {
+            return EXIT_FAILURE;
+        }
+    }
+    updateGLStatsEnabled();
+    // every allocation has to be seen, so this cannot wait for F1
+    gps::GLDispatch::setMemoryTrackingEnabled(hudVisible || vramEstimate);
+
+    gps::CpuProfiler::setThreadName("main");
+    jobSystem.Create(jobThreads);
+
     try {
         initOpenGLWindow();
     } catch (const std::exception& e) {
@@ -601,20 +1771,92 @@ int main(int argc, const char * argv[]) {
 
     initOpenGLState();
 	initFBO();
+	beginShaders();
 	initModels();
-	initShaders();
+	finishShaders();
+	initEntities();
 	initUniforms();
+    initPointLights();
+    initDeferred();
+    gpuProfiler.init();
     initSkyBox();
+    hud.Create();
+    initSoftwareOcclusion();
+    initSceneIndex();
+    initSceneBVH();
+
+    if (!playPathFile.empty()) {
+        if (!cameraPath.load(playPathFile)) {
+            cleanup();
+            return EXIT_FAILURE;
+        }
+        playingPath = true;
+    } else if (!recordPathFile.empty()) {
+        cameraPath.clear();
+    }
+
+    if (goldenMode != GOLDEN_OFF) {
+        initSceneFBO();
+        int result = runGolden();
+        cleanup();
+        return result;
+    }
+
+    if (benchmarkMode) {
+        initSceneFBO();
+        int result = runBenchmark();
+        cleanup();
+        return result;
+    }
+
     setWindowCallbacks();
 
 	glCheckError();
+    std::chrono::steady_clock::time_point lastFrameStart = std::chrono::steady_clock::now();
 	// application loop
 	while (!glfwWindowShouldClose(myWindow.getWindow())) {
+        GPS_CPU_SCOPE("frame");
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        frameMilliseconds = std::chrono::duration<float, std::milli>(frameStart - lastFrameStart).count();
+        lastFrameStart = frameStart;
+        hud.addFrameTime(frameMilliseconds);
+
         processInput();
+
+        if (playingPath) {
+            applyCameraPose(cameraPath.getPose(pathFrame));
+        } else if (!recordPathFile.empty()) {
+            cameraPath.addPose(currentCameraPose());
+        }
+
 	    renderScene();
+        cpuMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+        // a few updates a second stay readable
+        if (glStatsOverlay && gps::GLFrameStats::getFrameIndex() % 15 == 0) {
+            std::string title = std::string(WINDOW_TITLE) + " | " + gps::GLFrameStats::getSummary();
+            glfwSetWindowTitle(myWindow.getWindow(), title.c_str());
+        }
 
-		glfwPollEvents();
-		glfwSwapBuffers(myWindow.getWindow());
+        {
+            GPS_CPU_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
+        {
+            GPS_CPU_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(myWindow.getWindow());
+        }
+
+        if (playingPath) {
+            // wall clock frame time, vsync included
+            cameraPath.addFrameTime(pathFrame, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            cameraPath.addCulledMeshes(pathFrame, culledMeshes);
+
+            if (++pathFrame == cameraPath.getFrameCount()) {
+                printPathSegments();
+                playingPath = false; // back to the live camera
+            }
+        }
 
 		glCheckError();
 	}
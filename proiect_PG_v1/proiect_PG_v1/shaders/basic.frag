@@ -3,234 +3,69 @@
 in vec3 fPosition;
 in vec3 fNormal;
 in vec2 fTexCoords;
+#ifdef SHADOWS
 in vec4 fragPosLightSpace;
+#endif
 
 out vec4 fColor;
 
 // Matrices
 uniform mat4 model;
-uniform mat4 view;
 uniform mat3 normalMatrix;
 
-// Lighting Uniforms
-uniform vec3 lightDir; 
-uniform vec3 lightColor;
-uniform vec3 pointLightPos;
-
 // Texture Uniforms
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
-uniform sampler2D shadowMap;
-uniform int initAlpha; // 1 = Check Alpha, 0 = Ignore Alpha
-uniform int isFlat; // 1 = Flat Shading, 0 = Smooth Shading
-
-// Lighting Constants
-vec3 ambient;
-vec3 diffuse;
-vec3 specular;
-float ambientStrength = 0.2f;
-float specularStrength = 0.5f;
-float shininess = 32.0f;
-
-// Attenuation Constants
-float constant = 1.0f;
-float linear = 0.09f;
-float quadratic = 0.032f;
-
-float computeFog()
-{
-    float fogDensity = 0.02f;
-    
-    // Calculate position in View Space (Eye Space)
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    
-    // Calculate distance from camera
-    float fragmentDistance = length(fPosEye.xyz);
-    
-    // Calculate exponential fog factor: e^(-(distance * density)^2)
-    float fogFactor = exp(-pow(fragmentDistance * fogDensity, 2));
-    
-    // Clamp result between 0 and 1
-    return clamp(fogFactor, 0.0f, 1.0f);
-}
-
-float computeShadow()
-{
-    // 1. Perform perspective divide
-    vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    
-    // 2. Transform to [0,1] range
-    normalizedCoords = normalizedCoords * 0.5 + 0.5;
-    
-    // 3. Keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
-    if(normalizedCoords.z > 1.0)
-        return 0.0;
-
-    // 4. Calculate bias (slightly increased to work with PCF)
-    float bias = 0.005f; 
-    float currentDepth = normalizedCoords.z;
 
-    // 5. PCF (Percentage-Closer Filtering) Loop
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0); // dynamic texture size
-    
-    // Sample a 3x3 grid around the current fragment
-    for(int x = -1; x <= 1; ++x)
-    {
-        for(int y = -1; y <= 1; ++y)
-        {
-            float pcfDepth = texture(shadowMap, normalizedCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
-        }    
-    }
-    
-    // Average the results (9 samples)
-    shadow /= 9.0;
-    
-    return shadow;
-}
-
-void computeDirLight()
-{
-    // Calculate eye space positions
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    vec3 viewDir = normalize(-fPosEye.xyz);
-    vec3 normalEye;
-    if (isFlat == 1) {
-        // FLAT SHADING: Compute the normal of the actual triangle geometry
-        // dFdx/dFdy calculate how the position changes across the screen pixels
-        vec3 xTangent = dFdx(fPosEye.xyz);
-        vec3 yTangent = dFdy(fPosEye.xyz);
-        normalEye = normalize(cross(xTangent, yTangent));
-    } else {
-        // SMOOTH SHADING: Use the interpolated vertex normal (Standard)
-        normalEye = normalize(normalMatrix * fNormal);
-    }
-    
-    // Light direction is already in view space if transformed in main.cpp, 
-    // but typically we pass world space lightDir.
-    // Assuming lightDir is World Space, we transform it to View Space:
-    vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
+// Features are compile time defines (see ShaderVariants.hpp):
+// FLAT, ALPHA_TEST, SPOT_LIGHT, SHADOWS, FOG
 
-    // Ambient
-    ambient += ambientStrength * lightColor;
+#include "lighting.glsl"
 
-    // Diffuse
-    float diff = max(dot(normalEye, lightDirN), 0.0f);
-    
-    // Specular
-    vec3 reflectDir = reflect(-lightDirN, normalEye);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
-    
-    // Calculate Shadow
-    float shadow = computeShadow();
-
-    // Modulate Diffuse and Specular
-    diffuse += (1.0f - shadow) * diff * lightColor;
-    specular += (1.0f - shadow) * specularStrength * spec * lightColor;
-}
-
-void computePointLight()
+void main()
 {
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    vec3 viewDir = normalize(-fPosEye.xyz);
-    vec3 normalEye;
-    if (isFlat == 1) {
-        // FLAT SHADING: Compute the normal of the actual triangle geometry
-        // dFdx/dFdy calculate how the position changes across the screen pixels
-        vec3 xTangent = dFdx(fPosEye.xyz);
-        vec3 yTangent = dFdy(fPosEye.xyz);
-        normalEye = normalize(cross(xTangent, yTangent));
-    } else {
-        // SMOOTH SHADING: Use the interpolated vertex normal (Standard)
-        normalEye = normalize(normalMatrix * fNormal);
-    }
-
-    vec4 lightPosEye = view * vec4(pointLightPos, 1.0f);
-    vec3 lightDirN = normalize(lightPosEye.xyz - fPosEye.xyz);
-
-    float dist = length(lightPosEye.xyz - fPosEye.xyz);
-    float att = 1.0 / (constant + linear * dist + quadratic * (dist * dist));
-
-    ambient += (ambientStrength * lightColor) * att;
-
-    float diff = max(dot(normalEye, lightDirN), 0.0f);
-    diffuse += (diff * lightColor) * att;
-
-    vec3 reflectDir = reflect(-lightDirN, normalEye);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
-    specular += (specularStrength * spec * lightColor) * att;
-}
-
-void computeSpotLight()
-{
-    // 1. Get positions in Eye Space
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    vec3 viewDir = normalize(-fPosEye.xyz);
-    vec3 normalEye;
-    if (isFlat == 1) {
-        // FLAT SHADING: Compute the normal of the actual triangle geometry
-        // dFdx/dFdy calculate how the position changes across the screen pixels
-        vec3 xTangent = dFdx(fPosEye.xyz);
-        vec3 yTangent = dFdy(fPosEye.xyz);
-        normalEye = normalize(cross(xTangent, yTangent));
-    } else {
-        // SMOOTH SHADING: Use the interpolated vertex normal (Standard)
-        normalEye = normalize(normalMatrix * fNormal);
-    }
-
-    // 2. Spot Light Logic (Flashlight)
-    // In Eye Space, camera is at (0,0,0) and looks down -Z (0,0,-1)
-    vec3 lightPosEye = vec3(0.0f, 0.0f, 0.0f); // Camera Position
-    vec3 spotDir = vec3(0.0f, 0.0f, -1.0f);    // Camera Front
-    
-    vec3 lightDirN = normalize(lightPosEye - fPosEye.xyz);
-    
-    // Cutoff logic (Cosines of 12.5 and 17.5 degrees)
-    float cutOff = 0.976f;      
-    float outerCutOff = 0.953f; 
-
-    float theta = dot(lightDirN, normalize(-spotDir)); 
-    float epsilon = cutOff - outerCutOff;
-    float intensity = clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
-
-    // Attenuation
-    float dist = length(lightPosEye - fPosEye.xyz);
-    float att = 1.0 / (constant + linear * dist + quadratic * (dist * dist));
-
-    // Apply Flashlight (White Color)
-    ambient += (ambientStrength * vec3(1.0f)) * att * intensity;
-    diffuse += (intensity * att) * max(dot(normalEye, lightDirN), 0.0f) * vec3(1.0f);
-    
-    vec3 reflectDir = reflect(-lightDirN, normalEye);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
-    specular += (intensity * att * specularStrength) * spec * vec3(1.0f);
-}
-
-void main() 
-{
-    // discard fragments
     vec4 colorFromTexture = texture(diffuseTexture, fTexCoords);
-    if(initAlpha == 1 && colorFromTexture.a < 0.1)
+#ifdef ALPHA_TEST
+    // discard fragments
+    if(colorFromTexture.a < 0.1)
         discard;
+#endif
 
     vec3 texDiffuse = colorFromTexture.rgb;
     vec3 texSpecular = texture(specularTexture, fTexCoords).rgb;
 
+    // Calculate eye space position and normal once for every light
+    vec3 fPosEye = vec3(view * model * vec4(fPosition, 1.0f));
+#ifdef FLAT
+    vec3 normalEye = computeFlatNormal(fPosEye);
+#else
+    // SMOOTH SHADING: Use the interpolated vertex normal (Standard)
+    vec3 normalEye = normalize(normalMatrix * fNormal);
+#endif
+
     ambient = vec3(0.0f);
     diffuse = vec3(0.0f);
     specular = vec3(0.0f);
 
-    computeDirLight();
-    computePointLight();
+#ifdef SHADOWS
+    computeDirLight(fPosEye, normalEye, computeShadow(fragPosLightSpace));
+#else
+    computeDirLight(fPosEye, normalEye, 0.0f);
+#endif
+    computeClusteredPointLights(fPosEye, normalEye);
 
-    // computeSpotLight(); // uncomment for Spot Light (from camera)
+#ifdef SPOT_LIGHT
+    computeSpotLight(fPosEye, normalEye); // Spot Light (from camera)
+#endif
 
     vec3 color = min((ambient + diffuse) * texDiffuse + specular * texSpecular, 1.0f);
-    
+
+#ifdef FOG
     // Appy fog
-    float fogFactor = computeFog();
-    vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f); // Gray fog
+    float fogFactor = computeFog(fPosEye);
 
     fColor = mix(fogColor, vec4(color, 1.0f), fogFactor);
-}
\ No newline at end of file
+#else
+    fColor = vec4(color, 1.0f);
+#endif
+}
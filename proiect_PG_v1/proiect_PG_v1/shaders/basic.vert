@@ -7,19 +7,26 @@ layout(location=2) in vec2 vTexCoords;
 out vec3 fPosition;
 out vec3 fNormal;
 out vec2 fTexCoords;
+#ifdef SHADOWS
 out vec4 fragPosLightSpace;
+#endif
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat4 lightSpaceTrMatrix;
 
+// must match depthPrePass.vert so the GL_EQUAL depth test passes
+invariant gl_Position;
+
 void main() 
 {
     gl_Position = projection * view * model * vec4(vPosition, 1.0f);
     fPosition = vPosition;
     fNormal = vNormal;
     fTexCoords = vTexCoords;
-    
+
+#ifdef SHADOWS
     fragPosLightSpace = lightSpaceTrMatrix * model * vec4(vPosition, 1.0f);
+#endif
 }
\ No newline at end of file
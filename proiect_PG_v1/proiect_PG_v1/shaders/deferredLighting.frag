@@ -0,0 +1,70 @@
+#version 410 core
+
+// Fullscreen lighting pass of the deferred path, shades every pixel of the G-buffer once
+// with the same dir light, shadow, clustered point light and fog math as basic.frag
+// SHADOWS, SPOT_LIGHT and FOG are compile time defines (see ShaderVariants.hpp)
+
+in vec2 fTexCoords;
+
+out vec4 fColor;
+
+// G-buffer
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+// Matrices
+uniform mat4 inverseProjection;
+uniform mat4 inverseView;
+uniform mat4 lightSpaceTrMatrix;
+
+#include "gbufferEncoding.glsl"
+#include "lighting.glsl"
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+
+    // nothing was drawn here, leave the pixel to the skybox
+    if (depth == 1.0f)
+        discard;
+
+    // rebuild the eye space position from the depth buffer
+    vec4 ndc = vec4(vec3(fTexCoords, depth) * 2.0f - 1.0f, 1.0f);
+    vec4 posEye = inverseProjection * ndc;
+    vec3 fPosEye = posEye.xyz / posEye.w;
+
+    vec3 normalEye = decodeNormal(texelFetch(gNormal, pixel, 0).xy);
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+
+    ambient = vec3(0.0f);
+    diffuse = vec3(0.0f);
+    specular = vec3(0.0f);
+
+#ifdef SHADOWS
+    vec4 fragPosLightSpace = lightSpaceTrMatrix * inverseView * vec4(fPosEye, 1.0f);
+    computeDirLight(fPosEye, normalEye, computeShadow(fragPosLightSpace));
+#else
+    computeDirLight(fPosEye, normalEye, 0.0f);
+#endif
+    computeClusteredPointLights(fPosEye, normalEye);
+
+#ifdef SPOT_LIGHT
+    computeSpotLight(fPosEye, normalEye);
+#endif
+
+    vec3 color = min((ambient + diffuse) * albedoSpec.rgb + specular * albedoSpec.a, 1.0f);
+
+#ifdef FOG
+    // Appy fog
+    float fogFactor = computeFog(fPosEye);
+
+    fColor = mix(fogColor, vec4(color, 1.0f), fogFactor);
+#else
+    fColor = vec4(color, 1.0f);
+#endif
+
+    // keep the scene depth so the light cube and skybox are still occluded correctly
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,6 @@
+#version 410 core
+
+void main()
+{
+    // color writes are masked off, only depth is written
+}
@@ -0,0 +1,48 @@
+#version 410 core
+
+// G-buffer variant of basic.frag, paired with basic.vert
+// Lighting happens later in deferredLighting.frag
+
+in vec3 fPosition;
+in vec3 fNormal;
+in vec2 fTexCoords;
+
+layout(location = 0) out vec4 gAlbedoSpec; // rgb = diffuse texture, a = specular intensity
+layout(location = 1) out vec2 gNormal;     // octahedral encoded eye space normal
+
+// Matrices
+uniform mat4 model;
+uniform mat4 view;
+uniform mat3 normalMatrix;
+
+// Texture Uniforms
+uniform sampler2D diffuseTexture;
+uniform sampler2D specularTexture;
+
+// Features are compile time defines (see ShaderVariants.hpp), only FLAT and ALPHA_TEST matter here
+
+#include "gbufferEncoding.glsl"
+
+void main()
+{
+    vec4 colorFromTexture = texture(diffuseTexture, fTexCoords);
+#ifdef ALPHA_TEST
+    // discard fragments
+    if(colorFromTexture.a < 0.1)
+        discard;
+#endif
+
+    vec3 texSpecular = texture(specularTexture, fTexCoords).rgb;
+
+#ifdef FLAT
+    // FLAT SHADING: same derivative trick as lighting.glsl, done here before the position is lost
+    vec3 fPosEye = vec3(view * model * vec4(fPosition, 1.0f));
+    vec3 normalEye = normalize(cross(dFdx(fPosEye), dFdy(fPosEye)));
+#else
+    vec3 normalEye = normalize(normalMatrix * fNormal);
+#endif
+
+    // the specular map is stored as a single intensity to keep the target at 32 bits
+    gAlbedoSpec = vec4(colorFromTexture.rgb, dot(texSpecular, vec3(1.0f / 3.0f)));
+    gNormal = encodeNormal(normalEye);
+}
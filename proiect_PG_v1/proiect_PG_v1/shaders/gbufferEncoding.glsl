@@ -0,0 +1,22 @@
+// gbufferEncoding.glsl
+// Octahedral normal encoding for the 2 channel normal target of the G-buffer
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+vec2 encodeNormal(vec3 n)
+{
+    // project on the octahedron, fold the lower half over the upper one
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signNotZero(n.xy);
+}
+
+vec3 decodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f)
+        n.xy = (1.0f - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
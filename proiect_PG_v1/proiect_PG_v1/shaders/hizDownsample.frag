@@ -0,0 +1,28 @@
+#version 410 core
+
+// One texel of the next Hi-Z level: the farthest depth of the 2x2 source texels under it.
+// Sizes are halved rounding down, so the last row and column also take the odd texel left over.
+uniform sampler2D sourceDepth; // the depth copy, then the previous level (red)
+
+out float farthestDepth;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(sourceDepth, 0);
+    ivec2 outputSize = max(sourceSize / 2, ivec2(1));
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    ivec2 first = texel * 2;
+    ivec2 last = first + 1;
+    if (texel.x == outputSize.x - 1) last.x = sourceSize.x - 1;
+    if (texel.y == outputSize.y - 1) last.y = sourceSize.y - 1;
+    last = min(last, sourceSize - 1);
+
+    float depth = 0.0f;
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+            depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), 0).r);
+        }
+    }
+    farthestDepth = depth;
+}
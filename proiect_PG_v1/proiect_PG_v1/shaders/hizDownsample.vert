@@ -0,0 +1,8 @@
+#version 410 core
+
+void main()
+{
+    // fullscreen triangle from the vertex id, no vertex buffer needed
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,14 @@
+#version 410 core
+
+in vec2 fTexCoords;
+in vec4 fColorIn;
+
+out vec4 fColor;
+
+// glyph coverage in red, rectangles sample a solid cell
+uniform sampler2D fontAtlas;
+
+void main() 
+{
+	fColor = vec4(fColorIn.rgb, fColorIn.a * texture(fontAtlas, fTexCoords).r);
+}
@@ -0,0 +1,203 @@
+// lighting.glsl
+// Lighting math shared by the forward (basic.frag) and deferred (deferredLighting.frag) paths.
+// Included through gps::Shader, every function works on eye space position and normal.
+// Optional parts are compiled in by the FLAT, SPOT_LIGHT, SHADOWS and FOG variant defines.
+
+// Matrices
+uniform mat4 view;
+
+// Lighting Uniforms
+uniform vec3 lightDir;
+uniform vec3 lightColor;
+
+// Clustered point lights (see LightClusters.cpp)
+uniform samplerBuffer lightData;     // 2 texels per light: view space position + radius, color
+uniform usamplerBuffer clusterData;  // per cluster: offset into lightIndices, light count
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterGrid;
+uniform vec2 clusterTileScale;       // clusters per pixel
+uniform vec2 clusterDepthParams;     // near plane, depth slices per log unit
+
+#ifdef SHADOWS
+uniform sampler2D shadowMap;
+#endif
+
+// Lighting Constants
+vec3 ambient;
+vec3 diffuse;
+vec3 specular;
+float ambientStrength = 0.2f;
+float specularStrength = 0.5f;
+float shininess = 32.0f;
+
+// Attenuation Constants
+float constant = 1.0f;
+float linear = 0.09f;
+float quadratic = 0.032f;
+
+#ifdef FOG
+vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f); // Gray fog
+
+float computeFog(vec3 fPosEye)
+{
+    float fogDensity = 0.02f;
+
+    // Calculate distance from camera
+    float fragmentDistance = length(fPosEye);
+
+    // Calculate exponential fog factor: e^(-(distance * density)^2)
+    float fogFactor = exp(-pow(fragmentDistance * fogDensity, 2));
+
+    // Clamp result between 0 and 1
+    return clamp(fogFactor, 0.0f, 1.0f);
+}
+#endif
+
+#ifdef SHADOWS
+float computeShadow(vec4 fragPosLightSpace)
+{
+    // 1. Perform perspective divide
+    vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+
+    // 2. Transform to [0,1] range
+    normalizedCoords = normalizedCoords * 0.5 + 0.5;
+
+    // 3. Keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if(normalizedCoords.z > 1.0)
+        return 0.0;
+
+    // 4. Calculate bias (slightly increased to work with PCF)
+    float bias = 0.005f;
+    float currentDepth = normalizedCoords.z;
+
+    // 5. PCF (Percentage-Closer Filtering) Loop
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0); // dynamic texture size
+
+    // Sample a 3x3 grid around the current fragment
+    for(int x = -1; x <= 1; ++x)
+    {
+        for(int y = -1; y <= 1; ++y)
+        {
+            float pcfDepth = texture(shadowMap, normalizedCoords.xy + vec2(x, y) * texelSize).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+
+    // Average the results (9 samples)
+    shadow /= 9.0;
+
+    return shadow;
+}
+#endif
+
+#ifdef FLAT
+// FLAT SHADING: Compute the normal of the actual triangle geometry
+// dFdx/dFdy calculate how the position changes across the screen pixels
+vec3 computeFlatNormal(vec3 fPosEye)
+{
+    vec3 xTangent = dFdx(fPosEye);
+    vec3 yTangent = dFdy(fPosEye);
+    return normalize(cross(xTangent, yTangent));
+}
+#endif
+
+void computeDirLight(vec3 fPosEye, vec3 normalEye, float shadow)
+{
+    vec3 viewDir = normalize(-fPosEye);
+
+    // Assuming lightDir is World Space, we transform it to View Space:
+    vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
+
+    // Ambient
+    ambient += ambientStrength * lightColor;
+
+    // Diffuse
+    float diff = max(dot(normalEye, lightDirN), 0.0f);
+
+    // Specular
+    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
+
+    // Modulate Diffuse and Specular
+    diffuse += (1.0f - shadow) * diff * lightColor;
+    specular += (1.0f - shadow) * specularStrength * spec * lightColor;
+}
+
+void computePointLight(vec3 fPosEye, vec3 normalEye, vec3 lightPosEye, float radius, vec3 pointLightColor)
+{
+    vec3 viewDir = normalize(-fPosEye);
+    vec3 lightDirN = normalize(lightPosEye - fPosEye);
+
+    float dist = length(lightPosEye - fPosEye);
+    float att = 1.0 / (constant + linear * dist + quadratic * (dist * dist));
+
+    // fade out smoothly towards the radius the light was clustered with
+    float window = clamp(1.0f - pow(dist / radius, 4.0f), 0.0f, 1.0f);
+    att *= window * window;
+
+    ambient += (ambientStrength * pointLightColor) * att;
+
+    float diff = max(dot(normalEye, lightDirN), 0.0f);
+    diffuse += (diff * pointLightColor) * att;
+
+    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
+    specular += (specularStrength * spec * pointLightColor) * att;
+}
+
+void computeClusteredPointLights(vec3 fPosEye, vec3 normalEye)
+{
+    // find the cluster of this fragment: screen tile + exponential depth slice
+    float depth = max(-fPosEye.z, clusterDepthParams.x);
+
+    ivec3 cell;
+    cell.xy = ivec2(gl_FragCoord.xy * clusterTileScale);
+    cell.z = int(log(depth / clusterDepthParams.x) * clusterDepthParams.y);
+    cell = clamp(cell, ivec3(0), clusterGrid - 1);
+
+    int clusterIndex = cell.x + clusterGrid.x * (cell.y + clusterGrid.y * cell.z);
+    uvec2 range = texelFetch(clusterData, clusterIndex).xy;
+
+    // only the lights touching this cluster
+    for (uint i = 0u; i < range.y; i++) {
+        int lightIndex = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 posRadius = texelFetch(lightData, 2 * lightIndex);
+        vec3 color = texelFetch(lightData, 2 * lightIndex + 1).rgb;
+        computePointLight(fPosEye, normalEye, posRadius.xyz, posRadius.w, color);
+    }
+}
+
+#ifdef SPOT_LIGHT
+void computeSpotLight(vec3 fPosEye, vec3 normalEye)
+{
+    vec3 viewDir = normalize(-fPosEye);
+
+    // Spot Light Logic (Flashlight)
+    // In Eye Space, camera is at (0,0,0) and looks down -Z (0,0,-1)
+    vec3 lightPosEye = vec3(0.0f, 0.0f, 0.0f); // Camera Position
+    vec3 spotDir = vec3(0.0f, 0.0f, -1.0f);    // Camera Front
+
+    vec3 lightDirN = normalize(lightPosEye - fPosEye);
+
+    // Cutoff logic (Cosines of 12.5 and 17.5 degrees)
+    float cutOff = 0.976f;
+    float outerCutOff = 0.953f;
+
+    float theta = dot(lightDirN, normalize(-spotDir));
+    float epsilon = cutOff - outerCutOff;
+    float intensity = clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
+
+    // Attenuation
+    float dist = length(lightPosEye - fPosEye);
+    float att = 1.0 / (constant + linear * dist + quadratic * (dist * dist));
+
+    // Apply Flashlight (White Color)
+    ambient += (ambientStrength * vec3(1.0f)) * att * intensity;
+    diffuse += (intensity * att) * max(dot(normalEye, lightDirN), 0.0f) * vec3(1.0f);
+
+    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
+    specular += (intensity * att * specularStrength) * spec * vec3(1.0f);
+}
+#endif
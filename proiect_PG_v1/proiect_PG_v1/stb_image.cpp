@@ -1,2 +1,39 @@
+// stb_image allocates with malloc, which the operator new counting of loaderBench never sees;
+// its allocations go through these counters instead (relaxed atomics, a handful per image)
+#include <atomic>
+#include <cstdlib>
+
+namespace gps {
+
+    static std::atomic<size_t> imageAllocations(0);
+    static std::atomic<size_t> imageAllocatedBytes(0);
+
+    static void* countedMalloc(size_t size) {
+
+        imageAllocations.fetch_add(1, std::memory_order_relaxed);
+        imageAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        return malloc(size);
+    }
+
+    static void* countedRealloc(void* p, size_t size) {
+
+        imageAllocations.fetch_add(1, std::memory_order_relaxed);
+        imageAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        return realloc(p, size);
+    }
+
+    size_t imageAllocationCount() {
+        return imageAllocations.load(std::memory_order_relaxed);
+    }
+
+    size_t imageAllocationBytes() {
+        return imageAllocatedBytes.load(std::memory_order_relaxed);
+    }
+}
+
+#define STBI_MALLOC(size)       gps::countedMalloc(size)
+#define STBI_REALLOC(p, size)   gps::countedRealloc(p, size)
+#define STBI_FREE(p)            free(p)
+
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
@@ -0,0 +1,545 @@
+// gps_tests.cpp
+// Checks of the engine pieces that run without a GL context: the scene index, scene graph,
+// entity store, job system, BVH and camera collision, software occlusion, light clustering and
+// the image comparison of the golden tests and the JSON string escaping. Prints every failed check and exits with 1 if any failed.
+// ctest runs it from the build directory, it needs no assets.
+
+#include "../CameraCollider.hpp"
+#include "../EntityStore.hpp"
+#include "../ImageCompare.hpp"
+#include "../JobSystem.hpp"
+#include "../JsonWriter.hpp"
+#include "../LightClusters.hpp"
+#include "../SceneBVH.hpp"
+#include "../SceneGraph.hpp"
+#include "../SceneIndex.hpp"
+#include "../SoftwareOcclusion.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(const char* name, bool condition) {
+
+    if (!condition) {
+        printf("check failed: %s\n", name);
+        failures++;
+    }
+}
+
+static bool near(float value, float expected) {
+
+    return std::fabs(value - expected) < 0.001f;
+}
+
+static bool near(const glm::vec3& value, const glm::vec3& expected) {
+
+    return near(value.x, expected.x) && near(value.y, expected.y) && near(value.z, expected.z);
+}
+
+// Two triangles a b c, a c d
+static void quad(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d,
+    std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices) {
+
+    GLuint first = (GLuint)vertices.size();
+    const glm::vec3 corners[4] = { a, b, c, d };
+    for (int i = 0; i < 4; i++) {
+        gps::Vertex vertex;
+        vertex.Position = corners[i];
+        vertex.Normal = glm::vec3(0.0f);
+        vertex.TexCoords = glm::vec2(0.0f);
+        vertices.push_back(vertex);
+    }
+    const GLuint order[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int i = 0; i < 6; i++) {
+        indices.push_back(first + order[i]);
+    }
+}
+
+// A 10 x 10 wall at z = 0
+static void wall(std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices) {
+
+    quad(glm::vec3(-5.0f, -5.0f, 0.0f), glm::vec3(5.0f, -5.0f, 0.0f), glm::vec3(5.0f, 5.0f, 0.0f), glm::vec3(-5.0f, 5.0f, 0.0f),
+        vertices, indices);
+}
+
+static std::set<int> userData(gps::SceneIndex& index, const std::vector<int>& instances) {
+
+    std::set<int> result;
+    for (size_t i = 0; i < instances.size(); i++) {
+        result.insert(index.getUserData(instances[i]));
+    }
+    return result;
+}
+
+static void testSceneIndex() {
+
+    gps::SceneIndex index;
+    index.Create(glm::vec3(0.0f), 100.0f);
+
+    int small = index.insert(glm::vec3(9.5f, -0.5f, -0.5f), glm::vec3(10.5f, 0.5f, 0.5f), 1);
+    int far = index.insert(glm::vec3(-51.0f, -1.0f, -1.0f), glm::vec3(-49.0f, 1.0f, 1.0f), 2);
+    index.insert(glm::vec3(-90.0f, -1.0f, -1.0f), glm::vec3(90.0f, 1.0f, 1.0f), 3);
+    index.insert(glm::vec3(199.0f, -1.0f, -1.0f), glm::vec3(201.0f, 1.0f, 1.0f), 4);  // outside the world cube
+    check("scene index counts its instances", index.getInstanceCount() == 4);
+
+    std::vector<int> found;
+    index.querySphere(glm::vec3(10.0f, 3.0f, 0.0f), 3.0f, found);
+    check("sphere finds the boxes it touches", userData(index, found) == std::set<int>({ 1, 3 }));
+
+    found.clear();
+    index.queryRay(glm::vec3(-100.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 400.0f, found);
+    check("ray finds every box along it", userData(index, found) == std::set<int>({ 1, 2, 3, 4 }));
+
+    found.clear();
+    index.queryRay(glm::vec3(-100.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 60.0f, found);
+    check("ray stops at its length", userData(index, found) == std::set<int>({ 2, 3 }));
+
+    glm::mat4 view = glm::lookAt(glm::vec3(10.0f, 0.0f, 20.0f), glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    found.clear();
+    index.queryFrustum(projection * view, found);
+    check("frustum finds the boxes in view", userData(index, found) == std::set<int>({ 1, 3 }));
+
+    // behind the camera
+    index.move(small, glm::vec3(9.5f, -0.5f, 29.5f), glm::vec3(10.5f, 0.5f, 30.5f));
+    glm::vec3 boundsMin, boundsMax;
+    index.getBounds(small, boundsMin, boundsMax);
+    check("moved box keeps its new bounds", near(boundsMin, glm::vec3(9.5f, -0.5f, 29.5f)));
+    found.clear();
+    index.queryFrustum(projection * view, found);
+    check("moved box leaves the frustum", userData(index, found) == std::set<int>({ 3 }));
+
+    index.remove(far);
+    found.clear();
+    index.queryRay(glm::vec3(-100.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 400.0f, found);
+    check("removed box is not found", userData(index, found) == std::set<int>({ 3, 4 }));
+    check("removed box is not counted", index.getInstanceCount() == 3);
+
+    index.clear();
+    found.clear();
+    index.querySphere(glm::vec3(0.0f), 1000.0f, found);
+    check("cleared index is empty", found.empty() && index.getInstanceCount() == 0);
+}
+
+static void testSceneGraph() {
+
+    gps::SceneGraph graph;
+    int root = graph.addNode(-1, glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
+    int child = graph.addNode(root, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 0.0f)));
+    int other = graph.addNode(-1, glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 1.0f, 1.0f)));
+
+    check("first update computes every node", graph.update() == 3);
+    check("child world is the parent's times its own",
+        near(glm::vec3(graph.getWorld(child)[3]), glm::vec3(1.0f, 2.0f, 0.0f)));
+    check("normal matrix is the inverse transpose", near(graph.getNormal(other)[0][0], 0.5f)
+        && near(graph.getNormal(other)[1][1], 1.0f));
+    check("parent is kept", graph.getParent(child) == root && graph.getParent(root) == -1);
+
+    check("nothing changed, nothing recomputed", graph.update() == 0 && !graph.wasUpdated(root));
+
+    graph.setLocal(root, glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.0f, 0.0f)));
+    check("a moved parent recomputes its child", graph.update() == 2);
+    check("the child follows", graph.wasUpdated(child) && near(glm::vec3(graph.getWorld(child)[3]), glm::vec3(3.0f, 2.0f, 0.0f)));
+    check("the other root is untouched", !graph.wasUpdated(other));
+
+    graph.setLocal(child, glm::mat4(1.0f));
+    check("a moved leaf recomputes itself alone", graph.update() == 1 && !graph.wasUpdated(root));
+}
+
+static void testEntityStore() {
+
+    gps::ComponentArray<int> components;
+    components.add(0, 10);
+    components.add(1, 11);
+    components.add(2, 12);
+    components.remove(0);
+    check("remove moves the last component into the gap", components.size() == 2 && components.getEntity(0) == 2
+        && components.get(2) == 12 && components.get(1) == 11 && !components.has(0));
+
+    gps::EntityStore store;
+    int first = store.create();
+    int second = store.create();
+    store.destroy(first);
+    check("freed ids are given out again", store.create() == first && store.create() == second + 1);
+
+    gps::SceneGraph graph;
+    int entity = store.create();
+    gps::Transform transform;
+    transform.node = graph.addNode(-1, glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f)));
+    store.transforms.add(entity, transform);
+
+    gps::Bounds box;
+    box.localMin = glm::vec3(-1.0f);
+    box.localMax = glm::vec3(1.0f);
+    gps::MeshBounds mesh;
+    mesh.localMin = glm::vec3(0.0f);
+    mesh.localMax = glm::vec3(1.0f);
+    box.meshes.push_back(mesh);
+    box.dirty = true;
+    box.moved = false;
+    store.bounds.add(entity, box);
+
+    gps::Light light;
+    light.radius = 4.0f;
+    light.color = glm::vec3(1.0f, 0.5f, 0.25f);
+    store.lights.add(entity, light);
+
+    graph.update();
+    check("bounds follow the node", store.updateBounds(graph, 0, store.bounds.size()) == 1);
+    gps::Bounds& updated = store.bounds.get(entity);
+    check("world box is the moved local box", near(updated.worldMin, glm::vec3(4.0f, -1.0f, -1.0f))
+        && near(updated.worldMax, glm::vec3(6.0f, 1.0f, 1.0f)) && updated.moved);
+    check("mesh boxes move with it", near(updated.meshes[0].worldMin, glm::vec3(5.0f, 0.0f, 0.0f))
+        && near(updated.meshes[0].worldMax, glm::vec3(6.0f, 1.0f, 1.0f)));
+
+    graph.update();
+    check("still bounds are skipped", store.updateBounds(graph, 0, store.bounds.size()) == 0);
+
+    gps::PointLight gathered;
+    store.gatherLights(graph, 0, 1, &gathered);
+    check("light sits at the entity", near(gathered.position, glm::vec3(5.0f, 0.0f, 0.0f)) && gathered.radius == 4.0f);
+
+    int loose = store.create();
+    const glm::mat4& looseWorld = store.getWorld(graph, loose);
+    check("entity without a transform is at the origin", near(glm::vec3(looseWorld[3]), glm::vec3(0.0f))
+        && near(glm::vec3(looseWorld[0]), glm::vec3(1.0f, 0.0f, 0.0f)));
+
+    glm::vec3 worldMin, worldMax;
+    gps::EntityStore::transformBox(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+        glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(2.0f, 1.0f, 1.0f), worldMin, worldMax);
+    check("rotated box is bounded again", near(worldMin, glm::vec3(0.0f, 0.0f, -2.0f)) && near(worldMax, glm::vec3(1.0f, 1.0f, 0.0f)));
+
+    store.destroy(entity);
+    check("destroy removes the components", !store.transforms.has(entity) && !store.bounds.has(entity) && !store.lights.has(entity));
+}
+
+static void testJobSystem() {
+
+    gps::JobSystem jobs;
+    jobs.Create(4);
+    check("job system has its threads", jobs.getThreadCount() == 4);
+
+    std::vector<int> squares(10000, 0);
+    jobs.parallelFor("test", squares.size(), 64, [&squares](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            squares[i] = (int)(i * i % 1000);
+        }
+    });
+    bool all = true;
+    for (size_t i = 0; i < squares.size(); i++) {
+        all &= squares[i] == (int)(i * i % 1000);
+    }
+    check("parallelFor covers every index once", all);
+
+    // the second job may only start once every first one is done
+    std::atomic<int> firstDone(0);
+    int seenBySecond = -1;
+    gps::JobCounter firsts, second;
+    for (int i = 0; i < 100; i++) {
+        jobs.run("first", [&firstDone] { firstDone++; }, &firsts);
+    }
+    jobs.run("second", [&firstDone, &seenBySecond] { seenBySecond = firstDone.load(); }, &second, &firsts);
+    jobs.wait(second);
+    check("dependent job runs after its dependency", seenBySecond == 100 && firsts.isDone() && second.isDone());
+
+    // nested jobs waited for from inside a job
+    std::atomic<int> leaves(0);
+    gps::JobCounter outer;
+    for (int i = 0; i < 8; i++) {
+        jobs.run("outer", [&jobs, &leaves] {
+            gps::JobCounter inner;
+            for (int j = 0; j < 8; j++) {
+                jobs.run("inner", [&leaves] { leaves++; }, &inner);
+            }
+            jobs.wait(inner);
+        }, &outer);
+    }
+    jobs.wait(outer);
+    check("nested jobs all run", leaves.load() == 64);
+
+    jobs.Delete();
+
+    gps::JobSystem single;
+    single.Create(1);
+    int sum = 0;
+    single.parallelFor("single", 100, 1, [&sum](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            sum += (int)i;
+        }
+    });
+    check("one thread runs everything itself", sum == 4950);
+    single.Delete();
+}
+
+static void testSceneBVH() {
+
+    // a grid of 64 x 64 quads at z = 0 and a wall of 2 x 2 at z = 2 in front of its center
+    std::vector<gps::Vertex> vertices;
+    std::vector<GLuint> indices;
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            quad(glm::vec3(x - 32.0f, y - 32.0f, 0.0f), glm::vec3(x - 31.0f, y - 32.0f, 0.0f),
+                glm::vec3(x - 31.0f, y - 31.0f, 0.0f), glm::vec3(x - 32.0f, y - 31.0f, 0.0f), vertices, indices);
+        }
+    }
+    std::vector<gps::Vertex> wallVertices;
+    std::vector<GLuint> wallIndices;
+    quad(glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f),
+        wallVertices, wallIndices);
+
+    gps::SceneBVH serial, parallel;
+    gps::SceneBVH* trees[2] = { &serial, &parallel };
+    for (int t = 0; t < 2; t++) {
+        trees[t]->addMesh(vertices, indices, glm::mat4(1.0f), 7);
+        trees[t]->addMesh(wallVertices, wallIndices, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f)), 8);
+    }
+
+    gps::JobSystem jobs;
+    jobs.Create(4);
+    serial.build(nullptr);
+    parallel.build(&jobs);
+    jobs.Delete();
+
+    check("BVH holds every triangle", serial.getTriangleCount() == 64 * 64 * 2 + 2 && parallel.getTriangleCount() == serial.getTriangleCount());
+
+    gps::RayHit hit;
+    check("ray hits the nearest surface", serial.closestHit(glm::vec3(0.5f, 0.25f, 10.0f), glm::vec3(0.0f, 0.0f, -2.0f), 100.0f, hit)
+        && hit.mesh == 8 && near(hit.distance, 4.0f));
+    check("ray past the wall hits the grid", serial.closestHit(glm::vec3(10.5f, 0.25f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f), 100.0f, hit)
+        && hit.mesh == 7 && near(hit.distance, 10.0f));
+    check("ray pointing away misses", !serial.closestHit(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, 1.0f), 100.0f, hit));
+    check("short ray is not blocked", !serial.anyHit(glm::vec3(10.5f, 0.25f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f), 9.0f));
+    check("long ray is blocked", serial.anyHit(glm::vec3(10.5f, 0.25f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f), 11.0f));
+
+    // the jobs split the build differently but have to find the same hits
+    int differences = 0;
+    for (int i = 0; i < 1000; i++) {
+        glm::vec3 origin(std::sin(i * 0.37f) * 30.0f, std::cos(i * 0.53f) * 30.0f, 5.0f + (i % 7));
+        glm::vec3 direction(std::sin(i * 0.11f) * 0.5f, std::cos(i * 0.17f) * 0.5f, -1.0f);
+        gps::RayHit a, b;
+        bool hitA = serial.closestHit(origin, direction, 100.0f, a);
+        bool hitB = parallel.closestHit(origin, direction, 100.0f, b);
+        differences += hitA != hitB || (hitA && (a.mesh != b.mesh || a.triangle != b.triangle || !near(a.distance, b.distance)));
+    }
+    check("parallel build finds the same hits", differences == 0);
+
+    std::vector<glm::vec3> corners;
+    serial.collectTriangles(glm::vec3(-31.5f, -31.5f, -0.5f), glm::vec3(-31.25f, -31.25f, 0.5f), corners);
+    check("box collects the triangles under it", corners.size() == 2 * 3);
+}
+
+static void testCameraCollider() {
+
+    const float radius = 0.25f;
+
+    std::vector<gps::Vertex> vertices;
+    std::vector<GLuint> indices;
+    wall(vertices, indices);
+    gps::SceneBVH scene;
+    scene.addMesh(vertices, indices, glm::mat4(1.0f), 0);
+    scene.build(nullptr);
+
+    gps::CameraCollider collider;
+    collider.setScene(&scene);
+    glm::vec3 end = collider.slide(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -3.0f), radius);
+    check("sphere stops at the wall", std::fabs(end.z - radius) < 0.01f && near(end.x, 0.0f));
+    end = collider.slide(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(-2.0f, 0.0f, -3.0f), radius);
+    check("sphere slides along the wall", std::fabs(end.z - radius) < 0.01f && std::fabs(end.x + 2.0f) < 0.01f);
+    end = collider.slide(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 1.0f), radius);
+    check("free move is not changed", near(end, glm::vec3(0.0f, 0.0f, 3.0f)));
+
+    collider.setScene(nullptr);
+    end = collider.slide(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -3.0f), radius);
+    check("without a scene nothing blocks", near(end, glm::vec3(0.0f, 0.0f, -1.0f)));
+}
+
+static void testSoftwareOcclusion() {
+
+    std::vector<gps::Vertex> vertices;
+    std::vector<GLuint> indices;
+    wall(vertices, indices);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 256.0f / 128.0f, 0.1f, 1000.0f);
+    glm::mat4 identity(1.0f);
+
+    gps::JobSystem jobs;
+    jobs.Create(4);
+
+    // the same answers with the jobs and on the calling thread alone
+    gps::JobSystem* runners[2] = { &jobs, nullptr };
+    for (int r = 0; r < 2; r++) {
+
+        gps::SoftwareOcclusion occlusion;
+        occlusion.Create(256, 128, runners[r]);
+        check("occlusion uses the job threads", occlusion.getThreadCount() == (runners[r] ? 4 : 1));
+        occlusion.addOccluder(vertices, indices, identity, 0.0f);
+        check("occluder triangles are kept", occlusion.getOccluderTriangleCount() == 2);
+        occlusion.render(projection * view);
+
+        check("box behind the wall is culled",
+            occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, -3.0f), glm::vec3(1.0f, 1.0f, -1.0f), identity));
+        check("box in front of the wall is drawn",
+            !occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 3.0f), identity));
+        check("box beside the wall is drawn",
+            !occlusion.isOccluded(glm::vec3(6.0f, -1.0f, -3.0f), glm::vec3(7.0f, 1.0f, -1.0f), identity));
+        check("box reaching past the edge is drawn",
+            !occlusion.isOccluded(glm::vec3(4.0f, -1.0f, -3.0f), glm::vec3(5.5f, 1.0f, -1.0f), identity));
+        check("wall depth is written at the center", occlusion.getDepth(128, 64) < 1.0f);
+
+        occlusion.clearOccluders();
+        occlusion.render(projection * view);
+        check("without occluders nothing is culled",
+            !occlusion.isOccluded(glm::vec3(-1.0f, -1.0f, -3.0f), glm::vec3(1.0f, 1.0f, -1.0f), identity));
+        occlusion.Delete();
+    }
+
+    jobs.Delete();
+}
+
+static void testLightClusters() {
+
+    glm::mat4 view(1.0f);  // at the origin looking down -Z
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+
+    gps::LightClusters clusters;
+    std::vector<gps::PointLight> lights;
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    check("no lights, no indices", clusters.getLightCount() == 0 && clusters.getIndexCount() == 0);
+
+    gps::PointLight light;
+    light.color = glm::vec3(1.0f);
+    light.radius = 1.0f;
+    light.position = glm::vec3(0.0f, 0.0f, 10.0f);
+    lights.push_back(light);
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    check("light behind the camera is dropped", clusters.getLightCount() == 0 && clusters.getIndexCount() == 0);
+
+    lights[0].position = glm::vec3(0.0f, 0.0f, -10.0f);
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    int smallIndices = clusters.getIndexCount();
+    check("light in view is kept in a few clusters", clusters.getLightCount() == 1
+        && smallIndices > 0 && smallIndices < gps::LightClusters::CLUSTER_COUNT / 10);
+
+    lights[0].position = glm::vec3(0.0f);
+    lights[0].radius = 5000.0f;
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    check("light around the camera is in every cluster", clusters.getIndexCount() == gps::LightClusters::CLUSTER_COUNT);
+
+    // 300 lights around the camera overflow every cluster, which keeps 256
+    lights.assign(300, lights[0]);
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    check("clusters are capped", clusters.getLightCount() == 300
+        && clusters.getIndexCount() == 256 * gps::LightClusters::CLUSTER_COUNT);
+
+    // a rebuild starts over
+    lights.assign(1, light);
+    lights[0].position = glm::vec3(0.0f, 0.0f, -10.0f);
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    check("rebuild forgets the old lights", clusters.getLightCount() == 1 && clusters.getIndexCount() == smallIndices);
+
+    // a texture buffer of 1000 texels holds 500 lights and 1000 indices
+    lights[0].radius = 5000.0f;
+    lights.assign(600, lights[0]);
+    clusters.setMaxTexels(1000);
+    clusters.build(lights, view, projection, 0.1f, 1000.0f);
+    check("light data and indices fit the texture buffers", clusters.getLightCount() == 500
+        && clusters.getIndexCount() == 1000);
+}
+
+static gps::Image testImage(int width, int height) {
+
+    gps::Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        image.pixels[i] = (unsigned char)(i * 37 % 256);
+    }
+    return image;
+}
+
+static void testImageCompare() {
+
+    gps::Image image = testImage(5, 3);
+
+    const char* fileName = "gps_tests_image.png";
+    gps::Image read;
+    check("PNG is written", gps::writePNG(fileName, image));
+    check("PNG is read back", gps::readPNG(fileName, read));
+    check("PNG keeps every pixel", read.width == 5 && read.height == 3 && read.pixels == image.pixels);
+    remove(fileName);
+    check("missing file is not read", !gps::readPNG(fileName, read));
+
+    gps::ImageDifference same = gps::compareImages(image, image, nullptr);
+    check("identical images have infinite PSNR", std::isinf(same.psnr) && same.differentPixels == 0 && same.maxDifference == 0);
+
+    gps::Image changed = image;
+    changed.pixels[4 * 7 + 1] = (unsigned char)(changed.pixels[4 * 7 + 1] ^ 8);
+    changed.pixels[4 * 9 + 3] = (unsigned char)(changed.pixels[4 * 9 + 3] ^ 255);  // alpha is ignored
+    gps::Image diff;
+    gps::ImageDifference one = gps::compareImages(image, changed, &diff);
+    check("one changed pixel is found", one.differentPixels == 1 && one.maxDifference == 8 && !one.sizeMismatch);
+    check("PSNR of one changed channel", std::fabs(one.psnr - 10.0 * std::log10(255.0 * 255.0 * 45.0 / 64.0)) < 1e-6);
+    check("diff image marks the pixel in red", diff.width == 5 && diff.pixels[4 * 7] == 64 + 8 * 4 && diff.pixels[4 * 7 + 1] == 0
+        && diff.pixels[4 * 9 + 1] == diff.pixels[4 * 9]);
+
+    gps::ImageDifference mismatch = gps::compareImages(image, testImage(3, 5), nullptr);
+    check("different sizes are reported", mismatch.sizeMismatch);
+
+    gps::Image flipped = image;
+    gps::flipRows(flipped);
+    check("flip swaps the rows", std::equal(flipped.pixels.begin(), flipped.pixels.begin() + 20, image.pixels.begin() + 40)
+        && std::equal(flipped.pixels.begin() + 20, flipped.pixels.begin() + 40, image.pixels.begin() + 20));
+    gps::flipRows(flipped);
+    check("flipping twice restores the image", flipped.pixels == image.pixels);
+}
+
+static void testJsonWriter() {
+
+    FILE* file = tmpfile();
+    if (!file) {
+        check("temporary file for the JSON strings", false);
+        return;
+    }
+    gps::writeJsonString(file, "plain");
+    gps::writeJsonString(file, "a \"quoted\" C:\\path\n\tend");
+    gps::writeJsonString(file, nullptr);
+
+    char written[128] = { 0 };
+    rewind(file);
+    size_t length = fread(written, 1, sizeof(written) - 1, file);
+    fclose(file);
+    check("JSON strings are quoted and escaped", std::string(written, length)
+        == "\"plain\"\"a \\\"quoted\\\" C:\\\\path\\u000a\\u0009end\"\"\"");
+}
+
+int main() {
+
+    testSceneIndex();
+    testSceneGraph();
+    testEntityStore();
+    testJobSystem();
+    testSceneBVH();
+    testCameraCollider();
+    testSoftwareOcclusion();
+    testLightClusters();
+    testImageCompare();
+    testJsonWriter();
+
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("every check passed\n");
+    return 0;
+}